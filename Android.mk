@@ -57,9 +57,10 @@ include $(PREBUILT_STATIC_LIBRARY)
 
 include $(CLEAR_VARS)
 LOCAL_MODULE := scriba-java
-LOCAL_SRC_FILES := company.c event.c org_scribacrm_libscriba_ScribaDB.c poc.c project.c scriba.c sqlite3.c sqlite_backend.c types.c serializer.cpp
+LOCAL_SRC_FILES := arena.c cache.c company.c compress.c event.c org_scribacrm_libscriba_ScribaDB.c poc.c project.c scriba.c snapshot_backend.cpp memory_backend.cpp log_backend.cpp sqlite3.c sqlite_backend.c types.c serializer.cpp
 LOCAL_CFLAGS := -std=c99
 LOCAL_CPPFLAGS := -std=c++11
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/layout $(LOCAL_PATH)/unicode
 LOCAL_STATIC_LIBRARIES := icu-i18n icu-io icu-le icu-lx icu-tu icu-uc icu-data
+LOCAL_LDLIBS := -ldl
 include $(BUILD_SHARED_LIBRARY)
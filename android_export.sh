@@ -45,7 +45,10 @@ FLATBUFFERS_INCLUDE_FILES=`ls $FLATBUFFERS_INCLUDE_DIR/*.h`
 LIBRARY_FRONTEND_FILES=`ls *.c *.cpp *.h`
 
 LIBRARY_BACKEND_DIR=$SOURCE_DIR/sqlite-backend
-LIBRARY_BACKEND_FILES=`ls $LIBRARY_BACKEND_DIR/*`
+SNAPSHOT_BACKEND_DIR=$SOURCE_DIR/snapshot-backend
+MEMORY_BACKEND_DIR=$SOURCE_DIR/memory-backend
+LOG_BACKEND_DIR=$SOURCE_DIR/log-backend
+LIBRARY_BACKEND_FILES=`ls $LIBRARY_BACKEND_DIR/* $SNAPSHOT_BACKEND_DIR/* $MEMORY_BACKEND_DIR/* $LOG_BACKEND_DIR/*`
 
 JAVA_BINDINGS_DIR=$SOURCE_DIR/bindings/java
 LIBRARY_JNI_FILES=`ls $JAVA_BINDINGS_DIR/*.c $JAVA_BINDINGS_DIR/*.h`
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "arena.h"
+#include "db_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+// default arena chunk size
+#define ARENA_DEFAULT_CHUNK_SIZE    65536
+// alignment of memory returned by the arena
+#define ARENA_ALIGN                 16
+
+struct ScribaArenaChunk
+{
+    struct ScribaArenaChunk *next;
+    size_t size;                        // usable size of the chunk
+    size_t used;                        // number of bytes already allocated
+};
+
+struct _scriba_arena
+{
+    struct ScribaArenaChunk *head;      // first chunk
+    struct ScribaArenaChunk *cur;       // chunk allocations are currently made from
+    size_t chunk_size;
+};
+
+// header preceding shared entity data structure
+struct ScribaSharedHeader
+{
+    long long refs;                     // number of references
+    long long type;                     // entity type, 8 bytes keep the structure aligned
+};
+
+// layout of entity data structures created by the library
+static enum ScribaEntityLayout entity_layout = SCRIBA_LAYOUT_SEPARATE;
+static scriba_arena_t *entity_arena = NULL;
+
+
+
+// allocate new arena chunk with at least size usable bytes
+static struct ScribaArenaChunk *arena_chunk_create(size_t size);
+// pointer to the first usable byte of the chunk
+static char *arena_chunk_data(struct ScribaArenaChunk *chunk);
+// round size up to arena alignment
+static size_t arena_align(size_t size);
+
+
+
+/* Arena handling routines */
+
+// create new arena
+scriba_arena_t *scriba_arena_create(size_t chunk_size)
+{
+    scriba_arena_t *arena = (scriba_arena_t *)scriba_malloc(sizeof (scriba_arena_t));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->chunk_size = (chunk_size == 0) ? ARENA_DEFAULT_CHUNK_SIZE : chunk_size;
+    arena->head = arena_chunk_create(arena->chunk_size);
+    if (arena->head == NULL)
+    {
+        scriba_free(arena);
+        return NULL;
+    }
+    arena->cur = arena->head;
+
+    return arena;
+}
+
+// allocate size bytes from the arena
+void *scriba_arena_alloc(scriba_arena_t *arena, size_t size)
+{
+    void *ret = NULL;
+
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    size = arena_align(size);
+
+    // skip chunks that are too small, they are reused after reset
+    while ((arena->cur->size - arena->cur->used) < size)
+    {
+        if (arena->cur->next == NULL)
+        {
+            size_t chunk_size = (size > arena->chunk_size) ? size : arena->chunk_size;
+            struct ScribaArenaChunk *chunk = arena_chunk_create(chunk_size);
+            if (chunk == NULL)
+            {
+                return NULL;
+            }
+            arena->cur->next = chunk;
+        }
+        arena->cur = arena->cur->next;
+    }
+
+    ret = arena_chunk_data(arena->cur) + arena->cur->used;
+    arena->cur->used += size;
+
+    return ret;
+}
+
+// release all memory allocated from the arena
+void scriba_arena_reset(scriba_arena_t *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    for (struct ScribaArenaChunk *chunk = arena->head; chunk != NULL; chunk = chunk->next)
+    {
+        chunk->used = 0;
+    }
+    arena->cur = arena->head;
+}
+
+// destroy the arena and free all its chunks
+void scriba_arena_destroy(scriba_arena_t *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    if (entity_arena == arena)
+    {
+        // don't let the library allocate entities from destroyed arena
+        entity_layout = SCRIBA_LAYOUT_SEPARATE;
+        entity_arena = NULL;
+    }
+
+    struct ScribaArenaChunk *chunk = arena->head;
+    while (chunk != NULL)
+    {
+        struct ScribaArenaChunk *next = chunk->next;
+        scriba_free(chunk);
+        chunk = next;
+    }
+
+    scriba_free(arena);
+}
+
+static struct ScribaArenaChunk *arena_chunk_create(size_t size)
+{
+    struct ScribaArenaChunk *chunk = NULL;
+
+    chunk = (struct ScribaArenaChunk *)scriba_malloc(arena_align(sizeof (struct ScribaArenaChunk)) + size);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+static char *arena_chunk_data(struct ScribaArenaChunk *chunk)
+{
+    return (char *)chunk + arena_align(sizeof (struct ScribaArenaChunk));
+}
+
+static size_t arena_align(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+}
+
+/* Entity layout handling routines */
+
+// select memory layout of entity data structures
+void scriba_setEntityLayout(enum ScribaEntityLayout layout, scriba_arena_t *arena)
+{
+    if (((layout == SCRIBA_LAYOUT_ARENA) && (arena == NULL)) || (layout == SCRIBA_LAYOUT_SHARED))
+    {
+        return;
+    }
+
+    entity_layout = layout;
+    entity_arena = (layout == SCRIBA_LAYOUT_ARENA) ? arena : NULL;
+}
+
+// allocate entity data structure according to the current layout
+void *scriba_entity_alloc(size_t struct_size, size_t str_size, char **str_buf,
+                          enum ScribaEntityLayout *layout)
+{
+    char *block = NULL;
+
+    switch (entity_layout)
+    {
+    case SCRIBA_LAYOUT_BLOCK:
+        block = (char *)scriba_malloc(struct_size + str_size);
+        break;
+    case SCRIBA_LAYOUT_ARENA:
+        block = (char *)scriba_arena_alloc(entity_arena, struct_size + str_size);
+        break;
+    default:
+        block = (char *)scriba_malloc(struct_size);
+        break;
+    }
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    memset(block, 0, struct_size);
+    *str_buf = (entity_layout == SCRIBA_LAYOUT_SEPARATE) ? NULL : block + struct_size;
+    *layout = entity_layout;
+
+    return block;
+}
+
+// copy string into entity string storage
+char *scriba_entity_strcpy(char **str_buf, const char *src)
+{
+    size_t size = strlen(src) + 1;
+    char *dest = NULL;
+
+    if (*str_buf == NULL)
+    {
+        // separate layout, each string has its own allocation
+        dest = (char *)scriba_malloc(size);
+        if (dest == NULL)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        dest = *str_buf;
+        *str_buf += size;
+    }
+
+    memcpy(dest, src, size);
+    return dest;
+}
+
+/* Shared entity handling routines */
+
+// allocate shared entity data structure holding one reference
+void *scriba_entity_alloc_shared(enum ScribaEntityType type, size_t struct_size, size_t str_size,
+                                 char **str_buf)
+{
+    struct ScribaSharedHeader *header = NULL;
+    char *block = (char *)scriba_malloc(sizeof (struct ScribaSharedHeader) + struct_size + str_size);
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    header = (struct ScribaSharedHeader *)block;
+    header->refs = 1;
+    header->type = type;
+    block += sizeof (struct ScribaSharedHeader);
+    memset(block, 0, struct_size);
+    *str_buf = block + struct_size;
+
+    return block;
+}
+
+// add reference to shared entity
+void scriba_retain(const void *entity)
+{
+    if (entity == NULL)
+    {
+        return;
+    }
+
+    struct ScribaSharedHeader *header = (struct ScribaSharedHeader *)((char *)entity -
+                                                                      sizeof (struct ScribaSharedHeader));
+    __sync_add_and_fetch(&(header->refs), 1);
+}
+
+// drop reference to shared entity, free it if it was the last one
+void scriba_release(const void *entity)
+{
+    if (entity == NULL)
+    {
+        return;
+    }
+
+    struct ScribaSharedHeader *header = (struct ScribaSharedHeader *)((char *)entity -
+                                                                      sizeof (struct ScribaSharedHeader));
+    if (__sync_sub_and_fetch(&(header->refs), 1) != 0)
+    {
+        return;
+    }
+
+    // strings share the block with the structure, only child lists are separate
+    if (header->type == SCRIBA_ENTITY_COMPANY)
+    {
+        const struct ScribaCompany *company = (const struct ScribaCompany *)entity;
+        scriba_list_delete(company->poc_list);
+        scriba_list_delete(company->proj_list);
+        scriba_list_delete(company->event_list);
+    }
+    scriba_free(header);
+}
@@ -61,6 +61,7 @@ public final class ScribaDB {
     public static class MergeStatus {
         public static final byte OK = 0;
         public static final byte CONFLICTS = 1;
+        public static final byte FAILED = 2;
     }
 
     // library initialization and cleanup
@@ -124,6 +125,9 @@ public final class ScribaDB {
                                           DataDescriptor[] people,
                                           DataDescriptor[] projects);
 
+    // serialize all entries in the database
+    public static native byte[] serializeAll();
+
     public static native byte deserialize(byte[] buf, byte mergeStrategy);
 
     // retrieve array of descriptors pointed to by nextId
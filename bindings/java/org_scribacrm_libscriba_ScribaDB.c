@@ -89,7 +89,7 @@ static long add_data_array_part(JNIEnv *env, scriba_list_t *data, scriba_list_t
     if (part_list.list == NULL)
     {
         // this will be the first element
-        part_list.list = (data_array_part *)malloc(sizeof (data_array_part));
+        part_list.list = (data_array_part *)scriba_malloc(sizeof (data_array_part));
         part_list.list_size = 1;
         new_part = &(part_list.list[0]);
         new_part->id = part_list.list_size - 1;
@@ -110,7 +110,7 @@ static long add_data_array_part(JNIEnv *env, scriba_list_t *data, scriba_list_t
         {
             // no, we have to increase the part list
             part_list.list_size++;
-            part_list.list = (data_array_part *)realloc(part_list.list,
+            part_list.list = (data_array_part *)scriba_realloc(part_list.list,
                                                         sizeof (data_array_part) * part_list.list_size);
             new_part = &(part_list.list[part_list.list_size - 1]);
             new_part->id = part_list.list_size - 1;
@@ -151,7 +151,7 @@ static data_array_part *get_data_array_part(JNIEnv *env, long id)
          * with the same id and same scriba_list_t pointers
          */
         data_array_part *list_part = &(part_list.list[id]);
-        part = (data_array_part *)malloc(sizeof (data_array_part));
+        part = (data_array_part *)scriba_malloc(sizeof (data_array_part));
         part->id = list_part->id;
         part->data = list_part->data;
         part->part = list_part->part;
@@ -176,7 +176,7 @@ static void remove_data_array_part(JNIEnv *env, long id)
         if (part_list.free_ids == NULL)
         {
             // allocate space for free ids array
-            part_list.free_ids = (long *)malloc(sizeof (long) * 10);
+            part_list.free_ids = (long *)scriba_malloc(sizeof (long) * 10);
             part_list.allocated_free_ids = 10;
             part_list.num_free_ids = 1;
             part_list.free_ids[0] = id;
@@ -187,7 +187,7 @@ static void remove_data_array_part(JNIEnv *env, long id)
             {
                 // increase free ids array
                 part_list.allocated_free_ids += 10;
-                part_list.free_ids = (long *)realloc(part_list.free_ids,
+                part_list.free_ids = (long *)scriba_realloc(part_list.free_ids,
                                                      part_list.allocated_free_ids);
             }
             part_list.num_free_ids++;
@@ -229,7 +229,7 @@ static char *java_string_to_utf8(JNIEnv *env, jclass this, jstring str)
     }
 
     arraySize = (*env)->GetArrayLength(env, byteArray);
-    result = (char *)malloc(arraySize + 1);
+    result = (char *)scriba_malloc(arraySize + 1);
     if (result == NULL)
     {
         goto error;
@@ -251,7 +251,7 @@ error:
     }
     if (result != NULL)
     {
-        free(result);
+        scriba_free(result);
     }
 
     return NULL;
@@ -345,7 +345,7 @@ static jobjectArray scriba_list_to_data_descr_array(JNIEnv *env, jclass this, sc
         goto exit;
     }
 
-    data_descriptors = (jobject *)malloc(num_elements * sizeof(jobject));
+    data_descriptors = (jobject *)scriba_malloc(num_elements * sizeof(jobject));
     if (data_descriptors == NULL)
     {
         goto exit;
@@ -398,7 +398,7 @@ static jobjectArray scriba_list_to_data_descr_array(JNIEnv *env, jclass this, sc
 exit:
     if (data_descriptors != NULL)
     {
-        free(data_descriptors);
+        scriba_free(data_descriptors);
     }
     return java_array;
 }
@@ -454,7 +454,7 @@ static scriba_list_t *data_descr_array_to_scriba_list(JNIEnv *env, jclass this,
             {
                 scriba_list_add(scriba_list, item->id, NULL);
             }
-            free(part);
+            scriba_free(part);
 
             (*env)->DeleteLocalRef(env, data_descr);
             break;
@@ -621,14 +621,14 @@ JNIEXPORT jint JNICALL Java_org_scribacrm_libscriba_ScribaDB_init(JNIEnv *env,
                 goto exit;
             }
 
-            (*cur_param) = (struct ScribaDBParamList *)malloc(sizeof (struct ScribaDBParamList));
+            (*cur_param) = (struct ScribaDBParamList *)scriba_malloc(sizeof (struct ScribaDBParamList));
             if ((*cur_param) == NULL)
             {
                 ret = SCRIBA_INIT_MAX_ERR + 1;
                 goto exit;
             }
             (*cur_param)->next = NULL;
-            (*cur_param)->param = (struct ScribaDBParam *)malloc(sizeof (struct ScribaDBParam));
+            (*cur_param)->param = (struct ScribaDBParam *)scriba_malloc(sizeof (struct ScribaDBParam));
             if ((*cur_param)->param == NULL)
             {
                 ret = SCRIBA_INIT_MAX_ERR + 1;
@@ -658,7 +658,7 @@ JNIEXPORT jint JNICALL Java_org_scribacrm_libscriba_ScribaDB_init(JNIEnv *env,
 exit:
     if (db.name != NULL)
     {
-        free(db.name);
+        scriba_free(db.name);
     }
     if (pl != NULL)
     {
@@ -672,18 +672,18 @@ exit:
             {
                 if (cur_param->param->key != NULL)
                 {
-                    free(cur_param->param->key);
+                    scriba_free(cur_param->param->key);
                 }
                 if (cur_param->param->value != NULL)
                 {
-                    free(cur_param->param->value);
+                    scriba_free(cur_param->param->value);
                 }
 
-                free(cur_param->param);
+                scriba_free(cur_param->param);
             }
 
             cur_param = cur_param->next;
-            free(to_delete);
+            scriba_free(to_delete);
         } while (cur_param != NULL);
     }
     return ret;
@@ -702,13 +702,13 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_cleanup(JNIEnv *env
                 scriba_list_delete(part->data);
             }
         }
-        free(part_list.list);
+        scriba_free(part_list.list);
     }
     part_list.list = NULL;
     part_list.list_size = 0;
     if (part_list.free_ids != NULL)
     {
-        free(part_list.free_ids);
+        scriba_free(part_list.free_ids);
     }
     part_list.free_ids = 0;
     part_list.num_free_ids = 0;
@@ -817,7 +817,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getCompanie
 
     if (name != NULL)
     {
-        free(name);
+        scriba_free(name);
     }
 
     scriba_list_delete(companies);
@@ -837,7 +837,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getCompanie
 
     if (jur_name != NULL)
     {
-        free(jur_name);
+        scriba_free(jur_name);
     }
 
     scriba_list_delete(companies);
@@ -857,7 +857,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getCompanie
 
     if (address != NULL)
     {
-        free(address);
+        scriba_free(address);
     }
 
     scriba_list_delete(companies);
@@ -885,27 +885,27 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_addCompany(JNIEnv *
 
     if (name != NULL)
     {
-        free(name);
+        scriba_free(name);
     }
     if (jur_name != NULL)
     {
-        free(jur_name);
+        scriba_free(jur_name);
     }
     if (address != NULL)
     {
-        free(address);
+        scriba_free(address);
     }
     if (phonenum != NULL)
     {
-        free(phonenum);
+        scriba_free(phonenum);
     }
     if (inn != NULL)
     {
-        free(inn);
+        scriba_free(inn);
     }
     if (email != NULL)
     {
-        free(email);
+        scriba_free(email);
     }
 }
 
@@ -923,7 +923,7 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_updateCompany(JNIEn
         return;
     }
 
-    company = (struct ScribaCompany *)malloc(sizeof (struct ScribaCompany));
+    company = (struct ScribaCompany *)scriba_malloc(sizeof (struct ScribaCompany));
     if (company == NULL)
     {
         goto exit;
@@ -1106,7 +1106,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getPOCByNam
 exit:
     if (native_name != NULL)
     {
-        free(native_name);
+        scriba_free(native_name);
     }
     scriba_list_delete(poc_list);
     return java_poc_list;
@@ -1137,7 +1137,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getPOCByPos
 
     if (native_position != NULL)
     {
-        free(native_position);
+        scriba_free(native_position);
     }
     scriba_list_delete(poc_list);
 
@@ -1154,7 +1154,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getPOCByEma
 
     if (native_email != NULL)
     {
-        free(native_email);
+        scriba_free(native_email);
     }
     scriba_list_delete(poc_list);
 
@@ -1188,31 +1188,31 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_addPOC(JNIEnv *env,
 
     if (native_firstname != NULL)
     {
-        free(native_firstname);
+        scriba_free(native_firstname);
     }
     if (native_secondname != NULL)
     {
-        free(native_secondname);
+        scriba_free(native_secondname);
     }
     if (native_lastname != NULL)
     {
-        free(native_lastname);
+        scriba_free(native_lastname);
     }
     if (native_mobilenum != NULL)
     {
-        free(native_mobilenum);
+        scriba_free(native_mobilenum);
     }
     if (native_phonenum != NULL)
     {
-        free(native_phonenum);
+        scriba_free(native_phonenum);
     }
     if (native_email != NULL)
     {
-        free(native_email);
+        scriba_free(native_email);
     }
     if (native_position != NULL)
     {
-        free(native_position);
+        scriba_free(native_position);
     }
 }
 
@@ -1231,7 +1231,7 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_updatePOC(JNIEnv *e
         return;
     }
 
-    poc = (struct ScribaPoc*)malloc(sizeof (struct ScribaPoc));
+    poc = (struct ScribaPoc*)scriba_malloc(sizeof (struct ScribaPoc));
     if (poc == NULL)
     {
         goto exit;
@@ -1426,7 +1426,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getProjects
 exit:
     if (native_title != NULL)
     {
-        free(native_title);
+        scriba_free(native_title);
     }
     scriba_list_delete(projects);
     return java_projects;
@@ -1531,11 +1531,11 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_addProject(JNIEnv *
 
     if (native_title != NULL)
     {
-        free(native_title);
+        scriba_free(native_title);
     }
     if (native_descr != NULL)
     {
-        free(native_descr);
+        scriba_free(native_descr);
     }
 }
 
@@ -1554,7 +1554,7 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_updateProject(JNIEn
         goto exit;
     }
 
-    project = (struct ScribaProject *)malloc(sizeof (struct ScribaProject));
+    project = (struct ScribaProject *)scriba_malloc(sizeof (struct ScribaProject));
     if (project == NULL)
     {
         goto exit;
@@ -1739,7 +1739,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_getEventsBy
 exit:
     if (native_descr != NULL)
     {
-        free(native_descr);
+        scriba_free(native_descr);
     }
     scriba_list_delete(events);
     return java_events;
@@ -1849,11 +1849,11 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_addEvent(JNIEnv *en
 
     if (native_descr != NULL)
     {
-        free(native_descr);
+        scriba_free(native_descr);
     }
     if (native_outcome != NULL)
     {
-        free(native_outcome);
+        scriba_free(native_outcome);
     }
 }
 
@@ -1874,7 +1874,7 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_updateEvent(JNIEnv
         goto exit;
     }
 
-    event = (struct ScribaEvent *)malloc(sizeof (struct ScribaEvent));
+    event = (struct ScribaEvent *)scriba_malloc(sizeof (struct ScribaEvent));
     if (event == NULL)
     {
         goto exit;
@@ -2029,7 +2029,37 @@ exit:
     }
     if (buf != NULL)
     {
-        free(buf);
+        scriba_free(buf);
+    }
+
+    return java_array;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_serializeAll(JNIEnv *env,
+                                                                                jclass this)
+{
+    void *buf = NULL;
+    unsigned long buflen = 0;
+    jbyteArray java_array = NULL;
+
+    buf = scriba_serializeAll(&buflen);
+    if (buf == NULL)
+    {
+        goto exit;
+    }
+
+    java_array = (*env)->NewByteArray(env, buflen);
+    if (java_array == NULL)
+    {
+        goto exit;
+    }
+
+    (*env)->SetByteArrayRegion(env, java_array, 0, buflen, (jbyte *)buf);
+
+exit:
+    if (buf != NULL)
+    {
+        scriba_free(buf);
     }
 
     return java_array;
@@ -2066,13 +2096,17 @@ JNIEXPORT jbyte JNICALL Java_org_scribacrm_libscriba_ScribaDB_deserialize(JNIEnv
                                        (unsigned long)buflen,
                                        native_strategy);
 
-    if (native_status == SCRIBA_MERGE_OK)
+    switch (native_status)
     {
+    case SCRIBA_MERGE_OK:
         status = 0;
-    }
-    else
-    {
+        break;
+    case SCRIBA_MERGE_CONFLICTS:
         status = 1;
+        break;
+    default:
+        status = 2;
+        break;
     }
 
 exit:
@@ -2099,7 +2133,7 @@ JNIEXPORT jobjectArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_next(JNIEnv
     // Array part is being transferred to Java, so remove it.
     // scriba_list_to_data_descr_array() may have already created new part
     remove_data_array_part(env, part->id);
-    free(part);
+    scriba_free(part);
 
     return array;
 }
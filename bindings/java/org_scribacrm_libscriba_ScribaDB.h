@@ -327,6 +327,14 @@ JNIEXPORT void JNICALL Java_org_scribacrm_libscriba_ScribaDB_removeEvent
 JNIEXPORT jbyteArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_serialize
   (JNIEnv *, jclass, jobjectArray, jobjectArray, jobjectArray, jobjectArray);
 
+/*
+ * Class:     org_scribacrm_libscriba_ScribaDB
+ * Method:    serializeAll
+ * Signature: ()[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_org_scribacrm_libscriba_ScribaDB_serializeAll
+  (JNIEnv *, jclass);
+
 /*
  * Class:     org_scribacrm_libscriba_ScribaDB
  * Method:    deserialize
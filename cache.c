@@ -0,0 +1,1186 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cache.h"
+#include "db_backend.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// minimal number of hash table buckets, should be a power of 2
+#define CACHE_MIN_BUCKETS   64
+// number of entity types
+#define CACHE_ENTITY_TYPES  4
+
+extern struct ScribaDBFuncTbl *fTbl;
+
+struct CacheEntry
+{
+    enum ScribaEntityType type;
+    scriba_id_t id;
+    void *entity;                       // shared entity, the cache holds one reference
+    size_t size;                        // memory used by the entry
+    struct CacheEntry *hash_next;       // next entry of the same hash table bucket
+    struct CacheEntry *prev;            // LRU list, the most recently used entry first
+    struct CacheEntry *next;
+};
+
+// cache state is shared by threads reading the database in parallel
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t cache_limit = 0;
+static struct CacheEntry **buckets = NULL;
+static size_t num_buckets = 0;
+static struct CacheEntry *lru_head = NULL;
+static struct CacheEntry *lru_tail = NULL;
+static size_t type_entries[CACHE_ENTITY_TYPES];
+// increased by every change, entities retrieved before a change are not cached
+static unsigned long long cache_ver = 0;
+static struct ScribaCacheStats cache_stats;
+
+// number of query cache hash table buckets, a power of 2; few distinct queries are
+// expected, so the table does not grow
+#define QUERY_BUCKETS       256
+
+struct QueryEntry
+{
+    struct ScribaQueryKey key;          // query key, string argument is a private copy
+    unsigned long long version;         // version of the queried table the result belongs to
+    scriba_list_t *result;
+    size_t size;                        // memory used by the entry
+    struct QueryEntry *hash_next;       // next entry of the same hash table bucket
+    struct QueryEntry *prev;            // LRU list, the most recently used entry first
+    struct QueryEntry *next;
+};
+
+// query cache state is protected by cache lock as well
+static size_t query_limit = 0;
+static struct QueryEntry *query_buckets[QUERY_BUCKETS];
+static struct QueryEntry *query_head = NULL;
+static struct QueryEntry *query_tail = NULL;
+// increased by every change of the table, older results are stale
+static unsigned long long table_ver[CACHE_ENTITY_TYPES];
+static struct ScribaCacheStats query_stats;
+
+
+
+static size_t cache_hash(enum ScribaEntityType type, const scriba_id_t *id);
+static struct CacheEntry *cache_find(enum ScribaEntityType type, const scriba_id_t *id);
+static void cache_insert(struct CacheEntry *entry);
+// remove entry from the cache and free it
+static void cache_drop(struct CacheEntry *entry);
+static void cache_drop_all();
+// evict least recently used entries until the cache fits its size
+static void cache_evict();
+static void invalidate_entity(enum ScribaEntityType type, const scriba_id_t *id);
+static void invalidate_type(enum ScribaEntityType type);
+// double the number of hash table buckets
+static void cache_grow();
+static void lru_unlink(struct CacheEntry *entry);
+static void lru_push_front(struct CacheEntry *entry);
+
+static size_t query_hash(const struct ScribaQueryKey *key);
+static int query_key_equal(const struct ScribaQueryKey *key1, const struct ScribaQueryKey *key2);
+static struct QueryEntry *query_find(const struct ScribaQueryKey *key);
+// remove entry from the query cache and free it
+static void query_drop(struct QueryEntry *entry);
+static void query_drop_all();
+static void query_evict();
+static void query_unlink(struct QueryEntry *entry);
+static void query_push_front(struct QueryEntry *entry);
+
+// entity copies; shared copies have SCRIBA_LAYOUT_SHARED layout, other copies
+// honour the current entity layout; unlike scriba_copy*() functions, empty strings
+// and company child lists are kept
+static void *copy_entity(enum ScribaEntityType type, const void *entity, int shared);
+static struct ScribaCompany *copy_company(const struct ScribaCompany *company, int shared);
+static struct ScribaPoc *copy_poc(const struct ScribaPoc *poc, int shared);
+static struct ScribaProject *copy_project(const struct ScribaProject *project, int shared);
+static struct ScribaEvent *copy_event(const struct ScribaEvent *event, int shared);
+static void *alloc_entity(enum ScribaEntityType type, size_t struct_size, size_t str_size,
+                          char **str_buf, char *layout, int shared);
+static char *copy_str(char **str_buf, const char *str);
+static scriba_list_t *copy_list(const scriba_list_t *list);
+static void free_entity(enum ScribaEntityType type, void *entity);
+static char entity_layout(enum ScribaEntityType type, const void *entity);
+static size_t entity_size(enum ScribaEntityType type, const void *entity);
+static size_t str_size(const char *str);
+static size_t list_size(const scriba_list_t *list);
+static const scriba_id_t *entity_id(enum ScribaEntityType type, const void *entity);
+static const scriba_id_t *entity_company_id(enum ScribaEntityType type, const void *entity);
+
+
+
+/* Public cache interface */
+
+// set entity cache size in bytes
+void scriba_setCacheSize(size_t size)
+{
+    pthread_mutex_lock(&cache_lock);
+
+    if (cache_limit == 0)
+    {
+        memset(&cache_stats, 0, sizeof (cache_stats));
+    }
+    cache_limit = size;
+    if (size == 0)
+    {
+        cache_drop_all();
+        scriba_free(buckets);
+        buckets = NULL;
+        num_buckets = 0;
+    }
+    else
+    {
+        cache_evict();
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// drop all cached entities and query results
+void scriba_clearCache()
+{
+    pthread_mutex_lock(&cache_lock);
+    cache_drop_all();
+    cache_ver++;
+    query_drop_all();
+    for (int i = 0; i < CACHE_ENTITY_TYPES; i++)
+    {
+        table_ver[i]++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// get cache statistics
+void scriba_getCacheStats(struct ScribaCacheStats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    memcpy(stats, &cache_stats, sizeof (cache_stats));
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// set query result cache size in bytes
+void scriba_setQueryCacheSize(size_t size)
+{
+    pthread_mutex_lock(&cache_lock);
+
+    if (query_limit == 0)
+    {
+        memset(&query_stats, 0, sizeof (query_stats));
+    }
+    query_limit = size;
+    if (size == 0)
+    {
+        query_drop_all();
+    }
+    else
+    {
+        query_evict();
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// get query result cache statistics
+void scriba_getQueryCacheStats(struct ScribaCacheStats *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    memcpy(stats, &query_stats, sizeof (query_stats));
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* Cache interface used by the library front-end */
+
+// check whether entity cache is enabled
+int scriba_cache_enabled()
+{
+    pthread_mutex_lock(&cache_lock);
+    int enabled = (cache_limit != 0);
+    pthread_mutex_unlock(&cache_lock);
+
+    return enabled;
+}
+
+// version of cache contents
+unsigned long long scriba_cache_version()
+{
+    pthread_mutex_lock(&cache_lock);
+    unsigned long long version = cache_ver;
+    pthread_mutex_unlock(&cache_lock);
+
+    return version;
+}
+
+// get copy of cached entity
+void *scriba_cache_get(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    void *ret = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+
+    if (cache_limit != 0)
+    {
+        struct CacheEntry *entry = cache_find(type, id);
+        if (entry != NULL)
+        {
+            lru_unlink(entry);
+            lru_push_front(entry);
+            ret = copy_entity(type, entry->entity, 0);
+        }
+        if (ret != NULL)
+        {
+            cache_stats.hits++;
+        }
+        else
+        {
+            cache_stats.misses++;
+        }
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+// get cached shared entity
+const void *scriba_cache_get_shared(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    const void *ret = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+
+    if (cache_limit != 0)
+    {
+        struct CacheEntry *entry = cache_find(type, id);
+        if (entry != NULL)
+        {
+            lru_unlink(entry);
+            lru_push_front(entry);
+            scriba_retain(entry->entity);
+            ret = entry->entity;
+            cache_stats.hits++;
+        }
+        else
+        {
+            cache_stats.misses++;
+        }
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+// create shared copy of entity
+const void *scriba_entity_share(enum ScribaEntityType type, const void *entity)
+{
+    if (entity == NULL)
+    {
+        return NULL;
+    }
+    return copy_entity(type, entity, 1);
+}
+
+// put entity retrieved from the database into the cache
+void scriba_cache_put(enum ScribaEntityType type, const void *entity, unsigned long long version)
+{
+    struct CacheEntry *entry = NULL;
+
+    if (entity == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+
+    // entity could have been changed after it has been retrieved
+    if ((cache_limit == 0) || (version != cache_ver) ||
+        (cache_find(type, entity_id(type, entity)) != NULL))
+    {
+        goto out;
+    }
+    size_t size = sizeof (struct CacheEntry) + entity_size(type, entity);
+    if (size > cache_limit)
+    {
+        goto out;
+    }
+    if (cache_stats.entries >= num_buckets)
+    {
+        cache_grow();
+    }
+    if (num_buckets == 0)
+    {
+        goto out;
+    }
+
+    entry = (struct CacheEntry *)scriba_malloc(sizeof (struct CacheEntry));
+    if (entry == NULL)
+    {
+        goto out;
+    }
+    memset(entry, 0, sizeof (struct CacheEntry));
+    // shared entity is cached as it is, anything else is copied
+    if (entity_layout(type, entity) == SCRIBA_LAYOUT_SHARED)
+    {
+        scriba_retain(entity);
+        entry->entity = (void *)entity;
+    }
+    else
+    {
+        entry->entity = copy_entity(type, entity, 1);
+    }
+    if (entry->entity == NULL)
+    {
+        scriba_free(entry);
+        goto out;
+    }
+    entry->type = type;
+    scriba_id_copy(&(entry->id), entity_id(type, entity));
+    entry->size = size;
+    cache_insert(entry);
+    cache_evict();
+
+out:
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// drop cached entity after it has been changed
+void scriba_cache_invalidate(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    pthread_mutex_lock(&cache_lock);
+    table_ver[type]++;
+    invalidate_entity(type, id);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// drop all cached entities of the given type
+void scriba_cache_invalidate_all(enum ScribaEntityType type)
+{
+    pthread_mutex_lock(&cache_lock);
+    table_ver[type]++;
+    invalidate_type(type);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// drop cached company after its child list has been changed
+void scriba_cache_invalidate_owner(const scriba_id_t *company_id)
+{
+    pthread_mutex_lock(&cache_lock);
+    invalidate_entity(SCRIBA_ENTITY_COMPANY, company_id);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// drop all cached companies after bulk changes of their child lists
+void scriba_cache_invalidate_owners()
+{
+    pthread_mutex_lock(&cache_lock);
+    invalidate_type(SCRIBA_ENTITY_COMPANY);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// find company whose child list may include the given entity
+int scriba_cache_owner(enum ScribaEntityType type, const scriba_id_t *id, scriba_id_t *company_id)
+{
+    void *entity = NULL;
+    int found = 0;
+
+    pthread_mutex_lock(&cache_lock);
+
+    // nothing to look for if no companies are cached
+    if ((type_entries[SCRIBA_ENTITY_COMPANY] == 0) || (type == SCRIBA_ENTITY_COMPANY))
+    {
+        pthread_mutex_unlock(&cache_lock);
+        return 0;
+    }
+    struct CacheEntry *entry = cache_find(type, id);
+    if (entry != NULL)
+    {
+        scriba_id_copy(company_id, entity_company_id(type, entry->entity));
+        found = 1;
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+    if (found)
+    {
+        return 1;
+    }
+
+    // entity is not cached, ask the database
+    switch (type)
+    {
+    case SCRIBA_ENTITY_POC:
+        entity = fTbl->getPOC(*id);
+        break;
+    case SCRIBA_ENTITY_PROJECT:
+        entity = fTbl->getProject(*id);
+        break;
+    case SCRIBA_ENTITY_EVENT:
+        entity = fTbl->getEvent(*id);
+        break;
+    default:
+        break;
+    }
+    if (entity != NULL)
+    {
+        scriba_id_copy(company_id, entity_company_id(type, entity));
+        free_entity(type, entity);
+        found = 1;
+    }
+
+    return found;
+}
+
+// prepare key of list query returning entities of the given type
+void scriba_query_key_init(struct ScribaQueryKey *key, enum ScribaEntityType type,
+                           enum ScribaQuery query)
+{
+    memset(key, 0, sizeof (struct ScribaQueryKey));
+    key->type = type;
+    key->query = query;
+}
+
+// get copy of cached query result
+scriba_list_t *scriba_query_cache_get(const struct ScribaQueryKey *key, unsigned long long *version)
+{
+    scriba_list_t *ret = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+
+    *version = table_ver[key->type];
+    if (query_limit != 0)
+    {
+        struct QueryEntry *entry = query_find(key);
+        // results retrieved before the last change of the table are dropped lazily
+        if ((entry != NULL) && (entry->version != *version))
+        {
+            query_drop(entry);
+            query_stats.invalidations++;
+            entry = NULL;
+        }
+        if (entry != NULL)
+        {
+            query_unlink(entry);
+            query_push_front(entry);
+            ret = copy_list(entry->result);
+        }
+        if (ret != NULL)
+        {
+            query_stats.hits++;
+        }
+        else
+        {
+            query_stats.misses++;
+        }
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+// put query result retrieved from the database into the cache
+void scriba_query_cache_put(const struct ScribaQueryKey *key, const scriba_list_t *result,
+                            unsigned long long version)
+{
+    struct QueryEntry *entry = NULL;
+
+    if (result == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+
+    // the table could have been changed after the query
+    if ((query_limit == 0) || (version != table_ver[key->type]))
+    {
+        goto out;
+    }
+    size_t size = sizeof (struct QueryEntry) + str_size(key->str) + list_size(result);
+    if (size > query_limit)
+    {
+        goto out;
+    }
+    entry = query_find(key);
+    if (entry != NULL)
+    {
+        query_drop(entry);
+    }
+
+    entry = (struct QueryEntry *)scriba_malloc(sizeof (struct QueryEntry));
+    if (entry == NULL)
+    {
+        goto out;
+    }
+    memset(entry, 0, sizeof (struct QueryEntry));
+    memcpy(&(entry->key), key, sizeof (struct ScribaQueryKey));
+    entry->key.str = NULL;
+    if (key->str != NULL)
+    {
+        char *str = (char *)scriba_malloc(str_size(key->str));
+        if (str == NULL)
+        {
+            scriba_free(entry);
+            goto out;
+        }
+        strcpy(str, key->str);
+        entry->key.str = str;
+    }
+    entry->result = copy_list(result);
+    entry->version = version;
+    entry->size = size;
+
+    size_t bucket = query_hash(key);
+    entry->hash_next = query_buckets[bucket];
+    query_buckets[bucket] = entry;
+    query_push_front(entry);
+    query_stats.entries++;
+    query_stats.size += size;
+    query_evict();
+
+out:
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* Cache internals, called with cache lock held */
+
+static size_t cache_hash(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    unsigned long long hash = (id->_high * 0x9E3779B97F4A7C15ULL) ^ id->_low ^ (unsigned long long)type;
+
+    hash ^= hash >> 29;
+    return (size_t)hash & (num_buckets - 1);
+}
+
+static struct CacheEntry *cache_find(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    if (num_buckets == 0)
+    {
+        return NULL;
+    }
+
+    for (struct CacheEntry *entry = buckets[cache_hash(type, id)]; entry != NULL;
+         entry = entry->hash_next)
+    {
+        if ((entry->type == type) && scriba_id_compare(&(entry->id), id))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_insert(struct CacheEntry *entry)
+{
+    size_t bucket = cache_hash(entry->type, &(entry->id));
+
+    entry->hash_next = buckets[bucket];
+    buckets[bucket] = entry;
+    lru_push_front(entry);
+    type_entries[entry->type]++;
+    cache_stats.entries++;
+    cache_stats.size += entry->size;
+}
+
+static void cache_drop(struct CacheEntry *entry)
+{
+    struct CacheEntry **link = &(buckets[cache_hash(entry->type, &(entry->id))]);
+
+    while (*link != entry)
+    {
+        link = &((*link)->hash_next);
+    }
+    *link = entry->hash_next;
+
+    lru_unlink(entry);
+    type_entries[entry->type]--;
+    cache_stats.entries--;
+    cache_stats.size -= entry->size;
+
+    free_entity(entry->type, entry->entity);
+    scriba_free(entry);
+}
+
+static void cache_drop_all()
+{
+    while (lru_head != NULL)
+    {
+        cache_drop(lru_head);
+    }
+}
+
+static void cache_evict()
+{
+    while ((cache_stats.size > cache_limit) && (lru_tail != NULL))
+    {
+        cache_drop(lru_tail);
+        cache_stats.evictions++;
+    }
+}
+
+static void invalidate_entity(enum ScribaEntityType type, const scriba_id_t *id)
+{
+    cache_ver++;
+    struct CacheEntry *entry = (cache_limit != 0) ? cache_find(type, id) : NULL;
+    if (entry != NULL)
+    {
+        cache_drop(entry);
+        cache_stats.invalidations++;
+    }
+}
+
+static void invalidate_type(enum ScribaEntityType type)
+{
+    cache_ver++;
+    struct CacheEntry *entry = lru_head;
+    while (entry != NULL)
+    {
+        struct CacheEntry *next = entry->next;
+        if (entry->type == type)
+        {
+            cache_drop(entry);
+            cache_stats.invalidations++;
+        }
+        entry = next;
+    }
+}
+
+static void cache_grow()
+{
+    size_t new_num = (num_buckets == 0) ? CACHE_MIN_BUCKETS : num_buckets * 2;
+    struct CacheEntry **new_buckets = (struct CacheEntry **)scriba_malloc(new_num * sizeof (struct CacheEntry *));
+
+    if (new_buckets == NULL)
+    {
+        // keep using the current table
+        return;
+    }
+    memset(new_buckets, 0, new_num * sizeof (struct CacheEntry *));
+
+    struct CacheEntry **old_buckets = buckets;
+    size_t old_num = num_buckets;
+    buckets = new_buckets;
+    num_buckets = new_num;
+    for (size_t i = 0; i < old_num; i++)
+    {
+        struct CacheEntry *entry = old_buckets[i];
+        while (entry != NULL)
+        {
+            struct CacheEntry *next = entry->hash_next;
+            size_t bucket = cache_hash(entry->type, &(entry->id));
+            entry->hash_next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    scriba_free(old_buckets);
+}
+
+static void lru_unlink(struct CacheEntry *entry)
+{
+    if (entry->prev != NULL)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        lru_head = entry->next;
+    }
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        lru_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void lru_push_front(struct CacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = lru_head;
+    if (lru_head != NULL)
+    {
+        lru_head->prev = entry;
+    }
+    else
+    {
+        lru_tail = entry;
+    }
+    lru_head = entry;
+}
+
+static size_t query_hash(const struct ScribaQueryKey *key)
+{
+    // FNV-1a over key fields
+    unsigned long long hash = 14695981039346656037ULL;
+    unsigned long long values[4 + QUERY_KEY_ARGS];
+
+    values[0] = (unsigned long long)key->type;
+    values[1] = (unsigned long long)key->query;
+    values[2] = key->id._high;
+    values[3] = key->id._low;
+    for (int i = 0; i < QUERY_KEY_ARGS; i++)
+    {
+        values[4 + i] = (unsigned long long)key->args[i];
+    }
+    for (size_t i = 0; i < sizeof (values) / sizeof (values[0]); i++)
+    {
+        hash = (hash ^ values[i]) * 1099511628211ULL;
+    }
+    for (const char *c = key->str; (c != NULL) && (*c != '\0'); c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+
+    hash ^= hash >> 29;
+    return (size_t)hash & (QUERY_BUCKETS - 1);
+}
+
+static int query_key_equal(const struct ScribaQueryKey *key1, const struct ScribaQueryKey *key2)
+{
+    if ((key1->type != key2->type) || (key1->query != key2->query) ||
+        !scriba_id_compare(&(key1->id), &(key2->id)) ||
+        (memcmp(key1->args, key2->args, sizeof (key1->args)) != 0))
+    {
+        return 0;
+    }
+    if ((key1->str == NULL) || (key2->str == NULL))
+    {
+        return (key1->str == key2->str);
+    }
+    return (strcmp(key1->str, key2->str) == 0);
+}
+
+static struct QueryEntry *query_find(const struct ScribaQueryKey *key)
+{
+    for (struct QueryEntry *entry = query_buckets[query_hash(key)]; entry != NULL;
+         entry = entry->hash_next)
+    {
+        if (query_key_equal(&(entry->key), key))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void query_drop(struct QueryEntry *entry)
+{
+    struct QueryEntry **link = &(query_buckets[query_hash(&(entry->key))]);
+
+    while (*link != entry)
+    {
+        link = &((*link)->hash_next);
+    }
+    *link = entry->hash_next;
+
+    query_unlink(entry);
+    query_stats.entries--;
+    query_stats.size -= entry->size;
+
+    scriba_list_delete(entry->result);
+    if (entry->key.str != NULL)
+    {
+        scriba_free((char *)entry->key.str);
+    }
+    scriba_free(entry);
+}
+
+static void query_drop_all()
+{
+    while (query_head != NULL)
+    {
+        query_drop(query_head);
+    }
+}
+
+static void query_evict()
+{
+    while ((query_stats.size > query_limit) && (query_tail != NULL))
+    {
+        query_drop(query_tail);
+        query_stats.evictions++;
+    }
+}
+
+static void query_unlink(struct QueryEntry *entry)
+{
+    if (entry->prev != NULL)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        query_head = entry->next;
+    }
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry->prev;
+    }
+    else
+    {
+        query_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void query_push_front(struct QueryEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = query_head;
+    if (query_head != NULL)
+    {
+        query_head->prev = entry;
+    }
+    else
+    {
+        query_tail = entry;
+    }
+    query_head = entry;
+}
+
+/* Entity handling routines */
+
+static void *copy_entity(enum ScribaEntityType type, const void *entity, int shared)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        return copy_company((const struct ScribaCompany *)entity, shared);
+    case SCRIBA_ENTITY_POC:
+        return copy_poc((const struct ScribaPoc *)entity, shared);
+    case SCRIBA_ENTITY_PROJECT:
+        return copy_project((const struct ScribaProject *)entity, shared);
+    case SCRIBA_ENTITY_EVENT:
+        return copy_event((const struct ScribaEvent *)entity, shared);
+    }
+    return NULL;
+}
+
+static struct ScribaCompany *copy_company(const struct ScribaCompany *company, int shared)
+{
+    char *str_buf = NULL;
+    char layout = 0;
+    size_t size = str_size(company->name) + str_size(company->jur_name) +
+                  str_size(company->address) + str_size(company->inn) +
+                  str_size(company->phonenum) + str_size(company->email);
+    struct ScribaCompany *ret = (struct ScribaCompany *)alloc_entity(SCRIBA_ENTITY_COMPANY, sizeof (struct ScribaCompany),
+                                                                     size, &str_buf, &layout, shared);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+
+    ret->layout = layout;
+    scriba_id_copy(&(ret->id), &(company->id));
+    ret->name = copy_str(&str_buf, company->name);
+    ret->jur_name = copy_str(&str_buf, company->jur_name);
+    ret->address = copy_str(&str_buf, company->address);
+    ret->inn = copy_str(&str_buf, company->inn);
+    ret->phonenum = copy_str(&str_buf, company->phonenum);
+    ret->email = copy_str(&str_buf, company->email);
+    ret->poc_list = copy_list(company->poc_list);
+    ret->proj_list = copy_list(company->proj_list);
+    ret->event_list = copy_list(company->event_list);
+
+    return ret;
+}
+
+static struct ScribaPoc *copy_poc(const struct ScribaPoc *poc, int shared)
+{
+    char *str_buf = NULL;
+    char layout = 0;
+    size_t size = str_size(poc->firstname) + str_size(poc->secondname) +
+                  str_size(poc->lastname) + str_size(poc->mobilenum) +
+                  str_size(poc->phonenum) + str_size(poc->email) + str_size(poc->position);
+    struct ScribaPoc *ret = (struct ScribaPoc *)alloc_entity(SCRIBA_ENTITY_POC, sizeof (struct ScribaPoc),
+                                                             size, &str_buf, &layout, shared);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+
+    ret->layout = layout;
+    scriba_id_copy(&(ret->id), &(poc->id));
+    ret->firstname = copy_str(&str_buf, poc->firstname);
+    ret->secondname = copy_str(&str_buf, poc->secondname);
+    ret->lastname = copy_str(&str_buf, poc->lastname);
+    ret->mobilenum = copy_str(&str_buf, poc->mobilenum);
+    ret->phonenum = copy_str(&str_buf, poc->phonenum);
+    ret->email = copy_str(&str_buf, poc->email);
+    ret->position = copy_str(&str_buf, poc->position);
+    scriba_id_copy(&(ret->company_id), &(poc->company_id));
+
+    return ret;
+}
+
+static struct ScribaProject *copy_project(const struct ScribaProject *project, int shared)
+{
+    char *str_buf = NULL;
+    char layout = 0;
+    size_t size = str_size(project->title) + str_size(project->descr);
+    struct ScribaProject *ret = (struct ScribaProject *)alloc_entity(SCRIBA_ENTITY_PROJECT, sizeof (struct ScribaProject),
+                                                                     size, &str_buf, &layout, shared);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+
+    ret->layout = layout;
+    scriba_id_copy(&(ret->id), &(project->id));
+    ret->title = copy_str(&str_buf, project->title);
+    ret->descr = copy_str(&str_buf, project->descr);
+    scriba_id_copy(&(ret->company_id), &(project->company_id));
+    ret->state = project->state;
+    ret->currency = project->currency;
+    ret->cost = project->cost;
+    ret->start_time = project->start_time;
+    ret->mod_time = project->mod_time;
+
+    return ret;
+}
+
+static struct ScribaEvent *copy_event(const struct ScribaEvent *event, int shared)
+{
+    char *str_buf = NULL;
+    char layout = 0;
+    size_t size = str_size(event->descr) + str_size(event->outcome);
+    struct ScribaEvent *ret = (struct ScribaEvent *)alloc_entity(SCRIBA_ENTITY_EVENT, sizeof (struct ScribaEvent),
+                                                                 size, &str_buf, &layout, shared);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+
+    ret->layout = layout;
+    scriba_id_copy(&(ret->id), &(event->id));
+    ret->descr = copy_str(&str_buf, event->descr);
+    scriba_id_copy(&(ret->company_id), &(event->company_id));
+    scriba_id_copy(&(ret->poc_id), &(event->poc_id));
+    scriba_id_copy(&(ret->project_id), &(event->project_id));
+    ret->type = event->type;
+    ret->outcome = copy_str(&str_buf, event->outcome);
+    ret->timestamp = event->timestamp;
+    ret->state = event->state;
+
+    return ret;
+}
+
+static void *alloc_entity(enum ScribaEntityType type, size_t struct_size, size_t str_size,
+                          char **str_buf, char *layout, int shared)
+{
+    enum ScribaEntityLayout new_layout = SCRIBA_LAYOUT_SHARED;
+    void *ret = NULL;
+
+    if (shared)
+    {
+        ret = scriba_entity_alloc_shared(type, struct_size, str_size, str_buf);
+    }
+    else
+    {
+        ret = scriba_entity_alloc(struct_size, str_size, str_buf, &new_layout);
+    }
+
+    *layout = (char)new_layout;
+    return ret;
+}
+
+static char *copy_str(char **str_buf, const char *str)
+{
+    return (str != NULL) ? scriba_entity_strcpy(str_buf, str) : NULL;
+}
+
+static scriba_list_t *copy_list(const scriba_list_t *list)
+{
+    scriba_list_t *ret = NULL;
+    scriba_list_t *tail = NULL;
+
+    if (list == NULL)
+    {
+        return NULL;
+    }
+
+    ret = scriba_list_init();
+    if (list->init == 0)
+    {
+        return ret;
+    }
+
+    // items are appended to the tail directly, scriba_list_add() would
+    // walk the whole list for each item
+    for (const scriba_list_t *item = list; item != NULL; item = item->next)
+    {
+        scriba_list_t *new_item = (tail == NULL) ? ret : (scriba_list_t *)scriba_malloc(sizeof (scriba_list_t));
+        if (new_item == NULL)
+        {
+            break;
+        }
+        memset(new_item, 0, sizeof (scriba_list_t));
+        scriba_id_copy(&(new_item->id), &(item->id));
+        if (item->text != NULL)
+        {
+            size_t size = strlen(item->text) + 1;
+            new_item->text = (char *)scriba_malloc(size);
+            if (new_item->text != NULL)
+            {
+                memcpy(new_item->text, item->text, size);
+            }
+        }
+        new_item->init = 1;
+        if (tail != NULL)
+        {
+            tail->next = new_item;
+        }
+        tail = new_item;
+    }
+
+    return ret;
+}
+
+static void free_entity(enum ScribaEntityType type, void *entity)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        scriba_freeCompanyData((struct ScribaCompany *)entity);
+        break;
+    case SCRIBA_ENTITY_POC:
+        scriba_freePOCData((struct ScribaPoc *)entity);
+        break;
+    case SCRIBA_ENTITY_PROJECT:
+        scriba_freeProjectData((struct ScribaProject *)entity);
+        break;
+    case SCRIBA_ENTITY_EVENT:
+        scriba_freeEventData((struct ScribaEvent *)entity);
+        break;
+    }
+}
+
+static char entity_layout(enum ScribaEntityType type, const void *entity)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        return ((const struct ScribaCompany *)entity)->layout;
+    case SCRIBA_ENTITY_POC:
+        return ((const struct ScribaPoc *)entity)->layout;
+    case SCRIBA_ENTITY_PROJECT:
+        return ((const struct ScribaProject *)entity)->layout;
+    case SCRIBA_ENTITY_EVENT:
+        return ((const struct ScribaEvent *)entity)->layout;
+    }
+    return SCRIBA_LAYOUT_SEPARATE;
+}
+
+static size_t entity_size(enum ScribaEntityType type, const void *entity)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+    {
+        const struct ScribaCompany *company = (const struct ScribaCompany *)entity;
+        return sizeof (struct ScribaCompany) + str_size(company->name) +
+               str_size(company->jur_name) + str_size(company->address) +
+               str_size(company->inn) + str_size(company->phonenum) +
+               str_size(company->email) + list_size(company->poc_list) +
+               list_size(company->proj_list) + list_size(company->event_list);
+    }
+    case SCRIBA_ENTITY_POC:
+    {
+        const struct ScribaPoc *poc = (const struct ScribaPoc *)entity;
+        return sizeof (struct ScribaPoc) + str_size(poc->firstname) +
+               str_size(poc->secondname) + str_size(poc->lastname) +
+               str_size(poc->mobilenum) + str_size(poc->phonenum) +
+               str_size(poc->email) + str_size(poc->position);
+    }
+    case SCRIBA_ENTITY_PROJECT:
+    {
+        const struct ScribaProject *project = (const struct ScribaProject *)entity;
+        return sizeof (struct ScribaProject) + str_size(project->title) + str_size(project->descr);
+    }
+    case SCRIBA_ENTITY_EVENT:
+    {
+        const struct ScribaEvent *event = (const struct ScribaEvent *)entity;
+        return sizeof (struct ScribaEvent) + str_size(event->descr) + str_size(event->outcome);
+    }
+    }
+    return 0;
+}
+
+static size_t str_size(const char *str)
+{
+    return (str != NULL) ? strlen(str) + 1 : 0;
+}
+
+static size_t list_size(const scriba_list_t *list)
+{
+    size_t size = 0;
+
+    for (const scriba_list_t *item = list; item != NULL; item = item->next)
+    {
+        size += sizeof (scriba_list_t) + str_size(item->text);
+    }
+    return size;
+}
+
+static const scriba_id_t *entity_id(enum ScribaEntityType type, const void *entity)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        return &(((const struct ScribaCompany *)entity)->id);
+    case SCRIBA_ENTITY_POC:
+        return &(((const struct ScribaPoc *)entity)->id);
+    case SCRIBA_ENTITY_PROJECT:
+        return &(((const struct ScribaProject *)entity)->id);
+    case SCRIBA_ENTITY_EVENT:
+        return &(((const struct ScribaEvent *)entity)->id);
+    }
+    return NULL;
+}
+
+static const scriba_id_t *entity_company_id(enum ScribaEntityType type, const void *entity)
+{
+    switch (type)
+    {
+    case SCRIBA_ENTITY_POC:
+        return &(((const struct ScribaPoc *)entity)->company_id);
+    case SCRIBA_ENTITY_PROJECT:
+        return &(((const struct ScribaProject *)entity)->company_id);
+    case SCRIBA_ENTITY_EVENT:
+        return &(((const struct ScribaEvent *)entity)->company_id);
+    default:
+        break;
+    }
+    return &(((const struct ScribaCompany *)entity)->id);
+}
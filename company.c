@@ -25,34 +25,186 @@
 
 extern struct ScribaDBFuncTbl *fTbl;
 
+// retrieve companies from the database, in one batch if backend supports it
+static size_t fetch_companies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies);
+static int upsert_company(const struct ScribaCompany *company, int overwrite);
+
 // get company info by company id
 struct ScribaCompany *scriba_getCompany(scriba_id_t id)
 {
-    return (fTbl->getCompany(id));
+    unsigned long long version = scriba_cache_version();
+    struct ScribaCompany *company = (struct ScribaCompany *)scriba_cache_get(SCRIBA_ENTITY_COMPANY, &id);
+
+    if (company == NULL)
+    {
+        company = fTbl->getCompany(id);
+        scriba_cache_put(SCRIBA_ENTITY_COMPANY, company, version);
+    }
+    return company;
+}
+
+// get shared company info by company id
+const struct ScribaCompany *scriba_getSharedCompany(scriba_id_t id)
+{
+    unsigned long long version = scriba_cache_version();
+    const struct ScribaCompany *company = (const struct ScribaCompany *)scriba_cache_get_shared(SCRIBA_ENTITY_COMPANY, &id);
+
+    if (company == NULL)
+    {
+        // the entity is shared once, the cache and the caller hold a reference each
+        struct ScribaCompany *fetched = fTbl->getCompany(id);
+        company = (const struct ScribaCompany *)scriba_entity_share(SCRIBA_ENTITY_COMPANY, fetched);
+        scriba_freeCompanyData(fetched);
+        scriba_cache_put(SCRIBA_ENTITY_COMPANY, company, version);
+    }
+    return company;
+}
+
+// get info of several companies by their ids
+size_t scriba_getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies)
+{
+    unsigned long long version = scriba_cache_version();
+    scriba_id_t *missing_ids = NULL;
+    struct ScribaCompany **missing = NULL;
+    size_t num_missing = 0;
+    size_t found = 0;
+
+    if ((ids == NULL) || (companies == NULL))
+    {
+        return 0;
+    }
+    if ((n == 0) || !scriba_cache_enabled())
+    {
+        return fetch_companies(ids, n, companies);
+    }
+
+    // take cached companies, retrieve the rest from the database at once
+    missing_ids = (scriba_id_t *)scriba_malloc(n * sizeof (scriba_id_t));
+    missing = (struct ScribaCompany **)scriba_malloc(n * sizeof (struct ScribaCompany *));
+    if ((missing_ids == NULL) || (missing == NULL))
+    {
+        scriba_free(missing_ids);
+        scriba_free(missing);
+        return fetch_companies(ids, n, companies);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        companies[i] = (struct ScribaCompany *)scriba_cache_get(SCRIBA_ENTITY_COMPANY, &(ids[i]));
+        if (companies[i] == NULL)
+        {
+            scriba_id_copy(&(missing_ids[num_missing]), &(ids[i]));
+            num_missing++;
+        }
+    }
+    if (num_missing != 0)
+    {
+        fetch_companies(missing_ids, num_missing, missing);
+    }
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        if (companies[i] == NULL)
+        {
+            companies[i] = missing[j++];
+            scriba_cache_put(SCRIBA_ENTITY_COMPANY, companies[i], version);
+        }
+        if (companies[i] != NULL)
+        {
+            found++;
+        }
+    }
+    scriba_free(missing_ids);
+    scriba_free(missing);
+
+    return found;
+}
+
+// retrieve companies from the database
+static size_t fetch_companies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies)
+{
+    size_t found = 0;
+
+    if (fTbl->getCompanies != NULL)
+    {
+        return fTbl->getCompanies(ids, n, companies);
+    }
+
+    // backend does not support batch retrieval
+    for (size_t i = 0; i < n; i++)
+    {
+        companies[i] = fTbl->getCompany(ids[i]);
+        if (companies[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
 }
 
 // get all companies stored in the database
 scriba_list_t *scriba_getAllCompanies()
 {
-    return (fTbl->getAllCompanies());
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_COMPANY, SCRIBA_QUERY_ALL_COMPANIES);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getAllCompanies();
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get companies with given name
 scriba_list_t *scriba_getCompaniesByName(const char *name)
 {
-    return (fTbl->getCompaniesByName(name));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_COMPANY, SCRIBA_QUERY_COMPANIES_BY_NAME);
+    key.str = name;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getCompaniesByName(name);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get companies with given juridicial name
 scriba_list_t *scriba_getCompaniesByJurName(const char *juridicial_name)
 {
-    return (fTbl->getCompaniesByJurName(juridicial_name));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_COMPANY, SCRIBA_QUERY_COMPANIES_BY_JUR_NAME);
+    key.str = juridicial_name;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getCompaniesByJurName(juridicial_name);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get companies with given address
 scriba_list_t *scriba_getCompaniesByAddress(const char *address)
 {
-    return (fTbl->getCompaniesByAddress(address));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_COMPANY, SCRIBA_QUERY_COMPANIES_BY_ADDRESS);
+    key.str = address;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getCompaniesByAddress(address);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // add new company to the database
@@ -63,6 +215,7 @@ void scriba_addCompany(const char *name, const char *jur_name, const char *addre
 
     scriba_id_create(&company_id);
     fTbl->addCompany(company_id, name, jur_name, address, inn, phonenum, email);
+    scriba_cache_invalidate(SCRIBA_ENTITY_COMPANY, &company_id);
 }
 
 // add company with given id to the database
@@ -71,109 +224,235 @@ void scriba_addCompanyWithID(scriba_id_t id, const char *name, const char *jur_n
                              const char *email)
 {
     fTbl->addCompany(id, name, jur_name, address, inn, phonenum, email);
+    scriba_cache_invalidate(SCRIBA_ENTITY_COMPANY, &id);
 }
 
 // update company info
 void scriba_updateCompany(const struct ScribaCompany *company)
 {
     fTbl->updateCompany(company);
+    if (company != NULL)
+    {
+        scriba_cache_invalidate(SCRIBA_ENTITY_COMPANY, &(company->id));
+    }
 }
 
 // remove company info from the database
 void scriba_removeCompany(scriba_id_t id)
 {
     fTbl->removeCompany(id);
+    scriba_cache_invalidate(SCRIBA_ENTITY_COMPANY, &id);
 }
 
-// create a copy of company data structure
-struct ScribaCompany *scriba_copyCompany(const struct ScribaCompany *company)
+// insert company or merge it with existing one
+int scriba_upsertCompany(const struct ScribaCompany *company, int overwrite)
 {
-    int len = 0;
+    int ret = upsert_company(company, overwrite);
+
+    if ((ret == SCRIBA_UPSERT_UPDATED) || (ret == SCRIBA_UPSERT_INSERTED))
+    {
+        scriba_cache_invalidate(SCRIBA_ENTITY_COMPANY, &(company->id));
+    }
+    return ret;
+}
+
+// insert company or merge it with existing one in the database
+static int upsert_company(const struct ScribaCompany *company, int overwrite)
+{
+    struct ScribaCompany *existing = NULL;
 
     if (company == NULL)
     {
-        return NULL;
+        return -1;
     }
 
-    struct ScribaCompany *ret = (struct ScribaCompany *)malloc(sizeof (struct ScribaCompany));
-    memset((void *)ret, 0, sizeof (struct ScribaCompany));
-    scriba_id_copy(&(ret->id), &(company->id));
-    if ((len = strlen(company->name)) != 0)
+    if (fTbl->upsertCompany != NULL)
+    {
+        return fTbl->upsertCompany(company, overwrite);
+    }
+
+    // backend does not support upsert
+    existing = fTbl->getCompany(company->id);
+    if (existing == NULL)
+    {
+        fTbl->addCompany(company->id, company->name, company->jur_name, company->address,
+                         company->inn, company->phonenum, company->email);
+        return SCRIBA_UPSERT_INSERTED;
+    }
+    scriba_freeCompanyData(existing);
+    if (overwrite)
+    {
+        fTbl->updateCompany(company);
+        return SCRIBA_UPSERT_UPDATED;
+    }
+    return SCRIBA_UPSERT_KEPT;
+}
+
+// call func for each company matching the filter or for all companies
+int scriba_scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx)
+{
+    const scriba_id_t *ids = NULL;
+    scriba_id_t *all_ids = NULL;
+    size_t n = 0;
+
+    if (func == NULL)
     {
-        ret->name = (char *)malloc(len + 1);
-        memset(ret->name, 0, len + 1);
-        strncpy(ret->name, company->name, len);
+        return -1;
     }
-    if ((len = strlen(company->jur_name)) != 0)
+
+    if (fTbl->scanCompanies != NULL)
     {
-        ret->jur_name = (char *)malloc(len + 1);
-        memset(ret->jur_name, 0, len + 1);
-        strncpy(ret->jur_name, company->jur_name, len);
-    } 
-    if ((len = strlen(company->address)) != 0)
+        return fTbl->scanCompanies(filter, func, ctx);
+    }
+
+    // backend does not support scans, retrieve companies in batches
+    if ((filter != NULL) && (filter->ids != NULL))
     {
-        ret->address = (char *)malloc(len + 1);
-        memset(ret->address, 0, len + 1);
-        strncpy(ret->address, company->address, len);
+        ids = filter->ids;
+        n = filter->num_ids;
     }
-    if ((len = strlen(company->inn)) != 0)
+    else
     {
-        ret->inn = (char *)malloc(len + 1);
-        memset(ret->inn, 0, len + 1);
-        strncpy(ret->inn, company->inn, len);
+        scriba_list_t *list = fTbl->getAllCompanies();
+        all_ids = scriba_list_to_ids(list, &n);
+        scriba_list_delete(list);
+        ids = all_ids;
     }
-    if ((len = strlen(company->phonenum)) != 0)
+    for (size_t start = 0; start < n; start += SCRIBA_SCAN_BATCH_SIZE)
     {
-        ret->phonenum = (char *)malloc(len + 1);
-        memset(ret->phonenum, 0, len + 1);
-        strncpy(ret->phonenum, company->phonenum, len);
-    } 
-    if ((len = strlen(company->email)) != 0)
+        struct ScribaCompany *companies[SCRIBA_SCAN_BATCH_SIZE];
+        size_t num = ((n - start) > SCRIBA_SCAN_BATCH_SIZE) ? SCRIBA_SCAN_BATCH_SIZE : (n - start);
+
+        scriba_getCompanies(ids + start, num, companies);
+        for (size_t i = 0; i < num; i++)
+        {
+            if (companies[i] == NULL)
+            {
+                continue;
+            }
+            if (scriba_scan_filter_match(filter, &(companies[i]->id), &(companies[i]->id), NULL))
+            {
+                func(companies[i], ctx);
+            }
+            scriba_freeCompanyData(companies[i]);
+        }
+    }
+    if (all_ids != NULL)
     {
-        ret->email = (char *)malloc(len + 1);
-        memset(ret->email, 0, len + 1);
-        strncpy(ret->email, company->email, len);
-    } 
+        scriba_free(all_ids);
+    }
 
-    return ret;
+    return 0;
 }
 
-// free memory occupied by company data structure
-void scriba_freeCompanyData(struct ScribaCompany *company)
+// size of string storage required to copy string field, empty strings are not copied
+static size_t field_size(const char *str)
+{
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
+}
+
+// create a copy of company data structure
+struct ScribaCompany *scriba_copyCompany(const struct ScribaCompany *company)
 {
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
     if (company == NULL)
     {
-        return;
+        return NULL;
     }
 
-    if (company->name != NULL)
+    size_t str_size = field_size(company->name) + field_size(company->jur_name) +
+                      field_size(company->address) + field_size(company->inn) +
+                      field_size(company->phonenum) + field_size(company->email);
+    struct ScribaCompany *ret = (struct ScribaCompany *)scriba_entity_alloc(sizeof (struct ScribaCompany),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    scriba_id_copy(&(ret->id), &(company->id));
+    if (field_size(company->name) != 0)
+    {
+        ret->name = scriba_entity_strcpy(&str_buf, company->name);
+    }
+    if (field_size(company->jur_name) != 0)
+    {
+        ret->jur_name = scriba_entity_strcpy(&str_buf, company->jur_name);
+    }
+    if (field_size(company->address) != 0)
+    {
+        ret->address = scriba_entity_strcpy(&str_buf, company->address);
+    }
+    if (field_size(company->inn) != 0)
     {
-        free(company->name);
+        ret->inn = scriba_entity_strcpy(&str_buf, company->inn);
     }
-    if (company->jur_name != NULL)
+    if (field_size(company->phonenum) != 0)
     {
-        free(company->jur_name);
+        ret->phonenum = scriba_entity_strcpy(&str_buf, company->phonenum);
     }
-    if (company->address != NULL)
+    if (field_size(company->email) != 0)
     {
-        free(company->address);
+        ret->email = scriba_entity_strcpy(&str_buf, company->email);
     }
-    if (company->inn != NULL)
+
+    return ret;
+}
+
+// free memory occupied by company data structure
+void scriba_freeCompanyData(struct ScribaCompany *company)
+{
+    if (company == NULL)
     {
-        free(company->inn);
+        return;
     }
-    if (company->phonenum != NULL)
+
+    // shared entity is freed when its last reference is dropped
+    if (company->layout == SCRIBA_LAYOUT_SHARED)
     {
-        free(company->phonenum);
+        scriba_release(company);
+        return;
     }
-    if (company->email != NULL)
+
+    // strings are allocated separately only with the default layout
+    if (company->layout == SCRIBA_LAYOUT_SEPARATE)
     {
-        free(company->email);
+        if (company->name != NULL)
+        {
+            scriba_free(company->name);
+        }
+        if (company->jur_name != NULL)
+        {
+            scriba_free(company->jur_name);
+        }
+        if (company->address != NULL)
+        {
+            scriba_free(company->address);
+        }
+        if (company->inn != NULL)
+        {
+            scriba_free(company->inn);
+        }
+        if (company->phonenum != NULL)
+        {
+            scriba_free(company->phonenum);
+        }
+        if (company->email != NULL)
+        {
+            scriba_free(company->email);
+        }
     }
 
     scriba_list_delete(company->poc_list);
     scriba_list_delete(company->proj_list);
     scriba_list_delete(company->event_list);
 
-    free(company);
+    // arena memory is reclaimed by scriba_arena_reset()
+    if (company->layout != SCRIBA_LAYOUT_ARENA)
+    {
+        scriba_free(company);
+    }
 }
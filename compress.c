@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "compress.h"
+#include "types.h"
+#include <stdint.h>
+#include <string.h>
+
+// minimum match length
+#define LZ_MIN_MATCH 4
+// length value of token nibble meaning the length continues in the next bytes
+#define LZ_LENGTH_MASK 15
+// matches do not start in the last bytes of the data, so that match search
+// can read a whole sequence at any position it checks
+#define LZ_LAST_LITERALS 5
+// number of bits of match search hash table index; data smaller than the table
+// uses smaller table, which is faster to clear
+#define LZ_HASH_BITS 14
+#define LZ_MIN_HASH_BITS 10
+// length of sequences counted by dictionary training
+#define LZ_TRAIN_GRAM 8
+// size of segments the trained dictionary is made of
+#define LZ_TRAIN_SEGMENT 64
+// number of bits of dictionary training hash table index
+#define LZ_TRAIN_HASH_BITS 20
+
+struct ScribaLzDict
+{
+    uint8_t *data;
+    size_t len;
+    uint32_t table[1 << LZ_HASH_BITS];  // match search table of dictionary sequences
+};
+
+// read unaligned 32-bit value
+static uint32_t read32(const uint8_t *p);
+// hash of 4-byte sequence used by match search
+static uint32_t match_hash(uint32_t seq, unsigned int bits);
+// length of match between data at p and its source at ref; source in the
+// dictionary (ref_end is the end of the dictionary, NULL for source in the data)
+// continues at the beginning of the data
+static size_t match_length(const uint8_t *p, const uint8_t *end,
+                           const uint8_t *ref, const uint8_t *ref_end,
+                           const uint8_t *data);
+// hash of LZ_TRAIN_GRAM-byte sequence used by dictionary training
+static uint32_t gram_hash(const uint8_t *p);
+// score of sequence that occurs count times in training samples; sequences
+// occurring once are not worth a place in the dictionary
+static uint64_t gram_score(uint32_t count);
+// write length continuation bytes
+static uint8_t *write_length(uint8_t *op, size_t len);
+// read length continuation bytes and add them to len; returns 0 on success
+static int read_length(const uint8_t **ip, const uint8_t *iend, size_t *len);
+// write sequence of literals and match (match_len 0 writes literals only);
+// returns the end of written sequence, NULL if there is not enough space
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *oend,
+                               const uint8_t *literals, size_t lit_len,
+                               size_t offset, size_t match_len);
+
+// prepare dictionary
+struct ScribaLzDict *scriba_lz_dict_create(const void *data, size_t len)
+{
+    if (len < LZ_MIN_MATCH)
+    {
+        return NULL;
+    }
+    // only the end of the dictionary is reachable by matches
+    if (len > SCRIBA_LZ_WINDOW_SIZE)
+    {
+        data = (const uint8_t *)data + len - SCRIBA_LZ_WINDOW_SIZE;
+        len = SCRIBA_LZ_WINDOW_SIZE;
+    }
+
+    struct ScribaLzDict *dict = (struct ScribaLzDict *)scriba_malloc(sizeof (struct ScribaLzDict));
+    dict->data = (uint8_t *)scriba_malloc(len);
+    memcpy(dict->data, data, len);
+    dict->len = len;
+    // dictionary sequences are indexed once, compression starts with a copy of the table
+    memset(dict->table, 0, sizeof (dict->table));
+    for (size_t p = 0; p + LZ_MIN_MATCH <= len; p++)
+    {
+        dict->table[match_hash(read32(dict->data + p), LZ_HASH_BITS)] = (uint32_t)p;
+    }
+    return dict;
+}
+
+// release prepared dictionary
+void scriba_lz_dict_free(struct ScribaLzDict *dict)
+{
+    if (dict != NULL)
+    {
+        scriba_free(dict->data);
+        scriba_free(dict);
+    }
+}
+
+// maximum size of compressed block
+size_t scriba_lz_bound(size_t len)
+{
+    // incompressible data is written as a single literal run
+    return len + len / 255 + 16;
+}
+
+// compress data
+size_t scriba_lz_compress(const void *src, size_t len, const struct ScribaLzDict *dict,
+                          void *dst, size_t dst_len)
+{
+    const uint8_t *data = (const uint8_t *)src;
+    const uint8_t *dict_data = (dict != NULL) ? dict->data : NULL;
+    size_t dict_len = (dict != NULL) ? dict->len : 0;
+    uint8_t *op = (uint8_t *)dst;
+    const uint8_t *oend = op + dst_len;
+    unsigned int bits = LZ_HASH_BITS;
+    uint32_t *table = NULL;
+    size_t ret = 0;
+
+    /* Table keeps positions of sequences, the dictionary takes positions
+     * [0, dict_len) and is followed by the data. */
+    if (dict == NULL)
+    {
+        bits = LZ_MIN_HASH_BITS;
+        while ((bits < LZ_HASH_BITS) && (((size_t)1 << bits) < len))
+        {
+            bits++;
+        }
+    }
+    table = (uint32_t *)scriba_malloc(sizeof (uint32_t) << bits);
+    if (dict != NULL)
+    {
+        memcpy(table, dict->table, sizeof (dict->table));
+    }
+    else
+    {
+        memset(table, 0, sizeof (uint32_t) << bits);
+    }
+
+    const uint8_t *ip = data;
+    const uint8_t *anchor = ip;
+    const uint8_t *end = ip + len;
+
+    if (len > LZ_LAST_LITERALS + LZ_MIN_MATCH)
+    {
+        const uint8_t *limit = end - LZ_LAST_LITERALS;
+
+        while (ip < limit)
+        {
+            uint32_t seq = read32(ip);
+            uint32_t h = match_hash(seq, bits);
+            size_t pos = dict_len + (size_t)(ip - data);
+            size_t ref_pos = table[h];
+
+            table[h] = (uint32_t)pos;
+            if ((ref_pos >= pos) || (pos - ref_pos > SCRIBA_LZ_WINDOW_SIZE))
+            {
+                // skip faster through data that does not compress
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+                continue;
+            }
+
+            int in_dict = (ref_pos < dict_len);
+            const uint8_t *ref = in_dict ? dict_data + ref_pos : data + (ref_pos - dict_len);
+            const uint8_t *ref_start = in_dict ? dict_data : data;
+            if (read32(ref) != seq)
+            {
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+                continue;
+            }
+
+            size_t match_len = LZ_MIN_MATCH +
+                               match_length(ip + LZ_MIN_MATCH, end, ref + LZ_MIN_MATCH,
+                                            in_dict ? dict_data + dict_len : NULL, data);
+            // pending literals may be the beginning of the match
+            while ((ip > anchor) && (ref > ref_start) && (ip[-1] == ref[-1]))
+            {
+                ip--;
+                ref--;
+                match_len++;
+            }
+
+            op = write_sequence(op, oend, anchor, (size_t)(ip - anchor), pos - ref_pos, match_len);
+            if (op == NULL)
+            {
+                goto exit;
+            }
+            ip += match_len;
+            anchor = ip;
+            // position inside the match is likely to start the next match
+            if (ip < limit)
+            {
+                table[match_hash(read32(ip - 2), bits)] = (uint32_t)(dict_len + (size_t)(ip - 2 - data));
+            }
+        }
+    }
+
+    op = write_sequence(op, oend, anchor, (size_t)(end - anchor), 0, 0);
+    if (op == NULL)
+    {
+        goto exit;
+    }
+    ret = (size_t)(op - (uint8_t *)dst);
+
+exit:
+    scriba_free(table);
+    return ret;
+}
+
+// decompress data
+int scriba_lz_decompress(const void *src, size_t len, const struct ScribaLzDict *dict,
+                         void *dst, size_t dst_len)
+{
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + len;
+    uint8_t *op = (uint8_t *)dst;
+    const uint8_t *oend = op + dst_len;
+    const uint8_t *dict_data = (dict != NULL) ? dict->data : NULL;
+    size_t dict_len = (dict != NULL) ? dict->len : 0;
+
+    // every length and offset is checked, the block may come from anywhere
+    while (1)
+    {
+        if (ip >= iend)
+        {
+            return -1;
+        }
+
+        unsigned int token = *ip++;
+        size_t lit_len = token >> 4;
+        if ((lit_len == LZ_LENGTH_MASK) && (read_length(&ip, iend, &lit_len) != 0))
+        {
+            return -1;
+        }
+        if (((size_t)(iend - ip) < lit_len) || ((size_t)(oend - op) < lit_len))
+        {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+
+        if (ip == iend)
+        {
+            // the last sequence has no match
+            break;
+        }
+
+        if ((iend - ip) < 2)
+        {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_len = token & LZ_LENGTH_MASK;
+        if ((match_len == LZ_LENGTH_MASK) && (read_length(&ip, iend, &match_len) != 0))
+        {
+            return -1;
+        }
+        match_len += LZ_MIN_MATCH;
+
+        size_t pos = (size_t)(op - (uint8_t *)dst);
+        if ((offset == 0) || (offset > pos + dict_len) || ((size_t)(oend - op) < match_len))
+        {
+            return -1;
+        }
+        if (offset > pos)
+        {
+            // match starts in the dictionary and may continue in the data
+            size_t dict_part = offset - pos;
+            size_t n = (dict_part < match_len) ? dict_part : match_len;
+
+            memcpy(op, dict_data + dict_len - dict_part, n);
+            op += n;
+            match_len -= n;
+        }
+        const uint8_t *ref = op - offset;
+        if (offset >= match_len)
+        {
+            memcpy(op, ref, match_len);
+            op += match_len;
+        }
+        else
+        {
+            // overlapping match repeats the last offset bytes
+            while (match_len-- > 0)
+            {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return (op == oend) ? 0 : -1;
+}
+
+// build dictionary out of training samples
+size_t scriba_lz_train(const void *const *samples, const size_t *sample_lens, size_t n,
+                       void *dict, size_t dict_len)
+{
+    uint32_t *counts = NULL;
+    uint8_t *joined = NULL;
+    uint8_t *dp = (uint8_t *)dict;
+    size_t total = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        total += sample_lens[i];
+    }
+    if (dict_len > SCRIBA_LZ_WINDOW_SIZE)
+    {
+        dict_len = SCRIBA_LZ_WINDOW_SIZE;
+    }
+    size_t num_segments = dict_len / LZ_TRAIN_SEGMENT;
+    if ((num_segments == 0) || (total < LZ_TRAIN_SEGMENT))
+    {
+        return 0;
+    }
+
+    joined = (uint8_t *)scriba_malloc(total);
+    total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy(joined + total, samples[i], sample_lens[i]);
+        total += sample_lens[i];
+    }
+
+    counts = (uint32_t *)scriba_malloc(sizeof (uint32_t) << LZ_TRAIN_HASH_BITS);
+    memset(counts, 0, sizeof (uint32_t) << LZ_TRAIN_HASH_BITS);
+    for (size_t p = 0; p + LZ_TRAIN_GRAM <= total; p++)
+    {
+        counts[gram_hash(joined + p)]++;
+    }
+
+    /* Samples are split into one epoch per dictionary segment, the segment
+     * with the highest score is taken from each epoch. Sequences of the taken
+     * segment stop counting, so that later epochs do not repeat them. */
+    size_t epoch = total / num_segments;
+    if (epoch < LZ_TRAIN_SEGMENT)
+    {
+        epoch = LZ_TRAIN_SEGMENT;
+    }
+    for (size_t start = 0; start + LZ_TRAIN_SEGMENT <= total; start += epoch)
+    {
+        size_t stop = (start + epoch <= total) ? start + epoch : total;
+        size_t grams = LZ_TRAIN_SEGMENT - LZ_TRAIN_GRAM + 1;
+        uint64_t score = 0;
+        uint64_t best_score = 0;
+        size_t best = 0;
+
+        if ((size_t)(dp - (uint8_t *)dict) + LZ_TRAIN_SEGMENT > dict_len)
+        {
+            break;
+        }
+
+        for (size_t g = 0; g < grams; g++)
+        {
+            score += gram_score(counts[gram_hash(joined + start + g)]);
+        }
+        for (size_t p = start; p + LZ_TRAIN_SEGMENT <= stop; p++)
+        {
+            if (score > best_score)
+            {
+                best_score = score;
+                best = p;
+            }
+            if (p + LZ_TRAIN_SEGMENT < total)
+            {
+                score -= gram_score(counts[gram_hash(joined + p)]);
+                score += gram_score(counts[gram_hash(joined + p + grams)]);
+            }
+        }
+
+        if (best_score == 0)
+        {
+            continue;
+        }
+        memcpy(dp, joined + best, LZ_TRAIN_SEGMENT);
+        dp += LZ_TRAIN_SEGMENT;
+        for (size_t g = 0; g < grams; g++)
+        {
+            counts[gram_hash(joined + best + g)] = 0;
+        }
+    }
+
+    scriba_free(counts);
+    scriba_free(joined);
+    return (size_t)(dp - (uint8_t *)dict);
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof (v));
+    return v;
+}
+
+static uint32_t match_hash(uint32_t seq, unsigned int bits)
+{
+    return (seq * 2654435761u) >> (32 - bits);
+}
+
+static size_t match_length(const uint8_t *p, const uint8_t *end,
+                           const uint8_t *ref, const uint8_t *ref_end,
+                           const uint8_t *data)
+{
+    const uint8_t *start = p;
+
+    if (ref_end != NULL)
+    {
+        while ((p < end) && (ref < ref_end) && (*p == *ref))
+        {
+            p++;
+            ref++;
+        }
+        if ((ref < ref_end) || (p == end))
+        {
+            return (size_t)(p - start);
+        }
+        ref = data;
+    }
+    while ((p < end) && (*p == *ref))
+    {
+        p++;
+        ref++;
+    }
+    return (size_t)(p - start);
+}
+
+static uint32_t gram_hash(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof (v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ull) >> (64 - LZ_TRAIN_HASH_BITS));
+}
+
+static uint64_t gram_score(uint32_t count)
+{
+    return (count > 1) ? count : 0;
+}
+
+static uint8_t *write_length(uint8_t *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static int read_length(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    uint8_t b;
+
+    do
+    {
+        if (*ip >= iend)
+        {
+            return -1;
+        }
+        b = *(*ip)++;
+        *len += b;
+    }
+    while (b == 255);
+    return 0;
+}
+
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *oend,
+                               const uint8_t *literals, size_t lit_len,
+                               size_t offset, size_t match_len)
+{
+    // the longest possible encoding of the sequence
+    size_t need = 1 + (lit_len / 255 + 1) + lit_len + 2 + (match_len / 255 + 1);
+    if ((size_t)(oend - op) < need)
+    {
+        return NULL;
+    }
+
+    uint8_t *token = op++;
+    *token = (uint8_t)(((lit_len < LZ_LENGTH_MASK) ? lit_len : LZ_LENGTH_MASK) << 4);
+    if (lit_len >= LZ_LENGTH_MASK)
+    {
+        op = write_length(op, lit_len - LZ_LENGTH_MASK);
+    }
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+
+    if (match_len != 0)
+    {
+        size_t len = match_len - LZ_MIN_MATCH;
+
+        *op++ = (uint8_t)(offset & 0xff);
+        *op++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)((len < LZ_LENGTH_MASK) ? len : LZ_LENGTH_MASK);
+        if (len >= LZ_LENGTH_MASK)
+        {
+            op = write_length(op, len - LZ_LENGTH_MASK);
+        }
+    }
+    return op;
+}
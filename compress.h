@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_COMPRESS_H
+#define SCRIBA_COMPRESS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* LZ77 block codec used for compressed serializer frames. The block is a
+ * sequence of LZ4-style sequences: token byte with literal length in the high
+ * nibble and match length minus 4 in the low nibble (15 means the length
+ * continues in the following bytes, each byte of 255 adds 255 and the first
+ * byte less than 255 ends it), literals, 16-bit little-endian match offset and
+ * match length continuation. The last sequence has literals only.
+ * Matches may refer to the dictionary, which precedes the data. */
+
+// maximum distance between match and its source, also the maximum useful
+// dictionary size
+#define SCRIBA_LZ_WINDOW_SIZE 65535
+
+// dictionary prepared for compression and decompression
+struct ScribaLzDict;
+
+// prepare dictionary, the data is copied; returns NULL if the dictionary is
+// too small to be used
+struct ScribaLzDict *scriba_lz_dict_create(const void *data, size_t len);
+
+// release prepared dictionary
+void scriba_lz_dict_free(struct ScribaLzDict *dict);
+
+// maximum size of compressed block for data of the given size
+size_t scriba_lz_bound(size_t len);
+
+// compress len bytes of src into dst of dst_len bytes using dictionary (may be
+// NULL); returns compressed size, 0 if dst is too small
+size_t scriba_lz_compress(const void *src, size_t len, const struct ScribaLzDict *dict,
+                          void *dst, size_t dst_len);
+
+// decompress block of len bytes into dst, which should receive exactly dst_len
+// bytes, using the dictionary the block was compressed with;
+// returns 0 on success, -1 if the block is malformed
+int scriba_lz_decompress(const void *src, size_t len, const struct ScribaLzDict *dict,
+                         void *dst, size_t dst_len);
+
+// build dictionary of up to dict_len bytes out of the most frequent segments of
+// n samples; returns dictionary size, 0 if samples are too small
+size_t scriba_lz_train(const void *const *samples, const size_t *sample_lens, size_t n,
+                       void *dict, size_t dict_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_COMPRESS_H
@@ -26,6 +26,52 @@
 #include "poc.h"
 #include "project.h"
 #include "scriba.h"
+#include "arena.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// functions receiving entities found by scan functions; entity data structures
+// are only valid during the call, company child lists are not filled
+typedef void (*scriba_company_scan_fn)(const struct ScribaCompany *, void *);
+typedef void (*scriba_poc_scan_fn)(const struct ScribaPoc *, void *);
+typedef void (*scriba_project_scan_fn)(const struct ScribaProject *, void *);
+typedef void (*scriba_event_scan_fn)(const struct ScribaEvent *, void *);
+
+// entity types of change records
+enum ScribaEntityType
+{
+    SCRIBA_ENTITY_COMPANY = 0,
+    SCRIBA_ENTITY_EVENT,
+    SCRIBA_ENTITY_POC,
+    SCRIBA_ENTITY_PROJECT
+};
+
+// function receiving ids of removed entities found by scriba_scanRemoved()
+typedef void (*scriba_removed_scan_fn)(const scriba_id_t *, enum ScribaEntityType, void *);
+
+// number of entities retrieved at once when the library falls back
+// to batch retrieval instead of a scan
+#define SCRIBA_SCAN_BATCH_SIZE 256
+
+// conditions selecting entities found by scan functions;
+// conditions that are not set match all entities
+struct ScribaScanFilter
+{
+    const scriba_id_t *ids;             // entity ids, NULL if not set
+    size_t num_ids;
+    const scriba_id_t *company_ids;     // ids of companies entities belong to
+    size_t num_company_ids;             // (ids of companies themselves), NULL if not set
+    int use_mod_since;                  // non-zero if mod_since is set
+    scriba_time_t mod_since;            // minimal project mod_time, ignored for other entities
+    unsigned int num_shards;            // entities are split into num_shards disjoint shards
+    unsigned int shard;                 // and only entities of shard are selected; not set
+                                        // if num_shards is less than 2
+    int use_changed_since;              // non-zero if changed_since is set
+    unsigned long long changed_since;   // change stamp entities should be changed after
+};
 
 // pointers to functions that must be implemented by a database backend
 struct ScribaDBFuncTbl
@@ -86,6 +132,71 @@ struct ScribaDBFuncTbl
                      scriba_time_t, enum ScribaEventState);
     void (*updateEvent)(const struct ScribaEvent *);
     void (*removeEvent)(scriba_id_t);
+
+    // batch retrieval functions; optional, the library falls back to
+    // single get functions if a backend does not provide them
+    size_t (*getCompanies)(const scriba_id_t *, size_t, struct ScribaCompany **);
+    size_t (*getPeople)(const scriba_id_t *, size_t, struct ScribaPoc **);
+    size_t (*getProjects)(const scriba_id_t *, size_t, struct ScribaProject **);
+    size_t (*getEvents)(const scriba_id_t *, size_t, struct ScribaEvent **);
+
+    // bulk operations; optional, the library falls back to single row
+    // operations if a backend does not provide them;
+    // the last updateProjects argument is mod_time of projects whose state changes
+    long (*updateEvents)(const struct ScribaEventFilter *, const struct ScribaEventUpdate *);
+    long (*removeEvents)(const struct ScribaEventFilter *);
+    long (*updateProjects)(const struct ScribaProjectFilter *, const struct ScribaProjectUpdate *,
+                           scriba_time_t);
+    long (*removeProjects)(const struct ScribaProjectFilter *);
+
+    // insert entity or, if an entity with the same id exists, overwrite it
+    // (second argument is non-zero) or keep it intact (second argument is zero)
+    // in a single operation; should return SCRIBA_UPSERT_* result or -1 on failure;
+    // existing entity with the same data may be kept instead of being overwritten;
+    // optional, the library falls back to get and add or update functions
+    // if a backend does not provide them;
+    // the last upsertProject argument is mod_time of existing project whose state changes
+    int (*upsertCompany)(const struct ScribaCompany *, int);
+    int (*upsertPOC)(const struct ScribaPoc *, int);
+    int (*upsertProject)(const struct ScribaProject *, int, scriba_time_t);
+    int (*upsertEvent)(const struct ScribaEvent *, int);
+
+    // streaming scans; call the given function with the last argument as context
+    // for each entity matching the filter or for each entity in the database
+    // if filter is NULL; should return 0 on success;
+    // optional, the library falls back to batch retrieval functions
+    // if a backend does not provide them
+    int (*scanCompanies)(const struct ScribaScanFilter *, scriba_company_scan_fn, void *);
+    int (*scanPeople)(const struct ScribaScanFilter *, scriba_poc_scan_fn, void *);
+    int (*scanProjects)(const struct ScribaScanFilter *, scriba_project_scan_fn, void *);
+    int (*scanEvents)(const struct ScribaScanFilter *, scriba_event_scan_fn, void *);
+
+    // read transaction; data retrieved between beginRead() and endRead()
+    // should come from the same database snapshot; optional
+    void (*beginRead)(void);
+    void (*endRead)(void);
+
+    // write transaction; changes made between beginWrite() and commitWrite() are
+    // stored all at once, rollbackWrite() discards them; beginWrite() and
+    // commitWrite() should return 0 on success; optional
+    int (*beginWrite)(void);
+    int (*commitWrite)(void);
+    void (*rollbackWrite)(void);
+
+    // separate read connection of the calling thread; scans and read transactions
+    // made by the thread between attachReader() and detachReader() use it, so that
+    // several threads may read the database in parallel; attachReader() should
+    // return 0 on success; optional
+    int (*attachReader)(void);
+    void (*detachReader)(void);
+
+    // change tracking; every change of an entity, including its removal, gets
+    // a stamp greater than stamps of all previous changes; getChangeStamp() returns
+    // the stamp of the last change, scanRemoved() calls the given function for each
+    // entity removed after the given stamp and should return 0 on success;
+    // optional, backends without change tracking always export all entities
+    unsigned long long (*getChangeStamp)(void);
+    int (*scanRemoved)(unsigned long long, scriba_removed_scan_fn, void *);
 };
 
 // internal database backend
@@ -99,8 +210,218 @@ struct ScribaInternalDB
     void (*cleanup)();
 };
 
+// external database backend;
+// external backend is a shared library loaded from ScribaDB location, the library
+// should export function named SCRIBA_EXT_ENTRY_NAME of scriba_ext_entry_fn type
+// returning backend descriptor
+
+// version of external backend interface, increased whenever layout of ScribaDBFuncTbl
+// or ScribaExtDB changes
+#define SCRIBA_EXT_ABI_VERSION  1
+#define SCRIBA_EXT_ENTRY_NAME   "scriba_ext_backend"
+
+// groups of optional ScribaDBFuncTbl functions provided by external backend;
+// functions of groups missing from backend capabilities are never called;
+// scriba_init() fails with SCRIBA_INIT_NOT_SUPPORTED if any other function is missing
+#define SCRIBA_EXT_CAP_BATCH        0x0001  // batch retrieval functions
+#define SCRIBA_EXT_CAP_BULK         0x0002  // bulk operations
+#define SCRIBA_EXT_CAP_UPSERT       0x0004  // upsert functions
+#define SCRIBA_EXT_CAP_SCAN         0x0008  // streaming scans
+#define SCRIBA_EXT_CAP_READ_TXN     0x0010  // read transactions
+#define SCRIBA_EXT_CAP_WRITE_TXN    0x0020  // write transactions
+#define SCRIBA_EXT_CAP_READERS      0x0040  // separate read connections
+#define SCRIBA_EXT_CAP_CHANGES      0x0080  // change tracking
+
+// external database backend descriptor
+struct ScribaExtDB
+{
+    unsigned int abi_version;   // SCRIBA_EXT_ABI_VERSION the backend is built with
+    const char *name;           // should match ScribaDB name
+    unsigned int caps;          // SCRIBA_EXT_CAP_* flags
+    // backend initialization function; should return 0 on success
+    int (*init)(struct ScribaDBParamList *, struct ScribaDBFuncTbl *);
+    // backend cleanup function
+    void (*cleanup)();
+};
+
+// external backend entry point; receives SCRIBA_EXT_ABI_VERSION of the library,
+// should return NULL if the backend does not support it
+typedef const struct ScribaExtDB *(*scriba_ext_entry_fn)(unsigned int);
+
 // add new internal database backend at run-time
 // mostly useful for unit testing; must be called before scriba_init()
 void scriba_addInternalDB(struct ScribaInternalDB *db);
 
+// check whether application has replaced library allocator;
+// returns 1 if custom allocator is set, 0 otherwise
+int scriba_has_custom_allocator();
+
+// results of upsert functions
+#define SCRIBA_UPSERT_KEPT      0   // existing entity has been kept intact
+#define SCRIBA_UPSERT_UPDATED   1   // existing entity has been overwritten
+#define SCRIBA_UPSERT_INSERTED  2   // new entity has been inserted
+
+// Insert entity into the local database or merge it with existing entity that has
+// the same id: existing data is overwritten if overwrite is non-zero and kept
+// intact otherwise. Child lists of company data structure are ignored. Used by
+// deserializer; return SCRIBA_UPSERT_* result or -1 on failure.
+int scriba_upsertCompany(const struct ScribaCompany *company, int overwrite);
+int scriba_upsertPOC(const struct ScribaPoc *poc, int overwrite);
+int scriba_upsertProject(const struct ScribaProject *project, int overwrite);
+int scriba_upsertEvent(const struct ScribaEvent *event, int overwrite);
+
+// Call func for each entity matching the filter or for each entity in the database
+// if filter is NULL. Entity data structures passed to func are only valid during
+// the call. Used by serializer; return 0 on success.
+int scriba_scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx);
+int scriba_scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx);
+int scriba_scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx);
+int scriba_scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx);
+
+// check whether entity with given id, company id and modification time matches
+// scan filter; used by fallback scan implementations, mod_time is NULL for
+// entities that do not have modification time
+int scriba_scan_filter_match(const struct ScribaScanFilter *filter, const scriba_id_t *id,
+                             const scriba_id_t *company_id, const scriba_time_t *mod_time);
+
+// start and finish a read transaction, data retrieved in between comes from
+// the same database snapshot if backend supports it
+void scriba_beginRead();
+void scriba_endRead();
+
+// start, commit and roll back a write transaction; changes made in between are
+// stored all at once if backend supports it, otherwise each change is stored
+// right away and rollback has no effect; return 0 on success
+int scriba_beginWrite();
+int scriba_commitWrite();
+void scriba_rollbackWrite();
+
+// attach separate read connection to the calling thread and detach it; returns 0
+// on success, non-zero if backend does not support parallel reads
+int scriba_attachReader();
+void scriba_detachReader();
+
+// stamp of the last change made to the local database, 0 if backend does not
+// track changes
+unsigned long long scriba_getChangeStamp();
+
+// call func for each entity removed after the given change stamp; return 0 on success
+int scriba_scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx);
+
+// create array of ids of the given list; returns NULL for empty list, n receives
+// the number of ids; the array should be freed by scriba_free()
+scriba_id_t *scriba_list_to_ids(scriba_list_t *list, size_t *n);
+
+// check that buf holds serialized entries (see serializer.h) whose tables, vectors
+// and strings stay within len bytes; returns 1 if they do, 0 otherwise
+int scriba_verify_entries(const void *buf, unsigned long len);
+
+// Entity data structure allocation helpers, honour the layout selected by
+// scriba_setEntityLayout(). Backends should use them to create data structures
+// returned by get functions.
+
+// allocate zero-initialized entity data structure of struct_size bytes with
+// room for str_size bytes of string data (including terminating zeroes);
+// str_buf receives string storage pointer, layout receives the layout
+// that has to be stored in the structure
+void *scriba_entity_alloc(size_t struct_size, size_t str_size, char **str_buf,
+                          enum ScribaEntityLayout *layout);
+// copy string into entity string storage and return pointer to the copy
+char *scriba_entity_strcpy(char **str_buf, const char *src);
+// allocate zero-initialized shared entity data structure of the given type holding
+// one reference, see scriba_retain(); the structure is followed by str_size bytes
+// of string storage returned in str_buf, layout should be set to SCRIBA_LAYOUT_SHARED
+void *scriba_entity_alloc_shared(enum ScribaEntityType type, size_t struct_size, size_t str_size,
+                                 char **str_buf);
+
+// Entity cache used by front-end get functions, see cache.h.
+
+// check whether entity cache is enabled; returns 1 if it is, 0 otherwise
+int scriba_cache_enabled();
+// version of cache contents; it changes whenever an entity is invalidated
+unsigned long long scriba_cache_version();
+// copy of cached entity of the given type or NULL if the entity is not cached;
+// the copy should be freed by the caller
+void *scriba_cache_get(enum ScribaEntityType type, const scriba_id_t *id);
+// cached shared entity of the given type with a reference added for the caller
+// or NULL if the entity is not cached
+const void *scriba_cache_get_shared(enum ScribaEntityType type, const scriba_id_t *id);
+// shared copy of entity holding one reference, see scriba_retain()
+const void *scriba_entity_share(enum ScribaEntityType type, const void *entity);
+// put copy of entity retrieved from the database into the cache unless the cache
+// has been changed after version has been obtained, that is, before the retrieval;
+// shared entities are not copied, the cache adds a reference instead
+void scriba_cache_put(enum ScribaEntityType type, const void *entity, unsigned long long version);
+// drop cached entity after it has been changed, added or removed
+void scriba_cache_invalidate(enum ScribaEntityType type, const scriba_id_t *id);
+// drop all cached entities of the given type after bulk changes
+void scriba_cache_invalidate_all(enum ScribaEntityType type);
+// drop cached company after POC, project or event of the company has been changed;
+// unlike scriba_cache_invalidate(), query results for companies are kept
+void scriba_cache_invalidate_owner(const scriba_id_t *company_id);
+// drop all cached companies after bulk changes of people, projects or events
+void scriba_cache_invalidate_owners();
+// find company whose child list includes POC, project or event with the given id
+// before it is changed; returns 1 if company_id has been found, 0 if the entity
+// does not exist or no companies are cached
+int scriba_cache_owner(enum ScribaEntityType type, const scriba_id_t *id, scriba_id_t *company_id);
+
+// Query result cache used by front-end list functions, see cache.h.
+
+// list functions of the function table
+enum ScribaQuery
+{
+    SCRIBA_QUERY_ALL_COMPANIES = 0,
+    SCRIBA_QUERY_COMPANIES_BY_NAME,
+    SCRIBA_QUERY_COMPANIES_BY_JUR_NAME,
+    SCRIBA_QUERY_COMPANIES_BY_ADDRESS,
+    SCRIBA_QUERY_ALL_EVENTS,
+    SCRIBA_QUERY_EVENTS_BY_DESCR,
+    SCRIBA_QUERY_EVENTS_BY_COMPANY,
+    SCRIBA_QUERY_EVENTS_BY_POC,
+    SCRIBA_QUERY_EVENTS_BY_PROJECT,
+    SCRIBA_QUERY_EVENTS_BY_STATE,
+    SCRIBA_QUERY_ALL_PEOPLE,
+    SCRIBA_QUERY_POC_BY_NAME,
+    SCRIBA_QUERY_POC_BY_COMPANY,
+    SCRIBA_QUERY_POC_BY_POSITION,
+    SCRIBA_QUERY_POC_BY_PHONENUM,
+    SCRIBA_QUERY_POC_BY_EMAIL,
+    SCRIBA_QUERY_ALL_PROJECTS,
+    SCRIBA_QUERY_PROJECTS_BY_TITLE,
+    SCRIBA_QUERY_PROJECTS_BY_COMPANY,
+    SCRIBA_QUERY_PROJECTS_BY_STATE,
+    SCRIBA_QUERY_PROJECTS_BY_TIME,
+    SCRIBA_QUERY_PROJECTS_BY_STATE_TIME
+};
+
+// number of numeric query arguments
+#define QUERY_KEY_ARGS  5
+
+// list query and its arguments; unused arguments are zero
+struct ScribaQueryKey
+{
+    enum ScribaEntityType type;         // type of entities returned by the query
+    enum ScribaQuery query;
+    const char *str;                    // string argument
+    scriba_id_t id;                     // id argument
+    long long args[QUERY_KEY_ARGS];     // numeric arguments: states, times and comparisons
+};
+
+// zero-initialize query key
+void scriba_query_key_init(struct ScribaQueryKey *key, enum ScribaEntityType type,
+                           enum ScribaQuery query);
+// copy of cached query result or NULL if the result is not cached or the table
+// has been changed since it was cached; version receives the current version
+// of the queried table to be passed to scriba_query_cache_put()
+scriba_list_t *scriba_query_cache_get(const struct ScribaQueryKey *key, unsigned long long *version);
+// put copy of query result into the cache unless the table has been changed after
+// version has been obtained; scriba_cache_invalidate*() change table versions
+void scriba_query_cache_put(const struct ScribaQueryKey *key, const scriba_list_t *result,
+                            unsigned long long version);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // SCRIBA_DB_BACKEND_H
@@ -25,46 +25,225 @@
 
 extern struct ScribaDBFuncTbl *fTbl;
 
+// retrieve events from the database, in one batch if backend supports it
+static size_t fetch_events(const scriba_id_t *ids, size_t n, struct ScribaEvent **events);
+static int upsert_event(const struct ScribaEvent *event, int overwrite);
+// drop cached event and companies listing it
+static void invalidate_event(const scriba_id_t *id, const scriba_id_t *company_id,
+                             const scriba_id_t *old_company_id);
+// drop all cached events and companies after bulk changes
+static void invalidate_events();
+
 // get event info by id
 struct ScribaEvent *scriba_getEvent(scriba_id_t id)
 {
-    return (fTbl->getEvent(id));
+    unsigned long long version = scriba_cache_version();
+    struct ScribaEvent *event = (struct ScribaEvent *)scriba_cache_get(SCRIBA_ENTITY_EVENT, &id);
+
+    if (event == NULL)
+    {
+        event = fTbl->getEvent(id);
+        scriba_cache_put(SCRIBA_ENTITY_EVENT, event, version);
+    }
+    return event;
+}
+
+// get shared event info by id
+const struct ScribaEvent *scriba_getSharedEvent(scriba_id_t id)
+{
+    unsigned long long version = scriba_cache_version();
+    const struct ScribaEvent *event = (const struct ScribaEvent *)scriba_cache_get_shared(SCRIBA_ENTITY_EVENT, &id);
+
+    if (event == NULL)
+    {
+        // the entity is shared once, the cache and the caller hold a reference each
+        struct ScribaEvent *fetched = fTbl->getEvent(id);
+        event = (const struct ScribaEvent *)scriba_entity_share(SCRIBA_ENTITY_EVENT, fetched);
+        scriba_freeEventData(fetched);
+        scriba_cache_put(SCRIBA_ENTITY_EVENT, event, version);
+    }
+    return event;
+}
+
+// get info of several events by their ids
+size_t scriba_getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events)
+{
+    unsigned long long version = scriba_cache_version();
+    scriba_id_t *missing_ids = NULL;
+    struct ScribaEvent **missing = NULL;
+    size_t num_missing = 0;
+    size_t found = 0;
+
+    if ((ids == NULL) || (events == NULL))
+    {
+        return 0;
+    }
+    if ((n == 0) || !scriba_cache_enabled())
+    {
+        return fetch_events(ids, n, events);
+    }
+
+    // take cached events, retrieve the rest from the database at once
+    missing_ids = (scriba_id_t *)scriba_malloc(n * sizeof (scriba_id_t));
+    missing = (struct ScribaEvent **)scriba_malloc(n * sizeof (struct ScribaEvent *));
+    if ((missing_ids == NULL) || (missing == NULL))
+    {
+        scriba_free(missing_ids);
+        scriba_free(missing);
+        return fetch_events(ids, n, events);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        events[i] = (struct ScribaEvent *)scriba_cache_get(SCRIBA_ENTITY_EVENT, &(ids[i]));
+        if (events[i] == NULL)
+        {
+            scriba_id_copy(&(missing_ids[num_missing]), &(ids[i]));
+            num_missing++;
+        }
+    }
+    if (num_missing != 0)
+    {
+        fetch_events(missing_ids, num_missing, missing);
+    }
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        if (events[i] == NULL)
+        {
+            events[i] = missing[j++];
+            scriba_cache_put(SCRIBA_ENTITY_EVENT, events[i], version);
+        }
+        if (events[i] != NULL)
+        {
+            found++;
+        }
+    }
+    scriba_free(missing_ids);
+    scriba_free(missing);
+
+    return found;
+}
+
+// retrieve events from the database
+static size_t fetch_events(const scriba_id_t *ids, size_t n, struct ScribaEvent **events)
+{
+    size_t found = 0;
+
+    if (fTbl->getEvents != NULL)
+    {
+        return fTbl->getEvents(ids, n, events);
+    }
+
+    // backend does not support batch retrieval
+    for (size_t i = 0; i < n; i++)
+    {
+        events[i] = fTbl->getEvent(ids[i]);
+        if (events[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
 }
 
 // get all events
 scriba_list_t *scriba_getAllEvents()
 {
-    return (fTbl->getAllEvents());
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_ALL_EVENTS);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getAllEvents();
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // search events by description
 scriba_list_t *scriba_getEventsByDescr(const char *descr)
 {
-    return (fTbl->getEventsByDescr(descr));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_EVENTS_BY_DESCR);
+    key.str = descr;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getEventsByDescr(descr);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all events associated with given company
 scriba_list_t *scriba_getEventsByCompany(scriba_id_t id)
 {
-    return (fTbl->getEventsByCompany(id));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_EVENTS_BY_COMPANY);
+    scriba_id_copy(&(key.id), &id);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getEventsByCompany(id);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all events associated with given person
 scriba_list_t *scriba_getEventsByPOC(scriba_id_t id)
 {
-    return (fTbl->getEventsByPOC(id));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_EVENTS_BY_POC);
+    scriba_id_copy(&(key.id), &id);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getEventsByPOC(id);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all events associated with given project
 scriba_list_t *scriba_getEventsByProject(scriba_id_t id)
 {
-    return (fTbl->getEventsByProject(id));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_EVENTS_BY_PROJECT);
+    scriba_id_copy(&(key.id), &id);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getEventsByProject(id);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all events with given state
 scriba_list_t *scriba_getEventsByState(enum ScribaEventState state)
 {
-    return (fTbl->getEventsByState(state));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_EVENT, SCRIBA_QUERY_EVENTS_BY_STATE);
+    key.args[0] = state;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getEventsByState(state);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // add new event to the database
@@ -76,6 +255,7 @@ void scriba_addEvent(const char *descr, scriba_id_t company_id, scriba_id_t poc_
 
     scriba_id_create(&id);
     fTbl->addEvent(id, descr, company_id, poc_id, project_id, type, outcome, timestamp, state);
+    invalidate_event(&id, &company_id, NULL);
 }
 
 // add event with given ID to the database
@@ -85,49 +265,332 @@ void scriba_addEventWithID(scriba_id_t id, const char *descr, scriba_id_t compan
                            scriba_time_t timestamp, enum ScribaEventState state)
 {
     fTbl->addEvent(id, descr, company_id, poc_id, project_id, type, outcome, timestamp, state);
+    invalidate_event(&id, &company_id, NULL);
 }
 
 // update event info
 void scriba_updateEvent(const struct ScribaEvent *event)
 {
+    scriba_id_t old_company_id;
+    int has_old = 0;
+
+    if (event != NULL)
+    {
+        has_old = scriba_cache_owner(SCRIBA_ENTITY_EVENT, &(event->id), &old_company_id);
+    }
     fTbl->updateEvent(event);
+    if (event != NULL)
+    {
+        invalidate_event(&(event->id), &(event->company_id), has_old ? &old_company_id : NULL);
+    }
 }
 
 // delete event info from the database
 void scriba_removeEvent(scriba_id_t id)
 {
+    scriba_id_t old_company_id;
+    int has_old = scriba_cache_owner(SCRIBA_ENTITY_EVENT, &id, &old_company_id);
+
     fTbl->removeEvent(id);
+    invalidate_event(&id, NULL, has_old ? &old_company_id : NULL);
+}
+
+// insert event or merge it with existing one
+int scriba_upsertEvent(const struct ScribaEvent *event, int overwrite)
+{
+    scriba_id_t old_company_id;
+    int has_old = 0;
+
+    if (event != NULL)
+    {
+        has_old = scriba_cache_owner(SCRIBA_ENTITY_EVENT, &(event->id), &old_company_id);
+    }
+    int ret = upsert_event(event, overwrite);
+    if ((ret == SCRIBA_UPSERT_UPDATED) || (ret == SCRIBA_UPSERT_INSERTED))
+    {
+        invalidate_event(&(event->id), &(event->company_id), has_old ? &old_company_id : NULL);
+    }
+    return ret;
+}
+
+// insert event or merge it with existing one in the database
+static int upsert_event(const struct ScribaEvent *event, int overwrite)
+{
+    struct ScribaEvent *existing = NULL;
+
+    if (event == NULL)
+    {
+        return -1;
+    }
+
+    if (fTbl->upsertEvent != NULL)
+    {
+        return fTbl->upsertEvent(event, overwrite);
+    }
+
+    // backend does not support upsert
+    existing = fTbl->getEvent(event->id);
+    if (existing == NULL)
+    {
+        fTbl->addEvent(event->id, event->descr, event->company_id, event->poc_id,
+                       event->project_id, event->type, event->outcome, event->timestamp,
+                       event->state);
+        return SCRIBA_UPSERT_INSERTED;
+    }
+    scriba_freeEventData(existing);
+    if (overwrite)
+    {
+        fTbl->updateEvent(event);
+        return SCRIBA_UPSERT_UPDATED;
+    }
+    return SCRIBA_UPSERT_KEPT;
+}
+
+// call func for each event matching the filter or for all events
+int scriba_scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx)
+{
+    const scriba_id_t *ids = NULL;
+    scriba_id_t *all_ids = NULL;
+    size_t n = 0;
+
+    if (func == NULL)
+    {
+        return -1;
+    }
+
+    if (fTbl->scanEvents != NULL)
+    {
+        return fTbl->scanEvents(filter, func, ctx);
+    }
+
+    // backend does not support scans, retrieve events in batches
+    if ((filter != NULL) && (filter->ids != NULL))
+    {
+        ids = filter->ids;
+        n = filter->num_ids;
+    }
+    else
+    {
+        scriba_list_t *list = fTbl->getAllEvents();
+        all_ids = scriba_list_to_ids(list, &n);
+        scriba_list_delete(list);
+        ids = all_ids;
+    }
+    for (size_t start = 0; start < n; start += SCRIBA_SCAN_BATCH_SIZE)
+    {
+        struct ScribaEvent *events[SCRIBA_SCAN_BATCH_SIZE];
+        size_t num = ((n - start) > SCRIBA_SCAN_BATCH_SIZE) ? SCRIBA_SCAN_BATCH_SIZE : (n - start);
+
+        scriba_getEvents(ids + start, num, events);
+        for (size_t i = 0; i < num; i++)
+        {
+            if (events[i] == NULL)
+            {
+                continue;
+            }
+            if (scriba_scan_filter_match(filter, &(events[i]->id), &(events[i]->company_id), NULL))
+            {
+                func(events[i], ctx);
+            }
+            scriba_freeEventData(events[i]);
+        }
+    }
+    if (all_ids != NULL)
+    {
+        scriba_free(all_ids);
+    }
+
+    return 0;
+}
+
+// check whether event matches the filter
+static int event_matches(const struct ScribaEvent *event, const struct ScribaEventFilter *filter)
+{
+    if ((filter->flags & SCRIBA_EVENT_FILTER_STATE) && (event->state != filter->state))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_TYPE) && (event->type != filter->type))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_COMPANY) &&
+        !scriba_id_compare(&(event->company_id), &(filter->company_id)))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_POC) &&
+        !scriba_id_compare(&(event->poc_id), &(filter->poc_id)))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_PROJECT) &&
+        !scriba_id_compare(&(event->project_id), &(filter->project_id)))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_TIME_FROM) && (event->timestamp < filter->time_from))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_EVENT_FILTER_TIME_TO) && (event->timestamp >= filter->time_to))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+// apply update or removal to each event matching the filter one by one;
+// used if backend does not support bulk operations
+static long event_bulk_fallback(const struct ScribaEventFilter *filter,
+                                const struct ScribaEventUpdate *update)
+{
+    long count = 0;
+    scriba_list_t *events = fTbl->getAllEvents();
+
+    scriba_list_for_each(events, item)
+    {
+        struct ScribaEvent *event = fTbl->getEvent(item->id);
+        if (event == NULL)
+        {
+            continue;
+        }
+        if (event_matches(event, filter))
+        {
+            if (update == NULL)
+            {
+                fTbl->removeEvent(event->id);
+            }
+            else
+            {
+                char *outcome = event->outcome;
+                if (update->flags & SCRIBA_EVENT_SET_STATE)
+                {
+                    event->state = update->state;
+                }
+                if (update->flags & SCRIBA_EVENT_SET_TYPE)
+                {
+                    event->type = update->type;
+                }
+                if (update->flags & SCRIBA_EVENT_SET_OUTCOME)
+                {
+                    event->outcome = (char *)update->outcome;
+                }
+                if (update->flags & SCRIBA_EVENT_SET_TIMESTAMP)
+                {
+                    event->timestamp = update->timestamp;
+                }
+                fTbl->updateEvent(event);
+                event->outcome = outcome;
+            }
+            count++;
+        }
+        scriba_freeEventData(event);
+    }
+    scriba_list_delete(events);
+
+    return count;
+}
+
+// update all events matching the filter
+long scriba_updateEvents(const struct ScribaEventFilter *filter,
+                         const struct ScribaEventUpdate *update)
+{
+    if ((filter == NULL) || (update == NULL))
+    {
+        return -1;
+    }
+    if (update->flags == 0)
+    {
+        // nothing to update
+        return 0;
+    }
+
+    long ret = (fTbl->updateEvents != NULL) ? fTbl->updateEvents(filter, update) :
+                                              event_bulk_fallback(filter, update);
+    if (ret != 0)
+    {
+        invalidate_events();
+    }
+    return ret;
+}
+
+// remove all events matching the filter
+long scriba_removeEvents(const struct ScribaEventFilter *filter)
+{
+    if (filter == NULL)
+    {
+        return -1;
+    }
+
+    long ret = (fTbl->removeEvents != NULL) ? fTbl->removeEvents(filter) :
+                                              event_bulk_fallback(filter, NULL);
+    if (ret != 0)
+    {
+        invalidate_events();
+    }
+    return ret;
+}
+
+static void invalidate_event(const scriba_id_t *id, const scriba_id_t *company_id,
+                             const scriba_id_t *old_company_id)
+{
+    scriba_cache_invalidate(SCRIBA_ENTITY_EVENT, id);
+    if (company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(company_id);
+    }
+    if (old_company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(old_company_id);
+    }
+}
+
+// bulk operations may change any event and child lists of any company
+static void invalidate_events()
+{
+    scriba_cache_invalidate_all(SCRIBA_ENTITY_EVENT);
+    scriba_cache_invalidate_owners();
+}
+
+// size of string storage required to copy string field, empty strings are not copied
+static size_t field_size(const char *str)
+{
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
 }
 
 // create a copy of event data structure
 struct ScribaEvent *scriba_copyEvent(const struct ScribaEvent *event)
 {
-    int len = 0;
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
 
     if (event == NULL)
     {
         return NULL;
     }
 
-    struct ScribaEvent *ret = (struct ScribaEvent *)malloc(sizeof (struct ScribaEvent));
-    memset(ret, 0, sizeof (struct ScribaEvent));
+    size_t str_size = field_size(event->descr) + field_size(event->outcome);
+    struct ScribaEvent *ret = (struct ScribaEvent *)scriba_entity_alloc(sizeof (struct ScribaEvent),
+                                                                        str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
 
     scriba_id_copy(&(ret->id), &(event->id));
-    if ((len = strlen(event->descr)) != 0)
+    if (field_size(event->descr) != 0)
     {
-        ret->descr = (char *)malloc(len + 1);
-        memset(ret->descr, 0, len + 1);
-        strncpy(ret->descr, event->descr, len);
+        ret->descr = scriba_entity_strcpy(&str_buf, event->descr);
     }
     scriba_id_copy(&(ret->company_id), &(event->company_id));
     scriba_id_copy(&(ret->poc_id), &(event->poc_id));
     scriba_id_copy(&(ret->project_id), &(event->project_id));
     ret->type = event->type;
-    if ((len = strlen(event->outcome)) != 0)
+    if (field_size(event->outcome) != 0)
     {
-        ret->outcome = (char *)malloc(len + 1);
-        memset(ret->outcome, 0, len + 1);
-        strncpy(ret->outcome, event->outcome, len);
+        ret->outcome = scriba_entity_strcpy(&str_buf, event->outcome);
     }
     ret->timestamp = event->timestamp;
     ret->state = event->state;
@@ -143,14 +606,29 @@ void scriba_freeEventData(struct ScribaEvent *event)
         return;
     }
 
-    if (event->descr != NULL)
+    // shared entity is freed when its last reference is dropped
+    if (event->layout == SCRIBA_LAYOUT_SHARED)
     {
-        free(event->descr);
+        scriba_release(event);
+        return;
     }
-    if (event->outcome != NULL)
+
+    // strings are allocated separately only with the default layout
+    if (event->layout == SCRIBA_LAYOUT_SEPARATE)
     {
-        free(event->outcome);
+        if (event->descr != NULL)
+        {
+            scriba_free(event->descr);
+        }
+        if (event->outcome != NULL)
+        {
+            scriba_free(event->outcome);
+        }
     }
 
-    free(event);
+    // arena memory is reclaimed by scriba_arena_reset()
+    if (event->layout != SCRIBA_LAYOUT_ARENA)
+    {
+        scriba_free(event);
+    }
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_ARENA_H
+#define SCRIBA_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// memory arena; all memory allocated from the arena is released at once
+// by scriba_arena_reset() or scriba_arena_destroy()
+typedef struct _scriba_arena scriba_arena_t;
+
+// create new arena; memory is requested from the system in chunks of
+// chunk_size bytes (0 selects the default chunk size)
+scriba_arena_t *scriba_arena_create(size_t chunk_size);
+// allocate size bytes from the arena
+void *scriba_arena_alloc(scriba_arena_t *arena, size_t size);
+// release all memory allocated from the arena; chunks are kept for reuse
+void scriba_arena_reset(scriba_arena_t *arena);
+// destroy the arena and free all its chunks
+void scriba_arena_destroy(scriba_arena_t *arena);
+
+// memory layout of entity data structures (ScribaCompany, ScribaPoc,
+// ScribaProject and ScribaEvent) created by the library
+enum ScribaEntityLayout
+{
+    SCRIBA_LAYOUT_SEPARATE = 0,     // structure and each string field are allocated separately
+    SCRIBA_LAYOUT_BLOCK = 1,        // structure and its strings share one heap block
+    SCRIBA_LAYOUT_ARENA = 2,        // structure and its strings share one block in an arena
+    SCRIBA_LAYOUT_SHARED = 3        // immutable reference-counted structure, see scriba_retain()
+};
+
+// select memory layout of entity data structures returned by scriba_get*()
+// and scriba_copy*() functions; arena is required for SCRIBA_LAYOUT_ARENA
+// and ignored otherwise.
+// Entities with SCRIBA_LAYOUT_BLOCK layout are still freed by scriba_free*Data(),
+// but their string fields must not be freed or reallocated individually.
+// For SCRIBA_LAYOUT_ARENA, scriba_free*Data() only releases company child lists,
+// the rest of memory is reclaimed by scriba_arena_reset().
+// SCRIBA_LAYOUT_SHARED can't be selected, shared entities are returned
+// by scriba_getShared*() functions only.
+void scriba_setEntityLayout(enum ScribaEntityLayout layout, scriba_arena_t *arena);
+
+// Shared entities are immutable entity data structures with reference counter,
+// they are shared by the entity cache and all their users without copying.
+// Entity returned by scriba_getShared*() holds one reference; scriba_retain()
+// adds a reference, scriba_release() drops it, and the entity is freed when
+// the last reference is dropped. scriba_free*Data() drops a reference as well.
+// Shared entities may be used by several threads at once, but must not be
+// modified; scriba_copy*() creates a private modifiable copy.
+void scriba_retain(const void *entity);
+void scriba_release(const void *entity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_ARENA_H
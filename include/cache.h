@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_CACHE_H
+#define SCRIBA_CACHE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// entity cache statistics
+struct ScribaCacheStats
+{
+    unsigned long long hits;            // entities returned from the cache
+    unsigned long long misses;          // entities retrieved from the database
+    unsigned long long evictions;       // entities evicted to stay within the cache size
+    unsigned long long invalidations;   // entities dropped because they have changed
+    size_t entries;                     // number of cached entities
+    size_t size;                        // memory used by cached entities in bytes
+};
+
+// Set size of the cache of entities returned by scriba_get*() functions in bytes;
+// least recently used entities are evicted when cached entities take more memory.
+// The cache is disabled by default and if size is 0. Changes made through the library
+// update the cache, changes made to the database by other means require
+// scriba_clearCache().
+void scriba_setCacheSize(size_t size);
+// drop all cached entities and query results
+void scriba_clearCache();
+// get cache statistics collected since the cache has been enabled
+void scriba_getCacheStats(struct ScribaCacheStats *stats);
+
+// Set size of the cache of lists returned by scriba_getAll*() and search functions
+// like scriba_getProjectsByState() in bytes. Results are cached by function and
+// arguments until any entity of the same type is changed. The cache is disabled
+// by default and if size is 0; it does not depend on the entity cache.
+void scriba_setQueryCacheSize(size_t size);
+// get query result cache statistics; invalidations are results dropped
+// because the entities have changed
+void scriba_getQueryCacheStats(struct ScribaCacheStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_CACHE_H
@@ -41,10 +41,20 @@ struct ScribaCompany
     scriba_list_t *poc_list;        // list of people associated with the company
     scriba_list_t *proj_list;       // list of projects associated with the company
     scriba_list_t *event_list;      // list of event associated with the company
+
+    // the following field is for internal use only
+    char layout;
 };
 
 // get company info by company id
 struct ScribaCompany *scriba_getCompany(scriba_id_t id);
+// get shared company info by company id; the returned entity must not be modified and should be
+// released by scriba_release() or scriba_free*Data(), see arena.h
+const struct ScribaCompany *scriba_getSharedCompany(scriba_id_t id);
+// get info of several companies by their ids; companies array of n elements receives
+// company data structures in the order of ids, NULL for ids that were not found;
+// returns the number of companies found
+size_t scriba_getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies);
 // get all companies stored in the database
 scriba_list_t *scriba_getAllCompanies();
 // search companies by name
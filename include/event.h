@@ -56,10 +56,58 @@ struct ScribaEvent
     char *outcome;                      // description of event outcome
     scriba_time_t timestamp;            // event timestamp
     enum ScribaEventState state;        // state of the event
+
+    // the following field is for internal use only
+    char layout;
+};
+
+// event filter flags, select fields compared by bulk operations
+#define SCRIBA_EVENT_FILTER_STATE       0x01    // event state equals state
+#define SCRIBA_EVENT_FILTER_TYPE        0x02    // event type equals type
+#define SCRIBA_EVENT_FILTER_COMPANY     0x04    // event is associated with company_id
+#define SCRIBA_EVENT_FILTER_POC         0x08    // event is associated with poc_id
+#define SCRIBA_EVENT_FILTER_PROJECT     0x10    // event is associated with project_id
+#define SCRIBA_EVENT_FILTER_TIME_FROM   0x20    // event timestamp is not earlier than time_from
+#define SCRIBA_EVENT_FILTER_TIME_TO     0x40    // event timestamp is earlier than time_to
+
+// event filter used by bulk operations; filter without flags matches all events
+struct ScribaEventFilter
+{
+    unsigned int flags;                 // combination of SCRIBA_EVENT_FILTER_* flags
+    enum ScribaEventState state;
+    enum ScribaEventType type;
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+    scriba_time_t time_from;
+    scriba_time_t time_to;
+};
+
+// event update flags, select fields assigned by bulk update
+#define SCRIBA_EVENT_SET_STATE          0x01
+#define SCRIBA_EVENT_SET_TYPE           0x02
+#define SCRIBA_EVENT_SET_OUTCOME        0x04
+#define SCRIBA_EVENT_SET_TIMESTAMP      0x08
+
+// field values assigned to events by bulk update
+struct ScribaEventUpdate
+{
+    unsigned int flags;                 // combination of SCRIBA_EVENT_SET_* flags
+    enum ScribaEventState state;
+    enum ScribaEventType type;
+    const char *outcome;
+    scriba_time_t timestamp;
 };
 
 // get event info by id
 struct ScribaEvent *scriba_getEvent(scriba_id_t id);
+// get shared event info by id; the returned entity must not be modified and should be
+// released by scriba_release() or scriba_free*Data(), see arena.h
+const struct ScribaEvent *scriba_getSharedEvent(scriba_id_t id);
+// get info of several events by their ids; events array of n elements receives
+// event data structures in the order of ids, NULL for ids that were not found;
+// returns the number of events found
+size_t scriba_getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events);
 // get all events
 scriba_list_t *scriba_getAllEvents();
 // search events by description
@@ -85,6 +133,13 @@ void scriba_addEventWithID(scriba_id_t id, const char *descr, scriba_id_t compan
 void scriba_updateEvent(const struct ScribaEvent *event);
 // delete event info from the database
 void scriba_removeEvent(scriba_id_t id);
+// assign given field values to all events matching the filter;
+// returns the number of updated events or -1 on failure
+long scriba_updateEvents(const struct ScribaEventFilter *filter,
+                         const struct ScribaEventUpdate *update);
+// remove all events matching the filter;
+// returns the number of removed events or -1 on failure
+long scriba_removeEvents(const struct ScribaEventFilter *filter);
 // create a copy of event data structure
 struct ScribaEvent *scriba_copyEvent(const struct ScribaEvent *event);
 // free memory occupied by event data structure
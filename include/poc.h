@@ -40,10 +40,20 @@ struct ScribaPoc
     char *email;                // email
     char *position;             // position in a company
     scriba_id_t company_id;     // company of employment
+
+    // the following field is for internal use only
+    char layout;
 };
 
 // get POC by id
 struct ScribaPoc *scriba_getPOC(scriba_id_t id);
+// get shared POC by id; the returned entity must not be modified and should be
+// released by scriba_release() or scriba_free*Data(), see arena.h
+const struct ScribaPoc *scriba_getSharedPOC(scriba_id_t id);
+// get info of several people by their ids; people array of n elements receives
+// POC data structures in the order of ids, NULL for ids that were not found;
+// returns the number of people found
+size_t scriba_getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people);
 // search people by name
 scriba_list_t *scriba_getPOCByName(const char *name);
 // get all people
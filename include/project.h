@@ -69,10 +69,56 @@ struct ScribaProject
     long long cost;                     // cost of the project
     scriba_time_t start_time;           // project start time
     scriba_time_t mod_time;             // project state modification time
+
+    // the following field is for internal use only
+    char layout;
+};
+
+// project filter flags, select fields compared by bulk operations
+#define SCRIBA_PROJECT_FILTER_STATE         0x01    // project state equals state
+#define SCRIBA_PROJECT_FILTER_COMPANY       0x02    // project is associated with company_id
+#define SCRIBA_PROJECT_FILTER_START_FROM    0x04    // start_time is not earlier than start_from
+#define SCRIBA_PROJECT_FILTER_START_TO      0x08    // start_time is earlier than start_to
+#define SCRIBA_PROJECT_FILTER_MOD_FROM      0x10    // mod_time is not earlier than mod_from
+#define SCRIBA_PROJECT_FILTER_MOD_TO        0x20    // mod_time is earlier than mod_to
+
+// project filter used by bulk operations; filter without flags matches all projects
+struct ScribaProjectFilter
+{
+    unsigned int flags;                 // combination of SCRIBA_PROJECT_FILTER_* flags
+    enum ScribaProjectState state;
+    scriba_id_t company_id;
+    scriba_time_t start_from;
+    scriba_time_t start_to;
+    scriba_time_t mod_from;
+    scriba_time_t mod_to;
+};
+
+// project update flags, select fields assigned by bulk update
+#define SCRIBA_PROJECT_SET_STATE            0x01
+#define SCRIBA_PROJECT_SET_COMPANY          0x02
+#define SCRIBA_PROJECT_SET_CURRENCY         0x04
+#define SCRIBA_PROJECT_SET_COST             0x08
+
+// field values assigned to projects by bulk update
+struct ScribaProjectUpdate
+{
+    unsigned int flags;                 // combination of SCRIBA_PROJECT_SET_* flags
+    enum ScribaProjectState state;
+    scriba_id_t company_id;
+    enum ScribaCurrency currency;
+    long long cost;
 };
 
 // get project by id
 struct ScribaProject *scriba_getProject(scriba_id_t id);
+// get shared project by id; the returned entity must not be modified and should be
+// released by scriba_release() or scriba_free*Data(), see arena.h
+const struct ScribaProject *scriba_getSharedProject(scriba_id_t id);
+// get info of several projects by their ids; projects array of n elements receives
+// project data structures in the order of ids, NULL for ids that were not found;
+// returns the number of projects found
+size_t scriba_getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects);
 // get all projects in the database
 scriba_list_t *scriba_getAllProjects();
 // search projects by title
@@ -103,6 +149,14 @@ void scriba_addProjectWithID(scriba_id_t id, const char *title, const char *desc
 void scriba_updateProject(struct ScribaProject *project);
 // remove project from the database
 void scriba_removeProject(scriba_id_t id);
+// assign given field values to all projects matching the filter; mod_time of
+// projects whose state is changed is updated; returns the number of updated
+// projects or -1 on failure
+long scriba_updateProjects(const struct ScribaProjectFilter *filter,
+                           const struct ScribaProjectUpdate *update);
+// remove all projects matching the filter;
+// returns the number of removed projects or -1 on failure
+long scriba_removeProjects(const struct ScribaProjectFilter *filter);
 // create a copy of project data structure
 struct ScribaProject *scriba_copyProject(const struct ScribaProject *project);
 // free memory occupied by project data structure
@@ -60,7 +60,8 @@ struct ScribaDB
 {
     char *name;                         // unique backend name
     enum ScribaDBType type;             // backend type
-    char *location;                     // location (for external backends only)
+    char *location;                     // path to shared library of external backend,
+                                        // ignored for built-in backends
 };
 
 // initialize libscriba
@@ -45,22 +45,305 @@ enum ScribaMergeStrategy
 enum ScribaMergeStatus
 {
     SCRIBA_MERGE_OK = 0,
-    SCRIBA_MERGE_CONFLICTS
+    SCRIBA_MERGE_CONFLICTS,
+    SCRIBA_MERGE_FAILED                 // entries of the failed transaction have not been stored
 };
 
 // serialize the given entries into binary buffer and return the buffer pointer
-// buflen will contain buffer size
+// buflen will contain buffer size; the buffer should be freed by scriba_free()
 void *scriba_serialize(scriba_list_t *companies,
                        scriba_list_t *events,
                        scriba_list_t *people,
                        scriba_list_t *projects,
                        unsigned long *buflen);
 
+// serialization filter flags
+#define SCRIBA_SERIALIZE_COMPANIES  0x01    // export data of listed companies only
+#define SCRIBA_SERIALIZE_MOD_SINCE  0x02    // export projects modified since given time only
+#define SCRIBA_SERIALIZE_COMPACT    0x04    // produce compact buffer, see below
+
+// filter selecting entries exported by scriba_serializeFiltered()
+struct ScribaSerializeFilter
+{
+    unsigned int flags;                 // combination of SCRIBA_SERIALIZE_* flags
+    scriba_list_t *companies;           // listed companies and people, projects and
+                                        // events associated with them are exported
+    scriba_time_t mod_since;            // minimal project mod_time; other entries have
+                                        // no modification time and are not affected
+};
+
+/* Compact buffer keeps each id once in the id table, entities refer to it by
+ * 32-bit index and zero ids are not stored at all; equal strings are stored once.
+ * Compact buffer is usually much smaller, it is read by the same functions as
+ * the original one. Buffers are versioned: readers fail on buffers of schema
+ * newer than they support, readers older than compact buffers find no entries
+ * in them. Stream writers ignore SCRIBA_SERIALIZE_COMPACT. */
+
+// serialize all entries in the local database into binary buffer and return
+// the buffer pointer; the database is read as a consistent snapshot;
+// buflen will contain buffer size; the buffer should be freed by scriba_free()
+void *scriba_serializeAll(unsigned long *buflen);
+
+// serialize entries of the local database selected by the given filter, the same
+// way as scriba_serializeAll() does; NULL filter selects all entries
+void *scriba_serializeFiltered(const struct ScribaSerializeFilter *filter, unsigned long *buflen);
+
+// serialized data kept in the serializer's own buffer
+struct ScribaSerializedBuffer
+{
+    const void *data;                   // serialized data
+    unsigned long len;                  // data size
+    void *priv;                         // for internal use only
+};
+
+// serialize entries selected by the filter the same way as scriba_serializeFiltered()
+// does, but hand over the serializer's buffer instead of copying it; buf receives
+// pointer to serialized data and its size; the data should be released by
+// scriba_freeSerializedBuffer(); returns 0 on success, -1 on failure
+int scriba_serializeToBuffer(const struct ScribaSerializeFilter *filter,
+                             struct ScribaSerializedBuffer *buf);
+
+// release data returned by scriba_serializeToBuffer()
+void scriba_freeSerializedBuffer(struct ScribaSerializedBuffer *buf);
+
+// serialize entries selected by the filter and write serialized data directly
+// to the given file descriptor; returns 0 on success, -1 on failure
+int scriba_serializeToFd(const struct ScribaSerializeFilter *filter, int fd);
+
+// serialize entries selected by the filter and write serialized data to the file
+// at the given path, the file is created or truncated;
+// returns 0 on success, -1 on failure
+int scriba_serializeToFile(const struct ScribaSerializeFilter *filter, const char *path);
+
+// token identifying the state of the local database for incremental sync
+typedef unsigned long long scriba_sync_token_t;
+
+// serialize entries changed since the state identified by token, the same way as
+// scriba_serializeAll() does; entries removed since then are serialized as removal
+// records; token 0 selects all entries; new_token receives the token of the
+// exported state, which should be passed to the next call; if backend does not
+// track changes, all entries are serialized and new_token receives 0
+void *scriba_serializeChangesSince(scriba_sync_token_t token,
+                                   scriba_sync_token_t *new_token,
+                                   unsigned long *buflen);
+
+/* Compressed frame holds serialized buffer compressed by the built-in LZ77 codec,
+ * optionally with a dictionary. Functions reading serialized buffers
+ * (scriba_deserialize() and others) detect the frame and decompress it
+ * transparently. The frame compressed with dictionary can only be read if the
+ * same dictionary is set by scriba_setCompressionDict(). */
+
+// maximum size of compression dictionary
+#define SCRIBA_COMPRESS_DICT_MAX_SIZE 65535
+
+// compress serialized buffer into frame and return the frame pointer; framelen
+// will contain frame size; the frame should be freed by scriba_free();
+// returns NULL on failure
+void *scriba_compress(const void *buf, unsigned long buflen, unsigned long *framelen);
+
+// decompress frame into serialized buffer and return the buffer pointer; buflen
+// will contain buffer size; the buffer should be freed by scriba_free();
+// returns NULL if the frame is malformed or the dictionary does not match
+void *scriba_decompress(const void *frame, unsigned long framelen, unsigned long *buflen);
+
+// returns non-zero if the given buffer is compressed frame
+int scriba_isCompressed(const void *buf, unsigned long buflen);
+
+// serialize entries selected by the filter the same way as scriba_serializeFiltered()
+// does and compress them into frame; returns NULL on failure
+void *scriba_serializeCompressed(const struct ScribaSerializeFilter *filter,
+                                 unsigned long *framelen);
+
+// build compression dictionary of up to dict_len bytes (SCRIBA_COMPRESS_DICT_MAX_SIZE
+// at most) out of strings frequent in n sample serialized buffers; returns
+// dictionary size, 0 if there is not enough sample data
+unsigned long scriba_trainCompressionDict(const void *const *samples,
+                                          const unsigned long *sample_lens,
+                                          unsigned int n,
+                                          void *dict, unsigned long dict_len);
+
+// set dictionary used to compress and decompress frames, the dictionary is copied;
+// NULL dictionary disables it; should not be called while other threads use
+// the serializer; the dictionary should be disabled before the allocator is
+// changed; returns 0 on success, -1 if the dictionary is too large
+int scriba_setCompressionDict(const void *dict, unsigned long dict_len);
+
 // read entry data from the given buffer and store it in the local database
-// according to the given merge strategy
+// according to the given merge strategy; entities of removal records are removed
+// from the local database only with SCRIBA_MERGE_REMOTE_OVERRIDE, local data is kept
+// with other strategies; all entries are stored by a single
+// transaction, if any of them can not be stored, none of them are stored and
+// SCRIBA_MERGE_FAILED is returned
 enum ScribaMergeStatus scriba_deserialize(void *buf, unsigned long buflen,
                                           enum ScribaMergeStrategy strategy);
 
+// read entry data from the given buffer and store it in the local database the
+// same way as scriba_deserialize() does, but commit every batch_size entries
+// (0 stores all entries by a single transaction); in case of failure only the
+// current batch is discarded, entries of already committed batches are kept
+enum ScribaMergeStatus scriba_deserializeBatched(void *buf, unsigned long buflen,
+                                                 enum ScribaMergeStrategy strategy,
+                                                 unsigned long batch_size);
+
+// same as scriba_deserializeBatched(), but entries are decoded by num_threads
+// threads while the calling thread stores already decoded entries; entries are
+// stored in the same order, so the result does not depend on the number of threads;
+// num_threads 0 selects the number of threads by the number of CPU cores
+enum ScribaMergeStatus scriba_deserializeParallel(void *buf, unsigned long buflen,
+                                                  enum ScribaMergeStrategy strategy,
+                                                  unsigned long batch_size,
+                                                  unsigned int num_threads);
+
+// read entry data from the file at the given path and store it in the local
+// database the same way as scriba_deserialize() does; the file is mapped into
+// memory instead of being read into a buffer, compressed frames are decompressed
+// into memory though; the file is checked to hold well-formed serialized buffer
+// before anything is stored and should not be modified until the call returns
+enum ScribaMergeStatus scriba_deserializeFile(const char *path, enum ScribaMergeStrategy strategy);
+
+// merge statistics: entries of the local database inserted, overwritten by
+// remote data and skipped, either because local data is kept according to
+// the merge strategy or because local data is the same as remote data
+struct ScribaMergeStats
+{
+    unsigned long inserted;
+    unsigned long updated;
+    unsigned long skipped;
+};
+
+// get merge statistics of the last deserialize call of the calling process;
+// with stream reader statistics cover chunks applied so far by the last
+// created reader; removal records are not counted
+void scriba_getMergeStats(struct ScribaMergeStats *stats);
+
+/* Stream format allows to export and import large databases in bounded memory.
+ * The stream is a sequence of chunks, each chunk is 32-bit little-endian size
+ * followed by serialized buffer of that size, the same as produced by
+ * scriba_serialize(), holding up to chunk_size entries of any type.
+ * Chunk of zero size marks the end of the stream. */
+
+// default number of entries in a stream chunk
+#define SCRIBA_STREAM_CHUNK_SIZE 1024
+
+// function receiving stream data; returns 0 on success,
+// any other value stops the stream writer
+typedef int (*scriba_stream_write_fn)(const void *data, unsigned long len, void *ctx);
+
+// incremental stream writer
+typedef struct _scriba_stream_writer scriba_stream_writer_t;
+
+struct ScribaCompany;
+struct ScribaEvent;
+struct ScribaPoc;
+struct ScribaProject;
+
+// create stream writer; each chunk is passed to the write function as soon as
+// chunk_size entries are added to it (0 selects the default chunk size)
+scriba_stream_writer_t *scriba_stream_writer_create(unsigned long chunk_size,
+                                                    scriba_stream_write_fn write,
+                                                    void *ctx);
+// add entry to the stream; returns 0 on success, -1 if the stream could not be written
+int scriba_stream_write_company(scriba_stream_writer_t *writer, const struct ScribaCompany *company);
+int scriba_stream_write_event(scriba_stream_writer_t *writer, const struct ScribaEvent *event);
+int scriba_stream_write_poc(scriba_stream_writer_t *writer, const struct ScribaPoc *poc);
+int scriba_stream_write_project(scriba_stream_writer_t *writer, const struct ScribaProject *project);
+// write the last chunk and the end of stream mark and destroy the writer;
+// returns 0 if the whole stream has been written successfully, -1 otherwise
+int scriba_stream_writer_finish(scriba_stream_writer_t *writer);
+
+// serialize entries selected by the filter (NULL selects all entries) into stream
+// passed to the given write function; the database is read as a consistent snapshot;
+// returns 0 on success, -1 on failure
+int scriba_serializeStream(const struct ScribaSerializeFilter *filter,
+                           unsigned long chunk_size,
+                           scriba_stream_write_fn write,
+                           void *ctx);
+
+// serialize entries selected by the filter into stream written to file descriptor;
+// returns 0 on success, -1 on failure
+int scriba_serializeStreamToFd(const struct ScribaSerializeFilter *filter,
+                               unsigned long chunk_size,
+                               int fd);
+
+// serialize entries selected by the filter into stream the same way as
+// scriba_serializeStream() does, but split entries into num_threads shards that are
+// read and encoded by separate threads (0 selects the number of threads by the
+// number of CPU cores); chunks of different shards are interleaved in the stream,
+// the write function is never called by two threads at once; falls back to
+// scriba_serializeStream() if backend does not support parallel reads;
+// returns 0 on success, -1 on failure
+int scriba_serializeParallel(const struct ScribaSerializeFilter *filter,
+                             unsigned long chunk_size,
+                             unsigned int num_threads,
+                             scriba_stream_write_fn write,
+                             void *ctx);
+
+// serialize entries selected by the filter by num_threads threads into stream
+// written to file descriptor; returns 0 on success, -1 on failure
+int scriba_serializeParallelToFd(const struct ScribaSerializeFilter *filter,
+                                 unsigned long chunk_size,
+                                 unsigned int num_threads,
+                                 int fd);
+
+// incremental stream reader
+typedef struct _scriba_stream_reader scriba_stream_reader_t;
+
+// create stream reader storing entries in the local database according to
+// the given merge strategy
+scriba_stream_reader_t *scriba_stream_reader_create(enum ScribaMergeStrategy strategy);
+// feed stream data of any size to the reader; entries of each complete chunk are
+// stored right away by a single transaction; returns 0 on success, -1 if the
+// stream is malformed or the chunk could not be stored
+int scriba_stream_reader_feed(scriba_stream_reader_t *reader, const void *data, unsigned long len);
+// destroy the reader; status receives merge outcome of all stored entries;
+// returns 0 if the whole stream has been read, -1 if it is malformed or incomplete
+int scriba_stream_reader_finish(scriba_stream_reader_t *reader, enum ScribaMergeStatus *status);
+
+// read stream from file descriptor until the end of stream mark and store its
+// entries in the local database; returns 0 on success, -1 on failure
+int scriba_deserializeStreamFromFd(int fd, enum ScribaMergeStrategy strategy,
+                                   enum ScribaMergeStatus *status);
+
+/* Reconciliation finds entities that differ between two databases without
+ * sending all of them. Each side takes a snapshot of entity data hashes of its
+ * database and describes it by hashes of id ranges; the sides exchange messages,
+ * splitting ranges whose hashes differ into smaller ones until differing entities
+ * are found. Messages are serialized buffers carried by any transport the
+ * application provides: one side creates the first message, then each side passes
+ * messages it receives to scriba_reconciler_process() and sends back the reply
+ * until there is no reply. Then each side exports the entities it has found
+ * different, the peer imports them with scriba_deserialize(). Entities missing
+ * on one side are found by the other side, entities present on both sides with
+ * different data are found by both sides; for the databases to converge the side
+ * whose data should win imports with SCRIBA_MERGE_LOCAL_OVERRIDE and the other one
+ * with SCRIBA_MERGE_REMOTE_OVERRIDE. */
+
+// reconciliation state
+typedef struct _scriba_reconciler scriba_reconciler_t;
+
+// create reconciler holding a snapshot of entity hashes of the local database;
+// the database is not accessed until the reconciler serializes entities
+scriba_reconciler_t *scriba_reconciler_create();
+// create the first message of the exchange; the message should be freed by scriba_free()
+void *scriba_reconciler_start(scriba_reconciler_t *rec, unsigned long *msglen);
+// process message received from the peer; reply receives message that should be
+// sent back and freed by scriba_free(), or NULL if reconciliation is complete;
+// returns 0 on success, -1 if the message is malformed
+int scriba_reconciler_process(scriba_reconciler_t *rec, const void *msg, unsigned long msglen,
+                              void **reply, unsigned long *replylen);
+// number of local entities found different from the peer's ones so far
+unsigned long scriba_reconciler_count(const scriba_reconciler_t *rec);
+// serialize local entities found different the same way as scriba_serialize() does
+void *scriba_reconciler_serialize(const scriba_reconciler_t *rec, unsigned long *buflen);
+// destroy the reconciler
+void scriba_reconciler_free(scriba_reconciler_t *rec);
+
+// run the whole exchange over file descriptor connected to the peer, such as
+// socket; each message is preceded by its 32-bit little-endian size, zero size
+// means no reply; initiator is non-zero for the side sending the first message;
+// returns 0 on success, -1 on failure
+int scriba_reconcileOverFd(scriba_reconciler_t *rec, int fd, int initiator);
+
 #ifdef __cplusplus
 }
 #endif
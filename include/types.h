@@ -21,11 +21,37 @@
 #ifndef SCRIBA_TYPES_H
 #define SCRIBA_TYPES_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+// memory allocation functions; ctx is the context pointer given
+// to scriba_set_allocator()
+typedef void *(*scriba_malloc_fn)(size_t size, void *ctx);
+typedef void *(*scriba_realloc_fn)(void *ptr, size_t size, void *ctx);
+typedef void (*scriba_free_fn)(void *ptr, void *ctx);
+
+// make the library, including SQLite backend, allocate memory with the given
+// functions; passing NULL restores standard malloc(), realloc() and free().
+// Must be called before scriba_init() or after scriba_cleanup(); memory
+// returned by the library must be released before the allocator is changed.
+// SQLite uses the allocator only if it has not been initialized in the process
+// before scriba_init(), otherwise it keeps its own. If SQLite does use it,
+// scriba_cleanup() shuts SQLite down to release the memory, so other SQLite
+// users in the process must not be active at that time.
+void scriba_set_allocator(scriba_malloc_fn malloc_fn, scriba_realloc_fn realloc_fn,
+                          scriba_free_fn free_fn, void *ctx);
+
+// allocate, reallocate and free memory using the library allocator;
+// memory returned by the library (id strings and blobs, serialized data etc.)
+// should be released with scriba_free()
+void *scriba_malloc(size_t size);
+void *scriba_realloc(void *ptr, size_t size);
+void scriba_free(void *ptr);
+
 #define SCRIBA_ID_BLOB_SIZE     16      // size of scriba id binary blob in bytes
 
 // unique record id
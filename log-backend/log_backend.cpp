@@ -0,0 +1,1110 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "log_backend.h"
+#include "memory_backend.h"
+#include "snapshot_backend.h"
+#include "scriba_generated.h"
+#include "company.h"
+#include "event.h"
+#include "poc.h"
+#include "project.h"
+#include "stl_allocator.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SCRIBA_LOG_DEFAULT_SYNC_INTERVAL 10
+#define SCRIBA_LOG_DEFAULT_CHECKPOINT_SIZE (16ULL * 1024 * 1024)
+
+// suffixes of the checkpoint file and of the log started by a checkpoint
+// that has not been finished yet
+#define SCRIBA_LOG_CHECKPOINT_SUFFIX ".checkpoint"
+#define SCRIBA_LOG_NEXT_SUFFIX ".next"
+
+namespace scriba
+{
+
+namespace fb = flatbuffers;
+
+/* Log record: 32-bit size of the Entries buffer, 32-bit checksum of the buffer,
+ * the buffer and padding to 8 bytes, so that buffers stay aligned. Numbers are
+ * in host byte order. Records that are cut short, fail the checksum or do not
+ * hold valid entries end the log, they are left by writes interrupted by a crash. */
+struct RecordHeader
+{
+    uint32_t size;
+    uint32_t checksum;
+};
+
+typedef std::pair<unsigned long long, unsigned long long> IdKey;
+
+// backend state is kept in memory of the library allocator
+typedef std::set<IdKey, std::less<IdKey>, Allocator<IdKey>> IdSet;
+typedef Vector<uint8_t> Buffer;
+typedef std::basic_string<char, std::char_traits<char>, Allocator<char>> String;
+
+struct LogData
+{
+    struct ScribaDBFuncTbl mem;         // memory backend serving the data
+    String path;
+    String next_path;
+    String checkpoint_path;
+    unsigned int sync_interval;         // milliseconds
+    unsigned long long checkpoint_size;
+    unsigned long long log_size;        // size of the current log
+    bool in_write;                      // write transaction is in progress
+    IdSet changed[4];                   // changed entities not logged yet, by type
+
+    // state shared with the writer thread
+    std::mutex lock;
+    std::condition_variable wake;       // writer has something to do
+    std::condition_variable synced;     // appended records have been synced
+    Buffer pending;                     // records not written yet
+    int fd;                             // log receiving pending records
+    unsigned long long appended;        // number of bytes appended since init
+    unsigned long long synced_size;     // number of appended bytes synced to disk
+    bool flush;                         // sync pending records without waiting
+    bool stop;
+    bool failed;                        // writing failed, changes are not stored
+    // checkpoint handed over to the writer
+    bool checkpoint;
+    struct ScribaSerializedBuffer snapshot;
+    Buffer old_pending;                 // the rest of the previous log
+    int old_fd;
+
+    std::thread writer;
+};
+
+// entities of a record being built
+struct RecordBuilder
+{
+    Builder fbb;
+    Vector<fb::Offset<Company>> companies;
+    Vector<fb::Offset<Event>> events;
+    Vector<fb::Offset<POC>> people;
+    Vector<fb::Offset<Project>> projects;
+    Vector<fb::Offset<Removed>> removed;
+    std::set<IdKey> found;              // entities of the current type found by scan
+};
+
+static LogData *data = NULL;
+
+static int parse_param_list(struct ScribaDBParamList *pl);
+static uint32_t checksum(const uint8_t *buf, size_t len);
+static int write_all(int fd, const uint8_t *buf, size_t len);
+// sync directory holding the given file, so that renames are stored
+static int sync_dir(const String &path);
+
+// read records of the log file, apply them to the memory backend and return
+// the size of the valid part of the log, -1 on failure; the valid part is
+// appended to out_fd unless it is -1
+static long long replay(int fd, int out_fd);
+static void apply_record(const Entries *entries);
+static scriba_id_t to_id(const ID *id);
+static const char *to_str(const fb::String *str);
+
+// snapshot loading callbacks
+static void load_company(const struct ScribaCompany *company, void *ctx);
+static void load_poc(const struct ScribaPoc *poc, void *ctx);
+static void load_project(const struct ScribaProject *project, void *ctx);
+static void load_event(const struct ScribaEvent *event, void *ctx);
+
+// remember entity changed by a memory backend call if the change stamp has moved,
+// changes made outside of transactions are logged at once
+static void log_change(enum ScribaEntityType type, const scriba_id_t &id,
+                       unsigned long long stamp);
+// append record of the changed entities to the log; returns 0 on success
+static int log_changes(bool wait);
+static void build_entities(RecordBuilder &builder, enum ScribaEntityType type);
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, const char *str);
+static void record_company(const struct ScribaCompany *company, void *ctx);
+static void record_poc(const struct ScribaPoc *poc, void *ctx);
+static void record_project(const struct ScribaProject *project, void *ctx);
+static void record_event(const struct ScribaEvent *event, void *ctx);
+template<typename T>
+static fb::Offset<fb::Vector<fb::Offset<T>>> create_vector(fb::FlatBufferBuilder &fbb,
+                                                          const Vector<fb::Offset<T>> &items);
+// hand the record over to the writer; if wait is true or changes are synced
+// one by one, return after the record has been synced; returns 0 on success
+static int append(const Buffer &record, bool wait);
+// start checkpoint if the log has grown beyond the checkpoint size
+static void maybe_checkpoint();
+static void writer_main();
+
+// write interface functions
+static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
+                       const char *address, const char *inn, const char *phonenum,
+                       const char *email);
+static void updateCompany(const struct ScribaCompany *company);
+static void removeCompany(scriba_id_t id);
+static int upsertCompany(const struct ScribaCompany *company, int overwrite);
+static void addPOC(scriba_id_t id, const char *firstname, const char *secondname,
+                   const char *lastname, const char *mobilenum, const char *phonenum,
+                   const char *email, const char *position, scriba_id_t company_id);
+static void updatePOC(const struct ScribaPoc *poc);
+static void removePOC(scriba_id_t id);
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite);
+static void addProject(scriba_id_t id, const char *title, const char *descr,
+                       scriba_id_t company_id, enum ScribaProjectState state,
+                       enum ScribaCurrency currency, long long cost, scriba_time_t start_time);
+static void updateProject(struct ScribaProject *project);
+static void removeProject(scriba_id_t id);
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time);
+static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id, scriba_id_t poc_id,
+                     scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
+                     scriba_time_t timestamp, enum ScribaEventState state);
+static void updateEvent(const struct ScribaEvent *event);
+static void removeEvent(scriba_id_t id);
+static int upsertEvent(const struct ScribaEvent *event, int overwrite);
+static int beginWrite();
+static int commitWrite();
+static void rollbackWrite();
+
+} // namespace scriba
+
+using namespace scriba;
+
+extern "C"
+{
+
+struct ScribaInternalDB logDB =
+{
+    (char *)SCRIBA_LOG_BACKEND_NAME,
+    scriba_log_init,
+    scriba_log_cleanup
+};
+
+int scriba_log_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl)
+{
+    long long size = 0;
+
+    if ((pl == NULL) || (fTbl == NULL) || (data != NULL))
+    {
+        return 1;
+    }
+
+    data = try_create<LogData>();
+    if (data == NULL)
+    {
+        return 1;
+    }
+    data->sync_interval = SCRIBA_LOG_DEFAULT_SYNC_INTERVAL;
+    data->checkpoint_size = SCRIBA_LOG_DEFAULT_CHECKPOINT_SIZE;
+    data->fd = -1;
+    data->old_fd = -1;
+    if ((parse_param_list(pl) != 0) || data->path.empty())
+    {
+        destroy(data);
+        data = NULL;
+        return 1;
+    }
+    data->next_path = data->path + SCRIBA_LOG_NEXT_SUFFIX;
+    data->checkpoint_path = data->path + SCRIBA_LOG_CHECKPOINT_SUFFIX;
+
+    if (scriba_memory_init(NULL, &(data->mem)) != 0)
+    {
+        destroy(data);
+        data = NULL;
+        return 1;
+    }
+
+    // the state is the checkpoint followed by the log and the log started
+    // by an unfinished checkpoint, if any
+    if ((access(data->checkpoint_path.c_str(), F_OK) == 0) &&
+        (scriba_snapshot_read(data->checkpoint_path.c_str(), load_company, load_poc,
+                              load_project, load_event, NULL) != 0))
+    {
+        goto fail;
+    }
+
+    data->fd = open(data->path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (data->fd == -1)
+    {
+        goto fail;
+    }
+    size = replay(data->fd, -1);
+    // records cut short by a crash are dropped, so that new ones follow valid data
+    if ((size < 0) || (ftruncate(data->fd, (off_t)size) != 0))
+    {
+        goto fail;
+    }
+    data->log_size = (unsigned long long)size;
+
+    if (access(data->next_path.c_str(), F_OK) == 0)
+    {
+        // records of the unfinished checkpoint are moved to the log, they are
+        // applied after the log records the same way when the move is interrupted
+        int next_fd = open(data->next_path.c_str(), O_RDONLY);
+        if (next_fd == -1)
+        {
+            goto fail;
+        }
+        size = replay(next_fd, data->fd);
+        close(next_fd);
+        if ((size < 0) || (fdatasync(data->fd) != 0) || (unlink(data->next_path.c_str()) != 0))
+        {
+            goto fail;
+        }
+        data->log_size += (unsigned long long)size;
+    }
+
+    data->writer = std::thread(writer_main);
+
+    // reads go to the memory backend directly, writes are logged
+    *fTbl = data->mem;
+    fTbl->addCompany = addCompany;
+    fTbl->updateCompany = updateCompany;
+    fTbl->removeCompany = removeCompany;
+    fTbl->upsertCompany = upsertCompany;
+    fTbl->addPOC = addPOC;
+    fTbl->updatePOC = updatePOC;
+    fTbl->removePOC = removePOC;
+    fTbl->upsertPOC = upsertPOC;
+    fTbl->addProject = addProject;
+    fTbl->updateProject = updateProject;
+    fTbl->removeProject = removeProject;
+    fTbl->upsertProject = upsertProject;
+    fTbl->addEvent = addEvent;
+    fTbl->updateEvent = updateEvent;
+    fTbl->removeEvent = removeEvent;
+    fTbl->upsertEvent = upsertEvent;
+    fTbl->beginWrite = beginWrite;
+    fTbl->commitWrite = commitWrite;
+    fTbl->rollbackWrite = rollbackWrite;
+
+    return 0;
+
+fail:
+    if (data->fd != -1)
+    {
+        close(data->fd);
+    }
+    scriba_memory_cleanup();
+    destroy(data);
+    data = NULL;
+    return 1;
+}
+
+void scriba_log_cleanup()
+{
+    if (data == NULL)
+    {
+        return;
+    }
+
+    if (data->in_write)
+    {
+        rollbackWrite();
+    }
+
+    // the writer finishes pending records and checkpoint before it stops
+    {
+        std::lock_guard<std::mutex> guard(data->lock);
+        data->stop = true;
+    }
+    data->wake.notify_one();
+    data->writer.join();
+
+    close(data->fd);
+    scriba_memory_cleanup();
+    destroy(data);
+    data = NULL;
+}
+
+} // extern "C"
+
+namespace scriba
+{
+
+static int parse_param_list(struct ScribaDBParamList *pl)
+{
+    for (; pl != NULL; pl = pl->next)
+    {
+        struct ScribaDBParam *param = pl->param;
+        if ((param == NULL) || (param->key == NULL) || (param->value == NULL))
+        {
+            continue;
+        }
+        if (strcmp(param->key, SCRIBA_LOG_LOCATION_PARAM) == 0)
+        {
+            data->path = param->value;
+        }
+        else if (strcmp(param->key, SCRIBA_LOG_SYNC_INTERVAL_PARAM) == 0)
+        {
+            data->sync_interval = (unsigned int)strtoul(param->value, NULL, 10);
+        }
+        else if (strcmp(param->key, SCRIBA_LOG_CHECKPOINT_SIZE_PARAM) == 0)
+        {
+            data->checkpoint_size = strtoull(param->value, NULL, 10);
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t checksum(const uint8_t *buf, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ buf[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+static int sync_dir(const String &path)
+{
+    size_t slash = path.rfind('/');
+    String dir = (slash == String::npos) ? "." :
+                      (slash == 0) ? "/" : path.substr(0, slash);
+
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    int ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+static long long replay(int fd, int out_fd)
+{
+    struct stat st;
+    size_t pos = 0;
+
+    if (fstat(fd, &st) != 0)
+    {
+        return -1;
+    }
+    // empty log cannot be mapped
+    if ((unsigned long long)st.st_size < sizeof (RecordHeader))
+    {
+        return 0;
+    }
+    size_t map_len = (size_t)st.st_size;
+    void *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+    // records are read once from the beginning to the end
+    madvise(map, map_len, MADV_SEQUENTIAL);
+    const uint8_t *log = static_cast<const uint8_t *>(map);
+
+    while (map_len - pos >= sizeof (RecordHeader))
+    {
+        RecordHeader header;
+        memcpy(&header, log + pos, sizeof (header));
+        const uint8_t *buf = log + pos + sizeof (header);
+        size_t record_size = sizeof (header) + ((header.size + 7) & ~(size_t)7);
+        if ((record_size > map_len - pos) || (checksum(buf, header.size) != header.checksum) ||
+            !scriba_verify_entries(buf, header.size))
+        {
+            break;
+        }
+        apply_record(fb::GetRoot<Entries>(buf));
+        pos += record_size;
+    }
+
+    int ret = (out_fd == -1) ? 0 : write_all(out_fd, log, pos);
+    munmap(map, map_len);
+    return (ret == 0) ? (long long)pos : -1;
+}
+
+static void apply_record(const Entries *entries)
+{
+    if (entries->companies() != NULL)
+    {
+        for (fb::uoffset_t i = 0; i < entries->companies()->Length(); i++)
+        {
+            const Company *item = entries->companies()->Get(i);
+            struct ScribaCompany company;
+            memset(&company, 0, sizeof (company));
+            company.id = to_id(item->id());
+            company.name = (char *)to_str(item->name());
+            company.jur_name = (char *)to_str(item->jur_name());
+            company.address = (char *)to_str(item->address());
+            company.inn = (char *)to_str(item->inn());
+            company.phonenum = (char *)to_str(item->phonenum());
+            company.email = (char *)to_str(item->email());
+            load_company(&company, NULL);
+        }
+    }
+    if (entries->people() != NULL)
+    {
+        for (fb::uoffset_t i = 0; i < entries->people()->Length(); i++)
+        {
+            const POC *item = entries->people()->Get(i);
+            struct ScribaPoc poc;
+            memset(&poc, 0, sizeof (poc));
+            poc.id = to_id(item->id());
+            poc.firstname = (char *)to_str(item->firstname());
+            poc.secondname = (char *)to_str(item->secondname());
+            poc.lastname = (char *)to_str(item->lastname());
+            poc.mobilenum = (char *)to_str(item->mobilenum());
+            poc.phonenum = (char *)to_str(item->phonenum());
+            poc.email = (char *)to_str(item->email());
+            poc.position = (char *)to_str(item->position());
+            poc.company_id = to_id(item->company_id());
+            load_poc(&poc, NULL);
+        }
+    }
+    if (entries->projects() != NULL)
+    {
+        for (fb::uoffset_t i = 0; i < entries->projects()->Length(); i++)
+        {
+            const Project *item = entries->projects()->Get(i);
+            struct ScribaProject project;
+            memset(&project, 0, sizeof (project));
+            project.id = to_id(item->id());
+            project.title = (char *)to_str(item->title());
+            project.descr = (char *)to_str(item->descr());
+            project.company_id = to_id(item->company_id());
+            project.state = (enum ScribaProjectState)item->state();
+            project.currency = (enum ScribaCurrency)item->currency();
+            project.cost = (long long)item->cost();
+            project.start_time = item->start_time();
+            project.mod_time = item->mod_time();
+            load_project(&project, NULL);
+        }
+    }
+    if (entries->events() != NULL)
+    {
+        for (fb::uoffset_t i = 0; i < entries->events()->Length(); i++)
+        {
+            const Event *item = entries->events()->Get(i);
+            struct ScribaEvent event;
+            memset(&event, 0, sizeof (event));
+            event.id = to_id(item->id());
+            event.descr = (char *)to_str(item->descr());
+            event.company_id = to_id(item->company_id());
+            event.poc_id = to_id(item->poc_id());
+            event.project_id = to_id(item->project_id());
+            event.type = (enum ScribaEventType)item->type();
+            event.outcome = (char *)to_str(item->outcome());
+            event.timestamp = item->timestamp();
+            event.state = (enum ScribaEventState)item->state();
+            load_event(&event, NULL);
+        }
+    }
+    if (entries->removed() != NULL)
+    {
+        for (fb::uoffset_t i = 0; i < entries->removed()->Length(); i++)
+        {
+            const Removed *item = entries->removed()->Get(i);
+            scriba_id_t id = to_id(item->id());
+            switch (item->type())
+            {
+            case SCRIBA_ENTITY_COMPANY:
+                data->mem.removeCompany(id);
+                break;
+            case SCRIBA_ENTITY_EVENT:
+                data->mem.removeEvent(id);
+                break;
+            case SCRIBA_ENTITY_POC:
+                data->mem.removePOC(id);
+                break;
+            case SCRIBA_ENTITY_PROJECT:
+                data->mem.removeProject(id);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+static scriba_id_t to_id(const ID *id)
+{
+    scriba_id_t ret;
+
+    ret._high = (id != NULL) ? id->high() : 0;
+    ret._low = (id != NULL) ? id->low() : 0;
+    return ret;
+}
+
+static const char *to_str(const fb::String *str)
+{
+    return (str != NULL) ? str->c_str() : NULL;
+}
+
+// records hold the whole entity data, so that loading an entity replaces it
+static void load_company(const struct ScribaCompany *company, void *)
+{
+    data->mem.upsertCompany(company, 1);
+}
+
+static void load_poc(const struct ScribaPoc *poc, void *)
+{
+    data->mem.upsertPOC(poc, 1);
+}
+
+static void load_project(const struct ScribaProject *project, void *)
+{
+    data->mem.upsertProject(project, 1, project->mod_time);
+}
+
+static void load_event(const struct ScribaEvent *event, void *)
+{
+    data->mem.upsertEvent(event, 1);
+}
+
+static void log_change(enum ScribaEntityType type, const scriba_id_t &id,
+                       unsigned long long stamp)
+{
+    // calls changing nothing are not logged
+    if (data->mem.getChangeStamp() == stamp)
+    {
+        return;
+    }
+    data->changed[type].insert(IdKey(id._high, id._low));
+    if (!data->in_write)
+    {
+        log_changes(false);
+        maybe_checkpoint();
+    }
+}
+
+static int log_changes(bool wait)
+{
+    RecordBuilder builder;
+    Buffer record;
+    RecordHeader header;
+
+    if (data->changed[SCRIBA_ENTITY_COMPANY].empty() && data->changed[SCRIBA_ENTITY_EVENT].empty() &&
+        data->changed[SCRIBA_ENTITY_POC].empty() && data->changed[SCRIBA_ENTITY_PROJECT].empty())
+    {
+        return 0;
+    }
+
+    // entities changed several times are stored once with their resulting data
+    build_entities(builder, SCRIBA_ENTITY_COMPANY);
+    build_entities(builder, SCRIBA_ENTITY_EVENT);
+    build_entities(builder, SCRIBA_ENTITY_POC);
+    build_entities(builder, SCRIBA_ENTITY_PROJECT);
+    fb::FlatBufferBuilder &fbb = builder.fbb;
+    auto root = CreateEntries(fbb,
+                              create_vector(fbb, builder.companies),
+                              create_vector(fbb, builder.events),
+                              create_vector(fbb, builder.people),
+                              create_vector(fbb, builder.projects),
+                              create_vector(fbb, builder.removed),
+                              0, 0, 0, 0, 0, 0);
+    fbb.Finish(root);
+
+    header.size = fbb.GetSize();
+    header.checksum = checksum(fbb.GetBufferPointer(), fbb.GetSize());
+    record.resize(sizeof (header) + ((header.size + 7) & ~(size_t)7), 0);
+    memcpy(record.data(), &header, sizeof (header));
+    memcpy(record.data() + sizeof (header), fbb.GetBufferPointer(), fbb.GetSize());
+
+    return append(record, wait);
+}
+
+static void build_entities(RecordBuilder &builder, enum ScribaEntityType type)
+{
+    IdSet &changed = data->changed[type];
+    Vector<scriba_id_t> ids;
+    struct ScribaScanFilter filter;
+
+    if (changed.empty())
+    {
+        return;
+    }
+    for (const IdKey &key : changed)
+    {
+        scriba_id_t id;
+        id._high = key.first;
+        id._low = key.second;
+        ids.push_back(id);
+    }
+    memset(&filter, 0, sizeof (filter));
+    filter.ids = ids.data();
+    filter.num_ids = ids.size();
+
+    builder.found.clear();
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        data->mem.scanCompanies(&filter, record_company, &builder);
+        break;
+    case SCRIBA_ENTITY_EVENT:
+        data->mem.scanEvents(&filter, record_event, &builder);
+        break;
+    case SCRIBA_ENTITY_POC:
+        data->mem.scanPeople(&filter, record_poc, &builder);
+        break;
+    case SCRIBA_ENTITY_PROJECT:
+        data->mem.scanProjects(&filter, record_project, &builder);
+        break;
+    }
+
+    // changed entities that are gone have been removed
+    for (const IdKey &key : changed)
+    {
+        if (builder.found.count(key) == 0)
+        {
+            ID id(key.first, key.second);
+            builder.removed.push_back(CreateRemoved(builder.fbb, &id, (int8_t)type));
+        }
+    }
+    changed.clear();
+}
+
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, const char *str)
+{
+    // missing strings are not stored, so that they stay NULL
+    return (str != NULL) ? fbb.CreateString(str) : 0;
+}
+
+static void record_company(const struct ScribaCompany *company, void *ctx)
+{
+    RecordBuilder *builder = static_cast<RecordBuilder *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+
+    ID id(company->id._high, company->id._low);
+    auto name = create_string(fbb, company->name);
+    auto jur_name = create_string(fbb, company->jur_name);
+    auto address = create_string(fbb, company->address);
+    auto inn = create_string(fbb, company->inn);
+    auto phonenum = create_string(fbb, company->phonenum);
+    auto email = create_string(fbb, company->email);
+
+    builder->companies.push_back(CreateCompany(fbb, &id, name, jur_name, address, inn,
+                                               phonenum, email, 0));
+    builder->found.insert(IdKey(company->id._high, company->id._low));
+}
+
+static void record_poc(const struct ScribaPoc *poc, void *ctx)
+{
+    RecordBuilder *builder = static_cast<RecordBuilder *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+
+    ID id(poc->id._high, poc->id._low);
+    ID company_id(poc->company_id._high, poc->company_id._low);
+    auto firstname = create_string(fbb, poc->firstname);
+    auto secondname = create_string(fbb, poc->secondname);
+    auto lastname = create_string(fbb, poc->lastname);
+    auto mobilenum = create_string(fbb, poc->mobilenum);
+    auto phonenum = create_string(fbb, poc->phonenum);
+    auto email = create_string(fbb, poc->email);
+    auto position = create_string(fbb, poc->position);
+
+    builder->people.push_back(CreatePOC(fbb, &id, firstname, secondname, lastname, mobilenum,
+                                        phonenum, email, position, &company_id, 0, 0));
+    builder->found.insert(IdKey(poc->id._high, poc->id._low));
+}
+
+static void record_project(const struct ScribaProject *project, void *ctx)
+{
+    RecordBuilder *builder = static_cast<RecordBuilder *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+
+    ID id(project->id._high, project->id._low);
+    ID company_id(project->company_id._high, project->company_id._low);
+    auto title = create_string(fbb, project->title);
+    auto descr = create_string(fbb, project->descr);
+
+    builder->projects.push_back(CreateProject(fbb, &id, title, descr, &company_id,
+                                              (int8_t)project->state, (int8_t)project->currency,
+                                              (uint64_t)project->cost, project->start_time,
+                                              project->mod_time, 0, 0));
+    builder->found.insert(IdKey(project->id._high, project->id._low));
+}
+
+static void record_event(const struct ScribaEvent *event, void *ctx)
+{
+    RecordBuilder *builder = static_cast<RecordBuilder *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+
+    ID id(event->id._high, event->id._low);
+    ID company_id(event->company_id._high, event->company_id._low);
+    ID project_id(event->project_id._high, event->project_id._low);
+    ID poc_id(event->poc_id._high, event->poc_id._low);
+    auto descr = create_string(fbb, event->descr);
+    auto outcome = create_string(fbb, event->outcome);
+
+    builder->events.push_back(CreateEvent(fbb, &id, descr, &company_id, &project_id, &poc_id,
+                                          (int8_t)event->type, outcome, event->timestamp,
+                                          (int8_t)event->state, 0, 0, 0, 0));
+    builder->found.insert(IdKey(event->id._high, event->id._low));
+}
+
+template<typename T>
+static fb::Offset<fb::Vector<fb::Offset<T>>> create_vector(fb::FlatBufferBuilder &fbb,
+                                                          const Vector<fb::Offset<T>> &items)
+{
+    return items.empty() ? 0 : fbb.CreateVector(items);
+}
+
+static int append(const Buffer &record, bool wait)
+{
+    std::unique_lock<std::mutex> guard(data->lock);
+
+    if (data->failed)
+    {
+        return -1;
+    }
+
+    bool start = data->pending.empty();
+    data->pending.insert(data->pending.end(), record.begin(), record.end());
+    data->appended += record.size();
+    data->log_size += record.size();
+    if (wait || (data->sync_interval == 0))
+    {
+        unsigned long long end = data->appended;
+        data->flush = true;
+        data->wake.notify_one();
+        data->synced.wait(guard, [end] { return data->failed || (data->synced_size >= end); });
+    }
+    else if (start)
+    {
+        // the writer waits for more records before syncing the group
+        data->wake.notify_one();
+    }
+
+    return data->failed ? -1 : 0;
+}
+
+static void maybe_checkpoint()
+{
+    struct ScribaSerializedBuffer snapshot;
+
+    if ((data->log_size < data->checkpoint_size) || data->in_write)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(data->lock);
+        if (data->checkpoint || data->failed)
+        {
+            return;
+        }
+    }
+
+    // the snapshot should be taken by this thread, the memory backend
+    // is not thread-safe; the log is started over anyway, so that
+    // a failed attempt is not repeated on each change
+    data->log_size = 0;
+    if (scriba_snapshot_build(&snapshot) != 0)
+    {
+        return;
+    }
+    int fd = open(data->next_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd == -1)
+    {
+        scriba_freeSerializedBuffer(&snapshot);
+        return;
+    }
+
+    // records appended from now on go to the next log
+    {
+        std::lock_guard<std::mutex> guard(data->lock);
+        data->old_pending.swap(data->pending);
+        data->old_fd = data->fd;
+        data->fd = fd;
+        data->snapshot = snapshot;
+        data->checkpoint = true;
+    }
+    data->wake.notify_one();
+}
+
+static void writer_main()
+{
+    std::unique_lock<std::mutex> guard(data->lock);
+
+    while (true)
+    {
+        if (!data->flush && !data->stop && !data->checkpoint)
+        {
+            if (data->pending.empty())
+            {
+                data->wake.wait(guard);
+                continue;
+            }
+            // records appended during the interval are synced together
+            data->wake.wait_for(guard, std::chrono::milliseconds(data->sync_interval));
+        }
+        if (data->stop && data->pending.empty() && !data->checkpoint)
+        {
+            break;
+        }
+
+        Buffer records;
+        Buffer old_records;
+        struct ScribaSerializedBuffer snapshot;
+        records.swap(data->pending);
+        unsigned long long end = data->appended;
+        int fd = data->fd;
+        int old_fd = data->old_fd;
+        bool checkpoint = data->checkpoint;
+        if (checkpoint)
+        {
+            old_records.swap(data->old_pending);
+            snapshot = data->snapshot;
+            memset(&(data->snapshot), 0, sizeof (data->snapshot));
+        }
+        data->flush = false;
+        guard.unlock();
+
+        bool ok = true;
+        if (checkpoint)
+        {
+            // the previous log is complete before the checkpoint replaces it;
+            // until the next log is renamed over the log, init reads both
+            ok = (write_all(old_fd, old_records.data(), old_records.size()) == 0) &&
+                 (fdatasync(old_fd) == 0);
+            close(old_fd);
+            ok = ok && (scriba_snapshot_write(data->checkpoint_path.c_str(), &snapshot) == 0) &&
+                 (rename(data->next_path.c_str(), data->path.c_str()) == 0) &&
+                 (sync_dir(data->path) == 0);
+            scriba_freeSerializedBuffer(&snapshot);
+        }
+        ok = ok && (write_all(fd, records.data(), records.size()) == 0) && (fdatasync(fd) == 0);
+
+        guard.lock();
+        if (!ok)
+        {
+            data->failed = true;
+        }
+        if (checkpoint)
+        {
+            data->old_fd = -1;
+            data->checkpoint = false;
+        }
+        data->synced_size = end;
+        data->synced.notify_all();
+    }
+}
+
+// write interface functions
+static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
+                       const char *address, const char *inn, const char *phonenum,
+                       const char *email)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.addCompany(id, name, jur_name, address, inn, phonenum, email);
+    log_change(SCRIBA_ENTITY_COMPANY, id, stamp);
+}
+
+static void updateCompany(const struct ScribaCompany *company)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.updateCompany(company);
+    if (company != NULL)
+    {
+        log_change(SCRIBA_ENTITY_COMPANY, company->id, stamp);
+    }
+}
+
+static void removeCompany(scriba_id_t id)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.removeCompany(id);
+    log_change(SCRIBA_ENTITY_COMPANY, id, stamp);
+}
+
+static int upsertCompany(const struct ScribaCompany *company, int overwrite)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    int ret = data->mem.upsertCompany(company, overwrite);
+    log_change(SCRIBA_ENTITY_COMPANY, company->id, stamp);
+    return ret;
+}
+
+static void addPOC(scriba_id_t id, const char *firstname, const char *secondname,
+                   const char *lastname, const char *mobilenum, const char *phonenum,
+                   const char *email, const char *position, scriba_id_t company_id)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.addPOC(id, firstname, secondname, lastname, mobilenum, phonenum, email,
+                     position, company_id);
+    log_change(SCRIBA_ENTITY_POC, id, stamp);
+}
+
+static void updatePOC(const struct ScribaPoc *poc)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.updatePOC(poc);
+    if (poc != NULL)
+    {
+        log_change(SCRIBA_ENTITY_POC, poc->id, stamp);
+    }
+}
+
+static void removePOC(scriba_id_t id)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.removePOC(id);
+    log_change(SCRIBA_ENTITY_POC, id, stamp);
+}
+
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    int ret = data->mem.upsertPOC(poc, overwrite);
+    log_change(SCRIBA_ENTITY_POC, poc->id, stamp);
+    return ret;
+}
+
+static void addProject(scriba_id_t id, const char *title, const char *descr,
+                       scriba_id_t company_id, enum ScribaProjectState state,
+                       enum ScribaCurrency currency, long long cost, scriba_time_t start_time)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.addProject(id, title, descr, company_id, state, currency, cost, start_time);
+    log_change(SCRIBA_ENTITY_PROJECT, id, stamp);
+}
+
+static void updateProject(struct ScribaProject *project)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.updateProject(project);
+    if (project != NULL)
+    {
+        log_change(SCRIBA_ENTITY_PROJECT, project->id, stamp);
+    }
+}
+
+static void removeProject(scriba_id_t id)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.removeProject(id);
+    log_change(SCRIBA_ENTITY_PROJECT, id, stamp);
+}
+
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    int ret = data->mem.upsertProject(project, overwrite, mod_time);
+    log_change(SCRIBA_ENTITY_PROJECT, project->id, stamp);
+    return ret;
+}
+
+static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id, scriba_id_t poc_id,
+                     scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
+                     scriba_time_t timestamp, enum ScribaEventState state)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.addEvent(id, descr, company_id, poc_id, project_id, type, outcome, timestamp, state);
+    log_change(SCRIBA_ENTITY_EVENT, id, stamp);
+}
+
+static void updateEvent(const struct ScribaEvent *event)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.updateEvent(event);
+    if (event != NULL)
+    {
+        log_change(SCRIBA_ENTITY_EVENT, event->id, stamp);
+    }
+}
+
+static void removeEvent(scriba_id_t id)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    data->mem.removeEvent(id);
+    log_change(SCRIBA_ENTITY_EVENT, id, stamp);
+}
+
+static int upsertEvent(const struct ScribaEvent *event, int overwrite)
+{
+    unsigned long long stamp = data->mem.getChangeStamp();
+    int ret = data->mem.upsertEvent(event, overwrite);
+    log_change(SCRIBA_ENTITY_EVENT, event->id, stamp);
+    return ret;
+}
+
+// changes of a transaction are logged as a single record at commit
+static int beginWrite()
+{
+    int ret = data->mem.beginWrite();
+    if (ret == 0)
+    {
+        data->in_write = true;
+    }
+    return ret;
+}
+
+static int commitWrite()
+{
+    if (!data->in_write)
+    {
+        return 1;
+    }
+    int ret = data->mem.commitWrite();
+    data->in_write = false;
+    if (log_changes(true) != 0)
+    {
+        ret = 1;
+    }
+    maybe_checkpoint();
+    return ret;
+}
+
+static void rollbackWrite()
+{
+    data->mem.rollbackWrite();
+    for (IdSet &changed : data->changed)
+    {
+        changed.clear();
+    }
+    data->in_write = false;
+}
+
+} // namespace scriba
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_LOG_BACKEND_H
+#define SCRIBA_LOG_BACKEND_H
+
+#include "db_backend.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Backend storing changes in an append-only log file. Each committed change
+ * appends a record holding an Entries buffer with the resulting data of changed
+ * entities and ids of removed ones. Entities are served by the memory backend,
+ * which is filled from the last checkpoint and the log records at init.
+ *
+ * Records are written and synced to disk by a background thread in groups:
+ * writes outside of transactions reach the disk within the sync interval,
+ * scriba_commitWrite() returns after its changes have been synced. Once the log
+ * grows beyond the checkpoint size, the database is written to a snapshot file
+ * next to the log and the log is started over, so that superseded records are
+ * dropped and init does not replay the whole history. The snapshot is built by
+ * the calling thread, writing it is left to the background thread.
+ *
+ * The log is mapped into memory at init, records are checked against the
+ * serialization schema before they are applied. Backend state and pending
+ * records are allocated with the library allocator (scriba_setAllocator()).
+ *
+ * Like the SQLite backend, the backend is not thread-safe, calls should be
+ * serialized by the application. */
+
+#define SCRIBA_LOG_BACKEND_NAME "scriba_log"
+// path of the log file
+#define SCRIBA_LOG_LOCATION_PARAM "log_loc"
+// milliseconds between syncs of records written outside of transactions,
+// 0 syncs each change before returning; 10 by default
+#define SCRIBA_LOG_SYNC_INTERVAL_PARAM "sync_interval"
+// log size in bytes that triggers a checkpoint; 16 MB by default
+#define SCRIBA_LOG_CHECKPOINT_SIZE_PARAM "checkpoint_size"
+
+extern struct ScribaInternalDB logDB;
+
+int scriba_log_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl);
+
+void scriba_log_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_LOG_BACKEND_H
@@ -0,0 +1,1951 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "memory_backend.h"
+#include "snapshot_backend.h"
+#include "company.h"
+#include "event.h"
+#include "poc.h"
+#include "project.h"
+#include "stl_allocator.h"
+#include <cstring>
+#include <cctype>
+#include <iterator>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+namespace scriba
+{
+
+// string fields of an entity stored in a single allocation
+template<size_t N>
+class StringBlock
+{
+public:
+    StringBlock();
+    // copy the given fields, NULL fields stay NULL
+    explicit StringBlock(const char *const *fields);
+    StringBlock(const StringBlock &other);
+    StringBlock(StringBlock &&other) = default;
+    StringBlock &operator=(const StringBlock &other) = delete;
+    StringBlock &operator=(StringBlock &&other) = default;
+
+    const char *get(size_t field) const
+    {
+        return (offsets[field] == NO_STRING) ? NULL : buf.get() + offsets[field];
+    }
+
+private:
+    static const uint32_t NO_STRING = 0xFFFFFFFF;
+
+    std::unique_ptr<char, Free> buf;
+    uint32_t size;
+    uint32_t offsets[N];
+};
+
+// string fields of entities
+enum CompanyField { COMPANY_NAME = 0, COMPANY_JUR_NAME, COMPANY_ADDRESS, COMPANY_INN,
+                    COMPANY_PHONENUM, COMPANY_EMAIL, COMPANY_FIELDS };
+enum POCField { POC_FIRSTNAME = 0, POC_SECONDNAME, POC_LASTNAME, POC_MOBILENUM,
+                POC_PHONENUM, POC_EMAIL, POC_POSITION, POC_FIELDS };
+enum ProjectField { PROJECT_TITLE = 0, PROJECT_DESCR, PROJECT_FIELDS };
+enum EventField { EVENT_DESCR = 0, EVENT_OUTCOME, EVENT_FIELDS };
+
+struct CompanyRecord
+{
+    scriba_id_t id;
+    StringBlock<COMPANY_FIELDS> strings;
+    unsigned long long stamp;           // change stamp
+    unsigned long long seq;             // insertion order, the same as SQLite rowid order
+};
+
+struct POCRecord
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+    StringBlock<POC_FIELDS> strings;
+    unsigned long long stamp;
+    unsigned long long seq;
+};
+
+struct ProjectRecord
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+    enum ScribaProjectState state;
+    enum ScribaCurrency currency;
+    long long cost;
+    scriba_time_t start_time;
+    scriba_time_t mod_time;
+    StringBlock<PROJECT_FIELDS> strings;
+    unsigned long long stamp;
+    unsigned long long seq;
+};
+
+struct EventRecord
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+    enum ScribaEventType type;
+    enum ScribaEventState state;
+    scriba_time_t timestamp;
+    StringBlock<EVENT_FIELDS> strings;
+    unsigned long long stamp;
+    unsigned long long seq;
+};
+
+struct IdHash
+{
+    size_t operator()(const scriba_id_t &id) const
+    {
+        // ids are random, mixing both halves is enough
+        return std::hash<unsigned long long>()(id._high ^ (id._low * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+struct IdEqual
+{
+    bool operator()(const scriba_id_t &a, const scriba_id_t &b) const
+    {
+        return (a._high == b._high) && (a._low == b._low);
+    }
+};
+
+// key of ordered time indexes, entities with the same time
+// are ordered by insertion
+struct TimeKey
+{
+    scriba_time_t time;
+    unsigned long long seq;
+    scriba_id_t id;
+};
+
+struct TimeLess
+{
+    bool operator()(const TimeKey &a, const TimeKey &b) const
+    {
+        if (a.time != b.time)
+        {
+            return (a.time < b.time);
+        }
+        return (a.seq < b.seq);
+    }
+};
+
+// containers keep entity data in memory of the library allocator
+template<typename T>
+using IdMap = std::unordered_map<scriba_id_t, T, IdHash, IdEqual,
+                                 Allocator<std::pair<const scriba_id_t, T>>>;
+template<typename T>
+using IntMap = std::unordered_map<int, T, std::hash<int>, std::equal_to<int>,
+                                  Allocator<std::pair<const int, T>>>;
+// records ordered by insertion
+template<typename T>
+using SeqIndex = std::map<unsigned long long, const T *, std::less<unsigned long long>,
+                          Allocator<std::pair<const unsigned long long, const T *>>>;
+typedef std::set<TimeKey, TimeLess, Allocator<TimeKey>> TimeIndex;
+typedef std::basic_string<char, std::char_traits<char>, Allocator<char>> String;
+
+// state of an entity before the change made by a write transaction
+template<typename T>
+struct Undo
+{
+    scriba_id_t id;
+    std::unique_ptr<T, Destroy<T>> old; // NULL if the entity did not exist
+    unsigned long long removed;         // removal stamp, 0 if the entity was not removed
+};
+
+// entities of one type
+template<typename T>
+struct Table
+{
+    enum ScribaEntityType type;
+    IdMap<T> rows;
+    SeqIndex<T> order;                  // all rows in insertion order
+    unsigned long long seq;             // sequence number of the last inserted row
+    IdMap<unsigned long long> removed;  // change stamps of removed entities
+    std::vector<Undo<T>, Allocator<Undo<T>>> undo;  // changes of the current write transaction
+};
+
+struct MemoryData
+{
+    Table<CompanyRecord> companies;
+    Table<POCRecord> people;
+    Table<ProjectRecord> projects;
+    Table<EventRecord> events;
+
+    // secondary indexes
+    IdMap<SeqIndex<POCRecord>> people_by_company;
+    IdMap<SeqIndex<ProjectRecord>> projects_by_company;
+    IntMap<SeqIndex<ProjectRecord>> projects_by_state;
+    TimeIndex projects_by_start;
+    TimeIndex projects_by_mod;
+    TimeIndex events_by_time;
+    IdMap<TimeIndex> events_by_company;
+    IdMap<TimeIndex> events_by_poc;
+    IdMap<TimeIndex> events_by_project;
+    IntMap<TimeIndex> events_by_state;
+
+    unsigned long long stamp;           // stamp of the last change
+    bool in_write;                      // write transaction is in progress
+    unsigned long long write_stamp;     // stamp at the start of the transaction
+    String snapshot_path;               // empty if the database is not persisted
+};
+
+static MemoryData *data = NULL;
+
+static int parse_param_list(struct ScribaDBParamList *pl);
+
+// add record to secondary indexes and remove it from them
+static void index_add(const CompanyRecord &record);
+static void index_add(const POCRecord &record);
+static void index_add(const ProjectRecord &record);
+static void index_add(const EventRecord &record);
+static void index_remove(const CompanyRecord &record);
+static void index_remove(const POCRecord &record);
+static void index_remove(const ProjectRecord &record);
+static void index_remove(const EventRecord &record);
+// remove item from the index entry and the entry from the index once it is empty
+template<typename K, typename M, typename I>
+static void index_erase(M &index, const K &key, const I &item);
+
+// remember entity state if a write transaction is in progress
+template<typename T>
+static void save_undo(Table<T> &table, const scriba_id_t &id);
+template<typename T>
+static void rollback_table(Table<T> &table);
+// insert record or replace existing one with the same id
+template<typename T>
+static void store(Table<T> &table, T &&record);
+template<typename T>
+static void remove(Table<T> &table, const scriba_id_t &id);
+template<typename T>
+static const T *find(const Table<T> &table, const scriba_id_t &id);
+
+// create records out of entity fields
+static CompanyRecord company_record(const scriba_id_t &id, const char *name, const char *jur_name,
+                                    const char *address, const char *inn, const char *phonenum,
+                                    const char *email);
+static POCRecord poc_record(const scriba_id_t &id, const char *firstname, const char *secondname,
+                            const char *lastname, const char *mobilenum, const char *phonenum,
+                            const char *email, const char *position, const scriba_id_t &company_id);
+static ProjectRecord project_record(const scriba_id_t &id, const char *title, const char *descr,
+                                    const scriba_id_t &company_id, enum ScribaProjectState state,
+                                    enum ScribaCurrency currency, long long cost,
+                                    scriba_time_t start_time, scriba_time_t mod_time);
+static EventRecord event_record(const scriba_id_t &id, const char *descr,
+                                const scriba_id_t &company_id, const scriba_id_t &poc_id,
+                                const scriba_id_t &project_id, enum ScribaEventType type,
+                                const char *outcome, scriba_time_t timestamp,
+                                enum ScribaEventState state);
+
+// check whether entity data equals the stored record
+static bool str_equal(const char *a, const char *b);
+static bool same_data(const CompanyRecord &record, const struct ScribaCompany *company);
+static bool same_data(const POCRecord &record, const struct ScribaPoc *poc);
+static bool same_data(const ProjectRecord &record, const struct ScribaProject *project);
+static bool same_data(const EventRecord &record, const struct ScribaEvent *event);
+
+// case-insensitive substring search the way LIKE '%pattern%' does it
+static bool text_contains(const char *text, const char *pattern);
+static bool time_match(scriba_time_t time, scriba_time_t cond, enum ScribaTimeComp comp);
+
+// list items of the entities, text is the same as the SQLite backend returns
+static void list_company(scriba_list_t *list, const CompanyRecord &record);
+static void list_poc(scriba_list_t *list, const POCRecord &record);
+static void list_project(scriba_list_t *list, const ProjectRecord &record);
+static void list_event(scriba_list_t *list, const EventRecord &record);
+// add entities of the index entry to the list
+template<typename K, typename M, typename T>
+static void list_index(scriba_list_t *list, const M &index, const K &key,
+                       void (*add)(scriba_list_t *, const T &));
+// add events of the time index to the list, upcoming events go first,
+// both upcoming and past events are ordered by distance from the current time;
+// if descr is not NULL, only events whose description contains it are added
+static void list_events(scriba_list_t *list, const TimeIndex *index, const char *descr);
+static void list_events(scriba_list_t *list, TimeIndex::const_iterator begin,
+                        TimeIndex::const_iterator end, const char *descr);
+template<typename K, typename M>
+static void list_index_events(scriba_list_t *list, const M &index, const K &key);
+
+// create entity data structures out of the records
+static struct ScribaCompany *company_data(const CompanyRecord &record);
+static struct ScribaPoc *poc_data(const POCRecord &record);
+static struct ScribaProject *project_data(const ProjectRecord &record);
+static struct ScribaEvent *event_data(const EventRecord &record);
+
+template<typename T, typename S>
+static S *get_entity(const Table<T> &table, const scriba_id_t &id, S *(*create)(const T &));
+template<typename T, typename S>
+static size_t get_entities(const Table<T> &table, const scriba_id_t *ids, size_t n, S **result,
+                           S *(*create)(const T &));
+
+// fill entity data structure passed to scan functions, strings point
+// to the stored records
+static void fill_scanned(const CompanyRecord &record, ScribaCompany &scanned);
+static void fill_scanned(const POCRecord &record, ScribaPoc &scanned);
+static void fill_scanned(const ProjectRecord &record, ScribaProject &scanned);
+static void fill_scanned(const EventRecord &record, ScribaEvent &scanned);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaCompany &company);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaPoc &poc);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaProject &project);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaEvent &event);
+template<typename T, typename S>
+static void scan_record(const T &record, const ScribaScanFilter *filter,
+                        void (*func)(const S *, void *), void *ctx);
+template<typename T, typename S>
+static int scan_entities(const Table<T> &table, const ScribaScanFilter *filter,
+                         void (*func)(const S *, void *), void *ctx);
+
+// company interface functions
+static struct ScribaCompany *getCompany(scriba_id_t id);
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies);
+static scriba_list_t *getAllCompanies();
+static scriba_list_t *getCompaniesByName(const char *name);
+static scriba_list_t *getCompaniesByJurName(const char *juridicial_name);
+static scriba_list_t *getCompaniesByAddress(const char *address);
+static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
+                       const char *address, const char *inn, const char *phonenum,
+                       const char *email);
+static void updateCompany(const struct ScribaCompany *company);
+static void removeCompany(scriba_id_t id);
+static int upsertCompany(const struct ScribaCompany *company, int overwrite);
+
+// POC interface functions
+static struct ScribaPoc *getPOC(scriba_id_t id);
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people);
+static scriba_list_t *getAllPeople();
+static scriba_list_t *getPOCByName(const char *name);
+static scriba_list_t *getPOCByCompany(scriba_id_t id);
+static scriba_list_t *getPOCByPosition(const char *position);
+static scriba_list_t *getPOCByPhoneNum(const char *phonenum);
+static scriba_list_t *getPOCByEmail(const char *email);
+static void addPOC(scriba_id_t id, const char *firstname, const char *secondname,
+                   const char *lastname, const char *mobilenum, const char *phonenum,
+                   const char *email, const char *position, scriba_id_t company_id);
+static void updatePOC(const struct ScribaPoc *poc);
+static void removePOC(scriba_id_t id);
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite);
+
+// project interface functions
+static struct ScribaProject *getProject(scriba_id_t id);
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects);
+static scriba_list_t *getAllProjects();
+static scriba_list_t *getProjectsByTitle(const char *title);
+static scriba_list_t *getProjectsByCompany(scriba_id_t id);
+static scriba_list_t *getProjectsByState(enum ScribaProjectState state);
+static scriba_list_t *getProjectsByTime(scriba_time_t start_time, enum ScribaTimeComp start_comp,
+                                        scriba_time_t mod_time, enum ScribaTimeComp mod_comp);
+static scriba_list_t *getProjectsByStateTime(enum ScribaProjectState state,
+                                             scriba_time_t start_time,
+                                             enum ScribaTimeComp start_comp,
+                                             scriba_time_t mod_time,
+                                             enum ScribaTimeComp mod_comp);
+static void addProject(scriba_id_t id, const char *title, const char *descr,
+                       scriba_id_t company_id, enum ScribaProjectState state,
+                       enum ScribaCurrency currency, long long cost, scriba_time_t start_time);
+static void updateProject(struct ScribaProject *project);
+static void removeProject(scriba_id_t id);
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time);
+
+// event interface functions
+static struct ScribaEvent *getEvent(scriba_id_t id);
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events);
+static scriba_list_t *getAllEvents();
+static scriba_list_t *getEventsByDescr(const char *descr);
+static scriba_list_t *getEventsByCompany(scriba_id_t id);
+static scriba_list_t *getEventsByPOC(scriba_id_t id);
+static scriba_list_t *getEventsByProject(scriba_id_t id);
+static scriba_list_t *getEventsByState(enum ScribaEventState state);
+static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id, scriba_id_t poc_id,
+                     scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
+                     scriba_time_t timestamp, enum ScribaEventState state);
+static void updateEvent(const struct ScribaEvent *event);
+static void removeEvent(scriba_id_t id);
+static int upsertEvent(const struct ScribaEvent *event, int overwrite);
+
+// scan interface functions
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx);
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx);
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx);
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx);
+
+// write transactions keep undo records of changed entities
+static int beginWrite();
+static int commitWrite();
+static void rollbackWrite();
+
+// change tracking
+static unsigned long long getChangeStamp();
+static int scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx);
+
+// snapshot loading callbacks
+static void load_company(const struct ScribaCompany *company, void *ctx);
+static void load_poc(const struct ScribaPoc *poc, void *ctx);
+static void load_project(const struct ScribaProject *project, void *ctx);
+static void load_event(const struct ScribaEvent *event, void *ctx);
+
+} // namespace scriba
+
+using namespace scriba;
+
+extern "C"
+{
+
+struct ScribaInternalDB memoryDB =
+{
+    (char *)SCRIBA_MEMORY_BACKEND_NAME,
+    scriba_memory_init,
+    scriba_memory_cleanup
+};
+
+int scriba_memory_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl)
+{
+    if ((fTbl == NULL) || (data != NULL))
+    {
+        return 1;
+    }
+
+    data = try_create<MemoryData>();
+    if (data == NULL)
+    {
+        return 1;
+    }
+    data->companies.type = SCRIBA_ENTITY_COMPANY;
+    data->people.type = SCRIBA_ENTITY_POC;
+    data->projects.type = SCRIBA_ENTITY_PROJECT;
+    data->events.type = SCRIBA_ENTITY_EVENT;
+    data->stamp = 0;
+    data->in_write = false;
+    data->write_stamp = 0;
+
+    if (parse_param_list(pl) != 0)
+    {
+        destroy(data);
+        data = NULL;
+        return 1;
+    }
+
+    // missing snapshot file means the database is empty
+    if (!data->snapshot_path.empty() && (access(data->snapshot_path.c_str(), F_OK) == 0) &&
+        (scriba_snapshot_read(data->snapshot_path.c_str(), load_company, load_poc,
+                              load_project, load_event, NULL) != 0))
+    {
+        destroy(data);
+        data = NULL;
+        return 1;
+    }
+
+    fTbl->getCompany = getCompany;
+    fTbl->getCompanies = getCompanies;
+    fTbl->getAllCompanies = getAllCompanies;
+    fTbl->getCompaniesByName = getCompaniesByName;
+    fTbl->getCompaniesByJurName = getCompaniesByJurName;
+    fTbl->getCompaniesByAddress = getCompaniesByAddress;
+    fTbl->addCompany = addCompany;
+    fTbl->updateCompany = updateCompany;
+    fTbl->removeCompany = removeCompany;
+    fTbl->getEvent = getEvent;
+    fTbl->getEvents = getEvents;
+    fTbl->getAllEvents = getAllEvents;
+    fTbl->getEventsByDescr = getEventsByDescr;
+    fTbl->getEventsByCompany = getEventsByCompany;
+    fTbl->getEventsByPOC = getEventsByPOC;
+    fTbl->getEventsByProject = getEventsByProject;
+    fTbl->getEventsByState = getEventsByState;
+    fTbl->addEvent = addEvent;
+    fTbl->updateEvent = updateEvent;
+    fTbl->removeEvent = removeEvent;
+    fTbl->getPOC = getPOC;
+    fTbl->getPeople = getPeople;
+    fTbl->getAllPeople = getAllPeople;
+    fTbl->getPOCByName = getPOCByName;
+    fTbl->getPOCByCompany = getPOCByCompany;
+    fTbl->getPOCByPosition = getPOCByPosition;
+    fTbl->getPOCByPhoneNum = getPOCByPhoneNum;
+    fTbl->getPOCByEmail = getPOCByEmail;
+    fTbl->addPOC = addPOC;
+    fTbl->updatePOC = updatePOC;
+    fTbl->removePOC = removePOC;
+    fTbl->getProject = getProject;
+    fTbl->getProjects = getProjects;
+    fTbl->getAllProjects = getAllProjects;
+    fTbl->getProjectsByTitle = getProjectsByTitle;
+    fTbl->getProjectsByCompany = getProjectsByCompany;
+    fTbl->getProjectsByState = getProjectsByState;
+    fTbl->getProjectsByTime = getProjectsByTime;
+    fTbl->getProjectsByStateTime = getProjectsByStateTime;
+    fTbl->addProject = addProject;
+    fTbl->updateProject = updateProject;
+    fTbl->removeProject = removeProject;
+    fTbl->upsertCompany = upsertCompany;
+    fTbl->upsertPOC = upsertPOC;
+    fTbl->upsertProject = upsertProject;
+    fTbl->upsertEvent = upsertEvent;
+    fTbl->scanCompanies = scanCompanies;
+    fTbl->scanPeople = scanPeople;
+    fTbl->scanProjects = scanProjects;
+    fTbl->scanEvents = scanEvents;
+    fTbl->beginWrite = beginWrite;
+    fTbl->commitWrite = commitWrite;
+    fTbl->rollbackWrite = rollbackWrite;
+    fTbl->getChangeStamp = getChangeStamp;
+    fTbl->scanRemoved = scanRemoved;
+
+    return 0;
+}
+
+void scriba_memory_cleanup()
+{
+    if (data == NULL)
+    {
+        return;
+    }
+
+    if (data->in_write)
+    {
+        rollbackWrite();
+    }
+    // the library still uses this backend, so the snapshot is written
+    // by the regular export through scan functions
+    if (!data->snapshot_path.empty())
+    {
+        scriba_snapshot_export(data->snapshot_path.c_str());
+    }
+
+    destroy(data);
+    data = NULL;
+}
+
+} // extern "C"
+
+namespace scriba
+{
+
+template<size_t N>
+StringBlock<N>::StringBlock() : size(0)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        offsets[i] = NO_STRING;
+    }
+}
+
+template<size_t N>
+StringBlock<N>::StringBlock(const char *const *fields) : size(0)
+{
+    size_t lens[N];
+
+    for (size_t i = 0; i < N; i++)
+    {
+        lens[i] = (fields[i] != NULL) ? strlen(fields[i]) + 1 : 0;
+        size += (uint32_t)lens[i];
+    }
+    if (size != 0)
+    {
+        buf.reset(static_cast<char *>(allocate(size)));
+    }
+
+    uint32_t pos = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        if (fields[i] == NULL)
+        {
+            offsets[i] = NO_STRING;
+            continue;
+        }
+        memcpy(buf.get() + pos, fields[i], lens[i]);
+        offsets[i] = pos;
+        pos += (uint32_t)lens[i];
+    }
+}
+
+template<size_t N>
+StringBlock<N>::StringBlock(const StringBlock &other) : size(other.size)
+{
+    if (size != 0)
+    {
+        buf.reset(static_cast<char *>(allocate(size)));
+        memcpy(buf.get(), other.buf.get(), size);
+    }
+    memcpy(offsets, other.offsets, sizeof (offsets));
+}
+
+static int parse_param_list(struct ScribaDBParamList *pl)
+{
+    for (; pl != NULL; pl = pl->next)
+    {
+        struct ScribaDBParam *param = pl->param;
+        if ((param == NULL) || (param->key == NULL) || (param->value == NULL))
+        {
+            continue;
+        }
+        if (strcmp(param->key, SCRIBA_MEMORY_SNAPSHOT_PARAM) == 0)
+        {
+            data->snapshot_path = param->value;
+        }
+    }
+
+    return 0;
+}
+
+static void index_add(const CompanyRecord &)
+{
+}
+
+static void index_add(const POCRecord &record)
+{
+    data->people_by_company[record.company_id][record.seq] = &record;
+}
+
+static void index_add(const ProjectRecord &record)
+{
+    data->projects_by_company[record.company_id][record.seq] = &record;
+    data->projects_by_state[record.state][record.seq] = &record;
+    data->projects_by_start.insert(TimeKey{ record.start_time, record.seq, record.id });
+    data->projects_by_mod.insert(TimeKey{ record.mod_time, record.seq, record.id });
+}
+
+static void index_add(const EventRecord &record)
+{
+    TimeKey key{ record.timestamp, record.seq, record.id };
+
+    data->events_by_time.insert(key);
+    data->events_by_company[record.company_id].insert(key);
+    data->events_by_poc[record.poc_id].insert(key);
+    data->events_by_project[record.project_id].insert(key);
+    data->events_by_state[record.state].insert(key);
+}
+
+static void index_remove(const CompanyRecord &)
+{
+}
+
+static void index_remove(const POCRecord &record)
+{
+    index_erase(data->people_by_company, record.company_id, record.seq);
+}
+
+static void index_remove(const ProjectRecord &record)
+{
+    index_erase(data->projects_by_company, record.company_id, record.seq);
+    index_erase(data->projects_by_state, (int)record.state, record.seq);
+    data->projects_by_start.erase(TimeKey{ record.start_time, record.seq, record.id });
+    data->projects_by_mod.erase(TimeKey{ record.mod_time, record.seq, record.id });
+}
+
+static void index_remove(const EventRecord &record)
+{
+    TimeKey key{ record.timestamp, record.seq, record.id };
+
+    data->events_by_time.erase(key);
+    index_erase(data->events_by_company, record.company_id, key);
+    index_erase(data->events_by_poc, record.poc_id, key);
+    index_erase(data->events_by_project, record.project_id, key);
+    index_erase(data->events_by_state, (int)record.state, key);
+}
+
+template<typename K, typename M, typename I>
+static void index_erase(M &index, const K &key, const I &item)
+{
+    auto it = index.find(key);
+    if (it == index.end())
+    {
+        return;
+    }
+    it->second.erase(item);
+    if (it->second.empty())
+    {
+        index.erase(it);
+    }
+}
+
+template<typename T>
+static void save_undo(Table<T> &table, const scriba_id_t &id)
+{
+    Undo<T> undo;
+
+    if (!data->in_write)
+    {
+        return;
+    }
+
+    // entities changed several times are restored in reverse order, so that
+    // the state before the first change wins
+    undo.id = id;
+    auto row = table.rows.find(id);
+    if (row != table.rows.end())
+    {
+        undo.old.reset(create<T>(row->second));
+    }
+    auto removed = table.removed.find(id);
+    undo.removed = (removed != table.removed.end()) ? removed->second : 0;
+    table.undo.push_back(std::move(undo));
+}
+
+template<typename T>
+static void rollback_table(Table<T> &table)
+{
+    for (auto undo = table.undo.rbegin(); undo != table.undo.rend(); ++undo)
+    {
+        auto row = table.rows.find(undo->id);
+        if (row != table.rows.end())
+        {
+            index_remove(row->second);
+            table.order.erase(row->second.seq);
+            table.rows.erase(row);
+        }
+        if (undo->old)
+        {
+            row = table.rows.emplace(undo->id, std::move(*(undo->old))).first;
+            table.order[row->second.seq] = &(row->second);
+            index_add(row->second);
+        }
+        if (undo->removed != 0)
+        {
+            table.removed[undo->id] = undo->removed;
+        }
+        else
+        {
+            table.removed.erase(undo->id);
+        }
+    }
+    table.undo.clear();
+}
+
+template<typename T>
+static void store(Table<T> &table, T &&record)
+{
+    scriba_id_t id = record.id;
+
+    save_undo(table, id);
+    record.stamp = ++(data->stamp);
+    auto row = table.rows.find(id);
+    if (row != table.rows.end())
+    {
+        // updated entity keeps its place in the order
+        index_remove(row->second);
+        record.seq = row->second.seq;
+        row->second = std::move(record);
+    }
+    else
+    {
+        record.seq = ++(table.seq);
+        row = table.rows.emplace(id, std::move(record)).first;
+        table.order[row->second.seq] = &(row->second);
+    }
+    index_add(row->second);
+    table.removed.erase(id);
+}
+
+template<typename T>
+static void remove(Table<T> &table, const scriba_id_t &id)
+{
+    auto row = table.rows.find(id);
+    if (row == table.rows.end())
+    {
+        return;
+    }
+
+    save_undo(table, id);
+    index_remove(row->second);
+    table.order.erase(row->second.seq);
+    table.rows.erase(row);
+    table.removed[id] = ++(data->stamp);
+}
+
+template<typename T>
+static const T *find(const Table<T> &table, const scriba_id_t &id)
+{
+    auto row = table.rows.find(id);
+    return (row != table.rows.end()) ? &(row->second) : NULL;
+}
+
+static CompanyRecord company_record(const scriba_id_t &id, const char *name, const char *jur_name,
+                                    const char *address, const char *inn, const char *phonenum,
+                                    const char *email)
+{
+    const char *fields[COMPANY_FIELDS] = { name, jur_name, address, inn, phonenum, email };
+    CompanyRecord record{ id, StringBlock<COMPANY_FIELDS>(fields), 0, 0 };
+
+    return record;
+}
+
+static POCRecord poc_record(const scriba_id_t &id, const char *firstname, const char *secondname,
+                            const char *lastname, const char *mobilenum, const char *phonenum,
+                            const char *email, const char *position, const scriba_id_t &company_id)
+{
+    const char *fields[POC_FIELDS] = { firstname, secondname, lastname, mobilenum, phonenum,
+                                       email, position };
+    POCRecord record{ id, company_id, StringBlock<POC_FIELDS>(fields), 0, 0 };
+
+    return record;
+}
+
+static ProjectRecord project_record(const scriba_id_t &id, const char *title, const char *descr,
+                                    const scriba_id_t &company_id, enum ScribaProjectState state,
+                                    enum ScribaCurrency currency, long long cost,
+                                    scriba_time_t start_time, scriba_time_t mod_time)
+{
+    const char *fields[PROJECT_FIELDS] = { title, descr };
+    ProjectRecord record{ id, company_id, state, currency, cost, start_time, mod_time,
+                          StringBlock<PROJECT_FIELDS>(fields), 0, 0 };
+
+    return record;
+}
+
+static EventRecord event_record(const scriba_id_t &id, const char *descr,
+                                const scriba_id_t &company_id, const scriba_id_t &poc_id,
+                                const scriba_id_t &project_id, enum ScribaEventType type,
+                                const char *outcome, scriba_time_t timestamp,
+                                enum ScribaEventState state)
+{
+    const char *fields[EVENT_FIELDS] = { descr, outcome };
+    EventRecord record{ id, company_id, poc_id, project_id, type, state, timestamp,
+                        StringBlock<EVENT_FIELDS>(fields), 0, 0 };
+
+    return record;
+}
+
+static bool str_equal(const char *a, const char *b)
+{
+    if ((a == NULL) || (b == NULL))
+    {
+        return (a == b);
+    }
+    return (strcmp(a, b) == 0);
+}
+
+static bool same_data(const CompanyRecord &record, const struct ScribaCompany *company)
+{
+    return str_equal(record.strings.get(COMPANY_NAME), company->name) &&
+           str_equal(record.strings.get(COMPANY_JUR_NAME), company->jur_name) &&
+           str_equal(record.strings.get(COMPANY_ADDRESS), company->address) &&
+           str_equal(record.strings.get(COMPANY_INN), company->inn) &&
+           str_equal(record.strings.get(COMPANY_PHONENUM), company->phonenum) &&
+           str_equal(record.strings.get(COMPANY_EMAIL), company->email);
+}
+
+static bool same_data(const POCRecord &record, const struct ScribaPoc *poc)
+{
+    return str_equal(record.strings.get(POC_FIRSTNAME), poc->firstname) &&
+           str_equal(record.strings.get(POC_SECONDNAME), poc->secondname) &&
+           str_equal(record.strings.get(POC_LASTNAME), poc->lastname) &&
+           str_equal(record.strings.get(POC_MOBILENUM), poc->mobilenum) &&
+           str_equal(record.strings.get(POC_PHONENUM), poc->phonenum) &&
+           str_equal(record.strings.get(POC_EMAIL), poc->email) &&
+           str_equal(record.strings.get(POC_POSITION), poc->position) &&
+           IdEqual()(record.company_id, poc->company_id);
+}
+
+static bool same_data(const ProjectRecord &record, const struct ScribaProject *project)
+{
+    return str_equal(record.strings.get(PROJECT_TITLE), project->title) &&
+           str_equal(record.strings.get(PROJECT_DESCR), project->descr) &&
+           IdEqual()(record.company_id, project->company_id) &&
+           (record.state == project->state) && (record.currency == project->currency) &&
+           (record.cost == project->cost) && (record.start_time == project->start_time) &&
+           (record.mod_time == project->mod_time);
+}
+
+static bool same_data(const EventRecord &record, const struct ScribaEvent *event)
+{
+    return str_equal(record.strings.get(EVENT_DESCR), event->descr) &&
+           str_equal(record.strings.get(EVENT_OUTCOME), event->outcome) &&
+           IdEqual()(record.company_id, event->company_id) &&
+           IdEqual()(record.poc_id, event->poc_id) &&
+           IdEqual()(record.project_id, event->project_id) &&
+           (record.type == event->type) && (record.timestamp == event->timestamp) &&
+           (record.state == event->state);
+}
+
+static bool text_contains(const char *text, const char *pattern)
+{
+    if ((text == NULL) || (pattern == NULL))
+    {
+        return false;
+    }
+
+    size_t len = strlen(text);
+    size_t pattern_len = strlen(pattern);
+    for (size_t start = 0; start + pattern_len <= len; start++)
+    {
+        size_t i = 0;
+        while ((i < pattern_len) &&
+               (tolower((unsigned char)text[start + i]) == tolower((unsigned char)pattern[i])))
+        {
+            i++;
+        }
+        if (i == pattern_len)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool time_match(scriba_time_t time, scriba_time_t cond, enum ScribaTimeComp comp)
+{
+    switch (comp)
+    {
+    case SCRIBA_TIME_BEFORE:
+        return (time < cond);
+    case SCRIBA_TIME_AFTER:
+        return (time > cond);
+    default:
+        return true;
+    }
+}
+
+static void list_company(scriba_list_t *list, const CompanyRecord &record)
+{
+    scriba_list_add(list, record.id, (char *)record.strings.get(COMPANY_NAME));
+}
+
+static void list_poc(scriba_list_t *list, const POCRecord &record)
+{
+    std::string name;
+
+    // first, second and last names separated by spaces
+    for (int i = POC_FIRSTNAME; i <= POC_LASTNAME; i++)
+    {
+        if (i != POC_FIRSTNAME)
+        {
+            name += ' ';
+        }
+        if (record.strings.get(i) != NULL)
+        {
+            name += record.strings.get(i);
+        }
+    }
+    scriba_list_add(list, record.id, (name.size() > 2) ? (char *)name.c_str() : NULL);
+}
+
+static void list_project(scriba_list_t *list, const ProjectRecord &record)
+{
+    const char *title = record.strings.get(PROJECT_TITLE);
+    scriba_list_add(list, record.id, ((title != NULL) && (*title != 0)) ? (char *)title : NULL);
+}
+
+static void list_event(scriba_list_t *list, const EventRecord &record)
+{
+    const char *descr = record.strings.get(EVENT_DESCR);
+    scriba_list_add(list, record.id, ((descr != NULL) && (*descr != 0)) ? (char *)descr : NULL);
+}
+
+template<typename K, typename M, typename T>
+static void list_index(scriba_list_t *list, const M &index, const K &key,
+                       void (*add)(scriba_list_t *, const T &))
+{
+    auto records = index.find(key);
+    if (records == index.end())
+    {
+        return;
+    }
+    for (const auto &entry : records->second)
+    {
+        add(list, *(entry.second));
+    }
+}
+
+static void list_events(scriba_list_t *list, const TimeIndex *index, const char *descr)
+{
+    TimeKey now;
+
+    if (index == NULL)
+    {
+        return;
+    }
+
+    // the first upcoming event follows all events with the current timestamp
+    now.time = (scriba_time_t)time(NULL);
+    now.seq = ~0ULL;
+    auto upcoming = index->upper_bound(now);
+
+    list_events(list, upcoming, index->end(), descr);
+    // past events go backwards by time, but events with the same time
+    // stay in insertion order like in SQLite backend
+    for (auto end = upcoming; end != index->begin(); )
+    {
+        auto last = std::prev(end);
+        auto begin = index->lower_bound(TimeKey{ last->time, 0, last->id });
+        list_events(list, begin, end, descr);
+        end = begin;
+    }
+}
+
+static void list_events(scriba_list_t *list, TimeIndex::const_iterator begin,
+                        TimeIndex::const_iterator end, const char *descr)
+{
+    for (auto it = begin; it != end; ++it)
+    {
+        const EventRecord *record = find(data->events, it->id);
+        if ((record != NULL) &&
+            ((descr == NULL) || text_contains(record->strings.get(EVENT_DESCR), descr)))
+        {
+            list_event(list, *record);
+        }
+    }
+}
+
+template<typename K, typename M>
+static void list_index_events(scriba_list_t *list, const M &index, const K &key)
+{
+    auto events = index.find(key);
+    if (events != index.end())
+    {
+        list_events(list, &(events->second), NULL);
+    }
+}
+
+// size of entity storage required for string field
+static size_t field_size(const char *str)
+{
+    return (str != NULL) ? strlen(str) + 1 : 0;
+}
+
+// size of entity storage required for company string field, empty strings are not stored
+static size_t company_field_size(const char *str)
+{
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
+}
+
+static char *copy_field(char **str_buf, const char *str)
+{
+    return (str != NULL) ? scriba_entity_strcpy(str_buf, str) : NULL;
+}
+
+static char *copy_company_field(char **str_buf, const char *str)
+{
+    return (company_field_size(str) != 0) ? scriba_entity_strcpy(str_buf, str) : NULL;
+}
+
+static struct ScribaCompany *company_data(const CompanyRecord &record)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+    size_t str_size = 0;
+
+    for (int i = 0; i < COMPANY_FIELDS; i++)
+    {
+        str_size += company_field_size(record.strings.get(i));
+    }
+    struct ScribaCompany *ret = (struct ScribaCompany *)scriba_entity_alloc(sizeof (struct ScribaCompany),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = record.id;
+    ret->name = copy_company_field(&str_buf, record.strings.get(COMPANY_NAME));
+    ret->jur_name = copy_company_field(&str_buf, record.strings.get(COMPANY_JUR_NAME));
+    ret->address = copy_company_field(&str_buf, record.strings.get(COMPANY_ADDRESS));
+    ret->inn = copy_company_field(&str_buf, record.strings.get(COMPANY_INN));
+    ret->phonenum = copy_company_field(&str_buf, record.strings.get(COMPANY_PHONENUM));
+    ret->email = copy_company_field(&str_buf, record.strings.get(COMPANY_EMAIL));
+
+    ret->poc_list = scriba_list_init();
+    ret->proj_list = scriba_list_init();
+    ret->event_list = scriba_list_init();
+    list_index(ret->poc_list, data->people_by_company, record.id, list_poc);
+    list_index(ret->proj_list, data->projects_by_company, record.id, list_project);
+    list_index_events(ret->event_list, data->events_by_company, record.id);
+
+    return ret;
+}
+
+static struct ScribaPoc *poc_data(const POCRecord &record)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+    size_t str_size = 0;
+
+    for (int i = 0; i < POC_FIELDS; i++)
+    {
+        str_size += field_size(record.strings.get(i));
+    }
+    struct ScribaPoc *ret = (struct ScribaPoc *)scriba_entity_alloc(sizeof (struct ScribaPoc),
+                                                                    str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = record.id;
+    ret->firstname = copy_field(&str_buf, record.strings.get(POC_FIRSTNAME));
+    ret->secondname = copy_field(&str_buf, record.strings.get(POC_SECONDNAME));
+    ret->lastname = copy_field(&str_buf, record.strings.get(POC_LASTNAME));
+    ret->mobilenum = copy_field(&str_buf, record.strings.get(POC_MOBILENUM));
+    ret->phonenum = copy_field(&str_buf, record.strings.get(POC_PHONENUM));
+    ret->email = copy_field(&str_buf, record.strings.get(POC_EMAIL));
+    ret->position = copy_field(&str_buf, record.strings.get(POC_POSITION));
+    ret->company_id = record.company_id;
+
+    return ret;
+}
+
+static struct ScribaProject *project_data(const ProjectRecord &record)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(record.strings.get(PROJECT_TITLE)) +
+                      field_size(record.strings.get(PROJECT_DESCR));
+    struct ScribaProject *ret = (struct ScribaProject *)scriba_entity_alloc(sizeof (struct ScribaProject),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = record.id;
+    ret->title = copy_field(&str_buf, record.strings.get(PROJECT_TITLE));
+    ret->descr = copy_field(&str_buf, record.strings.get(PROJECT_DESCR));
+    ret->company_id = record.company_id;
+    ret->state = record.state;
+    ret->currency = record.currency;
+    ret->cost = record.cost;
+    ret->start_time = record.start_time;
+    ret->mod_time = record.mod_time;
+
+    return ret;
+}
+
+static struct ScribaEvent *event_data(const EventRecord &record)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(record.strings.get(EVENT_DESCR)) +
+                      field_size(record.strings.get(EVENT_OUTCOME));
+    struct ScribaEvent *ret = (struct ScribaEvent *)scriba_entity_alloc(sizeof (struct ScribaEvent),
+                                                                        str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = record.id;
+    ret->descr = copy_field(&str_buf, record.strings.get(EVENT_DESCR));
+    ret->company_id = record.company_id;
+    ret->poc_id = record.poc_id;
+    ret->project_id = record.project_id;
+    ret->type = record.type;
+    ret->outcome = copy_field(&str_buf, record.strings.get(EVENT_OUTCOME));
+    ret->timestamp = record.timestamp;
+    ret->state = record.state;
+
+    return ret;
+}
+
+template<typename T, typename S>
+static S *get_entity(const Table<T> &table, const scriba_id_t &id, S *(*create)(const T &))
+{
+    const T *record = find(table, id);
+    return (record != NULL) ? create(*record) : NULL;
+}
+
+template<typename T, typename S>
+static size_t get_entities(const Table<T> &table, const scriba_id_t *ids, size_t n, S **result,
+                           S *(*create)(const T &))
+{
+    size_t found = 0;
+
+    if (result == NULL)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        result[i] = get_entity(table, ids[i], create);
+        if (result[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
+static void fill_scanned(const CompanyRecord &record, ScribaCompany &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = record.id;
+    scanned.name = (char *)record.strings.get(COMPANY_NAME);
+    scanned.jur_name = (char *)record.strings.get(COMPANY_JUR_NAME);
+    scanned.address = (char *)record.strings.get(COMPANY_ADDRESS);
+    scanned.inn = (char *)record.strings.get(COMPANY_INN);
+    scanned.phonenum = (char *)record.strings.get(COMPANY_PHONENUM);
+    scanned.email = (char *)record.strings.get(COMPANY_EMAIL);
+}
+
+static void fill_scanned(const POCRecord &record, ScribaPoc &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = record.id;
+    scanned.firstname = (char *)record.strings.get(POC_FIRSTNAME);
+    scanned.secondname = (char *)record.strings.get(POC_SECONDNAME);
+    scanned.lastname = (char *)record.strings.get(POC_LASTNAME);
+    scanned.mobilenum = (char *)record.strings.get(POC_MOBILENUM);
+    scanned.phonenum = (char *)record.strings.get(POC_PHONENUM);
+    scanned.email = (char *)record.strings.get(POC_EMAIL);
+    scanned.position = (char *)record.strings.get(POC_POSITION);
+    scanned.company_id = record.company_id;
+}
+
+static void fill_scanned(const ProjectRecord &record, ScribaProject &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = record.id;
+    scanned.title = (char *)record.strings.get(PROJECT_TITLE);
+    scanned.descr = (char *)record.strings.get(PROJECT_DESCR);
+    scanned.company_id = record.company_id;
+    scanned.state = record.state;
+    scanned.currency = record.currency;
+    scanned.cost = record.cost;
+    scanned.start_time = record.start_time;
+    scanned.mod_time = record.mod_time;
+}
+
+static void fill_scanned(const EventRecord &record, ScribaEvent &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = record.id;
+    scanned.descr = (char *)record.strings.get(EVENT_DESCR);
+    scanned.company_id = record.company_id;
+    scanned.poc_id = record.poc_id;
+    scanned.project_id = record.project_id;
+    scanned.type = record.type;
+    scanned.outcome = (char *)record.strings.get(EVENT_OUTCOME);
+    scanned.timestamp = record.timestamp;
+    scanned.state = record.state;
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaCompany &company)
+{
+    return scriba_scan_filter_match(filter, &(company.id), &(company.id), NULL);
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaPoc &poc)
+{
+    return scriba_scan_filter_match(filter, &(poc.id), &(poc.company_id), NULL);
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaProject &project)
+{
+    return scriba_scan_filter_match(filter, &(project.id), &(project.company_id),
+                                    &(project.mod_time));
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaEvent &event)
+{
+    return scriba_scan_filter_match(filter, &(event.id), &(event.company_id), NULL);
+}
+
+template<typename T, typename S>
+static void scan_record(const T &record, const ScribaScanFilter *filter,
+                        void (*func)(const S *, void *), void *ctx)
+{
+    S scanned;
+
+    if ((filter != NULL) && filter->use_changed_since && (record.stamp <= filter->changed_since))
+    {
+        return;
+    }
+    fill_scanned(record, scanned);
+    if (scan_match(filter, scanned))
+    {
+        func(&scanned, ctx);
+    }
+}
+
+template<typename T, typename S>
+static int scan_entities(const Table<T> &table, const ScribaScanFilter *filter,
+                         void (*func)(const S *, void *), void *ctx)
+{
+    if (func == NULL)
+    {
+        return -1;
+    }
+
+    if ((filter != NULL) && (filter->ids != NULL))
+    {
+        // selected entities are looked up instead of scanning all of them
+        for (size_t i = 0; i < filter->num_ids; i++)
+        {
+            const T *record = find(table, filter->ids[i]);
+            if (record != NULL)
+            {
+                scan_record(*record, filter, func, ctx);
+            }
+        }
+        return 0;
+    }
+
+    for (const auto &row : table.order)
+    {
+        scan_record(*(row.second), filter, func, ctx);
+    }
+    return 0;
+}
+
+// company interface functions
+static struct ScribaCompany *getCompany(scriba_id_t id)
+{
+    return get_entity(data->companies, id, company_data);
+}
+
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies)
+{
+    return get_entities(data->companies, ids, n, companies, company_data);
+}
+
+static scriba_list_t *getAllCompanies()
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->companies.order)
+    {
+        list_company(list, *(row.second));
+    }
+    return list;
+}
+
+// search companies by text of the given field
+static scriba_list_t *companySearch(enum CompanyField field, const char *text)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->companies.order)
+    {
+        if (text_contains(row.second->strings.get(field), text))
+        {
+            list_company(list, *(row.second));
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getCompaniesByName(const char *name)
+{
+    return companySearch(COMPANY_NAME, name);
+}
+
+static scriba_list_t *getCompaniesByJurName(const char *juridicial_name)
+{
+    return companySearch(COMPANY_JUR_NAME, juridicial_name);
+}
+
+static scriba_list_t *getCompaniesByAddress(const char *address)
+{
+    return companySearch(COMPANY_ADDRESS, address);
+}
+
+static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
+                       const char *address, const char *inn, const char *phonenum,
+                       const char *email)
+{
+    // same as the SQLite backend, entity with existing id is not added
+    if (find(data->companies, id) == NULL)
+    {
+        store(data->companies, company_record(id, name, jur_name, address, inn, phonenum, email));
+    }
+}
+
+static void updateCompany(const struct ScribaCompany *company)
+{
+    if ((company == NULL) || (find(data->companies, company->id) == NULL))
+    {
+        return;
+    }
+    store(data->companies, company_record(company->id, company->name, company->jur_name,
+                                          company->address, company->inn, company->phonenum,
+                                          company->email));
+}
+
+static void removeCompany(scriba_id_t id)
+{
+    remove(data->companies, id);
+}
+
+static int upsertCompany(const struct ScribaCompany *company, int overwrite)
+{
+    const CompanyRecord *existing = find(data->companies, company->id);
+
+    if ((existing != NULL) && (!overwrite || same_data(*existing, company)))
+    {
+        return SCRIBA_UPSERT_KEPT;
+    }
+    store(data->companies, company_record(company->id, company->name, company->jur_name,
+                                          company->address, company->inn, company->phonenum,
+                                          company->email));
+    return (existing != NULL) ? SCRIBA_UPSERT_UPDATED : SCRIBA_UPSERT_INSERTED;
+}
+
+// POC interface functions
+static struct ScribaPoc *getPOC(scriba_id_t id)
+{
+    return get_entity(data->people, id, poc_data);
+}
+
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people)
+{
+    return get_entities(data->people, ids, n, people, poc_data);
+}
+
+static scriba_list_t *getAllPeople()
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->people.order)
+    {
+        list_poc(list, *(row.second));
+    }
+    return list;
+}
+
+// search people by text of the given field
+static void pocSearch(scriba_list_t *list, enum POCField field, const char *text)
+{
+    for (const auto &row : data->people.order)
+    {
+        if (text_contains(row.second->strings.get(field), text))
+        {
+            list_poc(list, *(row.second));
+        }
+    }
+}
+
+static scriba_list_t *getPOCByName(const char *name)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    // same as the SQLite backend, people matching by several names
+    // are listed several times
+    pocSearch(list, POC_FIRSTNAME, name);
+    pocSearch(list, POC_SECONDNAME, name);
+    pocSearch(list, POC_LASTNAME, name);
+    return list;
+}
+
+static scriba_list_t *getPOCByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index(list, data->people_by_company, id, list_poc);
+    return list;
+}
+
+static scriba_list_t *getPOCByPosition(const char *position)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    pocSearch(list, POC_POSITION, position);
+    return list;
+}
+
+static scriba_list_t *getPOCByPhoneNum(const char *phonenum)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->people.order)
+    {
+        // phone numbers are compared exactly
+        const char *poc_phonenum = row.second->strings.get(POC_PHONENUM);
+        if ((phonenum != NULL) && (poc_phonenum != NULL) && (strcmp(poc_phonenum, phonenum) == 0))
+        {
+            list_poc(list, *(row.second));
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getPOCByEmail(const char *email)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    pocSearch(list, POC_EMAIL, email);
+    return list;
+}
+
+static void addPOC(scriba_id_t id, const char *firstname, const char *secondname,
+                   const char *lastname, const char *mobilenum, const char *phonenum,
+                   const char *email, const char *position, scriba_id_t company_id)
+{
+    if (find(data->people, id) == NULL)
+    {
+        store(data->people, poc_record(id, firstname, secondname, lastname, mobilenum, phonenum,
+                                       email, position, company_id));
+    }
+}
+
+static void updatePOC(const struct ScribaPoc *poc)
+{
+    if ((poc == NULL) || (find(data->people, poc->id) == NULL))
+    {
+        return;
+    }
+    store(data->people, poc_record(poc->id, poc->firstname, poc->secondname, poc->lastname,
+                                   poc->mobilenum, poc->phonenum, poc->email, poc->position,
+                                   poc->company_id));
+}
+
+static void removePOC(scriba_id_t id)
+{
+    remove(data->people, id);
+}
+
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite)
+{
+    const POCRecord *existing = find(data->people, poc->id);
+
+    if ((existing != NULL) && (!overwrite || same_data(*existing, poc)))
+    {
+        return SCRIBA_UPSERT_KEPT;
+    }
+    store(data->people, poc_record(poc->id, poc->firstname, poc->secondname, poc->lastname,
+                                   poc->mobilenum, poc->phonenum, poc->email, poc->position,
+                                   poc->company_id));
+    return (existing != NULL) ? SCRIBA_UPSERT_UPDATED : SCRIBA_UPSERT_INSERTED;
+}
+
+// project interface functions
+static struct ScribaProject *getProject(scriba_id_t id)
+{
+    return get_entity(data->projects, id, project_data);
+}
+
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects)
+{
+    return get_entities(data->projects, ids, n, projects, project_data);
+}
+
+static scriba_list_t *getAllProjects()
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->projects.order)
+    {
+        list_project(list, *(row.second));
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByTitle(const char *title)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    for (const auto &row : data->projects.order)
+    {
+        if (text_contains(row.second->strings.get(PROJECT_TITLE), title))
+        {
+            list_project(list, *(row.second));
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index(list, data->projects_by_company, id, list_project);
+    return list;
+}
+
+static scriba_list_t *getProjectsByState(enum ScribaProjectState state)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index(list, data->projects_by_state, (int)state, list_project);
+    return list;
+}
+
+static scriba_list_t *getProjectsByTime(scriba_time_t start_time, enum ScribaTimeComp start_comp,
+                                        scriba_time_t mod_time, enum ScribaTimeComp mod_comp)
+{
+    scriba_list_t *list = scriba_list_init();
+    const TimeIndex *index = &(data->projects_by_start);
+    scriba_time_t cond = start_time;
+    enum ScribaTimeComp comp = start_comp;
+    TimeKey key;
+
+    if ((start_comp == SCRIBA_TIME_IGNORE) && (mod_comp == SCRIBA_TIME_IGNORE))
+    {
+        return list;
+    }
+    if (start_comp == SCRIBA_TIME_IGNORE)
+    {
+        index = &(data->projects_by_mod);
+        cond = mod_time;
+        comp = mod_comp;
+    }
+
+    // range of the ordered index matching one condition, the other one
+    // is checked for each project of the range
+    key.time = cond;
+    auto begin = index->begin();
+    auto end = index->end();
+    if (comp == SCRIBA_TIME_BEFORE)
+    {
+        key.seq = 0;
+        end = index->lower_bound(key);
+    }
+    else
+    {
+        key.seq = ~0ULL;
+        begin = index->upper_bound(key);
+    }
+
+    // matching projects are listed in insertion order like SQLite does
+    SeqIndex<ProjectRecord> found;
+    for (auto it = begin; it != end; ++it)
+    {
+        const ProjectRecord *record = find(data->projects, it->id);
+        if ((record != NULL) && time_match(record->start_time, start_time, start_comp) &&
+            time_match(record->mod_time, mod_time, mod_comp))
+        {
+            found[record->seq] = record;
+        }
+    }
+    for (const auto &entry : found)
+    {
+        list_project(list, *(entry.second));
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByStateTime(enum ScribaProjectState state,
+                                             scriba_time_t start_time,
+                                             enum ScribaTimeComp start_comp,
+                                             scriba_time_t mod_time,
+                                             enum ScribaTimeComp mod_comp)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    auto projects = data->projects_by_state.find((int)state);
+    if (projects == data->projects_by_state.end())
+    {
+        return list;
+    }
+    for (const auto &entry : projects->second)
+    {
+        const ProjectRecord *record = entry.second;
+        if (time_match(record->start_time, start_time, start_comp) &&
+            time_match(record->mod_time, mod_time, mod_comp))
+        {
+            list_project(list, *record);
+        }
+    }
+    return list;
+}
+
+static void addProject(scriba_id_t id, const char *title, const char *descr,
+                       scriba_id_t company_id, enum ScribaProjectState state,
+                       enum ScribaCurrency currency, long long cost, scriba_time_t start_time)
+{
+    // mod_time is set to start_time at project creation
+    if (find(data->projects, id) == NULL)
+    {
+        store(data->projects, project_record(id, title, descr, company_id, state, currency, cost,
+                                             start_time, start_time));
+    }
+}
+
+static void updateProject(struct ScribaProject *project)
+{
+    if ((project == NULL) || (find(data->projects, project->id) == NULL))
+    {
+        return;
+    }
+    store(data->projects, project_record(project->id, project->title, project->descr,
+                                         project->company_id, project->state, project->currency,
+                                         project->cost, project->start_time, project->mod_time));
+}
+
+static void removeProject(scriba_id_t id)
+{
+    remove(data->projects, id);
+}
+
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time)
+{
+    const ProjectRecord *existing = find(data->projects, project->id);
+
+    if ((existing != NULL) && (!overwrite || same_data(*existing, project)))
+    {
+        return SCRIBA_UPSERT_KEPT;
+    }
+    // existing project changing its state gets the given mod_time
+    if ((existing != NULL) && (existing->state != project->state))
+    {
+        store(data->projects, project_record(project->id, project->title, project->descr,
+                                             project->company_id, project->state,
+                                             project->currency, project->cost,
+                                             project->start_time, mod_time));
+        return SCRIBA_UPSERT_UPDATED;
+    }
+    store(data->projects, project_record(project->id, project->title, project->descr,
+                                         project->company_id, project->state, project->currency,
+                                         project->cost, project->start_time, project->mod_time));
+    return (existing != NULL) ? SCRIBA_UPSERT_UPDATED : SCRIBA_UPSERT_INSERTED;
+}
+
+// event interface functions
+static struct ScribaEvent *getEvent(scriba_id_t id)
+{
+    return get_entity(data->events, id, event_data);
+}
+
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events)
+{
+    return get_entities(data->events, ids, n, events, event_data);
+}
+
+static scriba_list_t *getAllEvents()
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_events(list, &(data->events_by_time), NULL);
+    return list;
+}
+
+static scriba_list_t *getEventsByDescr(const char *descr)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    if (descr != NULL)
+    {
+        list_events(list, &(data->events_by_time), descr);
+    }
+    return list;
+}
+
+static scriba_list_t *getEventsByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index_events(list, data->events_by_company, id);
+    return list;
+}
+
+static scriba_list_t *getEventsByPOC(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index_events(list, data->events_by_poc, id);
+    return list;
+}
+
+static scriba_list_t *getEventsByProject(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index_events(list, data->events_by_project, id);
+    return list;
+}
+
+static scriba_list_t *getEventsByState(enum ScribaEventState state)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_index_events(list, data->events_by_state, (int)state);
+    return list;
+}
+
+static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id, scriba_id_t poc_id,
+                     scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
+                     scriba_time_t timestamp, enum ScribaEventState state)
+{
+    if (find(data->events, id) == NULL)
+    {
+        store(data->events, event_record(id, descr, company_id, poc_id, project_id, type, outcome,
+                                         timestamp, state));
+    }
+}
+
+static void updateEvent(const struct ScribaEvent *event)
+{
+    if ((event == NULL) || (find(data->events, event->id) == NULL))
+    {
+        return;
+    }
+    store(data->events, event_record(event->id, event->descr, event->company_id, event->poc_id,
+                                     event->project_id, event->type, event->outcome,
+                                     event->timestamp, event->state));
+}
+
+static void removeEvent(scriba_id_t id)
+{
+    remove(data->events, id);
+}
+
+static int upsertEvent(const struct ScribaEvent *event, int overwrite)
+{
+    const EventRecord *existing = find(data->events, event->id);
+
+    if ((existing != NULL) && (!overwrite || same_data(*existing, event)))
+    {
+        return SCRIBA_UPSERT_KEPT;
+    }
+    store(data->events, event_record(event->id, event->descr, event->company_id, event->poc_id,
+                                     event->project_id, event->type, event->outcome,
+                                     event->timestamp, event->state));
+    return (existing != NULL) ? SCRIBA_UPSERT_UPDATED : SCRIBA_UPSERT_INSERTED;
+}
+
+// scan interface functions
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx)
+{
+    return scan_entities(data->companies, filter, func, ctx);
+}
+
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx)
+{
+    return scan_entities(data->people, filter, func, ctx);
+}
+
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx)
+{
+    return scan_entities(data->projects, filter, func, ctx);
+}
+
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx)
+{
+    return scan_entities(data->events, filter, func, ctx);
+}
+
+static int beginWrite()
+{
+    // nested transactions are not supported
+    if (data->in_write)
+    {
+        return 1;
+    }
+    data->in_write = true;
+    data->write_stamp = data->stamp;
+    return 0;
+}
+
+static int commitWrite()
+{
+    if (!data->in_write)
+    {
+        return 1;
+    }
+    data->companies.undo.clear();
+    data->people.undo.clear();
+    data->projects.undo.clear();
+    data->events.undo.clear();
+    data->in_write = false;
+    return 0;
+}
+
+static void rollbackWrite()
+{
+    if (!data->in_write)
+    {
+        return;
+    }
+    rollback_table(data->companies);
+    rollback_table(data->people);
+    rollback_table(data->projects);
+    rollback_table(data->events);
+    // stamps of the discarded changes are handed out again
+    data->stamp = data->write_stamp;
+    data->in_write = false;
+}
+
+static unsigned long long getChangeStamp()
+{
+    return data->stamp;
+}
+
+static int scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx)
+{
+    const IdMap<unsigned long long> *removed[] = { &(data->companies.removed),
+                                                  &(data->people.removed),
+                                                  &(data->projects.removed),
+                                                  &(data->events.removed) };
+    const enum ScribaEntityType types[] = { SCRIBA_ENTITY_COMPANY, SCRIBA_ENTITY_POC,
+                                            SCRIBA_ENTITY_PROJECT, SCRIBA_ENTITY_EVENT };
+
+    if (func == NULL)
+    {
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof (types) / sizeof (types[0]); i++)
+    {
+        for (const auto &entry : *(removed[i]))
+        {
+            if (entry.second > since)
+            {
+                func(&(entry.first), types[i], ctx);
+            }
+        }
+    }
+    return 0;
+}
+
+static void load_company(const struct ScribaCompany *company, void *)
+{
+    store(data->companies, company_record(company->id, company->name, company->jur_name,
+                                          company->address, company->inn, company->phonenum,
+                                          company->email));
+}
+
+static void load_poc(const struct ScribaPoc *poc, void *)
+{
+    store(data->people, poc_record(poc->id, poc->firstname, poc->secondname, poc->lastname,
+                                   poc->mobilenum, poc->phonenum, poc->email, poc->position,
+                                   poc->company_id));
+}
+
+static void load_project(const struct ScribaProject *project, void *)
+{
+    store(data->projects, project_record(project->id, project->title, project->descr,
+                                         project->company_id, project->state, project->currency,
+                                         project->cost, project->start_time, project->mod_time));
+}
+
+static void load_event(const struct ScribaEvent *event, void *)
+{
+    store(data->events, event_record(event->id, event->descr, event->company_id, event->poc_id,
+                                     event->project_id, event->type, event->outcome,
+                                     event->timestamp, event->state));
+}
+
+} // namespace scriba
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_MEMORY_BACKEND_H
+#define SCRIBA_MEMORY_BACKEND_H
+
+#include "db_backend.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Backend keeping the whole database in memory. Entities are stored in hash
+ * tables keyed by id, strings of an entity share a single allocation. Entities
+ * are looked up by company, person, project and state through hash indexes,
+ * events and project times are kept in ordered indexes. Text searches scan
+ * the tables. Lists are returned in the same order the SQLite backend uses.
+ * Entity storage and indexes are allocated with the library allocator
+ * (scriba_setAllocator()).
+ *
+ * If snapshot location parameter is given, the database is loaded from the
+ * snapshot file at init (if the file exists) and written back to it at cleanup.
+ * Like the SQLite backend, the backend is not thread-safe, calls should be
+ * serialized by the application. */
+
+#define SCRIBA_MEMORY_BACKEND_NAME "scriba_memory"
+#define SCRIBA_MEMORY_SNAPSHOT_PARAM "snapshot_loc"
+
+extern struct ScribaInternalDB memoryDB;
+
+int scriba_memory_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl);
+
+void scriba_memory_cleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_MEMORY_BACKEND_H
@@ -25,46 +25,223 @@
 
 extern struct ScribaDBFuncTbl *fTbl;
 
+// retrieve people from the database, in one batch if backend supports it
+static size_t fetch_people(const scriba_id_t *ids, size_t n, struct ScribaPoc **people);
+static int upsert_poc(const struct ScribaPoc *poc, int overwrite);
+// drop cached POC and companies listing it
+static void invalidate_poc(const scriba_id_t *id, const scriba_id_t *company_id,
+                           const scriba_id_t *old_company_id);
+
 // get POC by id
 struct ScribaPoc *scriba_getPOC(scriba_id_t id)
 {
-    return (fTbl->getPOC(id));
+    unsigned long long version = scriba_cache_version();
+    struct ScribaPoc *poc = (struct ScribaPoc *)scriba_cache_get(SCRIBA_ENTITY_POC, &id);
+
+    if (poc == NULL)
+    {
+        poc = fTbl->getPOC(id);
+        scriba_cache_put(SCRIBA_ENTITY_POC, poc, version);
+    }
+    return poc;
+}
+
+// get shared POC by id
+const struct ScribaPoc *scriba_getSharedPOC(scriba_id_t id)
+{
+    unsigned long long version = scriba_cache_version();
+    const struct ScribaPoc *poc = (const struct ScribaPoc *)scriba_cache_get_shared(SCRIBA_ENTITY_POC, &id);
+
+    if (poc == NULL)
+    {
+        // the entity is shared once, the cache and the caller hold a reference each
+        struct ScribaPoc *fetched = fTbl->getPOC(id);
+        poc = (const struct ScribaPoc *)scriba_entity_share(SCRIBA_ENTITY_POC, fetched);
+        scriba_freePOCData(fetched);
+        scriba_cache_put(SCRIBA_ENTITY_POC, poc, version);
+    }
+    return poc;
+}
+
+// get info of several people by their ids
+size_t scriba_getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people)
+{
+    unsigned long long version = scriba_cache_version();
+    scriba_id_t *missing_ids = NULL;
+    struct ScribaPoc **missing = NULL;
+    size_t num_missing = 0;
+    size_t found = 0;
+
+    if ((ids == NULL) || (people == NULL))
+    {
+        return 0;
+    }
+    if ((n == 0) || !scriba_cache_enabled())
+    {
+        return fetch_people(ids, n, people);
+    }
+
+    // take cached people, retrieve the rest from the database at once
+    missing_ids = (scriba_id_t *)scriba_malloc(n * sizeof (scriba_id_t));
+    missing = (struct ScribaPoc **)scriba_malloc(n * sizeof (struct ScribaPoc *));
+    if ((missing_ids == NULL) || (missing == NULL))
+    {
+        scriba_free(missing_ids);
+        scriba_free(missing);
+        return fetch_people(ids, n, people);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        people[i] = (struct ScribaPoc *)scriba_cache_get(SCRIBA_ENTITY_POC, &(ids[i]));
+        if (people[i] == NULL)
+        {
+            scriba_id_copy(&(missing_ids[num_missing]), &(ids[i]));
+            num_missing++;
+        }
+    }
+    if (num_missing != 0)
+    {
+        fetch_people(missing_ids, num_missing, missing);
+    }
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        if (people[i] == NULL)
+        {
+            people[i] = missing[j++];
+            scriba_cache_put(SCRIBA_ENTITY_POC, people[i], version);
+        }
+        if (people[i] != NULL)
+        {
+            found++;
+        }
+    }
+    scriba_free(missing_ids);
+    scriba_free(missing);
+
+    return found;
+}
+
+// retrieve people from the database
+static size_t fetch_people(const scriba_id_t *ids, size_t n, struct ScribaPoc **people)
+{
+    size_t found = 0;
+
+    if (fTbl->getPeople != NULL)
+    {
+        return fTbl->getPeople(ids, n, people);
+    }
+
+    // backend does not support batch retrieval
+    for (size_t i = 0; i < n; i++)
+    {
+        people[i] = fTbl->getPOC(ids[i]);
+        if (people[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
 }
 
 // search people by name
 scriba_list_t *scriba_getPOCByName(const char *name)
 {
-    return (fTbl->getPOCByName(name));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_POC_BY_NAME);
+    key.str = name;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getPOCByName(name);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all people
 scriba_list_t *scriba_getAllPeople()
 {
-    return (fTbl->getAllPeople());
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_ALL_PEOPLE);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getAllPeople();
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all people working in given company
 scriba_list_t *scriba_getPOCByCompany(scriba_id_t id)
 {
-    return (fTbl->getPOCByCompany(id));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_POC_BY_COMPANY);
+    scriba_id_copy(&(key.id), &id);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getPOCByCompany(id);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all people with given position
 scriba_list_t *scriba_getPOCByPosition(const char *position)
 {
-    return (fTbl->getPOCByPosition(position));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_POC_BY_POSITION);
+    key.str = position;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getPOCByPosition(position);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all people with given phone number
 scriba_list_t *scriba_getPOCByPhoneNum(const char *phonenum)
 {
-    return (fTbl->getPOCByPhoneNum(phonenum));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_POC_BY_PHONENUM);
+    key.str = phonenum;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getPOCByPhoneNum(phonenum);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get all people with given email
 scriba_list_t *scriba_getPOCByEmail(const char *email)
 {
-    return (fTbl->getPOCByEmail(email));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_POC, SCRIBA_QUERY_POC_BY_EMAIL);
+    key.str = email;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getPOCByEmail(email);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // add person to the database
@@ -78,6 +255,7 @@ void scriba_addPOC(const char *firstname, const char *secondname, const char *la
     fTbl->addPOC(id, firstname, secondname, lastname,
                  mobilenum, phonenum, email,
                  position, company_id);
+    invalidate_poc(&id, &company_id, NULL);
 }
 
 // add person with given ID to the database
@@ -88,117 +266,271 @@ void scriba_addPOCWithID(scriba_id_t id, const char *firstname, const char *seco
     fTbl->addPOC(id, firstname, secondname, lastname,
                  mobilenum, phonenum, email,
                  position, company_id);
+    invalidate_poc(&id, &company_id, NULL);
 }
 
 // update POC info
 void scriba_updatePOC(const struct ScribaPoc *poc)
 {
+    scriba_id_t old_company_id;
+    int has_old = 0;
+
+    if (poc != NULL)
+    {
+        has_old = scriba_cache_owner(SCRIBA_ENTITY_POC, &(poc->id), &old_company_id);
+    }
     fTbl->updatePOC(poc);
+    if (poc != NULL)
+    {
+        invalidate_poc(&(poc->id), &(poc->company_id), has_old ? &old_company_id : NULL);
+    }
 }
 
 // remove POC from the database
 void scriba_removePOC(scriba_id_t id)
 {
+    scriba_id_t old_company_id;
+    int has_old = scriba_cache_owner(SCRIBA_ENTITY_POC, &id, &old_company_id);
+
     fTbl->removePOC(id);
+    invalidate_poc(&id, NULL, has_old ? &old_company_id : NULL);
 }
 
-// create a copy of POC data structure
-struct ScribaPoc *scriba_copyPOC(const struct ScribaPoc *poc)
+// insert poc or merge it with existing one
+int scriba_upsertPOC(const struct ScribaPoc *poc, int overwrite)
+{
+    scriba_id_t old_company_id;
+    int has_old = 0;
+
+    if (poc != NULL)
+    {
+        has_old = scriba_cache_owner(SCRIBA_ENTITY_POC, &(poc->id), &old_company_id);
+    }
+    int ret = upsert_poc(poc, overwrite);
+    if ((ret == SCRIBA_UPSERT_UPDATED) || (ret == SCRIBA_UPSERT_INSERTED))
+    {
+        invalidate_poc(&(poc->id), &(poc->company_id), has_old ? &old_company_id : NULL);
+    }
+    return ret;
+}
+
+// insert poc or merge it with existing one in the database
+static int upsert_poc(const struct ScribaPoc *poc, int overwrite)
 {
-    int len = 0;
+    struct ScribaPoc *existing = NULL;
 
     if (poc == NULL)
     {
-        return NULL;
+        return -1;
     }
 
-    struct ScribaPoc *ret = (struct ScribaPoc *)malloc(sizeof (struct ScribaPoc));
-    memset(ret, 0, sizeof(struct ScribaPoc));
+    if (fTbl->upsertPOC != NULL)
+    {
+        return fTbl->upsertPOC(poc, overwrite);
+    }
 
-    scriba_id_copy(&(ret->id), &(poc->id));
-    if ((len = strlen(poc->firstname)) != 0)
+    // backend does not support upsert
+    existing = fTbl->getPOC(poc->id);
+    if (existing == NULL)
     {
-        ret->firstname = (char *)malloc(len + 1);
-        memset(ret->firstname, 0, len + 1);
-        strncpy(ret->firstname, poc->firstname, len);
+        fTbl->addPOC(poc->id, poc->firstname, poc->secondname, poc->lastname, poc->mobilenum,
+                     poc->phonenum, poc->email, poc->position, poc->company_id);
+        return SCRIBA_UPSERT_INSERTED;
     }
-    if ((len = strlen(poc->secondname)) != 0)
+    scriba_freePOCData(existing);
+    if (overwrite)
     {
-        ret->secondname = (char *)malloc(len + 1);
-        memset(ret->secondname, 0, len + 1);
-        strncpy(ret->secondname, poc->secondname, len);
+        fTbl->updatePOC(poc);
+        return SCRIBA_UPSERT_UPDATED;
     }
-    if ((len = strlen(poc->lastname)) != 0)
+    return SCRIBA_UPSERT_KEPT;
+}
+
+// call func for each person matching the filter or for all people
+int scriba_scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx)
+{
+    const scriba_id_t *ids = NULL;
+    scriba_id_t *all_ids = NULL;
+    size_t n = 0;
+
+    if (func == NULL)
     {
-        ret->lastname = (char *)malloc(len + 1);
-        memset(ret->lastname, 0, len + 1);
-        strncpy(ret->lastname, poc->lastname, len);
+        return -1;
     }
-    if ((len = strlen(poc->mobilenum)) != 0)
+
+    if (fTbl->scanPeople != NULL)
     {
-        ret->mobilenum = (char *)malloc(len + 1);
-        memset(ret->mobilenum, 0, len + 1);
-        strncpy(ret->mobilenum, poc->mobilenum, len);
+        return fTbl->scanPeople(filter, func, ctx);
     }
-    if ((len = strlen(poc->phonenum)) != 0)
+
+    // backend does not support scans, retrieve people in batches
+    if ((filter != NULL) && (filter->ids != NULL))
     {
-        ret->phonenum = (char *)malloc(len + 1);
-        memset(ret->phonenum, 0, len + 1);
-        strncpy(ret->phonenum, poc->phonenum, len);
+        ids = filter->ids;
+        n = filter->num_ids;
     }
-    if ((len = strlen(poc->email)) != 0)
+    else
     {
-        ret->email = (char *)malloc(len + 1);
-        memset(ret->email, 0, len + 1);
-        strncpy(ret->email, poc->email, len);
+        scriba_list_t *list = fTbl->getAllPeople();
+        all_ids = scriba_list_to_ids(list, &n);
+        scriba_list_delete(list);
+        ids = all_ids;
     }
-    if ((len = strlen(poc->position)) != 0)
+    for (size_t start = 0; start < n; start += SCRIBA_SCAN_BATCH_SIZE)
     {
-        ret->position = (char *)malloc(len + 1);
-        memset(ret->position, 0, len + 1);
-        strncpy(ret->position, poc->position, len);
+        struct ScribaPoc *people[SCRIBA_SCAN_BATCH_SIZE];
+        size_t num = ((n - start) > SCRIBA_SCAN_BATCH_SIZE) ? SCRIBA_SCAN_BATCH_SIZE : (n - start);
+
+        scriba_getPeople(ids + start, num, people);
+        for (size_t i = 0; i < num; i++)
+        {
+            if (people[i] == NULL)
+            {
+                continue;
+            }
+            if (scriba_scan_filter_match(filter, &(people[i]->id), &(people[i]->company_id), NULL))
+            {
+                func(people[i], ctx);
+            }
+            scriba_freePOCData(people[i]);
+        }
+    }
+    if (all_ids != NULL)
+    {
+        scriba_free(all_ids);
     }
-    scriba_id_copy(&(ret->company_id), &(poc->company_id));
 
-    return ret;
+    return 0;
 }
 
-// free memory occupied by POC data structure
-void scriba_freePOCData(struct ScribaPoc *poc)
+static void invalidate_poc(const scriba_id_t *id, const scriba_id_t *company_id,
+                           const scriba_id_t *old_company_id)
+{
+    scriba_cache_invalidate(SCRIBA_ENTITY_POC, id);
+    if (company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(company_id);
+    }
+    if (old_company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(old_company_id);
+    }
+}
+
+// size of string storage required to copy string field, empty strings are not copied
+static size_t field_size(const char *str)
 {
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
+}
+
+// create a copy of POC data structure
+struct ScribaPoc *scriba_copyPOC(const struct ScribaPoc *poc)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
     if (poc == NULL)
     {
-        return;
+        return NULL;
     }
 
-    if (poc->firstname != NULL)
+    size_t str_size = field_size(poc->firstname) + field_size(poc->secondname) +
+                      field_size(poc->lastname) + field_size(poc->mobilenum) +
+                      field_size(poc->phonenum) + field_size(poc->email) +
+                      field_size(poc->position);
+    struct ScribaPoc *ret = (struct ScribaPoc *)scriba_entity_alloc(sizeof (struct ScribaPoc),
+                                                                    str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    scriba_id_copy(&(ret->id), &(poc->id));
+    if (field_size(poc->firstname) != 0)
+    {
+        ret->firstname = scriba_entity_strcpy(&str_buf, poc->firstname);
+    }
+    if (field_size(poc->secondname) != 0)
+    {
+        ret->secondname = scriba_entity_strcpy(&str_buf, poc->secondname);
+    }
+    if (field_size(poc->lastname) != 0)
     {
-        free(poc->firstname);
+        ret->lastname = scriba_entity_strcpy(&str_buf, poc->lastname);
     }
-    if (poc->secondname != NULL)
+    if (field_size(poc->mobilenum) != 0)
     {
-        free(poc->secondname);
+        ret->mobilenum = scriba_entity_strcpy(&str_buf, poc->mobilenum);
     }
-    if (poc->lastname != NULL)
+    if (field_size(poc->phonenum) != 0)
     {
-        free(poc->lastname);
+        ret->phonenum = scriba_entity_strcpy(&str_buf, poc->phonenum);
     }
-    if (poc->mobilenum != NULL)
+    if (field_size(poc->email) != 0)
     {
-        free(poc->mobilenum);
+        ret->email = scriba_entity_strcpy(&str_buf, poc->email);
     }
-    if (poc->phonenum != NULL)
+    if (field_size(poc->position) != 0)
     {
-        free(poc->phonenum);
+        ret->position = scriba_entity_strcpy(&str_buf, poc->position);
     }
-    if (poc->email != NULL)
+    scriba_id_copy(&(ret->company_id), &(poc->company_id));
+
+    return ret;
+}
+
+// free memory occupied by POC data structure
+void scriba_freePOCData(struct ScribaPoc *poc)
+{
+    if (poc == NULL)
     {
-        free(poc->email);
+        return;
+    }
+
+    // shared entity is freed when its last reference is dropped
+    if (poc->layout == SCRIBA_LAYOUT_SHARED)
+    {
+        scriba_release(poc);
+        return;
     }
-    if (poc->position != NULL)
+
+    // strings are allocated separately only with the default layout
+    if (poc->layout == SCRIBA_LAYOUT_SEPARATE)
     {
-        free(poc->position);
+        if (poc->firstname != NULL)
+        {
+            scriba_free(poc->firstname);
+        }
+        if (poc->secondname != NULL)
+        {
+            scriba_free(poc->secondname);
+        }
+        if (poc->lastname != NULL)
+        {
+            scriba_free(poc->lastname);
+        }
+        if (poc->mobilenum != NULL)
+        {
+            scriba_free(poc->mobilenum);
+        }
+        if (poc->phonenum != NULL)
+        {
+            scriba_free(poc->phonenum);
+        }
+        if (poc->email != NULL)
+        {
+            scriba_free(poc->email);
+        }
+        if (poc->position != NULL)
+        {
+            scriba_free(poc->position);
+        }
     }
 
-    free(poc);
+    // arena memory is reclaimed by scriba_arena_reset()
+    if (poc->layout != SCRIBA_LAYOUT_ARENA)
+    {
+        scriba_free(poc);
+    }
 }
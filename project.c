@@ -26,41 +26,212 @@
 
 extern struct ScribaDBFuncTbl *fTbl;
 
+// retrieve projects from the database, in one batch if backend supports it
+static size_t fetch_projects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects);
+static int upsert_project(const struct ScribaProject *project, int overwrite);
+// drop cached project and companies listing it
+static void invalidate_project(const scriba_id_t *id, const scriba_id_t *company_id,
+                               const scriba_id_t *old_company_id);
+// drop all cached projects and companies after bulk changes
+static void invalidate_projects();
+
 // get project by id
 struct ScribaProject *scriba_getProject(scriba_id_t id)
 {
-    return (fTbl->getProject(id));
+    unsigned long long version = scriba_cache_version();
+    struct ScribaProject *project = (struct ScribaProject *)scriba_cache_get(SCRIBA_ENTITY_PROJECT, &id);
+
+    if (project == NULL)
+    {
+        project = fTbl->getProject(id);
+        scriba_cache_put(SCRIBA_ENTITY_PROJECT, project, version);
+    }
+    return project;
+}
+
+// get shared project by id
+const struct ScribaProject *scriba_getSharedProject(scriba_id_t id)
+{
+    unsigned long long version = scriba_cache_version();
+    const struct ScribaProject *project = (const struct ScribaProject *)scriba_cache_get_shared(SCRIBA_ENTITY_PROJECT, &id);
+
+    if (project == NULL)
+    {
+        // the entity is shared once, the cache and the caller hold a reference each
+        struct ScribaProject *fetched = fTbl->getProject(id);
+        project = (const struct ScribaProject *)scriba_entity_share(SCRIBA_ENTITY_PROJECT, fetched);
+        scriba_freeProjectData(fetched);
+        scriba_cache_put(SCRIBA_ENTITY_PROJECT, project, version);
+    }
+    return project;
+}
+
+// get info of several projects by their ids
+size_t scriba_getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects)
+{
+    unsigned long long version = scriba_cache_version();
+    scriba_id_t *missing_ids = NULL;
+    struct ScribaProject **missing = NULL;
+    size_t num_missing = 0;
+    size_t found = 0;
+
+    if ((ids == NULL) || (projects == NULL))
+    {
+        return 0;
+    }
+    if ((n == 0) || !scriba_cache_enabled())
+    {
+        return fetch_projects(ids, n, projects);
+    }
+
+    // take cached projects, retrieve the rest from the database at once
+    missing_ids = (scriba_id_t *)scriba_malloc(n * sizeof (scriba_id_t));
+    missing = (struct ScribaProject **)scriba_malloc(n * sizeof (struct ScribaProject *));
+    if ((missing_ids == NULL) || (missing == NULL))
+    {
+        scriba_free(missing_ids);
+        scriba_free(missing);
+        return fetch_projects(ids, n, projects);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        projects[i] = (struct ScribaProject *)scriba_cache_get(SCRIBA_ENTITY_PROJECT, &(ids[i]));
+        if (projects[i] == NULL)
+        {
+            scriba_id_copy(&(missing_ids[num_missing]), &(ids[i]));
+            num_missing++;
+        }
+    }
+    if (num_missing != 0)
+    {
+        fetch_projects(missing_ids, num_missing, missing);
+    }
+    for (size_t i = 0, j = 0; i < n; i++)
+    {
+        if (projects[i] == NULL)
+        {
+            projects[i] = missing[j++];
+            scriba_cache_put(SCRIBA_ENTITY_PROJECT, projects[i], version);
+        }
+        if (projects[i] != NULL)
+        {
+            found++;
+        }
+    }
+    scriba_free(missing_ids);
+    scriba_free(missing);
+
+    return found;
+}
+
+// retrieve projects from the database
+static size_t fetch_projects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects)
+{
+    size_t found = 0;
+
+    if (fTbl->getProjects != NULL)
+    {
+        return fTbl->getProjects(ids, n, projects);
+    }
+
+    // backend does not support batch retrieval
+    for (size_t i = 0; i < n; i++)
+    {
+        projects[i] = fTbl->getProject(ids[i]);
+        if (projects[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
 }
 
 // get all projects in the database
 scriba_list_t *scriba_getAllProjects()
 {
-    return (fTbl->getAllProjects());
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_ALL_PROJECTS);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getAllProjects();
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // search projects by title
 scriba_list_t *scriba_getProjectsByTitle(const char *title)
 {
-    return (fTbl->getProjectsByTitle(title));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_PROJECTS_BY_TITLE);
+    key.str = title;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getProjectsByTitle(title);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get projects associated with given company
 scriba_list_t *scriba_getProjectsByCompany(scriba_id_t id)
 {
-    return (fTbl->getProjectsByCompany(id));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_PROJECTS_BY_COMPANY);
+    scriba_id_copy(&(key.id), &id);
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getProjectsByCompany(id);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get projects with given state
 scriba_list_t *scriba_getProjectsByState(enum ScribaProjectState state)
 {
-    return (fTbl->getProjectsByState(state));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_PROJECTS_BY_STATE);
+    key.args[0] = state;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getProjectsByState(state);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get projects by time
 scriba_list_t *scriba_getProjectsByTime(scriba_time_t start_time, enum ScribaTimeComp start_comp,
                                         scriba_time_t mod_time, enum ScribaTimeComp mod_comp)
 {
-    return (fTbl->getProjectsByTime(start_time, start_comp, mod_time, mod_comp));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_PROJECTS_BY_TIME);
+    key.args[0] = start_time;
+    key.args[1] = start_comp;
+    key.args[2] = mod_time;
+    key.args[3] = mod_comp;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getProjectsByTime(start_time, start_comp, mod_time, mod_comp);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // get projects by state and time
@@ -70,7 +241,22 @@ scriba_list_t *scriba_getProjectsByStateTime(enum ScribaProjectState state,
                                              scriba_time_t mod_time,
                                              enum ScribaTimeComp mod_comp)
 {
-    return (fTbl->getProjectsByStateTime(state, start_time, start_comp, mod_time, mod_comp));
+    struct ScribaQueryKey key;
+    unsigned long long version = 0;
+
+    scriba_query_key_init(&key, SCRIBA_ENTITY_PROJECT, SCRIBA_QUERY_PROJECTS_BY_STATE_TIME);
+    key.args[0] = state;
+    key.args[1] = start_time;
+    key.args[2] = start_comp;
+    key.args[3] = mod_time;
+    key.args[4] = mod_comp;
+    scriba_list_t *ret = scriba_query_cache_get(&key, &version);
+    if (ret == NULL)
+    {
+        ret = fTbl->getProjectsByStateTime(state, start_time, start_comp, mod_time, mod_comp);
+        scriba_query_cache_put(&key, ret, version);
+    }
+    return ret;
 }
 
 // add project to the database
@@ -82,6 +268,7 @@ void scriba_addProject(const char *title, const char *descr, scriba_id_t company
 
     scriba_id_create(&id);
     fTbl->addProject(id, title, descr, company_id, state, currency, cost, start_time);
+    invalidate_project(&id, &company_id, NULL);
 }
 
 // add project with given ID to the database
@@ -91,12 +278,14 @@ void scriba_addProjectWithID(scriba_id_t id, const char *title, const char *desc
                              scriba_time_t start_time)
 {
     fTbl->addProject(id, title, descr, company_id, state, currency, cost, start_time);
+    invalidate_project(&id, &company_id, NULL);
 }
 
 // update project info
 void scriba_updateProject(struct ScribaProject *project)
 {
     struct ScribaProject *old_project = NULL;
+    scriba_id_t old_company_id;
 
     if (project == NULL)
     {
@@ -109,42 +298,327 @@ void scriba_updateProject(struct ScribaProject *project)
         // project state is being changed, update mod_time
         project->mod_time = (scriba_time_t)time(NULL);
     }
+    scriba_id_copy(&old_company_id, &(old_project->company_id));
     scriba_freeProjectData(old_project);
 
     fTbl->updateProject(project);
+    invalidate_project(&(project->id), &(project->company_id), &old_company_id);
 }
 
 // remove project from the database
 void scriba_removeProject(scriba_id_t id)
 {
+    scriba_id_t old_company_id;
+    int has_old = scriba_cache_owner(SCRIBA_ENTITY_PROJECT, &id, &old_company_id);
+
     fTbl->removeProject(id);
+    invalidate_project(&id, NULL, has_old ? &old_company_id : NULL);
+}
+
+// insert project or merge it with existing one
+int scriba_upsertProject(const struct ScribaProject *project, int overwrite)
+{
+    scriba_id_t old_company_id;
+    int has_old = 0;
+
+    if (project != NULL)
+    {
+        has_old = scriba_cache_owner(SCRIBA_ENTITY_PROJECT, &(project->id), &old_company_id);
+    }
+    int ret = upsert_project(project, overwrite);
+    if ((ret == SCRIBA_UPSERT_UPDATED) || (ret == SCRIBA_UPSERT_INSERTED))
+    {
+        invalidate_project(&(project->id), &(project->company_id),
+                           has_old ? &old_company_id : NULL);
+    }
+    return ret;
+}
+
+// insert project or merge it with existing one in the database
+static int upsert_project(const struct ScribaProject *project, int overwrite)
+{
+    // state change time, the same as for single project update
+    scriba_time_t mod_time = (scriba_time_t)time(NULL);
+    struct ScribaProject *existing = NULL;
+    struct ScribaProject updated_project;
+
+    if (project == NULL)
+    {
+        return -1;
+    }
+
+    if (fTbl->upsertProject != NULL)
+    {
+        return fTbl->upsertProject(project, overwrite, mod_time);
+    }
+
+    // backend does not support upsert
+    existing = fTbl->getProject(project->id);
+    memcpy(&updated_project, project, sizeof (struct ScribaProject));
+    if (existing == NULL)
+    {
+        fTbl->addProject(project->id, project->title, project->descr, project->company_id,
+                         project->state, project->currency, project->cost,
+                         project->start_time);
+        if (project->mod_time != project->start_time)
+        {
+            // keep mod_time of the given project
+            fTbl->updateProject(&updated_project);
+        }
+        return SCRIBA_UPSERT_INSERTED;
+    }
+    if (existing->state != project->state)
+    {
+        updated_project.mod_time = mod_time;
+    }
+    scriba_freeProjectData(existing);
+    if (overwrite)
+    {
+        fTbl->updateProject(&updated_project);
+        return SCRIBA_UPSERT_UPDATED;
+    }
+    return SCRIBA_UPSERT_KEPT;
+}
+
+// call func for each project matching the filter or for all projects
+int scriba_scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx)
+{
+    const scriba_id_t *ids = NULL;
+    scriba_id_t *all_ids = NULL;
+    size_t n = 0;
+
+    if (func == NULL)
+    {
+        return -1;
+    }
+
+    if (fTbl->scanProjects != NULL)
+    {
+        return fTbl->scanProjects(filter, func, ctx);
+    }
+
+    // backend does not support scans, retrieve projects in batches
+    if ((filter != NULL) && (filter->ids != NULL))
+    {
+        ids = filter->ids;
+        n = filter->num_ids;
+    }
+    else
+    {
+        scriba_list_t *list = fTbl->getAllProjects();
+        all_ids = scriba_list_to_ids(list, &n);
+        scriba_list_delete(list);
+        ids = all_ids;
+    }
+    for (size_t start = 0; start < n; start += SCRIBA_SCAN_BATCH_SIZE)
+    {
+        struct ScribaProject *projects[SCRIBA_SCAN_BATCH_SIZE];
+        size_t num = ((n - start) > SCRIBA_SCAN_BATCH_SIZE) ? SCRIBA_SCAN_BATCH_SIZE : (n - start);
+
+        scriba_getProjects(ids + start, num, projects);
+        for (size_t i = 0; i < num; i++)
+        {
+            if (projects[i] == NULL)
+            {
+                continue;
+            }
+            if (scriba_scan_filter_match(filter, &(projects[i]->id), &(projects[i]->company_id), &(projects[i]->mod_time)))
+            {
+                func(projects[i], ctx);
+            }
+            scriba_freeProjectData(projects[i]);
+        }
+    }
+    if (all_ids != NULL)
+    {
+        scriba_free(all_ids);
+    }
+
+    return 0;
+}
+
+// check whether project matches the filter
+static int project_matches(const struct ScribaProject *project,
+                           const struct ScribaProjectFilter *filter)
+{
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_STATE) && (project->state != filter->state))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_COMPANY) &&
+        !scriba_id_compare(&(project->company_id), &(filter->company_id)))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_START_FROM) && (project->start_time < filter->start_from))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_START_TO) && (project->start_time >= filter->start_to))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_MOD_FROM) && (project->mod_time < filter->mod_from))
+    {
+        return 0;
+    }
+    if ((filter->flags & SCRIBA_PROJECT_FILTER_MOD_TO) && (project->mod_time >= filter->mod_to))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+// apply update or removal to each project matching the filter one by one;
+// used if backend does not support bulk operations
+static long project_bulk_fallback(const struct ScribaProjectFilter *filter,
+                                  const struct ScribaProjectUpdate *update,
+                                  scriba_time_t mod_time)
+{
+    long count = 0;
+    scriba_list_t *projects = fTbl->getAllProjects();
+
+    scriba_list_for_each(projects, item)
+    {
+        struct ScribaProject *project = fTbl->getProject(item->id);
+        if (project == NULL)
+        {
+            continue;
+        }
+        if (project_matches(project, filter))
+        {
+            if (update == NULL)
+            {
+                fTbl->removeProject(project->id);
+            }
+            else
+            {
+                if ((update->flags & SCRIBA_PROJECT_SET_STATE) && (project->state != update->state))
+                {
+                    project->state = update->state;
+                    project->mod_time = mod_time;
+                }
+                if (update->flags & SCRIBA_PROJECT_SET_COMPANY)
+                {
+                    scriba_id_copy(&(project->company_id), &(update->company_id));
+                }
+                if (update->flags & SCRIBA_PROJECT_SET_CURRENCY)
+                {
+                    project->currency = update->currency;
+                }
+                if (update->flags & SCRIBA_PROJECT_SET_COST)
+                {
+                    project->cost = update->cost;
+                }
+                fTbl->updateProject(project);
+            }
+            count++;
+        }
+        scriba_freeProjectData(project);
+    }
+    scriba_list_delete(projects);
+
+    return count;
+}
+
+// update all projects matching the filter
+long scriba_updateProjects(const struct ScribaProjectFilter *filter,
+                           const struct ScribaProjectUpdate *update)
+{
+    // state change time, the same as for single project update
+    scriba_time_t mod_time = (scriba_time_t)time(NULL);
+
+    if ((filter == NULL) || (update == NULL))
+    {
+        return -1;
+    }
+    if (update->flags == 0)
+    {
+        // nothing to update
+        return 0;
+    }
+
+    long ret = (fTbl->updateProjects != NULL) ? fTbl->updateProjects(filter, update, mod_time) :
+                                                project_bulk_fallback(filter, update, mod_time);
+    if (ret != 0)
+    {
+        invalidate_projects();
+    }
+    return ret;
+}
+
+// remove all projects matching the filter
+long scriba_removeProjects(const struct ScribaProjectFilter *filter)
+{
+    if (filter == NULL)
+    {
+        return -1;
+    }
+
+    long ret = (fTbl->removeProjects != NULL) ? fTbl->removeProjects(filter) :
+                                                project_bulk_fallback(filter, NULL, 0);
+    if (ret != 0)
+    {
+        invalidate_projects();
+    }
+    return ret;
+}
+
+static void invalidate_project(const scriba_id_t *id, const scriba_id_t *company_id,
+                               const scriba_id_t *old_company_id)
+{
+    scriba_cache_invalidate(SCRIBA_ENTITY_PROJECT, id);
+    if (company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(company_id);
+    }
+    if (old_company_id != NULL)
+    {
+        scriba_cache_invalidate_owner(old_company_id);
+    }
+}
+
+// bulk operations may change any project and child lists of any company
+static void invalidate_projects()
+{
+    scriba_cache_invalidate_all(SCRIBA_ENTITY_PROJECT);
+    scriba_cache_invalidate_owners();
+}
+
+// size of string storage required to copy string field, empty strings are not copied
+static size_t field_size(const char *str)
+{
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
 }
 
 // create a copy of project data structure
 struct ScribaProject *scriba_copyProject(const struct ScribaProject *project)
 {
-    int len = 0;
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
 
     if (project == NULL)
     {
         return NULL;
     }
 
-    struct ScribaProject *ret = (struct ScribaProject *)malloc(sizeof (struct ScribaProject));
-    memset(ret, 0, sizeof (struct ScribaProject));
+    size_t str_size = field_size(project->title) + field_size(project->descr);
+    struct ScribaProject *ret = (struct ScribaProject *)scriba_entity_alloc(sizeof (struct ScribaProject),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
 
     scriba_id_copy(&(ret->id), &(project->id));
-    if((len = strlen(project->title)) != 0)
+    if (field_size(project->title) != 0)
     {
-        ret->title = (char *)malloc(len + 1);
-        memset(ret->title, 0, len + 1);
-        strncpy(ret->title, project->title, len);
+        ret->title = scriba_entity_strcpy(&str_buf, project->title);
     }
-    if((len = strlen(project->descr)) != 0)
+    if (field_size(project->descr) != 0)
     {
-        ret->descr = (char *)malloc(len + 1);
-        memset(ret->descr, 0, len + 1);
-        strncpy(ret->descr, project->descr, len);
+        ret->descr = scriba_entity_strcpy(&str_buf, project->descr);
     }
     scriba_id_copy(&(ret->company_id), &(project->company_id));
     ret->state = project->state;
@@ -164,14 +638,29 @@ void scriba_freeProjectData(struct ScribaProject *project)
         return;
     }
 
-    if (project->title != NULL)
+    // shared entity is freed when its last reference is dropped
+    if (project->layout == SCRIBA_LAYOUT_SHARED)
     {
-        free(project->title);
+        scriba_release(project);
+        return;
     }
-    if (project->descr != NULL)
+
+    // strings are allocated separately only with the default layout
+    if (project->layout == SCRIBA_LAYOUT_SEPARATE)
     {
-        free(project->descr);
+        if (project->title != NULL)
+        {
+            scriba_free(project->title);
+        }
+        if (project->descr != NULL)
+        {
+            scriba_free(project->descr);
+        }
     }
 
-    free(project);
+    // arena memory is reclaimed by scriba_arena_reset()
+    if (project->layout != SCRIBA_LAYOUT_ARENA)
+    {
+        scriba_free(project);
+    }
 }
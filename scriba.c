@@ -19,8 +19,13 @@
  */
 
 #include "sqlite_backend.h"
+#include "snapshot_backend.h"
+#include "memory_backend.h"
+#include "log_backend.h"
+#include "cache.h"
 #include <stdlib.h>
 #include <string.h>
+#include <dlfcn.h>
 
 // maximum number of internal database backends
 #define MAX_INT_BACKENDS    10
@@ -33,9 +38,9 @@
 static struct ScribaInternalDB *int_backends[MAX_INT_BACKENDS] = 
 {
     &sqliteDB,
-    NULL,
-    NULL,
-    NULL,
+    &snapshotDB,
+    &memoryDB,
+    &logDB,
     NULL,
     NULL,
     NULL,
@@ -46,6 +51,20 @@ static struct ScribaInternalDB *int_backends[MAX_INT_BACKENDS] =
 
 static struct ScribaInternalDB *cur_backend = NULL;
 
+// external backend loaded by scriba_init()
+static void *ext_handle = NULL;
+static struct ScribaInternalDB ext_backend;
+static unsigned int ext_caps = 0;
+
+static int load_ext_backend(struct ScribaDB *db);
+// clear functions of optional groups missing from external backend capabilities
+static void clear_ext_functions(struct ScribaDBFuncTbl *tbl, unsigned int caps);
+// check that functions outside of optional groups are provided;
+// returns 1 if they are, 0 otherwise
+static int has_mandatory_functions(const struct ScribaDBFuncTbl *tbl);
+// release backend whose initialization has failed
+static void drop_backend();
+
 struct ScribaDBFuncTbl *fTbl = NULL;
 
 
@@ -88,32 +107,51 @@ int scriba_init(struct ScribaDB *db, struct ScribaDBParamList *pl)
     }
     if (db->type == SCRIBA_DB_EXT)
     {
-        // currently not supported
-        ret = SCRIBA_INIT_NOT_SUPPORTED;
-        goto out;
+        ret = load_ext_backend(db);
+        if (ret != SCRIBA_INIT_SUCCESS)
+        {
+            goto out;
+        }
     }
-
-    // find backend with given name
-    for (int i = 0; i < MAX_INT_BACKENDS; i++)
+    else
     {
-        if (strcmp(int_backends[i]->name, db->name) == 0)
+        // find backend with given name
+        for (int i = 0; (i < MAX_INT_BACKENDS) && (int_backends[i] != NULL); i++)
         {
-            cur_backend = int_backends[i];
-            break;
+            if (strcmp(int_backends[i]->name, db->name) == 0)
+            {
+                cur_backend = int_backends[i];
+                break;
+            }
         }
     }
 
+    // entities of another database could be cached
+    scriba_clearCache();
+
     if (cur_backend != NULL)
     {
-        fTbl = (struct ScribaDBFuncTbl *)malloc(sizeof (struct ScribaDBFuncTbl));
+        fTbl = (struct ScribaDBFuncTbl *)scriba_malloc(sizeof (struct ScribaDBFuncTbl));
         memset(fTbl, 0, sizeof (struct ScribaDBFuncTbl));
 
         // call backend init function
         if (cur_backend->init(pl, fTbl) != 0)
         {
             ret = SCRIBA_INIT_BACKEND_INIT_FAILED;
+            drop_backend();
             goto out;
         }
+        if (cur_backend == &ext_backend)
+        {
+            clear_ext_functions(fTbl, ext_caps);
+            // mandatory functions are called without checks
+            if (!has_mandatory_functions(fTbl))
+            {
+                ret = SCRIBA_INIT_NOT_SUPPORTED;
+                drop_backend();
+                goto out;
+            }
+        }
     }
     else
     {
@@ -135,9 +173,331 @@ void scriba_cleanup()
         cur_backend = NULL;
     }
 
+    if (ext_handle != NULL)
+    {
+        dlclose(ext_handle);
+        ext_handle = NULL;
+    }
+
     if (fTbl != NULL)
     {
-        free(fTbl);
+        scriba_free(fTbl);
         fTbl = NULL;
     }
+
+    scriba_clearCache();
+}
+
+// load external backend library and find its descriptor
+static int load_ext_backend(struct ScribaDB *db)
+{
+    scriba_ext_entry_fn entry = NULL;
+    const struct ScribaExtDB *ext_db = NULL;
+    int ret = SCRIBA_INIT_SUCCESS;
+
+    if (db->location == NULL)
+    {
+        ret = SCRIBA_INIT_INVALID_ARG;
+        goto out;
+    }
+
+    ext_handle = dlopen(db->location, RTLD_NOW | RTLD_LOCAL);
+    if (ext_handle == NULL)
+    {
+        ret = SCRIBA_INIT_BACKEND_NOT_FOUND;
+        goto out;
+    }
+    entry = (scriba_ext_entry_fn)dlsym(ext_handle, SCRIBA_EXT_ENTRY_NAME);
+    if (entry == NULL)
+    {
+        ret = SCRIBA_INIT_BACKEND_NOT_FOUND;
+        goto out;
+    }
+
+    ext_db = entry(SCRIBA_EXT_ABI_VERSION);
+    if ((ext_db == NULL) || (ext_db->abi_version != SCRIBA_EXT_ABI_VERSION))
+    {
+        ret = SCRIBA_INIT_NOT_SUPPORTED;
+        goto out;
+    }
+    if ((ext_db->name == NULL) || (strcmp(ext_db->name, db->name) != 0) ||
+        (ext_db->init == NULL) || (ext_db->cleanup == NULL))
+    {
+        ret = SCRIBA_INIT_BACKEND_NOT_FOUND;
+        goto out;
+    }
+
+    ext_backend.name = (char *)ext_db->name;
+    ext_backend.init = ext_db->init;
+    ext_backend.cleanup = ext_db->cleanup;
+    ext_caps = ext_db->caps;
+    cur_backend = &ext_backend;
+
+out:
+    if ((ret != SCRIBA_INIT_SUCCESS) && (ext_handle != NULL))
+    {
+        dlclose(ext_handle);
+        ext_handle = NULL;
+    }
+    return ret;
+}
+
+static void clear_ext_functions(struct ScribaDBFuncTbl *tbl, unsigned int caps)
+{
+    if (!(caps & SCRIBA_EXT_CAP_BATCH))
+    {
+        tbl->getCompanies = NULL;
+        tbl->getPeople = NULL;
+        tbl->getProjects = NULL;
+        tbl->getEvents = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_BULK))
+    {
+        tbl->updateEvents = NULL;
+        tbl->removeEvents = NULL;
+        tbl->updateProjects = NULL;
+        tbl->removeProjects = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_UPSERT))
+    {
+        tbl->upsertCompany = NULL;
+        tbl->upsertPOC = NULL;
+        tbl->upsertProject = NULL;
+        tbl->upsertEvent = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_SCAN))
+    {
+        tbl->scanCompanies = NULL;
+        tbl->scanPeople = NULL;
+        tbl->scanProjects = NULL;
+        tbl->scanEvents = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_READ_TXN))
+    {
+        tbl->beginRead = NULL;
+        tbl->endRead = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_WRITE_TXN))
+    {
+        tbl->beginWrite = NULL;
+        tbl->commitWrite = NULL;
+        tbl->rollbackWrite = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_READERS))
+    {
+        tbl->attachReader = NULL;
+        tbl->detachReader = NULL;
+    }
+    if (!(caps & SCRIBA_EXT_CAP_CHANGES))
+    {
+        tbl->getChangeStamp = NULL;
+        tbl->scanRemoved = NULL;
+    }
+}
+
+static int has_mandatory_functions(const struct ScribaDBFuncTbl *tbl)
+{
+    return (tbl->getCompany != NULL) && (tbl->getAllCompanies != NULL) &&
+           (tbl->getCompaniesByName != NULL) && (tbl->getCompaniesByJurName != NULL) &&
+           (tbl->getCompaniesByAddress != NULL) && (tbl->addCompany != NULL) &&
+           (tbl->updateCompany != NULL) && (tbl->removeCompany != NULL) &&
+           (tbl->getPOC != NULL) && (tbl->getAllPeople != NULL) &&
+           (tbl->getPOCByName != NULL) && (tbl->getPOCByCompany != NULL) &&
+           (tbl->getPOCByPosition != NULL) && (tbl->getPOCByPhoneNum != NULL) &&
+           (tbl->getPOCByEmail != NULL) && (tbl->addPOC != NULL) &&
+           (tbl->updatePOC != NULL) && (tbl->removePOC != NULL) &&
+           (tbl->getProject != NULL) && (tbl->getAllProjects != NULL) &&
+           (tbl->getProjectsByTitle != NULL) && (tbl->getProjectsByCompany != NULL) &&
+           (tbl->getProjectsByState != NULL) && (tbl->getProjectsByTime != NULL) &&
+           (tbl->getProjectsByStateTime != NULL) && (tbl->addProject != NULL) &&
+           (tbl->updateProject != NULL) && (tbl->removeProject != NULL) &&
+           (tbl->getEvent != NULL) && (tbl->getAllEvents != NULL) &&
+           (tbl->getEventsByDescr != NULL) && (tbl->getEventsByCompany != NULL) &&
+           (tbl->getEventsByPOC != NULL) && (tbl->getEventsByProject != NULL) &&
+           (tbl->getEventsByState != NULL) && (tbl->addEvent != NULL) &&
+           (tbl->updateEvent != NULL) && (tbl->removeEvent != NULL);
+}
+
+static void drop_backend()
+{
+    // backend may have allocated its data before it failed
+    cur_backend->cleanup();
+    cur_backend = NULL;
+
+    scriba_free(fTbl);
+    fTbl = NULL;
+
+    if (ext_handle != NULL)
+    {
+        dlclose(ext_handle);
+        ext_handle = NULL;
+    }
+}
+
+// start read transaction
+void scriba_beginRead()
+{
+    if (fTbl->beginRead != NULL)
+    {
+        fTbl->beginRead();
+    }
+}
+
+// finish read transaction
+void scriba_endRead()
+{
+    if (fTbl->endRead != NULL)
+    {
+        fTbl->endRead();
+    }
+}
+
+// start write transaction
+int scriba_beginWrite()
+{
+    if (fTbl->beginWrite != NULL)
+    {
+        return fTbl->beginWrite();
+    }
+    return 0;
+}
+
+// commit write transaction
+int scriba_commitWrite()
+{
+    if (fTbl->commitWrite != NULL)
+    {
+        return fTbl->commitWrite();
+    }
+    return 0;
+}
+
+// roll back write transaction
+void scriba_rollbackWrite()
+{
+    if (fTbl->rollbackWrite != NULL)
+    {
+        fTbl->rollbackWrite();
+        // cached entities could include discarded changes
+        scriba_clearCache();
+    }
+}
+
+// attach separate read connection to the calling thread
+int scriba_attachReader()
+{
+    if (fTbl->attachReader != NULL)
+    {
+        return fTbl->attachReader();
+    }
+    return 1;
+}
+
+// detach read connection from the calling thread
+void scriba_detachReader()
+{
+    if (fTbl->detachReader != NULL)
+    {
+        fTbl->detachReader();
+    }
+}
+
+// stamp of the last change made to the local database
+unsigned long long scriba_getChangeStamp()
+{
+    if (fTbl->getChangeStamp != NULL)
+    {
+        return fTbl->getChangeStamp();
+    }
+    return 0;
+}
+
+// find entities removed after the given change stamp
+int scriba_scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx)
+{
+    if (fTbl->scanRemoved != NULL)
+    {
+        return fTbl->scanRemoved(since, func, ctx);
+    }
+    // removals are not tracked
+    return 0;
+}
+
+// create array of ids of the given list
+scriba_id_t *scriba_list_to_ids(scriba_list_t *list, size_t *n)
+{
+    scriba_id_t *ids = NULL;
+    size_t num = 0;
+
+    scriba_list_for_each(list, item)
+    {
+        num++;
+    }
+    if (num != 0)
+    {
+        ids = (scriba_id_t *)scriba_malloc(num * sizeof (scriba_id_t));
+    }
+
+    num = 0;
+    if (ids != NULL)
+    {
+        scriba_list_for_each(list, item)
+        {
+            scriba_id_copy(&(ids[num]), &(item->id));
+            num++;
+        }
+    }
+
+    if (n != NULL)
+    {
+        *n = num;
+    }
+    return ids;
+}
+
+// check whether entity matches scan filter
+int scriba_scan_filter_match(const struct ScribaScanFilter *filter, const scriba_id_t *id,
+                             const scriba_id_t *company_id, const scriba_time_t *mod_time)
+{
+    int found = 0;
+
+    if (filter == NULL)
+    {
+        return 1;
+    }
+
+    // fallback scans are not performance critical, so linear search is enough
+    if (filter->ids != NULL)
+    {
+        for (size_t i = 0; (i < filter->num_ids) && !found; i++)
+        {
+            found = scriba_id_compare(id, &(filter->ids[i]));
+        }
+        if (!found)
+        {
+            return 0;
+        }
+    }
+    if (filter->company_ids != NULL)
+    {
+        found = 0;
+        for (size_t i = 0; (i < filter->num_company_ids) && !found; i++)
+        {
+            found = scriba_id_compare(company_id, &(filter->company_ids[i]));
+        }
+        if (!found)
+        {
+            return 0;
+        }
+    }
+    if (filter->use_mod_since && (mod_time != NULL) && (*mod_time < filter->mod_since))
+    {
+        return 0;
+    }
+    if ((filter->num_shards > 1) && ((id->_low % filter->num_shards) != filter->shard))
+    {
+        return 0;
+    }
+
+    return 1;
 }
@@ -61,12 +61,34 @@ inline const char **EnumNamesCurrency() {
 
 inline const char *EnumNameCurrency(int e) { return EnumNamesCurrency()[e]; }
 
+enum {
+  EntityType_COMPANY = 0,
+  EntityType_EVENT = 1,
+  EntityType_POC = 2,
+  EntityType_PROJECT = 3,
+};
+
+inline const char **EnumNamesEntityType() {
+  static const char *names[] = { "COMPANY", "EVENT", "POC", "PROJECT", nullptr };
+  return names;
+}
+
+inline const char *EnumNameEntityType(int e) { return EnumNamesEntityType()[e]; }
+
 struct ID;
 struct Company;
 struct Event;
 struct POC;
 struct Project;
+struct Removed;
 struct Entries;
+struct RangeHash;
+struct ItemHash;
+struct EntityRef;
+struct RangeItems;
+struct Summary;
+struct IndexEntry;
+struct Snapshot;
 
 MANUALLY_ALIGNED_STRUCT(8) ID {
  private:
@@ -82,6 +104,75 @@ MANUALLY_ALIGNED_STRUCT(8) ID {
 };
 STRUCT_END(ID, 16);
 
+MANUALLY_ALIGNED_STRUCT(8) RangeHash {
+ private:
+  uint64_t prefix_;
+  uint64_t hash_;
+  uint32_t count_;
+  int8_t type_;
+  uint8_t depth_;
+  int16_t __padding0;
+
+ public:
+  RangeHash(uint64_t prefix, uint64_t hash, uint32_t count, int8_t type, uint8_t depth)
+    : prefix_(flatbuffers::EndianScalar(prefix)), hash_(flatbuffers::EndianScalar(hash)), count_(flatbuffers::EndianScalar(count)), type_(flatbuffers::EndianScalar(type)), depth_(flatbuffers::EndianScalar(depth)), __padding0(0) {}
+
+  uint64_t prefix() const { return flatbuffers::EndianScalar(prefix_); }
+  uint64_t hash() const { return flatbuffers::EndianScalar(hash_); }
+  uint32_t count() const { return flatbuffers::EndianScalar(count_); }
+  int8_t type() const { return flatbuffers::EndianScalar(type_); }
+  uint8_t depth() const { return flatbuffers::EndianScalar(depth_); }
+};
+STRUCT_END(RangeHash, 24);
+
+MANUALLY_ALIGNED_STRUCT(8) ItemHash {
+ private:
+  ID id_;
+  uint64_t hash_;
+
+ public:
+  ItemHash(const ID &id, uint64_t hash)
+    : id_(id), hash_(flatbuffers::EndianScalar(hash)) {}
+
+  const ID &id() const { return id_; }
+  uint64_t hash() const { return flatbuffers::EndianScalar(hash_); }
+};
+STRUCT_END(ItemHash, 24);
+
+MANUALLY_ALIGNED_STRUCT(8) EntityRef {
+ private:
+  ID id_;
+  int8_t type_;
+  int8_t __padding0;
+  int16_t __padding1;
+  int32_t __padding2;
+
+ public:
+  EntityRef(const ID &id, int8_t type)
+    : id_(id), type_(flatbuffers::EndianScalar(type)), __padding0(0), __padding1(0), __padding2(0) {}
+
+  const ID &id() const { return id_; }
+  int8_t type() const { return flatbuffers::EndianScalar(type_); }
+};
+STRUCT_END(EntityRef, 24);
+
+MANUALLY_ALIGNED_STRUCT(8) IndexEntry {
+ private:
+  ID key_;
+  int64_t time_;
+  uint32_t pos_;
+  int32_t __padding0;
+
+ public:
+  IndexEntry(const ID &key, int64_t time, uint32_t pos)
+    : key_(key), time_(flatbuffers::EndianScalar(time)), pos_(flatbuffers::EndianScalar(pos)), __padding0(0) {}
+
+  const ID &key() const { return key_; }
+  int64_t time() const { return flatbuffers::EndianScalar(time_); }
+  uint32_t pos() const { return flatbuffers::EndianScalar(pos_); }
+};
+STRUCT_END(IndexEntry, 32);
+
 struct Company : private flatbuffers::Table {
   const ID *id() const { return GetStruct<const ID *>(4); }
   const flatbuffers::String *name() const { return GetPointer<const flatbuffers::String *>(6); }
@@ -90,6 +181,25 @@ struct Company : private flatbuffers::Table {
   const flatbuffers::String *inn() const { return GetPointer<const flatbuffers::String *>(12); }
   const flatbuffers::String *phonenum() const { return GetPointer<const flatbuffers::String *>(14); }
   const flatbuffers::String *email() const { return GetPointer<const flatbuffers::String *>(16); }
+  uint32_t id_ref() const { return GetField<uint32_t>(18, 0); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<ID>(verifier, 4 /* id */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* name */) &&
+           verifier.Verify(name()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* jur_name */) &&
+           verifier.Verify(jur_name()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* address */) &&
+           verifier.Verify(address()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* inn */) &&
+           verifier.Verify(inn()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 14 /* phonenum */) &&
+           verifier.Verify(phonenum()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* email */) &&
+           verifier.Verify(email()) &&
+           VerifyField<uint32_t>(verifier, 18 /* id_ref */) &&
+           verifier.EndTable();
+  }
 };
 
 struct CompanyBuilder {
@@ -102,12 +212,14 @@ struct CompanyBuilder {
   void add_inn(flatbuffers::Offset<flatbuffers::String> inn) { fbb_.AddOffset(12, inn); }
   void add_phonenum(flatbuffers::Offset<flatbuffers::String> phonenum) { fbb_.AddOffset(14, phonenum); }
   void add_email(flatbuffers::Offset<flatbuffers::String> email) { fbb_.AddOffset(16, email); }
+  void add_id_ref(uint32_t id_ref) { fbb_.AddElement<uint32_t>(18, id_ref, 0); }
   CompanyBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
-  flatbuffers::Offset<Company> Finish() { return flatbuffers::Offset<Company>(fbb_.EndTable(start_, 7)); }
+  flatbuffers::Offset<Company> Finish() { return flatbuffers::Offset<Company>(fbb_.EndTable(start_, 8)); }
 };
 
-inline flatbuffers::Offset<Company> CreateCompany(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> name, flatbuffers::Offset<flatbuffers::String> jur_name, flatbuffers::Offset<flatbuffers::String> address, flatbuffers::Offset<flatbuffers::String> inn, flatbuffers::Offset<flatbuffers::String> phonenum, flatbuffers::Offset<flatbuffers::String> email) {
+inline flatbuffers::Offset<Company> CreateCompany(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> name, flatbuffers::Offset<flatbuffers::String> jur_name, flatbuffers::Offset<flatbuffers::String> address, flatbuffers::Offset<flatbuffers::String> inn, flatbuffers::Offset<flatbuffers::String> phonenum, flatbuffers::Offset<flatbuffers::String> email, uint32_t id_ref) {
   CompanyBuilder builder_(_fbb);
+  builder_.add_id_ref(id_ref);
   builder_.add_email(email);
   builder_.add_phonenum(phonenum);
   builder_.add_inn(inn);
@@ -128,6 +240,29 @@ struct Event : private flatbuffers::Table {
   const flatbuffers::String *outcome() const { return GetPointer<const flatbuffers::String *>(16); }
   int64_t timestamp() const { return GetField<int64_t>(18, 0); }
   int8_t state() const { return GetField<int8_t>(20, 0); }
+  uint32_t id_ref() const { return GetField<uint32_t>(22, 0); }
+  uint32_t company_ref() const { return GetField<uint32_t>(24, 0); }
+  uint32_t project_ref() const { return GetField<uint32_t>(26, 0); }
+  uint32_t poc_ref() const { return GetField<uint32_t>(28, 0); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<ID>(verifier, 4 /* id */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* descr */) &&
+           verifier.Verify(descr()) &&
+           VerifyField<ID>(verifier, 8 /* company_id */) &&
+           VerifyField<ID>(verifier, 10 /* project_id */) &&
+           VerifyField<ID>(verifier, 12 /* poc_id */) &&
+           VerifyField<int8_t>(verifier, 14 /* type */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* outcome */) &&
+           verifier.Verify(outcome()) &&
+           VerifyField<int64_t>(verifier, 18 /* timestamp */) &&
+           VerifyField<int8_t>(verifier, 20 /* state */) &&
+           VerifyField<uint32_t>(verifier, 22 /* id_ref */) &&
+           VerifyField<uint32_t>(verifier, 24 /* company_ref */) &&
+           VerifyField<uint32_t>(verifier, 26 /* project_ref */) &&
+           VerifyField<uint32_t>(verifier, 28 /* poc_ref */) &&
+           verifier.EndTable();
+  }
 };
 
 struct EventBuilder {
@@ -142,13 +277,21 @@ struct EventBuilder {
   void add_outcome(flatbuffers::Offset<flatbuffers::String> outcome) { fbb_.AddOffset(16, outcome); }
   void add_timestamp(int64_t timestamp) { fbb_.AddElement<int64_t>(18, timestamp, 0); }
   void add_state(int8_t state) { fbb_.AddElement<int8_t>(20, state, 0); }
+  void add_id_ref(uint32_t id_ref) { fbb_.AddElement<uint32_t>(22, id_ref, 0); }
+  void add_company_ref(uint32_t company_ref) { fbb_.AddElement<uint32_t>(24, company_ref, 0); }
+  void add_project_ref(uint32_t project_ref) { fbb_.AddElement<uint32_t>(26, project_ref, 0); }
+  void add_poc_ref(uint32_t poc_ref) { fbb_.AddElement<uint32_t>(28, poc_ref, 0); }
   EventBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
-  flatbuffers::Offset<Event> Finish() { return flatbuffers::Offset<Event>(fbb_.EndTable(start_, 9)); }
+  flatbuffers::Offset<Event> Finish() { return flatbuffers::Offset<Event>(fbb_.EndTable(start_, 13)); }
 };
 
-inline flatbuffers::Offset<Event> CreateEvent(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> descr, const ID *company_id, const ID *project_id, const ID *poc_id, int8_t type, flatbuffers::Offset<flatbuffers::String> outcome, int64_t timestamp, int8_t state) {
+inline flatbuffers::Offset<Event> CreateEvent(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> descr, const ID *company_id, const ID *project_id, const ID *poc_id, int8_t type, flatbuffers::Offset<flatbuffers::String> outcome, int64_t timestamp, int8_t state, uint32_t id_ref, uint32_t company_ref, uint32_t project_ref, uint32_t poc_ref) {
   EventBuilder builder_(_fbb);
   builder_.add_timestamp(timestamp);
+  builder_.add_poc_ref(poc_ref);
+  builder_.add_project_ref(project_ref);
+  builder_.add_company_ref(company_ref);
+  builder_.add_id_ref(id_ref);
   builder_.add_outcome(outcome);
   builder_.add_poc_id(poc_id);
   builder_.add_project_id(project_id);
@@ -170,6 +313,30 @@ struct POC : private flatbuffers::Table {
   const flatbuffers::String *email() const { return GetPointer<const flatbuffers::String *>(16); }
   const flatbuffers::String *position() const { return GetPointer<const flatbuffers::String *>(18); }
   const ID *company_id() const { return GetStruct<const ID *>(20); }
+  uint32_t id_ref() const { return GetField<uint32_t>(22, 0); }
+  uint32_t company_ref() const { return GetField<uint32_t>(24, 0); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<ID>(verifier, 4 /* id */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* firstname */) &&
+           verifier.Verify(firstname()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* secondname */) &&
+           verifier.Verify(secondname()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* lastname */) &&
+           verifier.Verify(lastname()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* mobilenum */) &&
+           verifier.Verify(mobilenum()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 14 /* phonenum */) &&
+           verifier.Verify(phonenum()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* email */) &&
+           verifier.Verify(email()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 18 /* position */) &&
+           verifier.Verify(position()) &&
+           VerifyField<ID>(verifier, 20 /* company_id */) &&
+           VerifyField<uint32_t>(verifier, 22 /* id_ref */) &&
+           VerifyField<uint32_t>(verifier, 24 /* company_ref */) &&
+           verifier.EndTable();
+  }
 };
 
 struct POCBuilder {
@@ -184,13 +351,17 @@ struct POCBuilder {
   void add_email(flatbuffers::Offset<flatbuffers::String> email) { fbb_.AddOffset(16, email); }
   void add_position(flatbuffers::Offset<flatbuffers::String> position) { fbb_.AddOffset(18, position); }
   void add_company_id(const ID *company_id) { fbb_.AddStruct(20, company_id); }
+  void add_id_ref(uint32_t id_ref) { fbb_.AddElement<uint32_t>(22, id_ref, 0); }
+  void add_company_ref(uint32_t company_ref) { fbb_.AddElement<uint32_t>(24, company_ref, 0); }
   POCBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
-  flatbuffers::Offset<POC> Finish() { return flatbuffers::Offset<POC>(fbb_.EndTable(start_, 9)); }
+  flatbuffers::Offset<POC> Finish() { return flatbuffers::Offset<POC>(fbb_.EndTable(start_, 11)); }
 };
 
-inline flatbuffers::Offset<POC> CreatePOC(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> firstname, flatbuffers::Offset<flatbuffers::String> secondname, flatbuffers::Offset<flatbuffers::String> lastname, flatbuffers::Offset<flatbuffers::String> mobilenum, flatbuffers::Offset<flatbuffers::String> phonenum, flatbuffers::Offset<flatbuffers::String> email, flatbuffers::Offset<flatbuffers::String> position, const ID *company_id) {
+inline flatbuffers::Offset<POC> CreatePOC(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> firstname, flatbuffers::Offset<flatbuffers::String> secondname, flatbuffers::Offset<flatbuffers::String> lastname, flatbuffers::Offset<flatbuffers::String> mobilenum, flatbuffers::Offset<flatbuffers::String> phonenum, flatbuffers::Offset<flatbuffers::String> email, flatbuffers::Offset<flatbuffers::String> position, const ID *company_id, uint32_t id_ref, uint32_t company_ref) {
   POCBuilder builder_(_fbb);
   builder_.add_company_id(company_id);
+  builder_.add_company_ref(company_ref);
+  builder_.add_id_ref(id_ref);
   builder_.add_position(position);
   builder_.add_email(email);
   builder_.add_phonenum(phonenum);
@@ -212,6 +383,25 @@ struct Project : private flatbuffers::Table {
   uint64_t cost() const { return GetField<uint64_t>(16, 0); }
   int64_t start_time() const { return GetField<int64_t>(18, 0); }
   int64_t mod_time() const { return GetField<int64_t>(20, 0); }
+  uint32_t id_ref() const { return GetField<uint32_t>(22, 0); }
+  uint32_t company_ref() const { return GetField<uint32_t>(24, 0); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<ID>(verifier, 4 /* id */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* title */) &&
+           verifier.Verify(title()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* descr */) &&
+           verifier.Verify(descr()) &&
+           VerifyField<ID>(verifier, 10 /* company_id */) &&
+           VerifyField<int8_t>(verifier, 12 /* state */) &&
+           VerifyField<int8_t>(verifier, 14 /* currency */) &&
+           VerifyField<uint64_t>(verifier, 16 /* cost */) &&
+           VerifyField<int64_t>(verifier, 18 /* start_time */) &&
+           VerifyField<int64_t>(verifier, 20 /* mod_time */) &&
+           VerifyField<uint32_t>(verifier, 22 /* id_ref */) &&
+           VerifyField<uint32_t>(verifier, 24 /* company_ref */) &&
+           verifier.EndTable();
+  }
 };
 
 struct ProjectBuilder {
@@ -226,16 +416,20 @@ struct ProjectBuilder {
   void add_cost(uint64_t cost) { fbb_.AddElement<uint64_t>(16, cost, 0); }
   void add_start_time(int64_t start_time) { fbb_.AddElement<int64_t>(18, start_time, 0); }
   void add_mod_time(int64_t mod_time) { fbb_.AddElement<int64_t>(20, mod_time, 0); }
+  void add_id_ref(uint32_t id_ref) { fbb_.AddElement<uint32_t>(22, id_ref, 0); }
+  void add_company_ref(uint32_t company_ref) { fbb_.AddElement<uint32_t>(24, company_ref, 0); }
   ProjectBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
-  flatbuffers::Offset<Project> Finish() { return flatbuffers::Offset<Project>(fbb_.EndTable(start_, 9)); }
+  flatbuffers::Offset<Project> Finish() { return flatbuffers::Offset<Project>(fbb_.EndTable(start_, 11)); }
 };
 
-inline flatbuffers::Offset<Project> CreateProject(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> title, flatbuffers::Offset<flatbuffers::String> descr, const ID *company_id, int8_t state, int8_t currency, uint64_t cost, int64_t start_time, int64_t mod_time) {
+inline flatbuffers::Offset<Project> CreateProject(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, flatbuffers::Offset<flatbuffers::String> title, flatbuffers::Offset<flatbuffers::String> descr, const ID *company_id, int8_t state, int8_t currency, uint64_t cost, int64_t start_time, int64_t mod_time, uint32_t id_ref, uint32_t company_ref) {
   ProjectBuilder builder_(_fbb);
   builder_.add_mod_time(mod_time);
   builder_.add_start_time(start_time);
   builder_.add_cost(cost);
   builder_.add_company_id(company_id);
+  builder_.add_company_ref(company_ref);
+  builder_.add_id_ref(id_ref);
   builder_.add_descr(descr);
   builder_.add_title(title);
   builder_.add_id(id);
@@ -244,11 +438,79 @@ inline flatbuffers::Offset<Project> CreateProject(flatbuffers::FlatBufferBuilder
   return builder_.Finish();
 }
 
+struct Removed : private flatbuffers::Table {
+  const ID *id() const { return GetStruct<const ID *>(4); }
+  int8_t type() const { return GetField<int8_t>(6, 0); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<ID>(verifier, 4 /* id */) &&
+           VerifyField<int8_t>(verifier, 6 /* type */) &&
+           verifier.EndTable();
+  }
+};
+
+struct RemovedBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_id(const ID *id) { fbb_.AddStruct(4, id); }
+  void add_type(int8_t type) { fbb_.AddElement<int8_t>(6, type, 0); }
+  RemovedBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  flatbuffers::Offset<Removed> Finish() { return flatbuffers::Offset<Removed>(fbb_.EndTable(start_, 2)); }
+};
+
+inline flatbuffers::Offset<Removed> CreateRemoved(flatbuffers::FlatBufferBuilder &_fbb, const ID *id, int8_t type) {
+  RemovedBuilder builder_(_fbb);
+  builder_.add_id(id);
+  builder_.add_type(type);
+  return builder_.Finish();
+}
+
 struct Entries : private flatbuffers::Table {
   const flatbuffers::Vector<flatbuffers::Offset<Company>> *companies() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Company>> *>(4); }
   const flatbuffers::Vector<flatbuffers::Offset<Event>> *events() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Event>> *>(6); }
   const flatbuffers::Vector<flatbuffers::Offset<POC>> *people() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<POC>> *>(8); }
   const flatbuffers::Vector<flatbuffers::Offset<Project>> *projects() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Project>> *>(10); }
+  const flatbuffers::Vector<flatbuffers::Offset<Removed>> *removed() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Removed>> *>(12); }
+  uint8_t version() const { return GetField<uint8_t>(14, 0); }
+  const flatbuffers::Vector<const ID *> *ids() const { return GetPointer<const flatbuffers::Vector<const ID *> *>(16); }
+  const flatbuffers::Vector<flatbuffers::Offset<Company>> *compact_companies() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Company>> *>(18); }
+  const flatbuffers::Vector<flatbuffers::Offset<Event>> *compact_events() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Event>> *>(20); }
+  const flatbuffers::Vector<flatbuffers::Offset<POC>> *compact_people() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<POC>> *>(22); }
+  const flatbuffers::Vector<flatbuffers::Offset<Project>> *compact_projects() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Project>> *>(24); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* companies */) &&
+           verifier.Verify(companies()) &&
+           verifier.VerifyVectorOfTables(companies()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* events */) &&
+           verifier.Verify(events()) &&
+           verifier.VerifyVectorOfTables(events()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* people */) &&
+           verifier.Verify(people()) &&
+           verifier.VerifyVectorOfTables(people()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* projects */) &&
+           verifier.Verify(projects()) &&
+           verifier.VerifyVectorOfTables(projects()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* removed */) &&
+           verifier.Verify(removed()) &&
+           verifier.VerifyVectorOfTables(removed()) &&
+           VerifyField<uint8_t>(verifier, 14 /* version */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* ids */) &&
+           verifier.Verify(ids()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 18 /* compact_companies */) &&
+           verifier.Verify(compact_companies()) &&
+           verifier.VerifyVectorOfTables(compact_companies()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 20 /* compact_events */) &&
+           verifier.Verify(compact_events()) &&
+           verifier.VerifyVectorOfTables(compact_events()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 22 /* compact_people */) &&
+           verifier.Verify(compact_people()) &&
+           verifier.VerifyVectorOfTables(compact_people()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 24 /* compact_projects */) &&
+           verifier.Verify(compact_projects()) &&
+           verifier.VerifyVectorOfTables(compact_projects()) &&
+           verifier.EndTable();
+  }
 };
 
 struct EntriesBuilder {
@@ -258,19 +520,209 @@ struct EntriesBuilder {
   void add_events(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> events) { fbb_.AddOffset(6, events); }
   void add_people(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> people) { fbb_.AddOffset(8, people); }
   void add_projects(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> projects) { fbb_.AddOffset(10, projects); }
+  void add_removed(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Removed>>> removed) { fbb_.AddOffset(12, removed); }
+  void add_version(uint8_t version) { fbb_.AddElement<uint8_t>(14, version, 0); }
+  void add_ids(flatbuffers::Offset<flatbuffers::Vector<const ID *>> ids) { fbb_.AddOffset(16, ids); }
+  void add_compact_companies(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> compact_companies) { fbb_.AddOffset(18, compact_companies); }
+  void add_compact_events(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> compact_events) { fbb_.AddOffset(20, compact_events); }
+  void add_compact_people(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> compact_people) { fbb_.AddOffset(22, compact_people); }
+  void add_compact_projects(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> compact_projects) { fbb_.AddOffset(24, compact_projects); }
   EntriesBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
-  flatbuffers::Offset<Entries> Finish() { return flatbuffers::Offset<Entries>(fbb_.EndTable(start_, 4)); }
+  flatbuffers::Offset<Entries> Finish() { return flatbuffers::Offset<Entries>(fbb_.EndTable(start_, 11)); }
 };
 
-inline flatbuffers::Offset<Entries> CreateEntries(flatbuffers::FlatBufferBuilder &_fbb, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> companies, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> events, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> people, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> projects) {
+inline flatbuffers::Offset<Entries> CreateEntries(flatbuffers::FlatBufferBuilder &_fbb, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> companies, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> events, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> people, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> projects, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Removed>>> removed, uint8_t version, flatbuffers::Offset<flatbuffers::Vector<const ID *>> ids, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> compact_companies, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> compact_events, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> compact_people, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> compact_projects) {
   EntriesBuilder builder_(_fbb);
+  builder_.add_compact_projects(compact_projects);
+  builder_.add_compact_people(compact_people);
+  builder_.add_compact_events(compact_events);
+  builder_.add_compact_companies(compact_companies);
+  builder_.add_ids(ids);
+  builder_.add_removed(removed);
+  builder_.add_projects(projects);
+  builder_.add_people(people);
+  builder_.add_events(events);
+  builder_.add_companies(companies);
+  builder_.add_version(version);
+  return builder_.Finish();
+}
+
+struct RangeItems : private flatbuffers::Table {
+  const RangeHash *range() const { return GetStruct<const RangeHash *>(4); }
+  const flatbuffers::Vector<const ItemHash *> *items() const { return GetPointer<const flatbuffers::Vector<const ItemHash *> *>(6); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<RangeHash>(verifier, 4 /* range */) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* items */) &&
+           verifier.Verify(items()) &&
+           verifier.EndTable();
+  }
+};
+
+struct RangeItemsBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_range(const RangeHash *range) { fbb_.AddStruct(4, range); }
+  void add_items(flatbuffers::Offset<flatbuffers::Vector<const ItemHash *>> items) { fbb_.AddOffset(6, items); }
+  RangeItemsBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  flatbuffers::Offset<RangeItems> Finish() { return flatbuffers::Offset<RangeItems>(fbb_.EndTable(start_, 2)); }
+};
+
+inline flatbuffers::Offset<RangeItems> CreateRangeItems(flatbuffers::FlatBufferBuilder &_fbb, const RangeHash *range, flatbuffers::Offset<flatbuffers::Vector<const ItemHash *>> items) {
+  RangeItemsBuilder builder_(_fbb);
+  builder_.add_items(items);
+  builder_.add_range(range);
+  return builder_.Finish();
+}
+
+struct Summary : private flatbuffers::Table {
+  const flatbuffers::Vector<const RangeHash *> *ranges() const { return GetPointer<const flatbuffers::Vector<const RangeHash *> *>(4); }
+  const flatbuffers::Vector<flatbuffers::Offset<RangeItems>> *items() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<RangeItems>> *>(6); }
+  const flatbuffers::Vector<const EntityRef *> *wanted() const { return GetPointer<const flatbuffers::Vector<const EntityRef *> *>(8); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* ranges */) &&
+           verifier.Verify(ranges()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* items */) &&
+           verifier.Verify(items()) &&
+           verifier.VerifyVectorOfTables(items()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* wanted */) &&
+           verifier.Verify(wanted()) &&
+           verifier.EndTable();
+  }
+};
+
+struct SummaryBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_ranges(flatbuffers::Offset<flatbuffers::Vector<const RangeHash *>> ranges) { fbb_.AddOffset(4, ranges); }
+  void add_items(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<RangeItems>>> items) { fbb_.AddOffset(6, items); }
+  void add_wanted(flatbuffers::Offset<flatbuffers::Vector<const EntityRef *>> wanted) { fbb_.AddOffset(8, wanted); }
+  SummaryBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  flatbuffers::Offset<Summary> Finish() { return flatbuffers::Offset<Summary>(fbb_.EndTable(start_, 3)); }
+};
+
+inline flatbuffers::Offset<Summary> CreateSummary(flatbuffers::FlatBufferBuilder &_fbb, flatbuffers::Offset<flatbuffers::Vector<const RangeHash *>> ranges, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<RangeItems>>> items, flatbuffers::Offset<flatbuffers::Vector<const EntityRef *>> wanted) {
+  SummaryBuilder builder_(_fbb);
+  builder_.add_wanted(wanted);
+  builder_.add_items(items);
+  builder_.add_ranges(ranges);
+  return builder_.Finish();
+}
+
+struct Snapshot : private flatbuffers::Table {
+  const flatbuffers::Vector<flatbuffers::Offset<Company>> *companies() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Company>> *>(4); }
+  const flatbuffers::Vector<const ID *> *company_ids() const { return GetPointer<const flatbuffers::Vector<const ID *> *>(6); }
+  const flatbuffers::Vector<flatbuffers::Offset<Event>> *events() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Event>> *>(8); }
+  const flatbuffers::Vector<const ID *> *event_ids() const { return GetPointer<const flatbuffers::Vector<const ID *> *>(10); }
+  const flatbuffers::Vector<flatbuffers::Offset<POC>> *people() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<POC>> *>(12); }
+  const flatbuffers::Vector<const ID *> *poc_ids() const { return GetPointer<const flatbuffers::Vector<const ID *> *>(14); }
+  const flatbuffers::Vector<flatbuffers::Offset<Project>> *projects() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Project>> *>(16); }
+  const flatbuffers::Vector<const ID *> *project_ids() const { return GetPointer<const flatbuffers::Vector<const ID *> *>(18); }
+  const flatbuffers::Vector<const IndexEntry *> *people_by_company() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(20); }
+  const flatbuffers::Vector<const IndexEntry *> *projects_by_company() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(22); }
+  const flatbuffers::Vector<const IndexEntry *> *projects_by_state() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(24); }
+  const flatbuffers::Vector<const IndexEntry *> *events_by_time() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(26); }
+  const flatbuffers::Vector<const IndexEntry *> *events_by_company() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(28); }
+  const flatbuffers::Vector<const IndexEntry *> *events_by_poc() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(30); }
+  const flatbuffers::Vector<const IndexEntry *> *events_by_project() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(32); }
+  const flatbuffers::Vector<const IndexEntry *> *events_by_state() const { return GetPointer<const flatbuffers::Vector<const IndexEntry *> *>(34); }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 4 /* companies */) &&
+           verifier.Verify(companies()) &&
+           verifier.VerifyVectorOfTables(companies()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 6 /* company_ids */) &&
+           verifier.Verify(company_ids()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 8 /* events */) &&
+           verifier.Verify(events()) &&
+           verifier.VerifyVectorOfTables(events()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 10 /* event_ids */) &&
+           verifier.Verify(event_ids()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 12 /* people */) &&
+           verifier.Verify(people()) &&
+           verifier.VerifyVectorOfTables(people()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 14 /* poc_ids */) &&
+           verifier.Verify(poc_ids()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 16 /* projects */) &&
+           verifier.Verify(projects()) &&
+           verifier.VerifyVectorOfTables(projects()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 18 /* project_ids */) &&
+           verifier.Verify(project_ids()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 20 /* people_by_company */) &&
+           verifier.Verify(people_by_company()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 22 /* projects_by_company */) &&
+           verifier.Verify(projects_by_company()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 24 /* projects_by_state */) &&
+           verifier.Verify(projects_by_state()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 26 /* events_by_time */) &&
+           verifier.Verify(events_by_time()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 28 /* events_by_company */) &&
+           verifier.Verify(events_by_company()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 30 /* events_by_poc */) &&
+           verifier.Verify(events_by_poc()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 32 /* events_by_project */) &&
+           verifier.Verify(events_by_project()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, 34 /* events_by_state */) &&
+           verifier.Verify(events_by_state()) &&
+           verifier.EndTable();
+  }
+};
+
+struct SnapshotBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_companies(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> companies) { fbb_.AddOffset(4, companies); }
+  void add_company_ids(flatbuffers::Offset<flatbuffers::Vector<const ID *>> company_ids) { fbb_.AddOffset(6, company_ids); }
+  void add_events(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> events) { fbb_.AddOffset(8, events); }
+  void add_event_ids(flatbuffers::Offset<flatbuffers::Vector<const ID *>> event_ids) { fbb_.AddOffset(10, event_ids); }
+  void add_people(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> people) { fbb_.AddOffset(12, people); }
+  void add_poc_ids(flatbuffers::Offset<flatbuffers::Vector<const ID *>> poc_ids) { fbb_.AddOffset(14, poc_ids); }
+  void add_projects(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> projects) { fbb_.AddOffset(16, projects); }
+  void add_project_ids(flatbuffers::Offset<flatbuffers::Vector<const ID *>> project_ids) { fbb_.AddOffset(18, project_ids); }
+  void add_people_by_company(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> people_by_company) { fbb_.AddOffset(20, people_by_company); }
+  void add_projects_by_company(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> projects_by_company) { fbb_.AddOffset(22, projects_by_company); }
+  void add_projects_by_state(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> projects_by_state) { fbb_.AddOffset(24, projects_by_state); }
+  void add_events_by_time(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_time) { fbb_.AddOffset(26, events_by_time); }
+  void add_events_by_company(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_company) { fbb_.AddOffset(28, events_by_company); }
+  void add_events_by_poc(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_poc) { fbb_.AddOffset(30, events_by_poc); }
+  void add_events_by_project(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_project) { fbb_.AddOffset(32, events_by_project); }
+  void add_events_by_state(flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_state) { fbb_.AddOffset(34, events_by_state); }
+  SnapshotBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
+  flatbuffers::Offset<Snapshot> Finish() { return flatbuffers::Offset<Snapshot>(fbb_.EndTable(start_, 16)); }
+};
+
+inline flatbuffers::Offset<Snapshot> CreateSnapshot(flatbuffers::FlatBufferBuilder &_fbb, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Company>>> companies, flatbuffers::Offset<flatbuffers::Vector<const ID *>> company_ids, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Event>>> events, flatbuffers::Offset<flatbuffers::Vector<const ID *>> event_ids, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<POC>>> people, flatbuffers::Offset<flatbuffers::Vector<const ID *>> poc_ids, flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Project>>> projects, flatbuffers::Offset<flatbuffers::Vector<const ID *>> project_ids, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> people_by_company, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> projects_by_company, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> projects_by_state, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_time, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_company, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_poc, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_project, flatbuffers::Offset<flatbuffers::Vector<const IndexEntry *>> events_by_state) {
+  SnapshotBuilder builder_(_fbb);
+  builder_.add_events_by_state(events_by_state);
+  builder_.add_events_by_project(events_by_project);
+  builder_.add_events_by_poc(events_by_poc);
+  builder_.add_events_by_company(events_by_company);
+  builder_.add_events_by_time(events_by_time);
+  builder_.add_projects_by_state(projects_by_state);
+  builder_.add_projects_by_company(projects_by_company);
+  builder_.add_people_by_company(people_by_company);
+  builder_.add_project_ids(project_ids);
   builder_.add_projects(projects);
+  builder_.add_poc_ids(poc_ids);
   builder_.add_people(people);
+  builder_.add_event_ids(event_ids);
   builder_.add_events(events);
+  builder_.add_company_ids(company_ids);
   builder_.add_companies(companies);
   return builder_.Finish();
 }
 
 inline const Entries *GetEntries(const void *buf) { return flatbuffers::GetRoot<Entries>(buf); }
 
+inline bool VerifyEntriesBuffer(flatbuffers::Verifier &verifier) { return verifier.VerifyBuffer<Entries>(); }
+
+inline const Summary *GetSummary(const void *buf) { return flatbuffers::GetRoot<Summary>(buf); }
+
+inline bool VerifySummaryBuffer(flatbuffers::Verifier &verifier) { return verifier.VerifyBuffer<Summary>(); }
+
+inline const Snapshot *GetSnapshot(const void *buf) { return flatbuffers::GetRoot<Snapshot>(buf); }
+
+inline bool VerifySnapshotBuffer(flatbuffers::Verifier &verifier) { return verifier.VerifyBuffer<Snapshot>(); }
+
 }; // namespace scriba
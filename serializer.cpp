@@ -24,22 +24,386 @@
 #include "event.h"
 #include "poc.h"
 #include "project.h"
+#include "db_backend.h"
+#include "compress.h"
+#include "stl_allocator.h"
 #include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// size of buffer used to read stream from file descriptor
+#define SCRIBA_STREAM_READ_SIZE 65536
+// number of entries decoded by pipeline decoder thread at once
+#define SCRIBA_PIPELINE_BATCH_SIZE 256
+// number of decoded batches each decoder thread may keep ahead of the writer
+#define SCRIBA_PIPELINE_DEPTH 4
+// compressed frame header: magic, dictionary id (0 if there is no dictionary) and
+// size of decompressed data, all values are 32-bit little-endian; serialized
+// buffer starts with the offset of the root table, which is written last and is
+// close to the beginning, so it can not be mistaken for the magic
+#define SCRIBA_FRAME_MAGIC 0x015A4353       // "SCZ\1"
+#define SCRIBA_FRAME_HEADER_SIZE 12
+// newest schema version of serialized buffers understood by the reader:
+// 0 - original schema, 1 - compact buffers with id table and shared strings
+#define SCRIBA_SCHEMA_VERSION 1
+// reconciliation range holding up to this number of entities is sent item by item
+#define SCRIBA_RECONCILE_LEAF_SIZE 16
+// each reconciliation range is split into 16 ranges by the next 4 bits of id,
+// ranges of the maximum depth are selected by the whole high id part
+#define SCRIBA_RECONCILE_FANOUT_BITS 4
+#define SCRIBA_RECONCILE_MAX_DEPTH 16
+
+// stream writer state
+struct _scriba_stream_writer
+{
+    scriba::Builder fbb;
+    scriba::Vector<flatbuffers::Offset<scriba::Company>> companies;
+    scriba::Vector<flatbuffers::Offset<scriba::Event>> events;
+    scriba::Vector<flatbuffers::Offset<scriba::POC>> people;
+    scriba::Vector<flatbuffers::Offset<scriba::Project>> projects;
+    unsigned long chunk_size;
+    unsigned long count;                // number of entries in the current chunk
+    scriba_stream_write_fn write;
+    void *ctx;
+    bool failed;
+};
+
+// stream reader state
+struct _scriba_stream_reader
+{
+    enum ScribaMergeStrategy strategy;
+    uint8_t header[sizeof (flatbuffers::uoffset_t)];    // size of the current chunk
+    size_t header_len;                  // number of size bytes received
+    scriba::Vector<uint8_t> chunk;         // data of the current chunk
+    size_t chunk_len;                   // number of chunk bytes received
+    struct ScribaMergeStats stats;      // totals of the chunks applied so far
+    bool conflicts;
+    bool ended;
+    bool failed;
+};
+
+// entity data hash kept by reconciler
+struct ReconcileItem
+{
+    scriba_id_t id;
+    uint64_t hash;
+};
+
+// reconciler state, indexed by entity type; items are sorted by id and sums[i]
+// is the sum of hashes of the first i items, so the hash of any id range is
+// the difference of two sums
+struct _scriba_reconciler
+{
+    scriba::Vector<ReconcileItem> items[4];
+    scriba::Vector<uint64_t> sums[4];
+    scriba::Vector<bool> differs[4];       // items found different from the peer's ones
+    unsigned long num_differs;
+};
 
 namespace scriba
 {
 
 namespace fb = flatbuffers;
 
-// internal serializer functions use C++ linkage
-static fb::Offset<Company> serialize_company(scriba_id_t id, fb::FlatBufferBuilder &fbb);
-static fb::Offset<Event> serialize_event(scriba_id_t id, fb::FlatBufferBuilder &fbb);
-static fb::Offset<POC> serialize_poc(scriba_id_t id, fb::FlatBufferBuilder &fbb);
-static fb::Offset<Project> serialize_project(scriba_id_t id, fb::FlatBufferBuilder &fbb);
-static bool deserialize_company(const Company *company, enum ScribaMergeStrategy strategy);
-static bool deserialize_event(const Event *event, enum ScribaMergeStrategy strategy);
-static bool deserialize_poc(const POC *poc, enum ScribaMergeStrategy strategy);
-static bool deserialize_project(const Project *project, enum ScribaMergeStrategy strategy);
+// id table and strings shared by entities of compact buffer; values are looked up
+// by open addressing hash tables holding value index plus one, 0 marks free slot
+struct CompactTables
+{
+    Vector<ID> ids;
+    Vector<uint32_t> id_slots;
+    Vector<fb::Offset<fb::String>> strings;
+    Vector<uint64_t> string_hashes;
+    Vector<uint32_t> string_slots;
+};
+
+// internal serializer functions use C++ linkage;
+// entities are serialized in compact form if compact tables are given
+static fb::Offset<Company> serialize_company(const ScribaCompany *company, fb::FlatBufferBuilder &fbb,
+                                             CompactTables *compact);
+static fb::Offset<Event> serialize_event(const ScribaEvent *event, fb::FlatBufferBuilder &fbb,
+                                         CompactTables *compact);
+static fb::Offset<POC> serialize_poc(const ScribaPoc *poc, fb::FlatBufferBuilder &fbb,
+                                     CompactTables *compact);
+static fb::Offset<Project> serialize_project(const ScribaProject *project, fb::FlatBufferBuilder &fbb,
+                                             CompactTables *compact);
+// create string, strings of compact buffer are created once for each value
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, CompactTables *compact,
+                                            const char *str);
+// reference to the id in the id table of compact buffer, the id is added to
+// the table when it is referred for the first time; zero id is referred by 0
+static uint32_t id_ref(CompactTables *compact, const scriba_id_t &id);
+// hash of id and string
+static uint64_t id_hash(unsigned long long high, unsigned long long low);
+static uint64_t string_hash(const char *str, size_t len);
+// find slot holding index of the value with the given hash, for which equal()
+// returns true, or free slot the value should be added to
+template<typename Equal>
+static uint32_t *find_slot(Vector<uint32_t> &slots, uint64_t hash, Equal equal);
+// make room in hash table for one more of num values, hash() returns hash of
+// the value with the given index
+template<typename Hash>
+static void reserve_slot(Vector<uint32_t> &slots, size_t num, Hash hash);
+// serializer state passed to scan functions
+template<typename T, typename O>
+struct ScanContext
+{
+    fb::Offset<O> (*serialize)(const T *, fb::FlatBufferBuilder &, CompactTables *);
+    fb::FlatBufferBuilder &fbb;
+    Vector<fb::Offset<O>> &offsets;
+    CompactTables *compact;
+};
+// serialize entity received from scan function
+template<typename T, typename O>
+static void serialize_scanned(const T *entity, void *ctx);
+// scan entities matching the filter in the database and serialize them;
+// nothing is serialized if filter is NULL
+template<typename T, typename O>
+static void serialize_entities(const ScribaScanFilter *filter,
+                               int (*scan)(const ScribaScanFilter *,
+                                           void (*)(const T *, void *), void *),
+                               fb::Offset<O> (*serialize)(const T *, fb::FlatBufferBuilder &,
+                                                          CompactTables *),
+                               fb::FlatBufferBuilder &fbb,
+                               Vector<fb::Offset<O>> &offsets,
+                               CompactTables *compact = nullptr);
+// serialize entities matching the filters of each entity type into the builder
+// inside one read transaction
+static void serialize_filtered(const ScribaScanFilter *company_filter,
+                               const ScribaScanFilter *event_filter,
+                               const ScribaScanFilter *poc_filter,
+                               const ScribaScanFilter *project_filter,
+                               fb::FlatBufferBuilder &fbb,
+                               bool compact = false);
+// create root table referring to serialized entities and removal records;
+// entities serialized with compact tables are stored in compact buffer
+static fb::Offset<Entries> create_entries(fb::FlatBufferBuilder &fbb,
+                                          const Vector<fb::Offset<Company>> &companies,
+                                          const Vector<fb::Offset<Event>> &events,
+                                          const Vector<fb::Offset<POC>> &people,
+                                          const Vector<fb::Offset<Project>> &projects,
+                                          const Vector<fb::Offset<Removed>> *removed = nullptr,
+                                          const CompactTables *compact = nullptr);
+// serializer state passed to removed entity scan function
+struct RemovedContext
+{
+    fb::FlatBufferBuilder &fbb;
+    Vector<fb::Offset<Removed>> &offsets;
+};
+// serialize removal record of entity received from scan function
+static void serialize_removed(const scriba_id_t *id, enum ScribaEntityType type, void *ctx);
+// convert public serializer filter to scan filter; returns false if no entries are
+// selected; company_ids receives id array that should be freed by scriba_free()
+static bool init_scan_filter(const ScribaSerializeFilter *filter,
+                             ScribaScanFilter *scan_filter,
+                             scriba_id_t **company_ids);
+// serialize entries selected by public serializer filter into the builder
+static void serialize_selected(const ScribaSerializeFilter *filter, fb::FlatBufferBuilder &fbb);
+// dictionary used by compressed frames and its id
+// statistics of the last deserialize call
+static struct ScribaMergeStats merge_stats = { 0, 0, 0 };
+static struct ScribaLzDict *compress_dict = NULL;
+static uint32_t compress_dict_id = 0;
+
+// read and write 32-bit little-endian value
+static uint32_t read_le32(const uint8_t *p);
+static void write_le32(uint8_t *p, uint32_t v);
+// compressed frame id of the dictionary, never 0
+static uint32_t dict_id(const uint8_t *dict, size_t len);
+// return pointer to serialized data of the buffer, compressed frame is
+// decompressed into plain; returns NULL if the frame can not be decompressed
+static const void *open_buffer(const void *buf, unsigned long buflen,
+                               Vector<uint8_t> &plain);
+// copy finished buffer out of the builder
+static void *copy_buffer(const fb::FlatBufferBuilder &fbb, unsigned long *buflen);
+// true if Entries buffer can be read without going out of its bounds
+static bool verify_entries(const void *buf, size_t len);
+// true if reconciliation message can be read without going out of its bounds
+static bool verify_summary(const void *buf, size_t len);
+// finish reconciliation message
+static void finish_summary(fb::FlatBufferBuilder &fbb, fb::Offset<Summary> root);
+// write data to file descriptor
+static int write_data(int fd, const void *data, size_t len);
+// stream write function writing to file descriptor passed in ctx
+static int stream_write_fd(const void *data, unsigned long len, void *ctx);
+// serialize entity into the current stream chunk
+template<typename T, typename O>
+static int stream_add(scriba_stream_writer_t *writer, const T *entity,
+                      fb::Offset<O> (*serialize)(const T *, fb::FlatBufferBuilder &,
+                                                 CompactTables *),
+                      Vector<fb::Offset<O>> &offsets);
+// add entity received from scan function to the stream
+template<typename T, int (*add)(scriba_stream_writer_t *, const T *)>
+static void stream_scanned(const T *entity, void *ctx);
+// finish the current chunk and pass it to the write function
+static int stream_flush(scriba_stream_writer_t *writer);
+// store entries of the received chunk
+static bool stream_apply(scriba_stream_reader_t *reader);
+// hash of entity data compared by reconciliation
+static uint64_t company_hash(const ScribaCompany *company);
+static uint64_t event_hash(const ScribaEvent *event);
+static uint64_t poc_hash(const ScribaPoc *poc);
+static uint64_t project_hash(const ScribaProject *project);
+// add hashes of entity data fields to the hash
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len);
+static uint64_t hash_text(uint64_t hash, const char *text);
+static uint64_t hash_int(uint64_t hash, uint64_t num);
+static uint64_t hash_id(uint64_t hash, const scriba_id_t &id);
+// add hash of entity received from scan function to the reconciler
+template<typename T, uint64_t (*hash)(const T *), int type>
+static void reconcile_scanned(const T *entity, void *ctx);
+// reconciler message being built
+struct ReconcileReply
+{
+    Builder fbb;
+    Vector<RangeHash> ranges;
+    Vector<fb::Offset<RangeItems>> items;
+    Vector<EntityRef> wanted;
+};
+// true if range refers to existing entity type and its prefix fits its depth
+static bool range_valid(const RangeHash *range);
+// find items of the range given by depth and id prefix
+static void range_bounds(const scriba_reconciler_t *rec, int type, unsigned int depth,
+                         uint64_t prefix, size_t &first, size_t &last);
+// local hash of the range
+static RangeHash range_hash(const scriba_reconciler_t *rec, int type, unsigned int depth,
+                            uint64_t prefix);
+// compare range hash of the peer with local one; differing range is either split
+// or sent item by item; returns false if the range is malformed
+static bool reconcile_range(scriba_reconciler_t *rec, const RangeHash *remote,
+                            ReconcileReply &reply);
+// compare items of the peer's range with local ones, local items that differ
+// are marked and the peer's ones are wanted; returns false if the range is malformed
+static bool reconcile_items(scriba_reconciler_t *rec, const RangeItems *remote,
+                            ReconcileReply &reply);
+// add local items of the range to the reply
+static void reply_items(const scriba_reconciler_t *rec, const RangeHash &range,
+                        ReconcileReply &reply);
+// mark local item as different from the peer's one
+static void mark_differs(scriba_reconciler_t *rec, int type, size_t index);
+// order of reconciliation items and ids
+static bool item_less(const ReconcileItem &a, const ReconcileItem &b);
+// send message preceded by its size, zero size if data is NULL
+static int send_message(int fd, const void *data, unsigned long len);
+// read exactly len bytes from file descriptor; returns -1 on failure or end of file
+static int read_data(int fd, void *data, size_t len);
+// parallel export state shared by exporting threads
+struct ParallelExport
+{
+    ScribaScanFilter scan_filter;
+    unsigned int num_shards;
+    unsigned long chunk_size;
+    scriba_stream_write_fn write;
+    void *ctx;
+    bool failed;
+    std::mutex lock;                    // serializes calls to the write function
+};
+// write function of shard stream writers
+static int parallel_write(const void *data, unsigned long len, void *ctx);
+// serialize entries of the given shard into chunks of the shared stream
+static void serialize_shard(ParallelExport *exp, unsigned int shard);
+// exporting thread, reads its shard by a separate read connection
+static void parallel_serialize(ParallelExport *exp, unsigned int shard);
+// deserializer state
+struct ImportContext
+{
+    enum ScribaMergeStrategy strategy;
+    unsigned long batch_size;           // number of entries stored by one transaction
+    unsigned long count;                // number of entries stored by current transaction
+    struct ScribaMergeStats stats;
+    bool failed;
+};
+// decoded entry of any type; string fields point to the deserialized buffer
+struct ImportRow
+{
+    enum { COMPANY, EVENT, POC, PROJECT } type;
+    union
+    {
+        ScribaCompany company;
+        ScribaEvent event;
+        ScribaPoc poc;
+        ScribaProject project;
+    };
+};
+// pipelined import state shared by decoder threads and the writer
+struct ImportPipeline
+{
+    const Entries *entries;
+    unsigned long num_entries;
+    unsigned long num_batches;
+    unsigned long next;                 // next batch to be decoded
+    unsigned long taken;                // number of batches taken by the writer
+    bool stop;
+    // decoded batches, batch n is kept in slot n modulo number of slots
+    Vector<Vector<ImportRow>> slots;
+    Vector<bool> ready;
+    std::mutex lock;
+    std::condition_variable decoded;    // signaled when a batch has been decoded
+    std::condition_variable freed;      // signaled when a slot is freed or import stops
+};
+// store decoded entry in the local database; returns false on failure
+static bool import_row(const ImportRow &row, ImportContext &ctx);
+// count entry stored by the current transaction, commit the transaction if
+// the batch is complete; returns false on failure
+static bool import_next(ImportContext &ctx);
+// remove entities of the given removal records from the local database if remote
+// data overrides local one
+static void import_removed(const fb::Vector<fb::Offset<Removed>> *removed, ImportContext &ctx);
+// id table of compact buffer
+typedef fb::Vector<const ID *> IdTable;
+// store entities of the given vector in the local database
+template<typename T>
+static void import_entities(const fb::Vector<fb::Offset<T>> *entities,
+                            void (*decode)(const T *, const IdTable *, ImportRow &),
+                            const IdTable *ids, ImportContext &ctx);
+// store entries of deserialized buffer in the local database; entries are stored
+// by transactions of batch_size entries, 0 stores all entries in one transaction
+static enum ScribaMergeStatus deserialize_entries(const Entries *entries,
+                                                  enum ScribaMergeStrategy strategy,
+                                                  unsigned long batch_size);
+// number of entities in the given vector
+template<typename T>
+static unsigned long entities_length(const fb::Vector<fb::Offset<T>> *entities);
+// number of entities of all types in the buffer
+static unsigned long entries_length(const Entries *entries);
+// decode entity with the given index if it belongs to the given vector,
+// otherwise subtract the vector length from the index; returns true if decoded
+template<typename T>
+static bool decode_from(const fb::Vector<fb::Offset<T>> *entities,
+                        void (*decode)(const T *, const IdTable *, ImportRow &),
+                        const IdTable *ids, unsigned long &index, ImportRow &row);
+// decode entry with the given index, entries are indexed in the order they
+// are stored: companies, events, people, projects, each type is indexed
+// in the original vector first and then in the compact one
+static void decode_entry(const Entries *entries, unsigned long index, ImportRow &row);
+// decoder thread of pipelined import
+static void pipeline_decode(ImportPipeline *pipeline);
+// store entries decoded by decoder threads in the local database
+static enum ScribaMergeStatus pipeline_import(const Entries *entries,
+                                              enum ScribaMergeStrategy strategy,
+                                              unsigned long batch_size,
+                                              unsigned int num_threads);
+// store entity in the local database; return 1 if entity data has been written,
+// 0 if local data has been kept and -1 on failure
+static int store_row(const ImportRow &row, enum ScribaMergeStrategy strategy);
+// convert deserialized entity to library representation; ids is the id table of
+// compact buffer, NULL for original buffers
+static void decode_company(const Company *company, const IdTable *ids, ImportRow &row);
+static void decode_event(const Event *event, const IdTable *ids, ImportRow &row);
+static void decode_poc(const POC *poc, const IdTable *ids, ImportRow &row);
+static void decode_project(const Project *project, const IdTable *ids, ImportRow &row);
+// decode id stored either as struct or as reference to the id table
+static void decode_id(const ID *id, uint32_t ref, const IdTable *ids, scriba_id_t &decoded);
 
 // externally visible functions should use C linkage
 #ifdef __cplusplus
@@ -55,135 +419,1778 @@ void *scriba_serialize(scriba_list_t *companies,
                        scriba_list_t *projects,
                        unsigned long *buflen)
 {
-    fb::FlatBufferBuilder fbb;
-    std::vector<fb::Offset<Company>> comp_offsets;
-    std::vector<fb::Offset<Event>> event_offsets;
-    std::vector<fb::Offset<POC>> poc_offsets;
-    std::vector<fb::Offset<Project>> project_offsets;
+    scriba_list_t *lists[] = { companies, events, people, projects };
+    ScribaScanFilter filters[4];
+    scriba_id_t *ids[4];
 
-    // serialize each entry and create offset vectors
-    scriba_list_for_each(companies, company)
+    // each list is turned into a filter selecting entities with listed ids;
+    // entities of types with empty lists are not serialized
+    for (int i = 0; i < 4; i++)
     {
-        auto offset = serialize_company(company->id, fbb);
-        comp_offsets.push_back(offset);
+        memset(&(filters[i]), 0, sizeof (ScribaScanFilter));
+        ids[i] = scriba_list_to_ids(lists[i], &(filters[i].num_ids));
+        filters[i].ids = ids[i];
     }
-    auto comp_vector = fbb.CreateVector(comp_offsets);
 
-    scriba_list_for_each(events, event)
+    Builder fbb;
+    serialize_filtered((ids[0] != NULL) ? &(filters[0]) : nullptr,
+                       (ids[1] != NULL) ? &(filters[1]) : nullptr,
+                       (ids[2] != NULL) ? &(filters[2]) : nullptr,
+                       (ids[3] != NULL) ? &(filters[3]) : nullptr,
+                       fbb);
+
+    for (int i = 0; i < 4; i++)
     {
-        auto offset = serialize_event(event->id, fbb);
-        event_offsets.push_back(offset);
+        if (ids[i] != NULL)
+        {
+            scriba_free(ids[i]);
+        }
     }
-    auto event_vector = fbb.CreateVector(event_offsets);
+    return copy_buffer(fbb, buflen);
+}
 
-    scriba_list_for_each(people, poc)
+// serialize all entries in the local database
+void *scriba_serializeAll(unsigned long *buflen)
+{
+    return scriba_serializeFiltered(NULL, buflen);
+}
+
+// serialize entries of the local database selected by the given filter
+void *scriba_serializeFiltered(const struct ScribaSerializeFilter *filter, unsigned long *buflen)
+{
+    Builder fbb;
+
+    serialize_selected(filter, fbb);
+    return copy_buffer(fbb, buflen);
+}
+
+// serialize entries selected by the filter and hand over serializer's buffer
+int scriba_serializeToBuffer(const struct ScribaSerializeFilter *filter,
+                             struct ScribaSerializedBuffer *buf)
+{
+    if (buf == NULL)
     {
-        auto offset = serialize_poc(poc->id, fbb);
-        poc_offsets.push_back(offset);
+        return -1;
     }
-    auto poc_vector = fbb.CreateVector(poc_offsets);
+    memset(buf, 0, sizeof (struct ScribaSerializedBuffer));
 
-    scriba_list_for_each(projects, project)
+    // the builder owns serialized data, so it lives until the buffer is released
+    Builder *fbb = try_create<Builder>();
+    if (fbb == nullptr)
     {
-        auto offset = serialize_project(project->id, fbb);
-        project_offsets.push_back(offset);
+        return -1;
     }
-    auto project_vector = fbb.CreateVector(project_offsets);
 
-    // now we have all the offsets, we can create the root element
-    EntriesBuilder eb(fbb);
-    eb.add_companies(comp_vector);
-    eb.add_events(event_vector);
-    eb.add_people(poc_vector);
-    eb.add_projects(project_vector);
-    auto root_offset = eb.Finish();
+    serialize_selected(filter, *fbb);
+    buf->data = fbb->GetBufferPointer();
+    buf->len = fbb->GetSize();
+    buf->priv = fbb;
+    return 0;
+}
 
-    // finalize the buffer
+// release data returned by scriba_serializeToBuffer()
+void scriba_freeSerializedBuffer(struct ScribaSerializedBuffer *buf)
+{
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    destroy(static_cast<Builder *>(buf->priv));
+    memset(buf, 0, sizeof (struct ScribaSerializedBuffer));
+}
+
+// serialize entries selected by the filter and write them to file descriptor
+int scriba_serializeToFd(const struct ScribaSerializeFilter *filter, int fd)
+{
+    Builder fbb;
+
+    serialize_selected(filter, fbb);
+    return write_data(fd, fbb.GetBufferPointer(), fbb.GetSize());
+}
+
+// serialize entries selected by the filter and write them to file
+int scriba_serializeToFile(const struct ScribaSerializeFilter *filter, const char *path)
+{
+    Builder fbb;
+
+    if (path == NULL)
+    {
+        return -1;
+    }
+
+    // build the buffer first, so that the file is not truncated for nothing
+    serialize_selected(filter, fbb);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    int ret = write_data(fd, fbb.GetBufferPointer(), fbb.GetSize());
+    if (close(fd) != 0)
+    {
+        ret = -1;
+    }
+    return ret;
+}
+
+// serialize entries changed since the state identified by token
+void *scriba_serializeChangesSince(scriba_sync_token_t token,
+                                   scriba_sync_token_t *new_token,
+                                   unsigned long *buflen)
+{
+    Builder fbb;
+    ScribaScanFilter scan_filter;
+    Vector<fb::Offset<Company>> comp_offsets;
+    Vector<fb::Offset<Event>> event_offsets;
+    Vector<fb::Offset<POC>> poc_offsets;
+    Vector<fb::Offset<Project>> project_offsets;
+    Vector<fb::Offset<Removed>> removed_offsets;
+    RemovedContext removed_ctx = { fbb, removed_offsets };
+
+    memset(&scan_filter, 0, sizeof (scan_filter));
+
+    // changes and the new token come from the same snapshot, so that changes made
+    // during the export are picked up by the next one
+    scriba_beginRead();
+    scriba_sync_token_t current = scriba_getChangeStamp();
+    // token of another database or of the state before the database has been
+    // reset is not comparable with local stamps, all entries are exported then
+    bool incremental = (token != 0) && (token <= current);
+    if (incremental)
+    {
+        scan_filter.use_changed_since = 1;
+        scan_filter.changed_since = token;
+    }
+    serialize_entities(&scan_filter, scriba_scanCompanies, serialize_company, fbb, comp_offsets);
+    serialize_entities(&scan_filter, scriba_scanEvents, serialize_event, fbb, event_offsets);
+    serialize_entities(&scan_filter, scriba_scanPeople, serialize_poc, fbb, poc_offsets);
+    serialize_entities(&scan_filter, scriba_scanProjects, serialize_project, fbb, project_offsets);
+    if (incremental)
+    {
+        scriba_scanRemoved(token, serialize_removed, &removed_ctx);
+    }
+    scriba_endRead();
+
+    auto root_offset = create_entries(fbb, comp_offsets, event_offsets, poc_offsets,
+                                      project_offsets, &removed_offsets);
     fbb.Finish(root_offset);
 
-    // copy it (the original buffer will die with FlatBufferBuilder object)
-    void *buf = malloc((size_t)(fbb.GetSize()));
-    memcpy(buf, (const void *)fbb.GetBufferPointer(), fbb.GetSize());
+    if (new_token != NULL)
+    {
+        *new_token = current;
+    }
+    return copy_buffer(fbb, buflen);
+}
+
+// compress serialized buffer into frame
+void *scriba_compress(const void *buf, unsigned long buflen, unsigned long *framelen)
+{
+    if ((buf == NULL) || (buflen > UINT32_MAX))
+    {
+        return NULL;
+    }
+
+    size_t bound = scriba_lz_bound(buflen);
+    uint8_t *frame = (uint8_t *)scriba_malloc(SCRIBA_FRAME_HEADER_SIZE + bound);
+    size_t len = scriba_lz_compress(buf, buflen, compress_dict,
+                                    frame + SCRIBA_FRAME_HEADER_SIZE, bound);
+    if (len == 0)
+    {
+        scriba_free(frame);
+        return NULL;
+    }
+    write_le32(frame, SCRIBA_FRAME_MAGIC);
+    write_le32(frame + 4, compress_dict_id);
+    write_le32(frame + 8, (uint32_t)buflen);
+
+    // compressed data is usually much smaller than the bound
+    len += SCRIBA_FRAME_HEADER_SIZE;
+    frame = (uint8_t *)scriba_realloc(frame, len);
+    if (framelen != NULL)
+    {
+        *framelen = len;
+    }
+    return frame;
+}
+
+// decompress frame into serialized buffer
+void *scriba_decompress(const void *frame, unsigned long framelen, unsigned long *buflen)
+{
+    if (!scriba_isCompressed(frame, framelen))
+    {
+        return NULL;
+    }
 
+    const uint8_t *header = (const uint8_t *)frame;
+    uint32_t len = read_le32(header + 8);
+    if (read_le32(header + 4) != compress_dict_id)
+    {
+        return NULL;
+    }
+    void *buf = scriba_malloc((len != 0) ? len : 1);
+    if (scriba_lz_decompress(header + SCRIBA_FRAME_HEADER_SIZE,
+                             framelen - SCRIBA_FRAME_HEADER_SIZE,
+                             compress_dict, buf, len) != 0)
+    {
+        scriba_free(buf);
+        return NULL;
+    }
     if (buflen != NULL)
     {
-        *buflen = fbb.GetSize();
+        *buflen = len;
     }
     return buf;
 }
 
+// check whether the buffer is compressed frame
+int scriba_isCompressed(const void *buf, unsigned long buflen)
+{
+    return (buf != NULL) && (buflen >= SCRIBA_FRAME_HEADER_SIZE) &&
+           (read_le32((const uint8_t *)buf) == SCRIBA_FRAME_MAGIC);
+}
+
+// serialize entries selected by the filter into compressed frame
+void *scriba_serializeCompressed(const struct ScribaSerializeFilter *filter,
+                                 unsigned long *framelen)
+{
+    Builder fbb;
+
+    serialize_selected(filter, fbb);
+    // builder data is compressed right away, without copying it
+    return scriba_compress(fbb.GetBufferPointer(), fbb.GetSize(), framelen);
+}
+
+// build compression dictionary out of sample serialized buffers
+unsigned long scriba_trainCompressionDict(const void *const *samples,
+                                          const unsigned long *sample_lens,
+                                          unsigned int n,
+                                          void *dict, unsigned long dict_len)
+{
+    if ((samples == NULL) || (sample_lens == NULL) || (dict == NULL))
+    {
+        return 0;
+    }
+
+    Vector<size_t> lens(sample_lens, sample_lens + n);
+    return scriba_lz_train(samples, lens.data(), n, dict,
+                           std::min(dict_len, (unsigned long)SCRIBA_COMPRESS_DICT_MAX_SIZE));
+}
+
+// set compression dictionary
+int scriba_setCompressionDict(const void *dict, unsigned long dict_len)
+{
+    if (dict_len > SCRIBA_COMPRESS_DICT_MAX_SIZE)
+    {
+        return -1;
+    }
+
+    scriba_lz_dict_free(compress_dict);
+    compress_dict = NULL;
+    compress_dict_id = 0;
+    if (dict != NULL)
+    {
+        // dictionary too small to be used is the same as no dictionary
+        compress_dict = scriba_lz_dict_create(dict, dict_len);
+    }
+    if (compress_dict != NULL)
+    {
+        compress_dict_id = dict_id((const uint8_t *)dict, dict_len);
+    }
+    return 0;
+}
+
 // read entry data from the given buffer and store it in the local database
 // according to the given merge strategy
 enum ScribaMergeStatus scriba_deserialize(void *buf, unsigned long buflen,
                                           enum ScribaMergeStrategy strategy)
 {
-    const Entries *entries = GetEntries(buf);
-    bool conflicts = false;
+    Vector<uint8_t> plain;
+    const void *data = open_buffer(buf, buflen, plain);
+
+    if (data == NULL)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+    return deserialize_entries(GetEntries(data), strategy, 0);
+}
+
+// read entry data from the given buffer and store it in the local database
+// by transactions of batch_size entries
+enum ScribaMergeStatus scriba_deserializeBatched(void *buf, unsigned long buflen,
+                                                 enum ScribaMergeStrategy strategy,
+                                                 unsigned long batch_size)
+{
+    Vector<uint8_t> plain;
+    const void *data = open_buffer(buf, buflen, plain);
+
+    if (data == NULL)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+    return deserialize_entries(GetEntries(data), strategy, batch_size);
+}
+
+// read entry data from the given buffer and store it in the local database
+// by transactions of batch_size entries, decoding entries by num_threads threads
+enum ScribaMergeStatus scriba_deserializeParallel(void *buf, unsigned long buflen,
+                                                  enum ScribaMergeStrategy strategy,
+                                                  unsigned long batch_size,
+                                                  unsigned int num_threads)
+{
+    if (num_threads == 0)
+    {
+        // the calling thread is busy with database writes
+        num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    Vector<uint8_t> plain;
+    const void *data = open_buffer(buf, buflen, plain);
+    if (data == NULL)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+    return pipeline_import(GetEntries(data), strategy, batch_size, num_threads);
+}
+
+// read entry data from the given file mapped into memory and store it in the
+// local database according to the given merge strategy
+enum ScribaMergeStatus scriba_deserializeFile(const char *path, enum ScribaMergeStrategy strategy)
+{
+    struct stat st;
+    enum ScribaMergeStatus status = SCRIBA_MERGE_FAILED;
+
+    if (path == NULL)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+    // buffer should at least hold root table offset;
+    // FlatBuffers larger than 2GB are not supported
+    if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof (fb::uoffset_t)) ||
+        ((unsigned long long)st.st_size >= (1ULL << 31)))
+    {
+        close(fd);
+        return SCRIBA_MERGE_FAILED;
+    }
+    size_t map_len = (size_t)st.st_size;
+    void *data = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+    // entries are read once from the beginning to the end
+    madvise(data, map_len, MADV_SEQUENTIAL);
+
+    Vector<uint8_t> plain;
+    const void *buf = open_buffer(data, (unsigned long)map_len, plain);
+    size_t len = (buf == plain.data()) ? plain.size() : map_len;
+    if ((buf != NULL) && verify_entries(buf, len))
+    {
+        status = deserialize_entries(GetEntries(buf), strategy, 0);
+    }
+
+    munmap(data, map_len);
+    return status;
+}
+
+// create stream writer
+scriba_stream_writer_t *scriba_stream_writer_create(unsigned long chunk_size,
+                                                    scriba_stream_write_fn write,
+                                                    void *ctx)
+{
+    if (write == NULL)
+    {
+        return NULL;
+    }
+
+    scriba_stream_writer_t *writer = try_create<scriba_stream_writer_t>();
+    if (writer == nullptr)
+    {
+        return NULL;
+    }
+    writer->chunk_size = (chunk_size != 0) ? chunk_size : SCRIBA_STREAM_CHUNK_SIZE;
+    writer->count = 0;
+    writer->write = write;
+    writer->ctx = ctx;
+    writer->failed = false;
+    return writer;
+}
+
+// add company to the stream
+int scriba_stream_write_company(scriba_stream_writer_t *writer, const struct ScribaCompany *company)
+{
+    return stream_add(writer, company, serialize_company, writer->companies);
+}
+
+// add event to the stream
+int scriba_stream_write_event(scriba_stream_writer_t *writer, const struct ScribaEvent *event)
+{
+    return stream_add(writer, event, serialize_event, writer->events);
+}
+
+// add poc to the stream
+int scriba_stream_write_poc(scriba_stream_writer_t *writer, const struct ScribaPoc *poc)
+{
+    return stream_add(writer, poc, serialize_poc, writer->people);
+}
+
+// add project to the stream
+int scriba_stream_write_project(scriba_stream_writer_t *writer, const struct ScribaProject *project)
+{
+    return stream_add(writer, project, serialize_project, writer->projects);
+}
+
+// write the last chunk and the end of stream mark and destroy the writer
+int scriba_stream_writer_finish(scriba_stream_writer_t *writer)
+{
+    uint8_t end_mark[sizeof (fb::uoffset_t)] = { 0 };
+    int ret = -1;
+
+    if (writer == NULL)
+    {
+        return -1;
+    }
+
+    if ((stream_flush(writer) == 0) &&
+        (writer->write(end_mark, sizeof (end_mark), writer->ctx) == 0))
+    {
+        ret = 0;
+    }
+    destroy(writer);
+    return ret;
+}
+
+// serialize entries selected by the filter into stream
+int scriba_serializeStream(const struct ScribaSerializeFilter *filter,
+                           unsigned long chunk_size,
+                           scriba_stream_write_fn write,
+                           void *ctx)
+{
+    ScribaScanFilter scan_filter;
+    scriba_id_t *company_ids = NULL;
+
+    scriba_stream_writer_t *writer = scriba_stream_writer_create(chunk_size, write, ctx);
+    if (writer == NULL)
+    {
+        return -1;
+    }
+
+    // entities are streamed right from the database rows, only the current
+    // chunk is kept in memory
+    if (init_scan_filter(filter, &scan_filter, &company_ids))
+    {
+        scriba_beginRead();
+        scriba_scanCompanies(&scan_filter,
+                             stream_scanned<ScribaCompany, scriba_stream_write_company>,
+                             writer);
+        scriba_scanEvents(&scan_filter,
+                          stream_scanned<ScribaEvent, scriba_stream_write_event>,
+                          writer);
+        scriba_scanPeople(&scan_filter,
+                          stream_scanned<ScribaPoc, scriba_stream_write_poc>,
+                          writer);
+        scriba_scanProjects(&scan_filter,
+                            stream_scanned<ScribaProject, scriba_stream_write_project>,
+                            writer);
+        scriba_endRead();
+    }
+
+    if (company_ids != NULL)
+    {
+        scriba_free(company_ids);
+    }
+    return scriba_stream_writer_finish(writer);
+}
+
+// serialize entries selected by the filter into stream written to file descriptor
+int scriba_serializeStreamToFd(const struct ScribaSerializeFilter *filter,
+                               unsigned long chunk_size,
+                               int fd)
+{
+    return scriba_serializeStream(filter, chunk_size, stream_write_fd, &fd);
+}
+
+// serialize entries selected by the filter into stream by num_threads threads
+int scriba_serializeParallel(const struct ScribaSerializeFilter *filter,
+                             unsigned long chunk_size,
+                             unsigned int num_threads,
+                             scriba_stream_write_fn write,
+                             void *ctx)
+{
+    uint8_t end_mark[sizeof (fb::uoffset_t)] = { 0 };
+    ParallelExport exp;
+    scriba_id_t *company_ids = NULL;
+    Vector<std::thread> threads;
+
+    if (write == NULL)
+    {
+        return -1;
+    }
+    if (num_threads == 0)
+    {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if ((num_threads < 2) || (scriba_attachReader() != 0))
+    {
+        return scriba_serializeStream(filter, chunk_size, write, ctx);
+    }
+
+    exp.num_shards = num_threads;
+    exp.chunk_size = chunk_size;
+    exp.write = write;
+    exp.ctx = ctx;
+    exp.failed = false;
+
+    if (init_scan_filter(filter, &(exp.scan_filter), &company_ids))
+    {
+        // the snapshot of the calling thread is taken before other threads start,
+        // so that all shards are read while writers are kept from committing
+        scriba_beginRead();
+
+        unsigned int shard = 1;
+        for (; shard < num_threads; shard++)
+        {
+            try
+            {
+                threads.push_back(std::thread(parallel_serialize, &exp, shard));
+            }
+            catch (const std::system_error &)
+            {
+                break;
+            }
+        }
+        serialize_shard(&exp, 0);
+        // shards that could not get their own thread are read by the calling thread
+        for (; shard < num_threads; shard++)
+        {
+            serialize_shard(&exp, shard);
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        scriba_endRead();
+    }
+    scriba_detachReader();
+
+    if (company_ids != NULL)
+    {
+        scriba_free(company_ids);
+    }
+    if (exp.failed || (write(end_mark, sizeof (end_mark), ctx) != 0))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// serialize entries selected by the filter by num_threads threads into stream
+// written to file descriptor
+int scriba_serializeParallelToFd(const struct ScribaSerializeFilter *filter,
+                                 unsigned long chunk_size,
+                                 unsigned int num_threads,
+                                 int fd)
+{
+    return scriba_serializeParallel(filter, chunk_size, num_threads, stream_write_fd, &fd);
+}
+
+// get statistics of the last deserialize call
+void scriba_getMergeStats(struct ScribaMergeStats *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = merge_stats;
+    }
+}
+
+// create stream reader
+scriba_stream_reader_t *scriba_stream_reader_create(enum ScribaMergeStrategy strategy)
+{
+    scriba_stream_reader_t *reader = try_create<scriba_stream_reader_t>();
+    if (reader == nullptr)
+    {
+        return NULL;
+    }
+    reader->strategy = strategy;
+    reader->header_len = 0;
+    reader->chunk_len = 0;
+    memset(&(reader->stats), 0, sizeof (reader->stats));
+    merge_stats = reader->stats;
+    reader->conflicts = false;
+    reader->ended = false;
+    reader->failed = false;
+    return reader;
+}
+
+// feed stream data to the reader
+int scriba_stream_reader_feed(scriba_stream_reader_t *reader, const void *data, unsigned long len)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    if ((reader == NULL) || reader->failed)
+    {
+        return -1;
+    }
 
-    const fb::Vector<fb::Offset<Company>> *companies = entries->companies();
-    if (companies != nullptr)
+    while (len > 0)
     {
-        for (fb::uoffset_t i = 0; i < companies->Length(); i++)
+        if (reader->ended)
+        {
+            // no data is expected after the end of stream mark
+            reader->failed = true;
+            return -1;
+        }
+
+        if (reader->header_len < sizeof (reader->header))
+        {
+            // chunk size
+            size_t n = sizeof (reader->header) - reader->header_len;
+            n = (n < len) ? n : len;
+            memcpy(reader->header + reader->header_len, bytes, n);
+            reader->header_len += n;
+            bytes += n;
+            len -= n;
+            if (reader->header_len < sizeof (reader->header))
+            {
+                break;
+            }
+
+            fb::uoffset_t size = fb::ReadScalar<fb::uoffset_t>(reader->header);
+            if (size == 0)
+            {
+                reader->ended = true;
+                continue;
+            }
+            // chunk should at least hold root table offset;
+            // FlatBuffers larger than 2GB are not supported
+            if ((size < sizeof (fb::uoffset_t)) || (size >= (1UL << 31)))
+            {
+                reader->failed = true;
+                return -1;
+            }
+            reader->chunk.resize(size);
+            reader->chunk_len = 0;
+            continue;
+        }
+
+        // chunk data
+        size_t n = reader->chunk.size() - reader->chunk_len;
+        n = (n < len) ? n : len;
+        memcpy(reader->chunk.data() + reader->chunk_len, bytes, n);
+        reader->chunk_len += n;
+        bytes += n;
+        len -= n;
+        if (reader->chunk_len == reader->chunk.size())
         {
-            bool ret = deserialize_company(companies->Get(i), strategy);
-            if (ret == true)
+            if (!stream_apply(reader))
             {
-                conflicts = true;
+                reader->failed = true;
+                return -1;
             }
+            reader->header_len = 0;
         }
     }
 
-    const fb::Vector<fb::Offset<Event>> *events = entries->events();
-    if (events != nullptr)
+    return 0;
+}
+
+// destroy the reader
+int scriba_stream_reader_finish(scriba_stream_reader_t *reader, enum ScribaMergeStatus *status)
+{
+    if (reader == NULL)
+    {
+        return -1;
+    }
+
+    int ret = (reader->ended && !reader->failed) ? 0 : -1;
+    if (status != NULL)
+    {
+        *status = reader->conflicts ? SCRIBA_MERGE_CONFLICTS : SCRIBA_MERGE_OK;
+    }
+    destroy(reader);
+    return ret;
+}
+
+// read stream from file descriptor and store its entries in the local database
+int scriba_deserializeStreamFromFd(int fd, enum ScribaMergeStrategy strategy,
+                                   enum ScribaMergeStatus *status)
+{
+    uint8_t buf[SCRIBA_STREAM_READ_SIZE];
+
+    scriba_stream_reader_t *reader = scriba_stream_reader_create(strategy);
+    if (reader == NULL)
+    {
+        return -1;
+    }
+
+    // received chunks are stored while the rest of the stream is being read
+    while (!reader->ended)
+    {
+        ssize_t n = read(fd, buf, sizeof (buf));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (n == 0)
+        {
+            // the stream is incomplete
+            break;
+        }
+        if (scriba_stream_reader_feed(reader, buf, (unsigned long)n) != 0)
+        {
+            break;
+        }
+    }
+
+    return scriba_stream_reader_finish(reader, status);
+}
+
+// create reconciler holding entity hashes of the local database
+scriba_reconciler_t *scriba_reconciler_create()
+{
+    scriba_reconciler_t *rec = try_create<scriba_reconciler_t>();
+    if (rec == nullptr)
+    {
+        return NULL;
+    }
+    rec->num_differs = 0;
+
+    // hashes are taken from the same database snapshot
+    scriba_beginRead();
+    scriba_scanCompanies(NULL, reconcile_scanned<ScribaCompany, company_hash, EntityType_COMPANY>, rec);
+    scriba_scanEvents(NULL, reconcile_scanned<ScribaEvent, event_hash, EntityType_EVENT>, rec);
+    scriba_scanPeople(NULL, reconcile_scanned<ScribaPoc, poc_hash, EntityType_POC>, rec);
+    scriba_scanProjects(NULL, reconcile_scanned<ScribaProject, project_hash, EntityType_PROJECT>, rec);
+    scriba_endRead();
+
+    for (int type = 0; type < 4; type++)
+    {
+        Vector<ReconcileItem> &items = rec->items[type];
+
+        std::sort(items.begin(), items.end(), item_less);
+        rec->sums[type].resize(items.size() + 1);
+        rec->sums[type][0] = 0;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            rec->sums[type][i + 1] = rec->sums[type][i] + items[i].hash;
+        }
+        rec->differs[type].assign(items.size(), false);
+    }
+    return rec;
+}
+
+// create the first reconciliation message holding hashes of whole tables
+void *scriba_reconciler_start(scriba_reconciler_t *rec, unsigned long *msglen)
+{
+    Builder fbb;
+    Vector<RangeHash> ranges;
+
+    if (rec == NULL)
+    {
+        return NULL;
+    }
+
+    for (int type = 0; type < 4; type++)
+    {
+        ranges.push_back(range_hash(rec, type, 0, 0));
+    }
+    auto range_vector = fbb.CreateVectorOfStructs(ranges);
+    finish_summary(fbb, CreateSummary(fbb, range_vector, 0, 0));
+    return copy_buffer(fbb, msglen);
+}
+
+// process reconciliation message of the peer
+int scriba_reconciler_process(scriba_reconciler_t *rec, const void *msg, unsigned long msglen,
+                              void **reply, unsigned long *replylen)
+{
+    ReconcileReply out;
+
+    if ((rec == NULL) || (msg == NULL) || (reply == NULL))
+    {
+        return -1;
+    }
+    *reply = NULL;
+    if (replylen != NULL)
+    {
+        *replylen = 0;
+    }
+
+    // message structs are 8-byte aligned, but the transport may have received
+    // the message into a buffer of any alignment
+    Vector<uint64_t> aligned;
+    if (((uintptr_t)msg % sizeof (uint64_t)) != 0)
+    {
+        aligned.resize((msglen + sizeof (uint64_t) - 1) / sizeof (uint64_t));
+        memcpy(aligned.data(), msg, msglen);
+        msg = aligned.data();
+    }
+    if (!verify_summary(msg, msglen))
+    {
+        return -1;
+    }
+    const Summary *summary = GetSummary(msg);
+
+    if (summary->ranges() != nullptr)
+    {
+        for (fb::uoffset_t i = 0; i < summary->ranges()->Length(); i++)
+        {
+            if (!reconcile_range(rec, summary->ranges()->Get(i), out))
+            {
+                return -1;
+            }
+        }
+    }
+    if (summary->items() != nullptr)
+    {
+        for (fb::uoffset_t i = 0; i < summary->items()->Length(); i++)
+        {
+            if (!reconcile_items(rec, summary->items()->Get(i), out))
+            {
+                return -1;
+            }
+        }
+    }
+    if (summary->wanted() != nullptr)
+    {
+        for (fb::uoffset_t i = 0; i < summary->wanted()->Length(); i++)
+        {
+            const EntityRef *ref = summary->wanted()->Get(i);
+            if ((ref->type() < 0) || (ref->type() > EntityType_PROJECT))
+            {
+                return -1;
+            }
+
+            Vector<ReconcileItem> &items = rec->items[ref->type()];
+            ReconcileItem wanted = { { ref->id().high(), ref->id().low() }, 0 };
+            auto found = std::lower_bound(items.begin(), items.end(), wanted, item_less);
+            if ((found != items.end()) && !item_less(wanted, *found))
+            {
+                mark_differs(rec, ref->type(), (size_t)(found - items.begin()));
+            }
+        }
+    }
+
+    // nothing to reply, the exchange is complete
+    if (out.ranges.empty() && out.items.empty() && out.wanted.empty())
+    {
+        return 0;
+    }
+
+    auto range_vector = out.fbb.CreateVectorOfStructs(out.ranges);
+    auto items_vector = out.fbb.CreateVector(out.items);
+    auto wanted_vector = out.fbb.CreateVectorOfStructs(out.wanted);
+    finish_summary(out.fbb, CreateSummary(out.fbb, range_vector, items_vector, wanted_vector));
+    *reply = copy_buffer(out.fbb, replylen);
+    return 0;
+}
+
+// number of local entities found different
+unsigned long scriba_reconciler_count(const scriba_reconciler_t *rec)
+{
+    return (rec != NULL) ? rec->num_differs : 0;
+}
+
+// serialize local entities found different
+void *scriba_reconciler_serialize(const scriba_reconciler_t *rec, unsigned long *buflen)
+{
+    ScribaScanFilter filters[4];
+    Vector<scriba_id_t> ids[4];
+
+    if (rec == NULL)
+    {
+        return NULL;
+    }
+
+    // entities of types without differing entities are not serialized
+    for (int type = 0; type < 4; type++)
+    {
+        for (size_t i = 0; i < rec->items[type].size(); i++)
+        {
+            if (rec->differs[type][i])
+            {
+                ids[type].push_back(rec->items[type][i].id);
+            }
+        }
+        memset(&(filters[type]), 0, sizeof (ScribaScanFilter));
+        filters[type].ids = ids[type].data();
+        filters[type].num_ids = ids[type].size();
+    }
+
+    Builder fbb;
+    serialize_filtered(ids[EntityType_COMPANY].empty() ? nullptr : &(filters[EntityType_COMPANY]),
+                       ids[EntityType_EVENT].empty() ? nullptr : &(filters[EntityType_EVENT]),
+                       ids[EntityType_POC].empty() ? nullptr : &(filters[EntityType_POC]),
+                       ids[EntityType_PROJECT].empty() ? nullptr : &(filters[EntityType_PROJECT]),
+                       fbb);
+    return copy_buffer(fbb, buflen);
+}
+
+// destroy the reconciler
+void scriba_reconciler_free(scriba_reconciler_t *rec)
+{
+    destroy(rec);
+}
+
+// run reconciliation exchange over file descriptor
+int scriba_reconcileOverFd(scriba_reconciler_t *rec, int fd, int initiator)
+{
+    Vector<uint8_t> msg;
+
+    if (rec == NULL)
+    {
+        return -1;
+    }
+
+    if (initiator)
+    {
+        unsigned long len = 0;
+        void *start = scriba_reconciler_start(rec, &len);
+        int ret = send_message(fd, start, len);
+        scriba_free(start);
+        if (ret != 0)
+        {
+            return -1;
+        }
+    }
+
+    // each side replies to every message until one of them has nothing to reply
+    while (true)
+    {
+        uint8_t header[sizeof (uint32_t)];
+        void *reply = NULL;
+        unsigned long replylen = 0;
+
+        if (read_data(fd, header, sizeof (header)) != 0)
+        {
+            return -1;
+        }
+        uint32_t len = read_le32(header);
+        if (len == 0)
+        {
+            return 0;
+        }
+        // messages larger than 2GB are not supported
+        if (len >= (1UL << 31))
+        {
+            return -1;
+        }
+        msg.resize(len);
+        if ((read_data(fd, msg.data(), len) != 0) ||
+            (scriba_reconciler_process(rec, msg.data(), len, &reply, &replylen) != 0))
+        {
+            return -1;
+        }
+        int ret = send_message(fd, reply, replylen);
+        scriba_free(reply);
+        if (ret != 0)
+        {
+            return -1;
+        }
+        if (reply == NULL)
+        {
+            return 0;
+        }
+    }
+}
+
+// check that buffer holds entries readable without going out of its bounds
+int scriba_verify_entries(const void *buf, unsigned long len)
+{
+    return ((buf != NULL) && verify_entries(buf, (size_t)len)) ? 1 : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+// internal serializer functions implementation
+
+template<typename T, typename O>
+static void serialize_scanned(const T *entity, void *ctx)
+{
+    ScanContext<T, O> *scan_ctx = static_cast<ScanContext<T, O> *>(ctx);
+    scan_ctx->offsets.push_back(scan_ctx->serialize(entity, scan_ctx->fbb, scan_ctx->compact));
+}
+
+template<typename T, typename O>
+static void serialize_entities(const ScribaScanFilter *filter,
+                               int (*scan)(const ScribaScanFilter *,
+                                           void (*)(const T *, void *), void *),
+                               fb::Offset<O> (*serialize)(const T *, fb::FlatBufferBuilder &,
+                                                          CompactTables *),
+                               fb::FlatBufferBuilder &fbb,
+                               Vector<fb::Offset<O>> &offsets,
+                               CompactTables *compact)
+{
+    // entities are fed to the builder right from the database rows,
+    // all matching entities are retrieved at once
+    if (filter != nullptr)
+    {
+        ScanContext<T, O> ctx = { serialize, fbb, offsets, compact };
+        scan(filter, serialize_scanned<T, O>, &ctx);
+    }
+}
+
+static void serialize_filtered(const ScribaScanFilter *company_filter,
+                               const ScribaScanFilter *event_filter,
+                               const ScribaScanFilter *poc_filter,
+                               const ScribaScanFilter *project_filter,
+                               fb::FlatBufferBuilder &fbb,
+                               bool compact)
+{
+    Vector<fb::Offset<Company>> comp_offsets;
+    Vector<fb::Offset<Event>> event_offsets;
+    Vector<fb::Offset<POC>> poc_offsets;
+    Vector<fb::Offset<Project>> project_offsets;
+    CompactTables tables;
+    CompactTables *compact_tables = compact ? &tables : nullptr;
+
+    // serialize each entry and create offset vectors;
+    // all entities are read from the same database snapshot
+    scriba_beginRead();
+    serialize_entities(company_filter, scriba_scanCompanies, serialize_company, fbb, comp_offsets,
+                       compact_tables);
+    serialize_entities(event_filter, scriba_scanEvents, serialize_event, fbb, event_offsets,
+                       compact_tables);
+    serialize_entities(poc_filter, scriba_scanPeople, serialize_poc, fbb, poc_offsets,
+                       compact_tables);
+    serialize_entities(project_filter, scriba_scanProjects, serialize_project, fbb, project_offsets,
+                       compact_tables);
+    scriba_endRead();
+
+    // now we have all the offsets, we can create the root element
+    auto root_offset = create_entries(fbb, comp_offsets, event_offsets, poc_offsets,
+                                      project_offsets, nullptr, compact_tables);
+
+    // finalize the buffer
+    fbb.Finish(root_offset);
+}
+
+static fb::Offset<Entries> create_entries(fb::FlatBufferBuilder &fbb,
+                                          const Vector<fb::Offset<Company>> &companies,
+                                          const Vector<fb::Offset<Event>> &events,
+                                          const Vector<fb::Offset<POC>> &people,
+                                          const Vector<fb::Offset<Project>> &projects,
+                                          const Vector<fb::Offset<Removed>> *removed,
+                                          const CompactTables *compact)
+{
+    auto comp_vector = fbb.CreateVector(companies);
+    auto event_vector = fbb.CreateVector(events);
+    auto poc_vector = fbb.CreateVector(people);
+    auto project_vector = fbb.CreateVector(projects);
+    fb::Offset<fb::Vector<fb::Offset<Removed>>> removed_vector;
+    fb::Offset<fb::Vector<const ID *>> id_vector;
+    // buffers without removal records do not have the vector at all
+    if ((removed != nullptr) && !removed->empty())
+    {
+        removed_vector = fbb.CreateVector(*removed);
+    }
+    if ((compact != nullptr) && !compact->ids.empty())
+    {
+        id_vector = fbb.CreateVectorOfStructs(compact->ids);
+    }
+
+    EntriesBuilder eb(fbb);
+    if (compact != nullptr)
+    {
+        // original vectors are left out, so that readers not aware of compact
+        // buffers find no entities instead of entities without ids
+        eb.add_version(1);
+        eb.add_ids(id_vector);
+        eb.add_compact_companies(comp_vector);
+        eb.add_compact_events(event_vector);
+        eb.add_compact_people(poc_vector);
+        eb.add_compact_projects(project_vector);
+    }
+    else
+    {
+        eb.add_companies(comp_vector);
+        eb.add_events(event_vector);
+        eb.add_people(poc_vector);
+        eb.add_projects(project_vector);
+    }
+    eb.add_removed(removed_vector);
+    return eb.Finish();
+}
+
+static void serialize_removed(const scriba_id_t *id, enum ScribaEntityType type, void *ctx)
+{
+    RemovedContext *removed_ctx = static_cast<RemovedContext *>(ctx);
+    ID removed_id(id->_high, id->_low);
+    int8_t removed_type = EntityType_COMPANY;
+
+    switch (type)
+    {
+    case SCRIBA_ENTITY_COMPANY:
+        removed_type = EntityType_COMPANY;
+        break;
+    case SCRIBA_ENTITY_EVENT:
+        removed_type = EntityType_EVENT;
+        break;
+    case SCRIBA_ENTITY_POC:
+        removed_type = EntityType_POC;
+        break;
+    case SCRIBA_ENTITY_PROJECT:
+        removed_type = EntityType_PROJECT;
+        break;
+    }
+
+    removed_ctx->offsets.push_back(CreateRemoved(removed_ctx->fbb, &removed_id, removed_type));
+}
+
+static bool init_scan_filter(const ScribaSerializeFilter *filter,
+                             ScribaScanFilter *scan_filter,
+                             scriba_id_t **company_ids)
+{
+    // filter without conditions matches all entities
+    memset(scan_filter, 0, sizeof (ScribaScanFilter));
+    *company_ids = NULL;
+    if (filter == NULL)
+    {
+        return true;
+    }
+
+    if (filter->flags & SCRIBA_SERIALIZE_COMPANIES)
+    {
+        *company_ids = scriba_list_to_ids(filter->companies, &(scan_filter->num_company_ids));
+        scan_filter->company_ids = *company_ids;
+        if (*company_ids == NULL)
+        {
+            // empty company list, nothing to export
+            return false;
+        }
+    }
+    if (filter->flags & SCRIBA_SERIALIZE_MOD_SINCE)
+    {
+        scan_filter->use_mod_since = 1;
+        scan_filter->mod_since = filter->mod_since;
+    }
+    return true;
+}
+
+static void serialize_selected(const ScribaSerializeFilter *filter, fb::FlatBufferBuilder &fbb)
+{
+    ScribaScanFilter scan_filter;
+    scriba_id_t *company_ids = NULL;
+
+    bool compact = (filter != NULL) && (filter->flags & SCRIBA_SERIALIZE_COMPACT);
+
+    if (init_scan_filter(filter, &scan_filter, &company_ids))
+    {
+        serialize_filtered(&scan_filter, &scan_filter, &scan_filter, &scan_filter, fbb, compact);
+    }
+    else
+    {
+        serialize_filtered(nullptr, nullptr, nullptr, nullptr, fbb, compact);
+    }
+
+    if (company_ids != NULL)
+    {
+        scriba_free(company_ids);
+    }
+}
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t dict_id(const uint8_t *dict, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h = (h ^ dict[i]) * 16777619u;
+    }
+    return (h != 0) ? h : 1;
+}
+
+static const void *open_buffer(const void *buf, unsigned long buflen,
+                               Vector<uint8_t> &plain)
+{
+    if (!scriba_isCompressed(buf, buflen))
+    {
+        return buf;
+    }
+
+    const uint8_t *header = (const uint8_t *)buf;
+    if (read_le32(header + 4) != compress_dict_id)
+    {
+        return NULL;
+    }
+    plain.resize(read_le32(header + 8));
+    if (scriba_lz_decompress(header + SCRIBA_FRAME_HEADER_SIZE,
+                             buflen - SCRIBA_FRAME_HEADER_SIZE,
+                             compress_dict,
+                             plain.data(), plain.size()) != 0)
+    {
+        return NULL;
+    }
+    return plain.data();
+}
+
+static void *copy_buffer(const fb::FlatBufferBuilder &fbb, unsigned long *buflen)
+{
+    // copy the buffer (the original buffer will die with FlatBufferBuilder object)
+    void *buf = scriba_malloc((size_t)(fbb.GetSize()));
+    memcpy(buf, (const void *)fbb.GetBufferPointer(), fbb.GetSize());
+
+    if (buflen != NULL)
+    {
+        *buflen = fbb.GetSize();
+    }
+    return buf;
+}
+
+static int write_data(int fd, const void *data, size_t len)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    // write() may write the data partially, so keep writing until everything is written
+    while (len > 0)
+    {
+        ssize_t written = write(fd, bytes, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        bytes += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+static int stream_write_fd(const void *data, unsigned long len, void *ctx)
+{
+    return write_data(*(static_cast<int *>(ctx)), data, len);
+}
+
+template<typename T, typename O>
+static int stream_add(scriba_stream_writer_t *writer, const T *entity,
+                      fb::Offset<O> (*serialize)(const T *, fb::FlatBufferBuilder &,
+                                                 CompactTables *),
+                      Vector<fb::Offset<O>> &offsets)
+{
+    if (writer->failed)
+    {
+        return -1;
+    }
+
+    offsets.push_back(serialize(entity, writer->fbb, nullptr));
+    writer->count++;
+    if (writer->count >= writer->chunk_size)
+    {
+        return stream_flush(writer);
+    }
+    return 0;
+}
+
+template<typename T, int (*add)(scriba_stream_writer_t *, const T *)>
+static void stream_scanned(const T *entity, void *ctx)
+{
+    add(static_cast<scriba_stream_writer_t *>(ctx), entity);
+}
+
+static int stream_flush(scriba_stream_writer_t *writer)
+{
+    if (writer->failed)
+    {
+        return -1;
+    }
+    if (writer->count == 0)
+    {
+        return 0;
+    }
+
+    auto root_offset = create_entries(writer->fbb, writer->companies, writer->events,
+                                      writer->people, writer->projects);
+    writer->fbb.Finish(root_offset);
+    // the finished buffer is aligned, so the size prefix is pushed without padding
+    // and the whole chunk is passed to the write function at once
+    writer->fbb.PushElement<fb::uoffset_t>(writer->fbb.GetSize());
+    if (writer->write(writer->fbb.GetBufferPointer(), writer->fbb.GetSize(), writer->ctx) != 0)
+    {
+        writer->failed = true;
+    }
+
+    // the builder keeps its memory, so it is not reallocated for each chunk
+    writer->fbb.Clear();
+    writer->companies.clear();
+    writer->events.clear();
+    writer->people.clear();
+    writer->projects.clear();
+    writer->count = 0;
+    return writer->failed ? -1 : 0;
+}
+
+static int parallel_write(const void *data, unsigned long len, void *ctx)
+{
+    ParallelExport *exp = static_cast<ParallelExport *>(ctx);
+    std::lock_guard<std::mutex> guard(exp->lock);
+
+    if (exp->failed)
+    {
+        return -1;
+    }
+    if (exp->write(data, len, exp->ctx) != 0)
+    {
+        exp->failed = true;
+        return -1;
+    }
+    return 0;
+}
+
+static void serialize_shard(ParallelExport *exp, unsigned int shard)
+{
+    ScribaScanFilter scan_filter = exp->scan_filter;
+
+    scan_filter.num_shards = exp->num_shards;
+    scan_filter.shard = shard;
+
+    // each shard has its own builder, chunks are only serialized by the write function
+    scriba_stream_writer_t *writer = scriba_stream_writer_create(exp->chunk_size,
+                                                                 parallel_write, exp);
+    if (writer == NULL)
+    {
+        std::lock_guard<std::mutex> guard(exp->lock);
+        exp->failed = true;
+        return;
+    }
+
+    scriba_scanCompanies(&scan_filter,
+                         stream_scanned<ScribaCompany, scriba_stream_write_company>,
+                         writer);
+    scriba_scanEvents(&scan_filter,
+                      stream_scanned<ScribaEvent, scriba_stream_write_event>,
+                      writer);
+    scriba_scanPeople(&scan_filter,
+                      stream_scanned<ScribaPoc, scriba_stream_write_poc>,
+                      writer);
+    scriba_scanProjects(&scan_filter,
+                        stream_scanned<ScribaProject, scriba_stream_write_project>,
+                        writer);
+    // the end of stream mark is written once all shards are done
+    stream_flush(writer);
+    destroy(writer);
+}
+
+static void parallel_serialize(ParallelExport *exp, unsigned int shard)
+{
+    if (scriba_attachReader() != 0)
+    {
+        std::lock_guard<std::mutex> guard(exp->lock);
+        exp->failed = true;
+        return;
+    }
+
+    scriba_beginRead();
+    serialize_shard(exp, shard);
+    scriba_endRead();
+    scriba_detachReader();
+}
+
+static bool stream_apply(scriba_stream_reader_t *reader)
+{
+    // root table offset should point inside the chunk
+    fb::uoffset_t root = fb::ReadScalar<fb::uoffset_t>(reader->chunk.data());
+    if (root >= reader->chunk.size())
+    {
+        return false;
+    }
+
+    // each chunk is stored by its own transaction
+    enum ScribaMergeStatus status = deserialize_entries(GetEntries(reader->chunk.data()),
+                                                        reader->strategy, 0);
+    // statistics of the stream cover all chunks applied so far
+    reader->stats.inserted += merge_stats.inserted;
+    reader->stats.updated += merge_stats.updated;
+    reader->stats.skipped += merge_stats.skipped;
+    merge_stats = reader->stats;
+    if (status == SCRIBA_MERGE_FAILED)
+    {
+        return false;
+    }
+    if (status == SCRIBA_MERGE_CONFLICTS)
+    {
+        reader->conflicts = true;
+    }
+    return true;
+}
+
+static bool import_row(const ImportRow &row, ImportContext &ctx)
+{
+    switch (store_row(row, ctx.strategy))
+    {
+    case SCRIBA_UPSERT_INSERTED:
+        ctx.stats.inserted++;
+        break;
+    case SCRIBA_UPSERT_UPDATED:
+        ctx.stats.updated++;
+        break;
+    case SCRIBA_UPSERT_KEPT:
+        ctx.stats.skipped++;
+        break;
+    default:
+        ctx.failed = true;
+        return false;
+    }
+
+    return import_next(ctx);
+}
+
+static bool import_next(ImportContext &ctx)
+{
+    ctx.count++;
+    if ((ctx.batch_size != 0) && (ctx.count == ctx.batch_size))
+    {
+        // store the batch and start the next one
+        if ((scriba_commitWrite() != 0) || (scriba_beginWrite() != 0))
+        {
+            ctx.failed = true;
+        }
+        ctx.count = 0;
+    }
+
+    return !ctx.failed;
+}
+
+template<typename T>
+static void import_entities(const fb::Vector<fb::Offset<T>> *entities,
+                            void (*decode)(const T *, const IdTable *, ImportRow &),
+                            const IdTable *ids, ImportContext &ctx)
+{
+    if (entities == nullptr)
+    {
+        return;
+    }
+
+    for (fb::uoffset_t i = 0; (i < entities->Length()) && !ctx.failed; i++)
+    {
+        ImportRow row;
+        decode(entities->Get(i), ids, row);
+        if (!import_row(row, ctx))
+        {
+            break;
+        }
+    }
+}
+
+static enum ScribaMergeStatus deserialize_entries(const Entries *entries,
+                                                  enum ScribaMergeStrategy strategy,
+                                                  unsigned long batch_size)
+{
+    ImportContext ctx = { strategy, batch_size, 0, { 0, 0, 0 }, false };
+    const IdTable *ids = entries->ids();
+
+    // buffers of newer schema can not be read correctly
+    if (entries->version() > SCRIBA_SCHEMA_VERSION)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+
+    // entries are stored by the write transaction, so that nothing is stored
+    // if any of the entries fails
+    if (scriba_beginWrite() != 0)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+
+    import_entities(entries->companies(), decode_company, ids, ctx);
+    import_entities(entries->compact_companies(), decode_company, ids, ctx);
+    import_entities(entries->events(), decode_event, ids, ctx);
+    import_entities(entries->compact_events(), decode_event, ids, ctx);
+    import_entities(entries->people(), decode_poc, ids, ctx);
+    import_entities(entries->compact_people(), decode_poc, ids, ctx);
+    import_entities(entries->projects(), decode_project, ids, ctx);
+    import_entities(entries->compact_projects(), decode_project, ids, ctx);
+    import_removed(entries->removed(), ctx);
+
+    if (!ctx.failed && (scriba_commitWrite() != 0))
+    {
+        ctx.failed = true;
+    }
+    merge_stats = ctx.stats;
+    if (ctx.failed)
+    {
+        scriba_rollbackWrite();
+        return SCRIBA_MERGE_FAILED;
+    }
+
+    // manual merge is not supported yet, so there are no conflicts
+    return SCRIBA_MERGE_OK;
+}
+
+static void import_removed(const fb::Vector<fb::Offset<Removed>> *removed, ImportContext &ctx)
+{
+    if (removed == nullptr)
+    {
+        return;
+    }
+
+    for (fb::uoffset_t i = 0; (i < removed->Length()) && !ctx.failed; i++)
+    {
+        const Removed *entry = removed->Get(i);
+        scriba_id_t id;
+
+        // local entities are kept unless remote data wins, records without id
+        // can not be applied
+        if ((ctx.strategy != SCRIBA_MERGE_REMOTE_OVERRIDE) || (entry->id() == nullptr))
+        {
+            if (!import_next(ctx))
+            {
+                break;
+            }
+            continue;
+        }
+
+        id._high = (unsigned long long)(entry->id()->high());
+        id._low = (unsigned long long)(entry->id()->low());
+        switch (entry->type())
+        {
+        case EntityType_COMPANY:
+            scriba_removeCompany(id);
+            break;
+        case EntityType_EVENT:
+            scriba_removeEvent(id);
+            break;
+        case EntityType_POC:
+            scriba_removePOC(id);
+            break;
+        case EntityType_PROJECT:
+            scriba_removeProject(id);
+            break;
+        default:
+            break;
+        }
+
+        if (!import_next(ctx))
+        {
+            break;
+        }
+    }
+}
+
+template<typename T>
+static unsigned long entities_length(const fb::Vector<fb::Offset<T>> *entities)
+{
+    return (entities == nullptr) ? 0 : entities->Length();
+}
+
+static unsigned long entries_length(const Entries *entries)
+{
+    return entities_length(entries->companies()) +
+           entities_length(entries->compact_companies()) +
+           entities_length(entries->events()) +
+           entities_length(entries->compact_events()) +
+           entities_length(entries->people()) +
+           entities_length(entries->compact_people()) +
+           entities_length(entries->projects()) +
+           entities_length(entries->compact_projects());
+}
+
+template<typename T>
+static bool decode_from(const fb::Vector<fb::Offset<T>> *entities,
+                        void (*decode)(const T *, const IdTable *, ImportRow &),
+                        const IdTable *ids, unsigned long &index, ImportRow &row)
+{
+    unsigned long num = entities_length(entities);
+    if (index < num)
+    {
+        decode(entities->Get(index), ids, row);
+        return true;
+    }
+    index -= num;
+    return false;
+}
+
+static void decode_entry(const Entries *entries, unsigned long index, ImportRow &row)
+{
+    const IdTable *ids = entries->ids();
+
+    if (decode_from(entries->companies(), decode_company, ids, index, row) ||
+        decode_from(entries->compact_companies(), decode_company, ids, index, row) ||
+        decode_from(entries->events(), decode_event, ids, index, row) ||
+        decode_from(entries->compact_events(), decode_event, ids, index, row) ||
+        decode_from(entries->people(), decode_poc, ids, index, row) ||
+        decode_from(entries->compact_people(), decode_poc, ids, index, row) ||
+        decode_from(entries->projects(), decode_project, ids, index, row))
+    {
+        return;
+    }
+    decode_from(entries->compact_projects(), decode_project, ids, index, row);
+}
+
+static void pipeline_decode(ImportPipeline *pipeline)
+{
+    std::unique_lock<std::mutex> guard(pipeline->lock);
+
+    while (true)
+    {
+        // a batch may be decoded only when its slot has been freed by the writer
+        pipeline->freed.wait(guard, [pipeline] {
+            return pipeline->stop ||
+                   (pipeline->next == pipeline->num_batches) ||
+                   (pipeline->next < pipeline->taken + pipeline->slots.size());
+        });
+        if (pipeline->stop || (pipeline->next == pipeline->num_batches))
+        {
+            break;
+        }
+
+        unsigned long batch = pipeline->next++;
+        guard.unlock();
+
+        unsigned long first = batch * SCRIBA_PIPELINE_BATCH_SIZE;
+        unsigned long last = std::min(first + SCRIBA_PIPELINE_BATCH_SIZE, pipeline->num_entries);
+        Vector<ImportRow> rows(last - first);
+        for (unsigned long i = first; i < last; i++)
+        {
+            decode_entry(pipeline->entries, i, rows[i - first]);
+        }
+
+        guard.lock();
+        unsigned long slot = batch % pipeline->slots.size();
+        pipeline->slots[slot].swap(rows);
+        pipeline->ready[slot] = true;
+        pipeline->decoded.notify_all();
+    }
+}
+
+static enum ScribaMergeStatus pipeline_import(const Entries *entries,
+                                              enum ScribaMergeStrategy strategy,
+                                              unsigned long batch_size,
+                                              unsigned int num_threads)
+{
+    ImportContext ctx = { strategy, batch_size, 0, { 0, 0, 0 }, false };
+    ImportPipeline pipeline;
+    Vector<std::thread> decoders;
+
+    if (entries->version() > SCRIBA_SCHEMA_VERSION)
+    {
+        return SCRIBA_MERGE_FAILED;
+    }
+
+    pipeline.entries = entries;
+    pipeline.num_entries = entries_length(entries);
+    pipeline.num_batches = (pipeline.num_entries + SCRIBA_PIPELINE_BATCH_SIZE - 1) /
+                           SCRIBA_PIPELINE_BATCH_SIZE;
+    pipeline.next = 0;
+    pipeline.taken = 0;
+    pipeline.stop = false;
+
+    if ((num_threads == 0) || (pipeline.num_batches < 2))
+    {
+        // there is nothing to overlap, decode in the calling thread
+        return deserialize_entries(entries, strategy, batch_size);
+    }
+
+    pipeline.slots.resize(num_threads * SCRIBA_PIPELINE_DEPTH);
+    pipeline.ready.resize(pipeline.slots.size(), false);
+
+    for (unsigned int i = 0; i < num_threads; i++)
+    {
+        try
+        {
+            decoders.push_back(std::thread(pipeline_decode, &pipeline));
+        }
+        catch (const std::system_error &)
+        {
+            // continue with the threads that have been started
+            break;
+        }
+    }
+    if (decoders.empty())
+    {
+        return deserialize_entries(entries, strategy, batch_size);
+    }
+
+    // entries are stored by the writer in the order they are found in the buffer,
+    // so the result is the same as of deserialize_entries()
+    if (scriba_beginWrite() != 0)
+    {
+        ctx.failed = true;
+    }
+
+    for (unsigned long batch = 0; (batch < pipeline.num_batches) && !ctx.failed; batch++)
     {
-        for (fb::uoffset_t i = 0; i < events->Length(); i++)
+        Vector<ImportRow> rows;
+        unsigned long slot = batch % pipeline.slots.size();
+
         {
-            bool ret = deserialize_event(events->Get(i), strategy);
-            if (ret == true)
-            {
-                conflicts = true;
-            }
+            std::unique_lock<std::mutex> guard(pipeline.lock);
+            pipeline.decoded.wait(guard, [&pipeline, slot] { return pipeline.ready[slot]; });
+            rows.swap(pipeline.slots[slot]);
+            pipeline.ready[slot] = false;
+            pipeline.taken++;
+            pipeline.freed.notify_all();
         }
-    }
 
-    const fb::Vector<fb::Offset<POC>> *people = entries->people();
-    if (people != nullptr)
-    {
-        for (fb::uoffset_t i = 0; i < people->Length(); i++)
+        for (const ImportRow &row : rows)
         {
-            bool ret = deserialize_poc(people->Get(i), strategy);
-            if (ret == true)
+            if (!import_row(row, ctx))
             {
-                conflicts = true;
+                break;
             }
         }
     }
+    // removal records are few, they are not worth decoding in advance
+    import_removed(entries->removed(), ctx);
 
-    const fb::Vector<fb::Offset<Project>> *projects = entries->projects();
-    if (projects != nullptr)
     {
-        for (fb::uoffset_t i = 0; i < projects->Length(); i++)
-        {
-            bool ret = deserialize_project(projects->Get(i), strategy);
-            if (ret == true)
-            {
-                conflicts = true;
-            }
-        }
+        std::lock_guard<std::mutex> guard(pipeline.lock);
+        pipeline.stop = true;
+        pipeline.freed.notify_all();
+    }
+    for (std::thread &decoder : decoders)
+    {
+        decoder.join();
     }
 
-    return (conflicts == true ? SCRIBA_MERGE_CONFLICTS : SCRIBA_MERGE_OK);
-}
+    if (!ctx.failed && (scriba_commitWrite() != 0))
+    {
+        ctx.failed = true;
+    }
+    merge_stats = ctx.stats;
+    if (ctx.failed)
+    {
+        scriba_rollbackWrite();
+        return SCRIBA_MERGE_FAILED;
+    }
 
-#ifdef __cplusplus
+    // manual merge is not supported yet, so there are no conflicts
+    return SCRIBA_MERGE_OK;
 }
-#endif
 
-// internal serializer functions implementation
-
-static fb::Offset<Company> serialize_company(scriba_id_t id, fb::FlatBufferBuilder &fbb)
+static fb::Offset<Company> serialize_company(const ScribaCompany *company, fb::FlatBufferBuilder &fbb,
+                                             CompactTables *compact)
 {
-    ScribaCompany *company = scriba_getCompany(id);
     fb::Offset<fb::String> company_name;
     fb::Offset<fb::String> company_jur_name;
     fb::Offset<fb::String> company_address;
@@ -191,34 +2198,41 @@ static fb::Offset<Company> serialize_company(scriba_id_t id, fb::FlatBufferBuild
     fb::Offset<fb::String> company_phonenum;
     fb::Offset<fb::String> company_email;
 
-    ID bufID(id._high, id._low);
+    ID bufID(company->id._high, company->id._low);
     if (company->name != NULL)
     {
-        company_name = fbb.CreateString(company->name);
+        company_name = create_string(fbb, compact, company->name);
     }
     if (company->jur_name != NULL)
     {
-        company_jur_name = fbb.CreateString(company->jur_name);
+        company_jur_name = create_string(fbb, compact, company->jur_name);
     }
     if (company->address != NULL)
     {
-        company_address = fbb.CreateString(company->address);
+        company_address = create_string(fbb, compact, company->address);
     }
     if (company->inn != NULL)
     {
-        company_inn = fbb.CreateString(company->inn);
+        company_inn = create_string(fbb, compact, company->inn);
     }
     if (company->phonenum != NULL)
     {
-        company_phonenum = fbb.CreateString(company->phonenum);
+        company_phonenum = create_string(fbb, compact, company->phonenum);
     }
     if (company->email != NULL)
     {
-        company_email = fbb.CreateString(company->email);
+        company_email = create_string(fbb, compact, company->email);
     }
 
     CompanyBuilder cb(fbb);
-    cb.add_id(&bufID);
+    if (compact != nullptr)
+    {
+        cb.add_id_ref(id_ref(compact, company->id));
+    }
+    else
+    {
+        cb.add_id(&bufID);
+    }
     if (company->name != NULL)
     {
         cb.add_name(company_name);
@@ -244,34 +2258,43 @@ static fb::Offset<Company> serialize_company(scriba_id_t id, fb::FlatBufferBuild
         cb.add_email(company_email);
     }
 
-    scriba_freeCompanyData(company);
     return cb.Finish();
 }
 
-static fb::Offset<Event> serialize_event(scriba_id_t id, fb::FlatBufferBuilder &fbb)
+static fb::Offset<Event> serialize_event(const ScribaEvent *event, fb::FlatBufferBuilder &fbb,
+                                         CompactTables *compact)
 {
-    ScribaEvent *event = scriba_getEvent(id);
     fb::Offset<fb::String> event_descr;
     fb::Offset<fb::String> event_outcome;
 
-    ID bufID(id._high, id._low);
+    ID bufID(event->id._high, event->id._low);
     ID companyID(event->company_id._high, event->company_id._low);
     ID projectID(event->project_id._high, event->project_id._low);
     ID pocID(event->poc_id._high, event->poc_id._low);
     if (event->descr != NULL)
     {
-        event_descr = fbb.CreateString(event->descr);
+        event_descr = create_string(fbb, compact, event->descr);
     }
     if (event->outcome != NULL)
     {
-        event_outcome = fbb.CreateString(event->outcome);
+        event_outcome = create_string(fbb, compact, event->outcome);
     }
 
     EventBuilder evb(fbb);
-    evb.add_id(&bufID);
-    evb.add_company_id(&companyID);
-    evb.add_project_id(&projectID);
-    evb.add_poc_id(&pocID);
+    if (compact != nullptr)
+    {
+        evb.add_id_ref(id_ref(compact, event->id));
+        evb.add_company_ref(id_ref(compact, event->company_id));
+        evb.add_project_ref(id_ref(compact, event->project_id));
+        evb.add_poc_ref(id_ref(compact, event->poc_id));
+    }
+    else
+    {
+        evb.add_id(&bufID);
+        evb.add_company_id(&companyID);
+        evb.add_project_id(&projectID);
+        evb.add_poc_id(&pocID);
+    }
     if (event->descr != NULL)
     {
         evb.add_descr(event_descr);
@@ -308,13 +2331,12 @@ static fb::Offset<Event> serialize_event(scriba_id_t id, fb::FlatBufferBuilder &
         break;
     }
 
-    scriba_freeEventData(event);
     return evb.Finish();
 }
 
-static fb::Offset<POC> serialize_poc(scriba_id_t id, fb::FlatBufferBuilder &fbb)
+static fb::Offset<POC> serialize_poc(const ScribaPoc *poc, fb::FlatBufferBuilder &fbb,
+                                     CompactTables *compact)
 {
-    ScribaPoc *poc = scriba_getPOC(id);
     fb::Offset<fb::String> poc_firstname;
     fb::Offset<fb::String> poc_secondname;
     fb::Offset<fb::String> poc_lastname;
@@ -323,41 +2345,49 @@ static fb::Offset<POC> serialize_poc(scriba_id_t id, fb::FlatBufferBuilder &fbb)
     fb::Offset<fb::String> poc_email;
     fb::Offset<fb::String> poc_position;
 
-    ID bufID(id._high, id._low);
+    ID bufID(poc->id._high, poc->id._low);
     ID companyID(poc->company_id._high, poc->company_id._low);
 
     if (poc->firstname != NULL)
     {
-        poc_firstname = fbb.CreateString(poc->firstname);
+        poc_firstname = create_string(fbb, compact, poc->firstname);
     }
     if (poc->secondname != NULL)
     {
-        poc_secondname = fbb.CreateString(poc->secondname);
+        poc_secondname = create_string(fbb, compact, poc->secondname);
     }
     if (poc->lastname != NULL)
     {
-        poc_lastname = fbb.CreateString(poc->lastname);
+        poc_lastname = create_string(fbb, compact, poc->lastname);
     }
     if (poc->mobilenum != NULL)
     {
-        poc_mobilenum = fbb.CreateString(poc->mobilenum);
+        poc_mobilenum = create_string(fbb, compact, poc->mobilenum);
     }
     if (poc->phonenum != NULL)
     {
-        poc_phonenum = fbb.CreateString(poc->phonenum);
+        poc_phonenum = create_string(fbb, compact, poc->phonenum);
     }
     if (poc->email != NULL)
     {
-        poc_email = fbb.CreateString(poc->email);
+        poc_email = create_string(fbb, compact, poc->email);
     }
     if (poc->position != NULL)
     {
-        poc_position = fbb.CreateString(poc->position);
+        poc_position = create_string(fbb, compact, poc->position);
     }
 
     POCBuilder pb(fbb);
-    pb.add_id(&bufID);
-    pb.add_company_id(&companyID);
+    if (compact != nullptr)
+    {
+        pb.add_id_ref(id_ref(compact, poc->id));
+        pb.add_company_ref(id_ref(compact, poc->company_id));
+    }
+    else
+    {
+        pb.add_id(&bufID);
+        pb.add_company_id(&companyID);
+    }
     if (poc->firstname != NULL)
     {
         pb.add_firstname(poc_firstname);
@@ -387,31 +2417,38 @@ static fb::Offset<POC> serialize_poc(scriba_id_t id, fb::FlatBufferBuilder &fbb)
         pb.add_position(poc_position);
     }
 
-    scriba_freePOCData(poc);
     return pb.Finish();
 }
 
-static fb::Offset<Project> serialize_project(scriba_id_t id, fb::FlatBufferBuilder &fbb)
+static fb::Offset<Project> serialize_project(const ScribaProject *project, fb::FlatBufferBuilder &fbb,
+                                             CompactTables *compact)
 {
-    ScribaProject *project = scriba_getProject(id);
     fb::Offset<fb::String> project_title;
     fb::Offset<fb::String> project_descr;
 
-    ID bufID(id._high, id._low);
+    ID bufID(project->id._high, project->id._low);
     ID companyID(project->company_id._high, project->company_id._low);
 
     if (project->title != NULL)
     {
-        project_title = fbb.CreateString(project->title);
+        project_title = create_string(fbb, compact, project->title);
     }
     if (project->descr != NULL)
     {
-        project_descr = fbb.CreateString(project->descr);
+        project_descr = create_string(fbb, compact, project->descr);
     }
 
     ProjectBuilder prjb(fbb);
-    prjb.add_id(&bufID);
-    prjb.add_company_id(&companyID);
+    if (compact != nullptr)
+    {
+        prjb.add_id_ref(id_ref(compact, project->id));
+        prjb.add_company_ref(id_ref(compact, project->company_id));
+    }
+    else
+    {
+        prjb.add_id(&bufID);
+        prjb.add_company_id(&companyID);
+    }
     if (project->title != NULL)
     {
         prjb.add_title(project_title);
@@ -465,16 +2502,136 @@ static fb::Offset<Project> serialize_project(scriba_id_t id, fb::FlatBufferBuild
     prjb.add_start_time(project->start_time);
     prjb.add_mod_time(project->mod_time);
 
-    scriba_freeProjectData(project);
     return prjb.Finish();
 }
 
-static bool deserialize_company(const Company *company, enum ScribaMergeStrategy strategy)
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, CompactTables *compact,
+                                            const char *str)
+{
+    if (compact == nullptr)
+    {
+        return fbb.CreateString(str);
+    }
+
+    size_t len = strlen(str);
+    uint64_t hash = string_hash(str, len);
+    reserve_slot(compact->string_slots, compact->strings.size(),
+                 [compact](uint32_t i) { return compact->string_hashes[i]; });
+    // strings already created are compared right in the builder, it grows
+    // downwards, so the string lives at the same offset from the buffer end
+    uint32_t *slot = find_slot(compact->string_slots, hash, [&](uint32_t i) {
+        const uint8_t *end = fbb.GetBufferPointer() + fbb.GetSize();
+        const fb::String *created = reinterpret_cast<const fb::String *>(end - compact->strings[i].o);
+        return (compact->string_hashes[i] == hash) && (created->Length() == len) &&
+               (memcmp(created->c_str(), str, len) == 0);
+    });
+    if (*slot == 0)
+    {
+        // strings are referred to by offset from the referring table, so a string
+        // created earlier may be shared by any number of tables
+        compact->strings.push_back(fbb.CreateString(str, len));
+        compact->string_hashes.push_back(hash);
+        *slot = (uint32_t)(compact->strings.size());
+    }
+    return compact->strings[*slot - 1];
+}
+
+static uint32_t id_ref(CompactTables *compact, const scriba_id_t &id)
+{
+    if ((id._high == 0) && (id._low == 0))
+    {
+        // 0 is the default value, so the field is not stored at all
+        return 0;
+    }
+
+    reserve_slot(compact->id_slots, compact->ids.size(), [compact](uint32_t i) {
+        return id_hash(compact->ids[i].high(), compact->ids[i].low());
+    });
+    uint32_t *slot = find_slot(compact->id_slots, id_hash(id._high, id._low), [&](uint32_t i) {
+        return (compact->ids[i].high() == id._high) && (compact->ids[i].low() == id._low);
+    });
+    if (*slot == 0)
+    {
+        compact->ids.push_back(ID(id._high, id._low));
+        *slot = (uint32_t)(compact->ids.size());
+    }
+    return *slot;
+}
+
+static uint64_t id_hash(unsigned long long high, unsigned long long low)
+{
+    uint64_t h = (high ^ (low * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+
+static uint64_t string_hash(const char *str, size_t len)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h = (h ^ (uint8_t)str[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+template<typename Equal>
+static uint32_t *find_slot(Vector<uint32_t> &slots, uint64_t hash, Equal equal)
+{
+    size_t mask = slots.size() - 1;
+
+    // linear probing, the table is never more than half full
+    for (size_t i = (size_t)hash & mask; ; i = (i + 1) & mask)
+    {
+        if ((slots[i] == 0) || equal(slots[i] - 1))
+        {
+            return &(slots[i]);
+        }
+    }
+}
+
+template<typename Hash>
+static void reserve_slot(Vector<uint32_t> &slots, size_t num, Hash hash)
+{
+    if ((num + 1) * 2 <= slots.size())
+    {
+        return;
+    }
+
+    Vector<uint32_t> grown(std::max(slots.size() * 2, (size_t)1024), 0);
+    for (size_t i = 0; i < num; i++)
+    {
+        uint32_t *slot = find_slot(grown, hash((uint32_t)i), [](uint32_t) { return false; });
+        *slot = (uint32_t)(i + 1);
+    }
+    slots.swap(grown);
+}
+
+static void decode_id(const ID *id, uint32_t ref, const IdTable *ids, scriba_id_t &decoded)
+{
+    // references outside of the id table are decoded as zero id
+    if ((id == nullptr) && (ref != 0) && (ids != nullptr) && (ref <= ids->Length()))
+    {
+        id = ids->Get(ref - 1);
+    }
+
+    if (id != nullptr)
+    {
+        decoded._high = (unsigned long long)(id->high());
+        decoded._low = (unsigned long long)(id->low());
+    }
+    else
+    {
+        decoded._high = 0;
+        decoded._low = 0;
+    }
+}
+
+static void decode_company(const Company *company, const IdTable *ids, ImportRow &row)
 {
     scriba_id_t company_id;
 
-    company_id._high = (unsigned long long)(company->id()->high());
-    company_id._low = (unsigned long long)(company->id()->low());
+    decode_id(company->id(), company->id_ref(), ids, company_id);
     char *company_name = NULL;
     char *company_jur_name = NULL;
     char *company_address = NULL;
@@ -507,44 +2664,19 @@ static bool deserialize_company(const Company *company, enum ScribaMergeStrategy
         company_email = (char *)(company->email()->c_str());
     }
 
-    ScribaCompany *duplicate = scriba_getCompany(company_id);
-    if (duplicate != NULL)
-    {
-        if (strategy == SCRIBA_MERGE_REMOTE_OVERRIDE)
-        {
-            ScribaCompany updated_company;
-            scriba_id_copy(&(updated_company.id), &company_id);
-            updated_company.name = company_name;
-            updated_company.jur_name = company_jur_name;
-            updated_company.address = company_address;
-            updated_company.inn = company_inn;
-            updated_company.phonenum = company_phonenum;
-            updated_company.email = company_email;
-            scriba_updateCompany(&updated_company);
-        }
-
-        // If merge stragegy is LOCAL_OVERRIDE, we just keep local data.
-        // Manual merge is not supported yet.
-
-        scriba_freeCompanyData(duplicate);
-        duplicate = NULL;
-    }
-    else
-    {
-        // no such company in the local database, add new one
-        scriba_addCompanyWithID(company_id,
-                                company_name,
-                                company_jur_name,
-                                company_address,
-                                company_inn,
-                                company_phonenum,
-                                company_email);
-    }
-
-    return false;
+    row.type = ImportRow::COMPANY;
+    ScribaCompany &remote_company = row.company;
+    memset(&remote_company, 0, sizeof (remote_company));
+    scriba_id_copy(&(remote_company.id), &company_id);
+    remote_company.name = company_name;
+    remote_company.jur_name = company_jur_name;
+    remote_company.address = company_address;
+    remote_company.inn = company_inn;
+    remote_company.phonenum = company_phonenum;
+    remote_company.email = company_email;
 }
 
-static bool deserialize_event(const Event *event, enum ScribaMergeStrategy strategy)
+static void decode_event(const Event *event, const IdTable *ids, ImportRow &row)
 {
     scriba_id_t event_id;
     scriba_id_t company_id;
@@ -555,14 +2687,10 @@ static bool deserialize_event(const Event *event, enum ScribaMergeStrategy strat
     char *event_descr = NULL;
     char *event_outcome = NULL;
 
-    event_id._high = (unsigned long long)(event->id()->high());
-    event_id._low = (unsigned long long)(event->id()->low());
-    company_id._high = (unsigned long long)(event->company_id()->high());
-    company_id._low = (unsigned long long)(event->company_id()->low());
-    poc_id._high = (unsigned long long)(event->poc_id()->high());
-    poc_id._low = (unsigned long long)(event->poc_id()->low());
-    project_id._high = (unsigned long long)(event->project_id()->high());
-    project_id._low = (unsigned long long)(event->project_id()->low());
+    decode_id(event->id(), event->id_ref(), ids, event_id);
+    decode_id(event->company_id(), event->company_ref(), ids, company_id);
+    decode_id(event->poc_id(), event->poc_ref(), ids, poc_id);
+    decode_id(event->project_id(), event->project_ref(), ids, project_id);
     switch (event->state())
     {
     case EventState_COMPLETED:
@@ -595,48 +2723,21 @@ static bool deserialize_event(const Event *event, enum ScribaMergeStrategy strat
         event_outcome = (char *)(event->outcome()->c_str());
     }
 
-    ScribaEvent *duplicate = scriba_getEvent(event_id);
-    if (duplicate != NULL)
-    {
-        if (strategy == SCRIBA_MERGE_REMOTE_OVERRIDE)
-        {
-            ScribaEvent updatedEvent;
-
-            scriba_id_copy(&(updatedEvent.id), &event_id);
-            updatedEvent.descr = event_descr;
-            scriba_id_copy(&(updatedEvent.company_id), &company_id);
-            scriba_id_copy(&(updatedEvent.poc_id), &poc_id);
-            scriba_id_copy(&(updatedEvent.project_id), &project_id);
-            updatedEvent.type = event_type;
-            updatedEvent.outcome = event_outcome;
-            updatedEvent.timestamp = (scriba_time_t)(event->timestamp());
-            updatedEvent.state = event_state;
-            scriba_updateEvent(&updatedEvent);
-        }
-
-        // If merge stragegy is LOCAL_OVERRIDE, we just keep local data.
-        // Manual merge is not supported yet.
-        scriba_freeEventData(duplicate);
-        duplicate = NULL;
-    }
-    else
-    {
-        // no such event, add it
-        scriba_addEventWithID(event_id,
-                              event_descr,
-                              company_id,
-                              poc_id,
-                              project_id,
-                              event_type,
-                              event_outcome,
-                              (scriba_time_t)(event->timestamp()),
-                              event_state);
-    }
-
-    return false;
+    row.type = ImportRow::EVENT;
+    ScribaEvent &remote_event = row.event;
+    memset(&remote_event, 0, sizeof (remote_event));
+    scriba_id_copy(&(remote_event.id), &event_id);
+    remote_event.descr = event_descr;
+    scriba_id_copy(&(remote_event.company_id), &company_id);
+    scriba_id_copy(&(remote_event.poc_id), &poc_id);
+    scriba_id_copy(&(remote_event.project_id), &project_id);
+    remote_event.type = event_type;
+    remote_event.outcome = event_outcome;
+    remote_event.timestamp = (scriba_time_t)(event->timestamp());
+    remote_event.state = event_state;
 }
 
-static bool deserialize_poc(const POC *poc, enum ScribaMergeStrategy strategy)
+static void decode_poc(const POC *poc, const IdTable *ids, ImportRow &row)
 {
     scriba_id_t poc_id;
     scriba_id_t company_id;
@@ -648,10 +2749,8 @@ static bool deserialize_poc(const POC *poc, enum ScribaMergeStrategy strategy)
     char *poc_email = NULL;
     char *poc_position = NULL;
 
-    poc_id._high = (unsigned long long)(poc->id()->high());
-    poc_id._low = (unsigned long long)(poc->id()->low());
-    company_id._high = (unsigned long long)(poc->company_id()->high());
-    company_id._low = (unsigned long long)(poc->company_id()->low());
+    decode_id(poc->id(), poc->id_ref(), ids, poc_id);
+    decode_id(poc->company_id(), poc->company_ref(), ids, company_id);
 
     if (poc->firstname() != NULL)
     {
@@ -682,49 +2781,21 @@ static bool deserialize_poc(const POC *poc, enum ScribaMergeStrategy strategy)
         poc_position = (char *)(poc->position()->c_str());
     }
 
-    // do we have this POC locally?
-    ScribaPoc *duplicate = scriba_getPOC(poc_id);
-    if (duplicate != NULL)
-    {
-        if (strategy == SCRIBA_MERGE_REMOTE_OVERRIDE)
-        {
-            ScribaPoc updated_poc;
-
-            scriba_id_copy(&(updated_poc.id), &poc_id);
-            updated_poc.firstname = poc_firstname;
-            updated_poc.secondname = poc_secondname;
-            updated_poc.lastname = poc_lastname;
-            updated_poc.mobilenum = poc_mobilenum;
-            updated_poc.phonenum = poc_phonenum;
-            updated_poc.email = poc_email;
-            updated_poc.position = poc_position;
-            scriba_id_copy(&(updated_poc.company_id), &company_id);
-            scriba_updatePOC(&updated_poc);
-        }
-
-        // If merge stragegy is LOCAL_OVERRIDE, we just keep local data.
-        // Manual merge is not supported yet.
-        scriba_freePOCData(duplicate);
-        duplicate = NULL;
-    }
-    else
-    {
-        // we don't have this POC locally, add it
-        scriba_addPOCWithID(poc_id,
-                            poc_firstname,
-                            poc_secondname,
-                            poc_lastname,
-                            poc_mobilenum,
-                            poc_phonenum,
-                            poc_email,
-                            poc_position,
-                            company_id);
-    }
-
-    return false;
+    row.type = ImportRow::POC;
+    ScribaPoc &remote_poc = row.poc;
+    memset(&remote_poc, 0, sizeof (remote_poc));
+    scriba_id_copy(&(remote_poc.id), &poc_id);
+    remote_poc.firstname = poc_firstname;
+    remote_poc.secondname = poc_secondname;
+    remote_poc.lastname = poc_lastname;
+    remote_poc.mobilenum = poc_mobilenum;
+    remote_poc.phonenum = poc_phonenum;
+    remote_poc.email = poc_email;
+    remote_poc.position = poc_position;
+    scriba_id_copy(&(remote_poc.company_id), &company_id);
 }
 
-static bool deserialize_project(const Project *project, enum ScribaMergeStrategy strategy)
+static void decode_project(const Project *project, const IdTable *ids, ImportRow &row)
 {
     scriba_id_t project_id;
     scriba_id_t company_id;
@@ -733,10 +2804,8 @@ static bool deserialize_project(const Project *project, enum ScribaMergeStrategy
     char *project_descr = NULL;
     enum ScribaCurrency project_currency = SCRIBA_CURRENCY_RUB;
 
-    project_id._high = project->id()->high();
-    project_id._low = project->id()->low();
-    company_id._high = project->company_id()->high();
-    company_id._low = project->company_id()->low();
+    decode_id(project->id(), project->id_ref(), ids, project_id);
+    decode_id(project->company_id(), project->company_ref(), ids, company_id);
     switch (project->state())
     {
     case ProjectState_CLIENT_INFORMED:
@@ -785,51 +2854,395 @@ static bool deserialize_project(const Project *project, enum ScribaMergeStrategy
         project_descr = (char *)(project->descr()->c_str());
     }
 
-    // do we have such project?
-    ScribaProject *duplicate = scriba_getProject(project_id);
-    if (duplicate != NULL)
+    row.type = ImportRow::PROJECT;
+    ScribaProject &remote_project = row.project;
+    memset(&remote_project, 0, sizeof (remote_project));
+    scriba_id_copy(&(remote_project.id), &project_id);
+    remote_project.title = project_title;
+    remote_project.descr = project_descr;
+    scriba_id_copy(&(remote_project.company_id), &company_id);
+    remote_project.state = project_state;
+    remote_project.currency = project_currency;
+    remote_project.cost = project->cost();
+    remote_project.start_time = static_cast<scriba_time_t>(project->start_time());
+    remote_project.mod_time = static_cast<scriba_time_t>(project->mod_time());
+}
+
+static int store_row(const ImportRow &row, enum ScribaMergeStrategy strategy)
+{
+    // If merge stragegy is LOCAL_OVERRIDE, existing local data is kept.
+    // Manual merge is not supported yet.
+    int overwrite = (strategy == SCRIBA_MERGE_REMOTE_OVERRIDE) ? 1 : 0;
+
+    switch (row.type)
+    {
+    case ImportRow::COMPANY:
+        return scriba_upsertCompany(&(row.company), overwrite);
+    case ImportRow::EVENT:
+        return scriba_upsertEvent(&(row.event), overwrite);
+    case ImportRow::POC:
+        return scriba_upsertPOC(&(row.poc), overwrite);
+    case ImportRow::PROJECT:
+        return scriba_upsertProject(&(row.project), overwrite);
+    }
+
+    return -1;
+}
+
+static uint64_t company_hash(const ScribaCompany *company)
+{
+    uint64_t hash = hash_id(14695981039346656037ULL, company->id);
+
+    hash = hash_text(hash, company->name);
+    hash = hash_text(hash, company->jur_name);
+    hash = hash_text(hash, company->address);
+    hash = hash_text(hash, company->inn);
+    hash = hash_text(hash, company->phonenum);
+    return hash_text(hash, company->email);
+}
+
+static uint64_t event_hash(const ScribaEvent *event)
+{
+    uint64_t hash = hash_id(14695981039346656037ULL, event->id);
+
+    hash = hash_text(hash, event->descr);
+    hash = hash_id(hash, event->company_id);
+    hash = hash_id(hash, event->poc_id);
+    hash = hash_id(hash, event->project_id);
+    hash = hash_int(hash, (uint64_t)(event->type));
+    hash = hash_text(hash, event->outcome);
+    hash = hash_int(hash, (uint64_t)(event->timestamp));
+    return hash_int(hash, (uint64_t)(event->state));
+}
+
+static uint64_t poc_hash(const ScribaPoc *poc)
+{
+    uint64_t hash = hash_id(14695981039346656037ULL, poc->id);
+
+    hash = hash_text(hash, poc->firstname);
+    hash = hash_text(hash, poc->secondname);
+    hash = hash_text(hash, poc->lastname);
+    hash = hash_text(hash, poc->mobilenum);
+    hash = hash_text(hash, poc->phonenum);
+    hash = hash_text(hash, poc->email);
+    hash = hash_text(hash, poc->position);
+    return hash_id(hash, poc->company_id);
+}
+
+static uint64_t project_hash(const ScribaProject *project)
+{
+    uint64_t hash = hash_id(14695981039346656037ULL, project->id);
+
+    hash = hash_text(hash, project->title);
+    hash = hash_text(hash, project->descr);
+    hash = hash_id(hash, project->company_id);
+    hash = hash_int(hash, (uint64_t)(project->state));
+    hash = hash_int(hash, (uint64_t)(project->currency));
+    hash = hash_int(hash, (uint64_t)(project->cost));
+    hash = hash_int(hash, (uint64_t)(project->start_time));
+    return hash_int(hash, (uint64_t)(project->mod_time));
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    // FNV-1a
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_text(uint64_t hash, const char *text)
+{
+    // serialized buffers do not tell NULL string from empty one;
+    // length keeps field boundaries
+    size_t len = (text != NULL) ? strlen(text) : 0;
+
+    hash = hash_int(hash, (uint64_t)len);
+    return hash_bytes(hash, text, len);
+}
+
+static uint64_t hash_int(uint64_t hash, uint64_t num)
+{
+    uint8_t bytes[sizeof (num)];
+
+    // the same hash on any byte order
+    for (size_t i = 0; i < sizeof (num); i++)
+    {
+        bytes[i] = (uint8_t)(num >> (i * 8));
+    }
+    return hash_bytes(hash, bytes, sizeof (bytes));
+}
+
+static uint64_t hash_id(uint64_t hash, const scriba_id_t &id)
+{
+    hash = hash_int(hash, (uint64_t)(id._high));
+    return hash_int(hash, (uint64_t)(id._low));
+}
+
+template<typename T, uint64_t (*hash)(const T *), int type>
+static void reconcile_scanned(const T *entity, void *ctx)
+{
+    scriba_reconciler_t *rec = static_cast<scriba_reconciler_t *>(ctx);
+    uint64_t h = hash(entity);
+
+    // range hashes are sums of entity hashes, so FNV hash is mixed to spread
+    // its bits evenly
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    ReconcileItem item = { entity->id, h };
+    rec->items[type].push_back(item);
+}
+
+static bool range_valid(const RangeHash *range)
+{
+    if ((range == nullptr) || (range->type() < 0) || (range->type() > EntityType_PROJECT) ||
+        (range->depth() > SCRIBA_RECONCILE_MAX_DEPTH))
+    {
+        return false;
+    }
+    unsigned int bits = range->depth() * SCRIBA_RECONCILE_FANOUT_BITS;
+    return (bits == 64) || ((range->prefix() >> bits) == 0);
+}
+
+static void range_bounds(const scriba_reconciler_t *rec, int type, unsigned int depth,
+                         uint64_t prefix, size_t &first, size_t &last)
+{
+    const Vector<ReconcileItem> &items = rec->items[type];
+
+    if (depth == 0)
+    {
+        first = 0;
+        last = items.size();
+        return;
+    }
+
+    // the range holds high id parts from low to high inclusive
+    unsigned int shift = 64 - depth * SCRIBA_RECONCILE_FANOUT_BITS;
+    unsigned long long low = (unsigned long long)prefix << shift;
+    unsigned long long high = (shift == 0) ? low : (low | ((1ULL << shift) - 1));
+    first = (size_t)(std::lower_bound(items.begin(), items.end(), low,
+                                      [](const ReconcileItem &item, unsigned long long value)
+                                      { return item.id._high < value; }) - items.begin());
+    last = (size_t)(std::upper_bound(items.begin(), items.end(), high,
+                                     [](unsigned long long value, const ReconcileItem &item)
+                                     { return value < item.id._high; }) - items.begin());
+}
+
+static RangeHash range_hash(const scriba_reconciler_t *rec, int type, unsigned int depth,
+                            uint64_t prefix)
+{
+    size_t first = 0;
+    size_t last = 0;
+
+    range_bounds(rec, type, depth, prefix, first, last);
+    return RangeHash(prefix, rec->sums[type][last] - rec->sums[type][first],
+                     (uint32_t)(last - first), (int8_t)type, (uint8_t)depth);
+}
+
+static bool reconcile_range(scriba_reconciler_t *rec, const RangeHash *remote,
+                            ReconcileReply &reply)
+{
+    size_t first = 0;
+    size_t last = 0;
+
+    if (!range_valid(remote))
+    {
+        return false;
+    }
+
+    int type = remote->type();
+    range_bounds(rec, type, remote->depth(), remote->prefix(), first, last);
+    uint64_t hash = rec->sums[type][last] - rec->sums[type][first];
+    if ((hash == remote->hash()) && ((last - first) == remote->count()))
+    {
+        return true;
+    }
+
+    if (remote->count() == 0)
+    {
+        // the peer has none of local items
+        for (size_t i = first; i < last; i++)
+        {
+            mark_differs(rec, type, i);
+        }
+    }
+    else if (((last - first) <= SCRIBA_RECONCILE_LEAF_SIZE) ||
+             (remote->depth() == SCRIBA_RECONCILE_MAX_DEPTH))
     {
-        if (strategy == SCRIBA_MERGE_REMOTE_OVERRIDE)
+        reply_items(rec, *remote, reply);
+    }
+    else
+    {
+        unsigned int depth = remote->depth() + 1;
+        for (uint64_t i = 0; i < (1U << SCRIBA_RECONCILE_FANOUT_BITS); i++)
         {
-            ScribaProject updated_project;
+            uint64_t prefix = (remote->prefix() << SCRIBA_RECONCILE_FANOUT_BITS) | i;
+            reply.ranges.push_back(range_hash(rec, type, depth, prefix));
+        }
+    }
+    return true;
+}
+
+static bool reconcile_items(scriba_reconciler_t *rec, const RangeItems *remote,
+                            ReconcileReply &reply)
+{
+    Vector<ReconcileItem> remote_items;
+    size_t first = 0;
+    size_t last = 0;
 
-            scriba_id_copy(&(updated_project.id), &project_id);
-            updated_project.title = project_title;
-            updated_project.descr = project_descr;
-            scriba_id_copy(&(updated_project.company_id), &company_id);
-            updated_project.state = project_state;
-            updated_project.currency = project_currency;
-            updated_project.cost = project->cost();
-            updated_project.start_time = static_cast<scriba_time_t>(project->start_time());
-            updated_project.mod_time = static_cast<scriba_time_t>(project->mod_time());
+    if (!range_valid(remote->range()))
+    {
+        return false;
+    }
 
-            scriba_updateProject(&updated_project);
+    int type = remote->range()->type();
+    if (remote->items() != nullptr)
+    {
+        for (fb::uoffset_t i = 0; i < remote->items()->Length(); i++)
+        {
+            const ItemHash *item = remote->items()->Get(i);
+            ReconcileItem remote_item = { { item->id().high(), item->id().low() }, item->hash() };
+            remote_items.push_back(remote_item);
         }
+    }
+    std::sort(remote_items.begin(), remote_items.end(), item_less);
+
+    // both lists are sorted by id, so they are merged in one pass
+    const Vector<ReconcileItem> &items = rec->items[type];
+    range_bounds(rec, type, remote->range()->depth(), remote->range()->prefix(), first, last);
+    size_t i = first;
+    size_t j = 0;
+    while ((i < last) || (j < remote_items.size()))
+    {
+        bool local_only = (j == remote_items.size()) ||
+                          ((i < last) && item_less(items[i], remote_items[j]));
+        bool remote_only = !local_only &&
+                           ((i == last) || item_less(remote_items[j], items[i]));
 
-        // If merge stragegy is LOCAL_OVERRIDE, we just keep local data.
-        // Manual merge is not supported yet.
-        scriba_freeProjectData(duplicate);
-        duplicate = NULL;
+        if (local_only)
+        {
+            mark_differs(rec, type, i++);
+            continue;
+        }
+        if (remote_only || (items[i].hash != remote_items[j].hash))
+        {
+            const scriba_id_t &id = remote_items[j].id;
+            reply.wanted.push_back(EntityRef(ID(id._high, id._low), (int8_t)type));
+        }
+        if (!remote_only)
+        {
+            if (items[i].hash != remote_items[j].hash)
+            {
+                mark_differs(rec, type, i);
+            }
+            i++;
+        }
+        j++;
     }
-    else
+    return true;
+}
+
+static void reply_items(const scriba_reconciler_t *rec, const RangeHash &range,
+                        ReconcileReply &reply)
+{
+    Vector<ItemHash> item_hashes;
+    size_t first = 0;
+    size_t last = 0;
+
+    range_bounds(rec, range.type(), range.depth(), range.prefix(), first, last);
+    for (size_t i = first; i < last; i++)
     {
-        // we don't have this project locally, add it
-        scriba_addProjectWithID(project_id,
-                                project_title,
-                                project_descr,
-                                company_id,
-                                project_state,
-                                project_currency,
-                                project->cost(),
-                                static_cast<scriba_time_t>(project->start_time()));
-        // write mod_time
-        ScribaProject *newProject = scriba_getProject(project_id);
-        newProject->mod_time = static_cast<scriba_time_t>(project->mod_time());
-        scriba_updateProject(newProject);
-        scriba_freeProjectData(newProject);
+        const ReconcileItem &item = rec->items[range.type()][i];
+        item_hashes.push_back(ItemHash(ID(item.id._high, item.id._low), item.hash));
     }
 
-    return false;
+    // the range tells the peer which of its items should be compared with the list
+    RangeHash local = range_hash(rec, range.type(), range.depth(), range.prefix());
+    auto item_vector = reply.fbb.CreateVectorOfStructs(item_hashes);
+    reply.items.push_back(CreateRangeItems(reply.fbb, &local, item_vector));
+}
+
+static void mark_differs(scriba_reconciler_t *rec, int type, size_t index)
+{
+    if (!rec->differs[type][index])
+    {
+        rec->differs[type][index] = true;
+        rec->num_differs++;
+    }
+}
+
+static bool item_less(const ReconcileItem &a, const ReconcileItem &b)
+{
+    return (a.id._high < b.id._high) || ((a.id._high == b.id._high) && (a.id._low < b.id._low));
+}
+
+static int send_message(int fd, const void *data, unsigned long len)
+{
+    uint8_t header[sizeof (uint32_t)];
+
+    write_le32(header, (data != NULL) ? (uint32_t)len : 0);
+    if (write_data(fd, header, sizeof (header)) != 0)
+    {
+        return -1;
+    }
+    return (data != NULL) ? write_data(fd, data, len) : 0;
+}
+
+static int read_data(int fd, void *data, size_t len)
+{
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+
+    while (len > 0)
+    {
+        ssize_t n = read(fd, bytes, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            return -1;
+        }
+        bytes += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// each table takes at least its vtable offset, so that a valid buffer can't
+// hold more tables than that; the limit keeps verification of offsets pointing
+// to the same table many times linear in buffer size
+static bool verify_entries(const void *buf, size_t len)
+{
+    fb::Verifier verifier(static_cast<const uint8_t *>(buf), len, 64,
+                          len / sizeof (fb::soffset_t));
+    return VerifyEntriesBuffer(verifier);
+}
+
+static bool verify_summary(const void *buf, size_t len)
+{
+    fb::Verifier verifier(static_cast<const uint8_t *>(buf), len, 64,
+                          len / sizeof (fb::soffset_t));
+    return VerifySummaryBuffer(verifier);
+}
+
+static void finish_summary(fb::FlatBufferBuilder &fbb, fb::Offset<Summary> root)
+{
+    // FlatBuffers 1.0 does not raise buffer alignment for vectors of structs,
+    // message structs are 8-byte aligned
+    fbb.Align(sizeof (uint64_t));
+    fbb.Finish(root);
 }
 
 } // namespace scriba
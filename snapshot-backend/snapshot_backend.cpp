@@ -0,0 +1,1841 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "snapshot_backend.h"
+#include "scriba_generated.h"
+#include "company.h"
+#include "event.h"
+#include "poc.h"
+#include "project.h"
+#include "stl_allocator.h"
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// file identifier of snapshot buffers
+#define SCRIBA_SNAPSHOT_IDENTIFIER "SCSN"
+
+// maximum size of snapshot file, FlatBuffers offsets are limited to 2GB
+#define SCRIBA_SNAPSHOT_MAX_SIZE 0x7FFFFFFFUL
+
+namespace scriba
+{
+
+namespace fb = flatbuffers;
+
+typedef fb::Vector<const ID *> IdVector;
+typedef fb::Vector<const IndexEntry *> Index;
+
+// mapped snapshot file
+struct SnapshotData
+{
+    void *map;
+    size_t map_len;
+    const Snapshot *root;
+};
+
+// entity added to the snapshot being exported
+struct SnapshotItem
+{
+    scriba_id_t id;
+    fb::uoffset_t offset;       // offset of the entity table
+    scriba_id_t company_id;
+    scriba_id_t poc_id;         // events only
+    scriba_id_t project_id;     // events only
+    int state;                  // projects and events only
+    scriba_time_t time;         // events only
+};
+
+// snapshot being exported
+struct SnapshotExport
+{
+    explicit SnapshotExport(fb::FlatBufferBuilder &builder) : fbb(builder) {}
+
+    fb::FlatBufferBuilder &fbb;
+    Vector<SnapshotItem> items[4];     // indexed by ScribaEntityType
+};
+
+static SnapshotData *data = NULL;
+
+static int parse_param_list(struct ScribaDBParamList *pl, const char **path);
+// map snapshot file and check its header; returns 0 on success
+static int map_snapshot(SnapshotData *snapshot, const char *path);
+static void unmap_snapshot(SnapshotData *snapshot);
+
+// compare stored id with the given one like memcmp() does
+static int id_cmp(const ID *stored, const scriba_id_t &id);
+// position of id in sorted id vector, -1 if not found
+static long find_id(const IdVector *ids, const scriba_id_t &id);
+// range of index entries with the given key
+static void index_range(const Index *index, const scriba_id_t &key,
+                        fb::uoffset_t &begin, fb::uoffset_t &end);
+static scriba_id_t to_id(const ID *id);
+static scriba_id_t state_key(int state);
+static const char *to_str(const fb::String *str);
+// case-insensitive substring search the way LIKE '%pattern%' does it
+static bool text_contains(const fb::String *text, const char *pattern);
+
+// list items of the entities, text is the same as the SQLite backend returns
+static void list_company(scriba_list_t *list, const Company *company);
+static void list_poc(scriba_list_t *list, const POC *poc);
+static void list_project(scriba_list_t *list, const Project *project);
+static void list_event(scriba_list_t *list, const Event *event);
+// add entities of the index range to the list
+template<typename T>
+static void list_range(scriba_list_t *list, const fb::Vector<fb::Offset<T>> *entities,
+                       const Index *index, const scriba_id_t &key,
+                       void (*add)(scriba_list_t *, const T *));
+// add events of the index range to the list, upcoming events go first,
+// both upcoming and past events are ordered by distance from the current time;
+// if descr is not NULL, only events whose description contains it are added
+static void list_events(scriba_list_t *list, const Index *index, const scriba_id_t &key,
+                        const char *descr);
+
+// create entity data structures out of the snapshot tables
+static struct ScribaCompany *company_data(const Company *company);
+static struct ScribaPoc *poc_data(const POC *poc);
+static struct ScribaProject *project_data(const Project *project);
+static struct ScribaEvent *event_data(const Event *event);
+
+template<typename T, typename S>
+static S *get_entity(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                     const scriba_id_t &id, S *(*create)(const T *));
+template<typename T, typename S>
+static size_t get_entities(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                           const scriba_id_t *req, size_t n, S **result,
+                           S *(*create)(const T *));
+
+// fill entity data structure passed to scan functions, strings point
+// to the mapped snapshot
+static void fill_scanned(const Company *company, ScribaCompany &scanned);
+static void fill_scanned(const POC *poc, ScribaPoc &scanned);
+static void fill_scanned(const Project *project, ScribaProject &scanned);
+static void fill_scanned(const Event *event, ScribaEvent &scanned);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaCompany &company);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaPoc &poc);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaProject &project);
+static bool scan_match(const ScribaScanFilter *filter, const ScribaEvent &event);
+template<typename T, typename S>
+static int scan_entities(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                         const ScribaScanFilter *filter, void (*func)(const S *, void *),
+                         void *ctx);
+template<typename T, typename S>
+static void read_entities(const fb::Vector<fb::Offset<T>> *entities,
+                          void (*func)(const S *, void *), void *ctx);
+
+// company interface functions
+static struct ScribaCompany *getCompany(scriba_id_t id);
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies);
+static scriba_list_t *getAllCompanies();
+static scriba_list_t *getCompaniesByName(const char *name);
+static scriba_list_t *getCompaniesByJurName(const char *juridicial_name);
+static scriba_list_t *getCompaniesByAddress(const char *address);
+static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
+                       const char *address, const char *inn, const char *phonenum,
+                       const char *email);
+static void updateCompany(const struct ScribaCompany *company);
+static void removeCompany(scriba_id_t id);
+static int upsertCompany(const struct ScribaCompany *company, int overwrite);
+
+// POC interface functions
+static struct ScribaPoc *getPOC(scriba_id_t id);
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people);
+static scriba_list_t *getAllPeople();
+static scriba_list_t *getPOCByName(const char *name);
+static scriba_list_t *getPOCByCompany(scriba_id_t id);
+static scriba_list_t *getPOCByPosition(const char *position);
+static scriba_list_t *getPOCByPhoneNum(const char *phonenum);
+static scriba_list_t *getPOCByEmail(const char *email);
+static void addPOC(scriba_id_t id, const char *firstname, const char *secondname,
+                   const char *lastname, const char *mobilenum, const char *phonenum,
+                   const char *email, const char *position, scriba_id_t company_id);
+static void updatePOC(const struct ScribaPoc *poc);
+static void removePOC(scriba_id_t id);
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite);
+
+// project interface functions
+static struct ScribaProject *getProject(scriba_id_t id);
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects);
+static scriba_list_t *getAllProjects();
+static scriba_list_t *getProjectsByTitle(const char *title);
+static scriba_list_t *getProjectsByCompany(scriba_id_t id);
+static scriba_list_t *getProjectsByState(enum ScribaProjectState state);
+static scriba_list_t *getProjectsByTime(scriba_time_t start_time, enum ScribaTimeComp start_comp,
+                                        scriba_time_t mod_time, enum ScribaTimeComp mod_comp);
+static scriba_list_t *getProjectsByStateTime(enum ScribaProjectState state,
+                                             scriba_time_t start_time,
+                                             enum ScribaTimeComp start_comp,
+                                             scriba_time_t mod_time,
+                                             enum ScribaTimeComp mod_comp);
+static void addProject(scriba_id_t id, const char *title, const char *descr,
+                       scriba_id_t company_id, enum ScribaProjectState state,
+                       enum ScribaCurrency currency, long long cost, scriba_time_t start_time);
+static void updateProject(struct ScribaProject *project);
+static void removeProject(scriba_id_t id);
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time);
+static long updateProjects(const struct ScribaProjectFilter *filter,
+                           const struct ScribaProjectUpdate *update,
+                           scriba_time_t mod_time);
+static long removeProjects(const struct ScribaProjectFilter *filter);
+// check whether time matches time condition
+static bool time_match(scriba_time_t time, scriba_time_t cond, enum ScribaTimeComp comp);
+
+// event interface functions
+static struct ScribaEvent *getEvent(scriba_id_t id);
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events);
+static scriba_list_t *getAllEvents();
+static scriba_list_t *getEventsByDescr(const char *descr);
+static scriba_list_t *getEventsByCompany(scriba_id_t id);
+static scriba_list_t *getEventsByPOC(scriba_id_t id);
+static scriba_list_t *getEventsByProject(scriba_id_t id);
+static scriba_list_t *getEventsByState(enum ScribaEventState state);
+static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id, scriba_id_t poc_id,
+                     scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
+                     scriba_time_t timestamp, enum ScribaEventState state);
+static void updateEvent(const struct ScribaEvent *event);
+static void removeEvent(scriba_id_t id);
+static int upsertEvent(const struct ScribaEvent *event, int overwrite);
+static long updateEvents(const struct ScribaEventFilter *filter,
+                         const struct ScribaEventUpdate *update);
+static long removeEvents(const struct ScribaEventFilter *filter);
+
+// scan interface functions
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx);
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx);
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx);
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx);
+
+// snapshot is immutable, so any thread may read it at any time
+static int beginWrite();
+static int attachReader();
+static void detachReader();
+
+// snapshot export helpers
+// build snapshot of the local database in the given builder; returns 0 on success
+static int build_snapshot(fb::FlatBufferBuilder &fbb);
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, const char *str);
+static void export_company(const ScribaCompany *company, void *ctx);
+static void export_poc(const ScribaPoc *poc, void *ctx);
+static void export_project(const ScribaProject *project, void *ctx);
+static void export_event(const ScribaEvent *event, void *ctx);
+static bool item_less(const SnapshotItem &a, const SnapshotItem &b);
+static bool index_less(const IndexEntry &a, const IndexEntry &b);
+// sort entities of the given type by id, create their vector and id vector
+template<typename T>
+static fb::Offset<fb::Vector<fb::Offset<T>>> export_entities(SnapshotExport &builder,
+                                                            enum ScribaEntityType type,
+                                                            fb::Offset<IdVector> &ids);
+// create index of entities of the given type by the key selected by key()
+static fb::Offset<Index> export_index(SnapshotExport &builder, enum ScribaEntityType type,
+                                      scriba_id_t (*key)(const SnapshotItem &), bool timed);
+static scriba_id_t item_company(const SnapshotItem &item);
+static scriba_id_t item_poc(const SnapshotItem &item);
+static scriba_id_t item_project(const SnapshotItem &item);
+static scriba_id_t item_state(const SnapshotItem &item);
+static scriba_id_t item_none(const SnapshotItem &item);
+static int write_file(const char *path, const void *buf, size_t len);
+
+} // namespace scriba
+
+using namespace scriba;
+
+extern "C"
+{
+
+struct ScribaInternalDB snapshotDB =
+{
+    (char *)SCRIBA_SNAPSHOT_BACKEND_NAME,
+    scriba_snapshot_init,
+    scriba_snapshot_cleanup
+};
+
+int scriba_snapshot_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl)
+{
+    const char *path = NULL;
+
+    if ((pl == NULL) || (fTbl == NULL) || (data != NULL))
+    {
+        return 1;
+    }
+    if (parse_param_list(pl, &path) != 0)
+    {
+        return 1;
+    }
+
+    data = (SnapshotData *)scriba_malloc(sizeof (SnapshotData));
+    if (data == NULL)
+    {
+        return 1;
+    }
+    memset(data, 0, sizeof (SnapshotData));
+
+    if (map_snapshot(data, path) != 0)
+    {
+        scriba_snapshot_cleanup();
+        return 1;
+    }
+
+    fTbl->getCompany = getCompany;
+    fTbl->getCompanies = getCompanies;
+    fTbl->getAllCompanies = getAllCompanies;
+    fTbl->getCompaniesByName = getCompaniesByName;
+    fTbl->getCompaniesByJurName = getCompaniesByJurName;
+    fTbl->getCompaniesByAddress = getCompaniesByAddress;
+    fTbl->addCompany = addCompany;
+    fTbl->updateCompany = updateCompany;
+    fTbl->removeCompany = removeCompany;
+    fTbl->getEvent = getEvent;
+    fTbl->getEvents = getEvents;
+    fTbl->getAllEvents = getAllEvents;
+    fTbl->getEventsByDescr = getEventsByDescr;
+    fTbl->getEventsByCompany = getEventsByCompany;
+    fTbl->getEventsByPOC = getEventsByPOC;
+    fTbl->getEventsByProject = getEventsByProject;
+    fTbl->getEventsByState = getEventsByState;
+    fTbl->addEvent = addEvent;
+    fTbl->updateEvent = updateEvent;
+    fTbl->removeEvent = removeEvent;
+    fTbl->getPOC = getPOC;
+    fTbl->getPeople = getPeople;
+    fTbl->getAllPeople = getAllPeople;
+    fTbl->getPOCByName = getPOCByName;
+    fTbl->getPOCByCompany = getPOCByCompany;
+    fTbl->getPOCByPosition = getPOCByPosition;
+    fTbl->getPOCByPhoneNum = getPOCByPhoneNum;
+    fTbl->getPOCByEmail = getPOCByEmail;
+    fTbl->addPOC = addPOC;
+    fTbl->updatePOC = updatePOC;
+    fTbl->removePOC = removePOC;
+    fTbl->getProject = getProject;
+    fTbl->getProjects = getProjects;
+    fTbl->getAllProjects = getAllProjects;
+    fTbl->getProjectsByTitle = getProjectsByTitle;
+    fTbl->getProjectsByCompany = getProjectsByCompany;
+    fTbl->getProjectsByState = getProjectsByState;
+    fTbl->getProjectsByTime = getProjectsByTime;
+    fTbl->getProjectsByStateTime = getProjectsByStateTime;
+    fTbl->addProject = addProject;
+    fTbl->updateProject = updateProject;
+    fTbl->removeProject = removeProject;
+    fTbl->updateEvents = updateEvents;
+    fTbl->removeEvents = removeEvents;
+    fTbl->updateProjects = updateProjects;
+    fTbl->removeProjects = removeProjects;
+    fTbl->upsertCompany = upsertCompany;
+    fTbl->upsertPOC = upsertPOC;
+    fTbl->upsertProject = upsertProject;
+    fTbl->upsertEvent = upsertEvent;
+    fTbl->scanCompanies = scanCompanies;
+    fTbl->scanPeople = scanPeople;
+    fTbl->scanProjects = scanProjects;
+    fTbl->scanEvents = scanEvents;
+    fTbl->beginWrite = beginWrite;
+    fTbl->attachReader = attachReader;
+    fTbl->detachReader = detachReader;
+
+    return 0;
+}
+
+void scriba_snapshot_cleanup()
+{
+    if (data != NULL)
+    {
+        unmap_snapshot(data);
+        scriba_free(data);
+        data = NULL;
+    }
+}
+
+// write snapshot of the local database to the file
+int scriba_snapshot_export(const char *path)
+{
+    Builder fbb;
+
+    if ((path == NULL) || (build_snapshot(fbb) != 0))
+    {
+        return -1;
+    }
+    return write_file(path, fbb.GetBufferPointer(), fbb.GetSize());
+}
+
+// build snapshot without writing it
+int scriba_snapshot_build(struct ScribaSerializedBuffer *buf)
+{
+    if (buf == NULL)
+    {
+        return -1;
+    }
+    memset(buf, 0, sizeof (struct ScribaSerializedBuffer));
+
+    // the builder owns snapshot data the same way as in scriba_serializeToBuffer()
+    Builder *fbb = try_create<Builder>();
+    if (fbb == nullptr)
+    {
+        return -1;
+    }
+    if (build_snapshot(*fbb) != 0)
+    {
+        destroy(fbb);
+        return -1;
+    }
+    buf->data = fbb->GetBufferPointer();
+    buf->len = fbb->GetSize();
+    buf->priv = fbb;
+    return 0;
+}
+
+// write snapshot data to file
+int scriba_snapshot_write(const char *path, const struct ScribaSerializedBuffer *buf)
+{
+    if ((path == NULL) || (buf == NULL) || (buf->data == NULL))
+    {
+        return -1;
+    }
+    return write_file(path, buf->data, buf->len);
+}
+
+// read entities of the snapshot file
+int scriba_snapshot_read(const char *path, scriba_company_scan_fn company_func,
+                         scriba_poc_scan_fn poc_func, scriba_project_scan_fn project_func,
+                         scriba_event_scan_fn event_func, void *ctx)
+{
+    SnapshotData snapshot;
+
+    if (path == NULL)
+    {
+        return -1;
+    }
+    memset(&snapshot, 0, sizeof (snapshot));
+    if (map_snapshot(&snapshot, path) != 0)
+    {
+        unmap_snapshot(&snapshot);
+        return -1;
+    }
+
+    // the whole file is read, unlike lookups of the backend
+    madvise(snapshot.map, snapshot.map_len, MADV_SEQUENTIAL);
+    read_entities(snapshot.root->companies(), company_func, ctx);
+    read_entities(snapshot.root->people(), poc_func, ctx);
+    read_entities(snapshot.root->projects(), project_func, ctx);
+    read_entities(snapshot.root->events(), event_func, ctx);
+
+    unmap_snapshot(&snapshot);
+    return 0;
+}
+
+} // extern "C"
+
+namespace scriba
+{
+
+static int parse_param_list(struct ScribaDBParamList *pl, const char **path)
+{
+    for (; pl != NULL; pl = pl->next)
+    {
+        struct ScribaDBParam *param = pl->param;
+        if ((param == NULL) || (param->key == NULL) || (param->value == NULL))
+        {
+            continue;
+        }
+        if ((strcmp(param->key, SCRIBA_SNAPSHOT_LOCATION_PARAM) == 0) &&
+            (strlen(param->value) != 0))
+        {
+            *path = param->value;
+        }
+    }
+
+    return (*path == NULL);
+}
+
+static int map_snapshot(SnapshotData *snapshot, const char *path)
+{
+    struct stat st;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return 1;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < 8) ||
+        ((unsigned long long)st.st_size > SCRIBA_SNAPSHOT_MAX_SIZE))
+    {
+        close(fd);
+        return 1;
+    }
+
+    snapshot->map_len = (size_t)st.st_size;
+    void *map = mmap(NULL, snapshot->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the file is closed
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return 1;
+    }
+    snapshot->map = map;
+    // lookups jump all over the file, read-ahead would be wasted
+    madvise(map, snapshot->map_len, MADV_RANDOM);
+
+    // snapshot is trusted, only the header is checked, so that opening
+    // the snapshot does not touch the rest of the file
+    if (!fb::BufferHasIdentifier(map, SCRIBA_SNAPSHOT_IDENTIFIER))
+    {
+        return 1;
+    }
+    fb::uoffset_t root = fb::ReadScalar<fb::uoffset_t>(map);
+    if (root > snapshot->map_len - sizeof (fb::uoffset_t))
+    {
+        return 1;
+    }
+    snapshot->root = GetSnapshot(map);
+
+    return 0;
+}
+
+static void unmap_snapshot(SnapshotData *snapshot)
+{
+    if (snapshot->map != NULL)
+    {
+        munmap(snapshot->map, snapshot->map_len);
+        snapshot->map = NULL;
+    }
+}
+
+static int id_cmp(const ID *stored, const scriba_id_t &id)
+{
+    if (stored->high() != id._high)
+    {
+        return (stored->high() < id._high) ? -1 : 1;
+    }
+    if (stored->low() != id._low)
+    {
+        return (stored->low() < id._low) ? -1 : 1;
+    }
+    return 0;
+}
+
+static long find_id(const IdVector *ids, const scriba_id_t &id)
+{
+    if (ids == NULL)
+    {
+        return -1;
+    }
+
+    fb::uoffset_t begin = 0;
+    fb::uoffset_t end = ids->Length();
+    while (begin < end)
+    {
+        fb::uoffset_t mid = begin + (end - begin) / 2;
+        int cmp = id_cmp(ids->Get(mid), id);
+        if (cmp == 0)
+        {
+            return (long)mid;
+        }
+        if (cmp < 0)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+    return -1;
+}
+
+static void index_range(const Index *index, const scriba_id_t &key,
+                        fb::uoffset_t &begin, fb::uoffset_t &end)
+{
+    begin = 0;
+    end = 0;
+    if (index == NULL)
+    {
+        return;
+    }
+
+    // lower bound of the key
+    fb::uoffset_t low = 0;
+    fb::uoffset_t high = index->Length();
+    while (low < high)
+    {
+        fb::uoffset_t mid = low + (high - low) / 2;
+        if (id_cmp(&(index->Get(mid)->key()), key) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    begin = low;
+
+    // upper bound of the key
+    high = index->Length();
+    while (low < high)
+    {
+        fb::uoffset_t mid = low + (high - low) / 2;
+        if (id_cmp(&(index->Get(mid)->key()), key) <= 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    end = low;
+}
+
+static scriba_id_t to_id(const ID *id)
+{
+    scriba_id_t ret;
+
+    scriba_id_zero_init(&ret);
+    if (id != NULL)
+    {
+        ret._high = id->high();
+        ret._low = id->low();
+    }
+    return ret;
+}
+
+static scriba_id_t state_key(int state)
+{
+    scriba_id_t key;
+
+    scriba_id_zero_init(&key);
+    key._low = (unsigned long long)state;
+    return key;
+}
+
+static const char *to_str(const fb::String *str)
+{
+    return (str != NULL) ? str->c_str() : NULL;
+}
+
+static bool text_contains(const fb::String *text, const char *pattern)
+{
+    if ((text == NULL) || (pattern == NULL))
+    {
+        return false;
+    }
+
+    const char *str = text->c_str();
+    size_t len = text->Length();
+    size_t pattern_len = strlen(pattern);
+    for (size_t start = 0; start + pattern_len <= len; start++)
+    {
+        size_t i = 0;
+        while ((i < pattern_len) &&
+               (tolower((unsigned char)str[start + i]) == tolower((unsigned char)pattern[i])))
+        {
+            i++;
+        }
+        if (i == pattern_len)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void list_company(scriba_list_t *list, const Company *company)
+{
+    scriba_list_add(list, to_id(company->id()), (char *)to_str(company->name()));
+}
+
+static void list_poc(scriba_list_t *list, const POC *poc)
+{
+    const char *names[] = { to_str(poc->firstname()), to_str(poc->secondname()),
+                            to_str(poc->lastname()) };
+    std::string name;
+
+    // first, second and last names separated by spaces
+    for (int i = 0; i < 3; i++)
+    {
+        if (i != 0)
+        {
+            name += ' ';
+        }
+        if (names[i] != NULL)
+        {
+            name += names[i];
+        }
+    }
+    scriba_list_add(list, to_id(poc->id()), (name.size() > 2) ? (char *)name.c_str() : NULL);
+}
+
+static void list_project(scriba_list_t *list, const Project *project)
+{
+    const char *title = to_str(project->title());
+    scriba_list_add(list, to_id(project->id()),
+                    ((title != NULL) && (*title != 0)) ? (char *)title : NULL);
+}
+
+static void list_event(scriba_list_t *list, const Event *event)
+{
+    const char *descr = to_str(event->descr());
+    scriba_list_add(list, to_id(event->id()),
+                    ((descr != NULL) && (*descr != 0)) ? (char *)descr : NULL);
+}
+
+template<typename T>
+static void list_range(scriba_list_t *list, const fb::Vector<fb::Offset<T>> *entities,
+                       const Index *index, const scriba_id_t &key,
+                       void (*add)(scriba_list_t *, const T *))
+{
+    fb::uoffset_t begin;
+    fb::uoffset_t end;
+
+    if (entities == NULL)
+    {
+        return;
+    }
+    index_range(index, key, begin, end);
+    for (fb::uoffset_t i = begin; i < end; i++)
+    {
+        add(list, entities->Get(index->Get(i)->pos()));
+    }
+}
+
+static void list_events(scriba_list_t *list, const Index *index, const scriba_id_t &key,
+                        const char *descr)
+{
+    const fb::Vector<fb::Offset<Event>> *events = data->root->events();
+    int64_t now = (int64_t)time(NULL);
+    fb::uoffset_t begin;
+    fb::uoffset_t end;
+
+    if (events == NULL)
+    {
+        return;
+    }
+    index_range(index, key, begin, end);
+
+    // entries of the range are sorted by time, find the first upcoming event
+    fb::uoffset_t low = begin;
+    fb::uoffset_t high = end;
+    while (low < high)
+    {
+        fb::uoffset_t mid = low + (high - low) / 2;
+        if (index->Get(mid)->time() <= now)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    for (fb::uoffset_t i = low; i < end; i++)
+    {
+        const Event *event = events->Get(index->Get(i)->pos());
+        if ((descr == NULL) || text_contains(event->descr(), descr))
+        {
+            list_event(list, event);
+        }
+    }
+    for (fb::uoffset_t i = low; i > begin; i--)
+    {
+        const Event *event = events->Get(index->Get(i - 1)->pos());
+        if ((descr == NULL) || text_contains(event->descr(), descr))
+        {
+            list_event(list, event);
+        }
+    }
+}
+
+// size of entity storage required for string field
+static size_t field_size(const fb::String *str)
+{
+    return (str != NULL) ? str->Length() + 1 : 0;
+}
+
+// size of entity storage required for company string field, empty strings are not stored
+static size_t company_field_size(const fb::String *str)
+{
+    return ((str != NULL) && (str->Length() != 0)) ? str->Length() + 1 : 0;
+}
+
+static char *copy_field(char **str_buf, const fb::String *str)
+{
+    return (str != NULL) ? scriba_entity_strcpy(str_buf, str->c_str()) : NULL;
+}
+
+static char *copy_company_field(char **str_buf, const fb::String *str)
+{
+    return (company_field_size(str) != 0) ? scriba_entity_strcpy(str_buf, str->c_str()) : NULL;
+}
+
+static struct ScribaCompany *company_data(const Company *company)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = company_field_size(company->name()) + company_field_size(company->jur_name()) +
+                      company_field_size(company->address()) + company_field_size(company->inn()) +
+                      company_field_size(company->phonenum()) + company_field_size(company->email());
+    struct ScribaCompany *ret = (struct ScribaCompany *)scriba_entity_alloc(sizeof (struct ScribaCompany),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = to_id(company->id());
+    ret->name = copy_company_field(&str_buf, company->name());
+    ret->jur_name = copy_company_field(&str_buf, company->jur_name());
+    ret->address = copy_company_field(&str_buf, company->address());
+    ret->inn = copy_company_field(&str_buf, company->inn());
+    ret->phonenum = copy_company_field(&str_buf, company->phonenum());
+    ret->email = copy_company_field(&str_buf, company->email());
+
+    ret->poc_list = scriba_list_init();
+    ret->proj_list = scriba_list_init();
+    ret->event_list = scriba_list_init();
+    list_range(ret->poc_list, data->root->people(), data->root->people_by_company(),
+               ret->id, list_poc);
+    list_range(ret->proj_list, data->root->projects(), data->root->projects_by_company(),
+               ret->id, list_project);
+    list_events(ret->event_list, data->root->events_by_company(), ret->id, NULL);
+
+    return ret;
+}
+
+static struct ScribaPoc *poc_data(const POC *poc)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(poc->firstname()) + field_size(poc->secondname()) +
+                      field_size(poc->lastname()) + field_size(poc->mobilenum()) +
+                      field_size(poc->phonenum()) + field_size(poc->email()) +
+                      field_size(poc->position());
+    struct ScribaPoc *ret = (struct ScribaPoc *)scriba_entity_alloc(sizeof (struct ScribaPoc),
+                                                                    str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = to_id(poc->id());
+    ret->firstname = copy_field(&str_buf, poc->firstname());
+    ret->secondname = copy_field(&str_buf, poc->secondname());
+    ret->lastname = copy_field(&str_buf, poc->lastname());
+    ret->mobilenum = copy_field(&str_buf, poc->mobilenum());
+    ret->phonenum = copy_field(&str_buf, poc->phonenum());
+    ret->email = copy_field(&str_buf, poc->email());
+    ret->position = copy_field(&str_buf, poc->position());
+    ret->company_id = to_id(poc->company_id());
+
+    return ret;
+}
+
+static struct ScribaProject *project_data(const Project *project)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(project->title()) + field_size(project->descr());
+    struct ScribaProject *ret = (struct ScribaProject *)scriba_entity_alloc(sizeof (struct ScribaProject),
+                                                                            str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = to_id(project->id());
+    ret->title = copy_field(&str_buf, project->title());
+    ret->descr = copy_field(&str_buf, project->descr());
+    ret->company_id = to_id(project->company_id());
+    ret->state = (enum ScribaProjectState)project->state();
+    ret->currency = (enum ScribaCurrency)project->currency();
+    ret->cost = (long long)project->cost();
+    ret->start_time = project->start_time();
+    ret->mod_time = project->mod_time();
+
+    return ret;
+}
+
+static struct ScribaEvent *event_data(const Event *event)
+{
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(event->descr()) + field_size(event->outcome());
+    struct ScribaEvent *ret = (struct ScribaEvent *)scriba_entity_alloc(sizeof (struct ScribaEvent),
+                                                                        str_size, &str_buf, &layout);
+    if (ret == NULL)
+    {
+        return NULL;
+    }
+    ret->layout = (char)layout;
+
+    ret->id = to_id(event->id());
+    ret->descr = copy_field(&str_buf, event->descr());
+    ret->company_id = to_id(event->company_id());
+    ret->poc_id = to_id(event->poc_id());
+    ret->project_id = to_id(event->project_id());
+    ret->type = (enum ScribaEventType)event->type();
+    ret->outcome = copy_field(&str_buf, event->outcome());
+    ret->timestamp = event->timestamp();
+    ret->state = (enum ScribaEventState)event->state();
+
+    return ret;
+}
+
+template<typename T, typename S>
+static S *get_entity(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                     const scriba_id_t &id, S *(*create)(const T *))
+{
+    long pos = find_id(ids, id);
+    if ((pos < 0) || (entities == NULL))
+    {
+        return NULL;
+    }
+    return create(entities->Get((fb::uoffset_t)pos));
+}
+
+template<typename T, typename S>
+static size_t get_entities(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                           const scriba_id_t *req, size_t n, S **result,
+                           S *(*create)(const T *))
+{
+    size_t found = 0;
+
+    if (result == NULL)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        result[i] = get_entity(entities, ids, req[i], create);
+        if (result[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
+static void fill_scanned(const Company *company, ScribaCompany &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = to_id(company->id());
+    scanned.name = (char *)to_str(company->name());
+    scanned.jur_name = (char *)to_str(company->jur_name());
+    scanned.address = (char *)to_str(company->address());
+    scanned.inn = (char *)to_str(company->inn());
+    scanned.phonenum = (char *)to_str(company->phonenum());
+    scanned.email = (char *)to_str(company->email());
+}
+
+static void fill_scanned(const POC *poc, ScribaPoc &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = to_id(poc->id());
+    scanned.firstname = (char *)to_str(poc->firstname());
+    scanned.secondname = (char *)to_str(poc->secondname());
+    scanned.lastname = (char *)to_str(poc->lastname());
+    scanned.mobilenum = (char *)to_str(poc->mobilenum());
+    scanned.phonenum = (char *)to_str(poc->phonenum());
+    scanned.email = (char *)to_str(poc->email());
+    scanned.position = (char *)to_str(poc->position());
+    scanned.company_id = to_id(poc->company_id());
+}
+
+static void fill_scanned(const Project *project, ScribaProject &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = to_id(project->id());
+    scanned.title = (char *)to_str(project->title());
+    scanned.descr = (char *)to_str(project->descr());
+    scanned.company_id = to_id(project->company_id());
+    scanned.state = (enum ScribaProjectState)project->state();
+    scanned.currency = (enum ScribaCurrency)project->currency();
+    scanned.cost = (long long)project->cost();
+    scanned.start_time = project->start_time();
+    scanned.mod_time = project->mod_time();
+}
+
+static void fill_scanned(const Event *event, ScribaEvent &scanned)
+{
+    memset(&scanned, 0, sizeof (scanned));
+    scanned.id = to_id(event->id());
+    scanned.descr = (char *)to_str(event->descr());
+    scanned.company_id = to_id(event->company_id());
+    scanned.poc_id = to_id(event->poc_id());
+    scanned.project_id = to_id(event->project_id());
+    scanned.type = (enum ScribaEventType)event->type();
+    scanned.outcome = (char *)to_str(event->outcome());
+    scanned.timestamp = event->timestamp();
+    scanned.state = (enum ScribaEventState)event->state();
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaCompany &company)
+{
+    return scriba_scan_filter_match(filter, &(company.id), &(company.id), NULL);
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaPoc &poc)
+{
+    return scriba_scan_filter_match(filter, &(poc.id), &(poc.company_id), NULL);
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaProject &project)
+{
+    return scriba_scan_filter_match(filter, &(project.id), &(project.company_id),
+                                    &(project.mod_time));
+}
+
+static bool scan_match(const ScribaScanFilter *filter, const ScribaEvent &event)
+{
+    return scriba_scan_filter_match(filter, &(event.id), &(event.company_id), NULL);
+}
+
+template<typename T, typename S>
+static int scan_entities(const fb::Vector<fb::Offset<T>> *entities, const IdVector *ids,
+                         const ScribaScanFilter *filter, void (*func)(const S *, void *),
+                         void *ctx)
+{
+    S scanned;
+
+    if (func == NULL)
+    {
+        return -1;
+    }
+    if (entities == NULL)
+    {
+        return 0;
+    }
+
+    if ((filter != NULL) && (filter->ids != NULL))
+    {
+        // selected entities are looked up instead of scanning all of them
+        for (size_t i = 0; i < filter->num_ids; i++)
+        {
+            long pos = find_id(ids, filter->ids[i]);
+            if (pos < 0)
+            {
+                continue;
+            }
+            fill_scanned(entities->Get((fb::uoffset_t)pos), scanned);
+            if (scan_match(filter, scanned))
+            {
+                func(&scanned, ctx);
+            }
+        }
+        return 0;
+    }
+
+    for (fb::uoffset_t i = 0; i < entities->Length(); i++)
+    {
+        fill_scanned(entities->Get(i), scanned);
+        if (scan_match(filter, scanned))
+        {
+            func(&scanned, ctx);
+        }
+    }
+    return 0;
+}
+
+template<typename T, typename S>
+static void read_entities(const fb::Vector<fb::Offset<T>> *entities,
+                          void (*func)(const S *, void *), void *ctx)
+{
+    S scanned;
+
+    for (fb::uoffset_t i = 0; (func != NULL) && (entities != NULL) && (i < entities->Length()); i++)
+    {
+        fill_scanned(entities->Get(i), scanned);
+        func(&scanned, ctx);
+    }
+}
+
+// company interface functions
+static struct ScribaCompany *getCompany(scriba_id_t id)
+{
+    return get_entity(data->root->companies(), data->root->company_ids(), id, company_data);
+}
+
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies)
+{
+    return get_entities(data->root->companies(), data->root->company_ids(), ids, n, companies,
+                        company_data);
+}
+
+static scriba_list_t *getAllCompanies()
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Company>> *companies = data->root->companies();
+
+    for (fb::uoffset_t i = 0; (companies != NULL) && (i < companies->Length()); i++)
+    {
+        list_company(list, companies->Get(i));
+    }
+    return list;
+}
+
+// search companies by text of the field selected by field()
+static scriba_list_t *companySearch(const fb::String *(Company::*field)() const, const char *text)
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Company>> *companies = data->root->companies();
+
+    for (fb::uoffset_t i = 0; (companies != NULL) && (i < companies->Length()); i++)
+    {
+        const Company *company = companies->Get(i);
+        if (text_contains((company->*field)(), text))
+        {
+            list_company(list, company);
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getCompaniesByName(const char *name)
+{
+    return companySearch(&Company::name, name);
+}
+
+static scriba_list_t *getCompaniesByJurName(const char *juridicial_name)
+{
+    return companySearch(&Company::jur_name, juridicial_name);
+}
+
+static scriba_list_t *getCompaniesByAddress(const char *address)
+{
+    return companySearch(&Company::address, address);
+}
+
+// snapshot is read-only, changes are ignored
+static void addCompany(scriba_id_t, const char *, const char *, const char *,
+                       const char *, const char *, const char *)
+{
+}
+
+static void updateCompany(const struct ScribaCompany *)
+{
+}
+
+static void removeCompany(scriba_id_t)
+{
+}
+
+static int upsertCompany(const struct ScribaCompany *, int)
+{
+    return -1;
+}
+
+// POC interface functions
+static struct ScribaPoc *getPOC(scriba_id_t id)
+{
+    return get_entity(data->root->people(), data->root->poc_ids(), id, poc_data);
+}
+
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people)
+{
+    return get_entities(data->root->people(), data->root->poc_ids(), ids, n, people, poc_data);
+}
+
+static scriba_list_t *getAllPeople()
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<POC>> *people = data->root->people();
+
+    for (fb::uoffset_t i = 0; (people != NULL) && (i < people->Length()); i++)
+    {
+        list_poc(list, people->Get(i));
+    }
+    return list;
+}
+
+// search people by text of the field selected by field()
+static void pocSearch(scriba_list_t *list, const fb::String *(POC::*field)() const, const char *text)
+{
+    const fb::Vector<fb::Offset<POC>> *people = data->root->people();
+
+    for (fb::uoffset_t i = 0; (people != NULL) && (i < people->Length()); i++)
+    {
+        const POC *poc = people->Get(i);
+        if (text_contains((poc->*field)(), text))
+        {
+            list_poc(list, poc);
+        }
+    }
+}
+
+static scriba_list_t *getPOCByName(const char *name)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    // same as the SQLite backend, people matching by several names
+    // are listed several times
+    pocSearch(list, &POC::firstname, name);
+    pocSearch(list, &POC::secondname, name);
+    pocSearch(list, &POC::lastname, name);
+    return list;
+}
+
+static scriba_list_t *getPOCByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_range(list, data->root->people(), data->root->people_by_company(), id, list_poc);
+    return list;
+}
+
+static scriba_list_t *getPOCByPosition(const char *position)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    pocSearch(list, &POC::position, position);
+    return list;
+}
+
+static scriba_list_t *getPOCByPhoneNum(const char *phonenum)
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<POC>> *people = data->root->people();
+
+    for (fb::uoffset_t i = 0; (people != NULL) && (phonenum != NULL) && (i < people->Length()); i++)
+    {
+        const POC *poc = people->Get(i);
+        // phone numbers are compared exactly
+        if ((poc->phonenum() != NULL) && (strcmp(poc->phonenum()->c_str(), phonenum) == 0))
+        {
+            list_poc(list, poc);
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getPOCByEmail(const char *email)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    pocSearch(list, &POC::email, email);
+    return list;
+}
+
+static void addPOC(scriba_id_t, const char *, const char *, const char *, const char *,
+                   const char *, const char *, const char *, scriba_id_t)
+{
+}
+
+static void updatePOC(const struct ScribaPoc *)
+{
+}
+
+static void removePOC(scriba_id_t)
+{
+}
+
+static int upsertPOC(const struct ScribaPoc *, int)
+{
+    return -1;
+}
+
+// project interface functions
+static struct ScribaProject *getProject(scriba_id_t id)
+{
+    return get_entity(data->root->projects(), data->root->project_ids(), id, project_data);
+}
+
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects)
+{
+    return get_entities(data->root->projects(), data->root->project_ids(), ids, n, projects,
+                        project_data);
+}
+
+static scriba_list_t *getAllProjects()
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Project>> *projects = data->root->projects();
+
+    for (fb::uoffset_t i = 0; (projects != NULL) && (i < projects->Length()); i++)
+    {
+        list_project(list, projects->Get(i));
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByTitle(const char *title)
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Project>> *projects = data->root->projects();
+
+    for (fb::uoffset_t i = 0; (projects != NULL) && (i < projects->Length()); i++)
+    {
+        const Project *project = projects->Get(i);
+        if (text_contains(project->title(), title))
+        {
+            list_project(list, project);
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_range(list, data->root->projects(), data->root->projects_by_company(), id,
+               list_project);
+    return list;
+}
+
+static scriba_list_t *getProjectsByState(enum ScribaProjectState state)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_range(list, data->root->projects(), data->root->projects_by_state(), state_key(state),
+               list_project);
+    return list;
+}
+
+static bool time_match(scriba_time_t time, scriba_time_t cond, enum ScribaTimeComp comp)
+{
+    switch (comp)
+    {
+    case SCRIBA_TIME_BEFORE:
+        return (time < cond);
+    case SCRIBA_TIME_AFTER:
+        return (time > cond);
+    default:
+        return true;
+    }
+}
+
+static scriba_list_t *getProjectsByTime(scriba_time_t start_time, enum ScribaTimeComp start_comp,
+                                        scriba_time_t mod_time, enum ScribaTimeComp mod_comp)
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Project>> *projects = data->root->projects();
+
+    if ((start_comp == SCRIBA_TIME_IGNORE) && (mod_comp == SCRIBA_TIME_IGNORE))
+    {
+        return list;
+    }
+    for (fb::uoffset_t i = 0; (projects != NULL) && (i < projects->Length()); i++)
+    {
+        const Project *project = projects->Get(i);
+        if (time_match(project->start_time(), start_time, start_comp) &&
+            time_match(project->mod_time(), mod_time, mod_comp))
+        {
+            list_project(list, project);
+        }
+    }
+    return list;
+}
+
+static scriba_list_t *getProjectsByStateTime(enum ScribaProjectState state,
+                                             scriba_time_t start_time,
+                                             enum ScribaTimeComp start_comp,
+                                             scriba_time_t mod_time,
+                                             enum ScribaTimeComp mod_comp)
+{
+    scriba_list_t *list = scriba_list_init();
+    const fb::Vector<fb::Offset<Project>> *projects = data->root->projects();
+    const Index *index = data->root->projects_by_state();
+    fb::uoffset_t begin;
+    fb::uoffset_t end;
+
+    if (projects == NULL)
+    {
+        return list;
+    }
+    index_range(index, state_key(state), begin, end);
+    for (fb::uoffset_t i = begin; i < end; i++)
+    {
+        const Project *project = projects->Get(index->Get(i)->pos());
+        if (time_match(project->start_time(), start_time, start_comp) &&
+            time_match(project->mod_time(), mod_time, mod_comp))
+        {
+            list_project(list, project);
+        }
+    }
+    return list;
+}
+
+static void addProject(scriba_id_t, const char *, const char *, scriba_id_t,
+                       enum ScribaProjectState, enum ScribaCurrency, long long, scriba_time_t)
+{
+}
+
+static void updateProject(struct ScribaProject *)
+{
+}
+
+static void removeProject(scriba_id_t)
+{
+}
+
+static int upsertProject(const struct ScribaProject *, int, scriba_time_t)
+{
+    return -1;
+}
+
+static long updateProjects(const struct ScribaProjectFilter *, const struct ScribaProjectUpdate *,
+                           scriba_time_t)
+{
+    return -1;
+}
+
+static long removeProjects(const struct ScribaProjectFilter *)
+{
+    return -1;
+}
+
+// event interface functions
+static struct ScribaEvent *getEvent(scriba_id_t id)
+{
+    return get_entity(data->root->events(), data->root->event_ids(), id, event_data);
+}
+
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events)
+{
+    return get_entities(data->root->events(), data->root->event_ids(), ids, n, events, event_data);
+}
+
+static scriba_list_t *getAllEvents()
+{
+    scriba_list_t *list = scriba_list_init();
+    scriba_id_t key;
+
+    scriba_id_zero_init(&key);
+    list_events(list, data->root->events_by_time(), key, NULL);
+    return list;
+}
+
+static scriba_list_t *getEventsByDescr(const char *descr)
+{
+    scriba_list_t *list = scriba_list_init();
+    scriba_id_t key;
+
+    if (descr != NULL)
+    {
+        scriba_id_zero_init(&key);
+        list_events(list, data->root->events_by_time(), key, descr);
+    }
+    return list;
+}
+
+static scriba_list_t *getEventsByCompany(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_events(list, data->root->events_by_company(), id, NULL);
+    return list;
+}
+
+static scriba_list_t *getEventsByPOC(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_events(list, data->root->events_by_poc(), id, NULL);
+    return list;
+}
+
+static scriba_list_t *getEventsByProject(scriba_id_t id)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_events(list, data->root->events_by_project(), id, NULL);
+    return list;
+}
+
+static scriba_list_t *getEventsByState(enum ScribaEventState state)
+{
+    scriba_list_t *list = scriba_list_init();
+
+    list_events(list, data->root->events_by_state(), state_key(state), NULL);
+    return list;
+}
+
+static void addEvent(scriba_id_t, const char *, scriba_id_t, scriba_id_t, scriba_id_t,
+                     enum ScribaEventType, const char *, scriba_time_t, enum ScribaEventState)
+{
+}
+
+static void updateEvent(const struct ScribaEvent *)
+{
+}
+
+static void removeEvent(scriba_id_t)
+{
+}
+
+static int upsertEvent(const struct ScribaEvent *, int)
+{
+    return -1;
+}
+
+static long updateEvents(const struct ScribaEventFilter *, const struct ScribaEventUpdate *)
+{
+    return -1;
+}
+
+static long removeEvents(const struct ScribaEventFilter *)
+{
+    return -1;
+}
+
+// scan interface functions
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx)
+{
+    return scan_entities(data->root->companies(), data->root->company_ids(), filter, func, ctx);
+}
+
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx)
+{
+    return scan_entities(data->root->people(), data->root->poc_ids(), filter, func, ctx);
+}
+
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx)
+{
+    return scan_entities(data->root->projects(), data->root->project_ids(), filter, func, ctx);
+}
+
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx)
+{
+    return scan_entities(data->root->events(), data->root->event_ids(), filter, func, ctx);
+}
+
+static int beginWrite()
+{
+    return 1;
+}
+
+static int attachReader()
+{
+    return 0;
+}
+
+static void detachReader()
+{
+}
+
+// snapshot export helpers
+static int build_snapshot(fb::FlatBufferBuilder &fbb)
+{
+    SnapshotExport builder(fbb);
+    fb::Offset<IdVector> company_ids;
+    fb::Offset<IdVector> event_ids;
+    fb::Offset<IdVector> poc_ids;
+    fb::Offset<IdVector> project_ids;
+    int ret = 0;
+
+    // entities of all types should come from the same database state
+    scriba_beginRead();
+    if ((scriba_scanCompanies(NULL, export_company, &builder) != 0) ||
+        (scriba_scanPeople(NULL, export_poc, &builder) != 0) ||
+        (scriba_scanProjects(NULL, export_project, &builder) != 0) ||
+        (scriba_scanEvents(NULL, export_event, &builder) != 0))
+    {
+        ret = -1;
+    }
+    scriba_endRead();
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    auto companies = export_entities<Company>(builder, SCRIBA_ENTITY_COMPANY, company_ids);
+    auto events = export_entities<Event>(builder, SCRIBA_ENTITY_EVENT, event_ids);
+    auto people = export_entities<POC>(builder, SCRIBA_ENTITY_POC, poc_ids);
+    auto projects = export_entities<Project>(builder, SCRIBA_ENTITY_PROJECT, project_ids);
+
+    auto root = CreateSnapshot(builder.fbb,
+                               companies, company_ids,
+                               events, event_ids,
+                               people, poc_ids,
+                               projects, project_ids,
+                               export_index(builder, SCRIBA_ENTITY_POC, item_company, false),
+                               export_index(builder, SCRIBA_ENTITY_PROJECT, item_company, false),
+                               export_index(builder, SCRIBA_ENTITY_PROJECT, item_state, false),
+                               export_index(builder, SCRIBA_ENTITY_EVENT, item_none, true),
+                               export_index(builder, SCRIBA_ENTITY_EVENT, item_company, true),
+                               export_index(builder, SCRIBA_ENTITY_EVENT, item_poc, true),
+                               export_index(builder, SCRIBA_ENTITY_EVENT, item_project, true),
+                               export_index(builder, SCRIBA_ENTITY_EVENT, item_state, true));
+    builder.fbb.Finish(root, SCRIBA_SNAPSHOT_IDENTIFIER);
+
+    return 0;
+}
+
+static fb::Offset<fb::String> create_string(fb::FlatBufferBuilder &fbb, const char *str)
+{
+    // missing strings are not stored, so that they stay NULL
+    return (str != NULL) ? fbb.CreateString(str) : 0;
+}
+
+static void export_company(const ScribaCompany *company, void *ctx)
+{
+    SnapshotExport *builder = static_cast<SnapshotExport *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+    SnapshotItem item;
+
+    memset(&item, 0, sizeof (item));
+    ID id(company->id._high, company->id._low);
+    auto name = create_string(fbb, company->name);
+    auto jur_name = create_string(fbb, company->jur_name);
+    auto address = create_string(fbb, company->address);
+    auto inn = create_string(fbb, company->inn);
+    auto phonenum = create_string(fbb, company->phonenum);
+    auto email = create_string(fbb, company->email);
+
+    item.id = company->id;
+    item.offset = CreateCompany(fbb, &id, name, jur_name, address, inn, phonenum, email, 0).o;
+    builder->items[SCRIBA_ENTITY_COMPANY].push_back(item);
+}
+
+static void export_poc(const ScribaPoc *poc, void *ctx)
+{
+    SnapshotExport *builder = static_cast<SnapshotExport *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+    SnapshotItem item;
+
+    memset(&item, 0, sizeof (item));
+    ID id(poc->id._high, poc->id._low);
+    ID company_id(poc->company_id._high, poc->company_id._low);
+    auto firstname = create_string(fbb, poc->firstname);
+    auto secondname = create_string(fbb, poc->secondname);
+    auto lastname = create_string(fbb, poc->lastname);
+    auto mobilenum = create_string(fbb, poc->mobilenum);
+    auto phonenum = create_string(fbb, poc->phonenum);
+    auto email = create_string(fbb, poc->email);
+    auto position = create_string(fbb, poc->position);
+
+    item.id = poc->id;
+    item.company_id = poc->company_id;
+    item.offset = CreatePOC(fbb, &id, firstname, secondname, lastname, mobilenum, phonenum,
+                            email, position, &company_id, 0, 0).o;
+    builder->items[SCRIBA_ENTITY_POC].push_back(item);
+}
+
+static void export_project(const ScribaProject *project, void *ctx)
+{
+    SnapshotExport *builder = static_cast<SnapshotExport *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+    SnapshotItem item;
+
+    memset(&item, 0, sizeof (item));
+    ID id(project->id._high, project->id._low);
+    ID company_id(project->company_id._high, project->company_id._low);
+    auto title = create_string(fbb, project->title);
+    auto descr = create_string(fbb, project->descr);
+
+    item.id = project->id;
+    item.company_id = project->company_id;
+    item.state = project->state;
+    item.offset = CreateProject(fbb, &id, title, descr, &company_id, (int8_t)project->state,
+                                (int8_t)project->currency, (uint64_t)project->cost,
+                                project->start_time, project->mod_time, 0, 0).o;
+    builder->items[SCRIBA_ENTITY_PROJECT].push_back(item);
+}
+
+static void export_event(const ScribaEvent *event, void *ctx)
+{
+    SnapshotExport *builder = static_cast<SnapshotExport *>(ctx);
+    fb::FlatBufferBuilder &fbb = builder->fbb;
+    SnapshotItem item;
+
+    memset(&item, 0, sizeof (item));
+    ID id(event->id._high, event->id._low);
+    ID company_id(event->company_id._high, event->company_id._low);
+    ID project_id(event->project_id._high, event->project_id._low);
+    ID poc_id(event->poc_id._high, event->poc_id._low);
+    auto descr = create_string(fbb, event->descr);
+    auto outcome = create_string(fbb, event->outcome);
+
+    item.id = event->id;
+    item.company_id = event->company_id;
+    item.poc_id = event->poc_id;
+    item.project_id = event->project_id;
+    item.state = event->state;
+    item.time = event->timestamp;
+    item.offset = CreateEvent(fbb, &id, descr, &company_id, &project_id, &poc_id,
+                              (int8_t)event->type, outcome, event->timestamp,
+                              (int8_t)event->state, 0, 0, 0, 0).o;
+    builder->items[SCRIBA_ENTITY_EVENT].push_back(item);
+}
+
+static bool item_less(const SnapshotItem &a, const SnapshotItem &b)
+{
+    if (a.id._high != b.id._high)
+    {
+        return (a.id._high < b.id._high);
+    }
+    return (a.id._low < b.id._low);
+}
+
+static bool index_less(const IndexEntry &a, const IndexEntry &b)
+{
+    if (a.key().high() != b.key().high())
+    {
+        return (a.key().high() < b.key().high());
+    }
+    if (a.key().low() != b.key().low())
+    {
+        return (a.key().low() < b.key().low());
+    }
+    if (a.time() != b.time())
+    {
+        return (a.time() < b.time());
+    }
+    return (a.pos() < b.pos());
+}
+
+template<typename T>
+static fb::Offset<fb::Vector<fb::Offset<T>>> export_entities(SnapshotExport &builder,
+                                                            enum ScribaEntityType type,
+                                                            fb::Offset<IdVector> &ids)
+{
+    Vector<SnapshotItem> &items = builder.items[type];
+    Vector<fb::Offset<T>> offsets;
+    Vector<ID> sorted_ids;
+
+    std::sort(items.begin(), items.end(), item_less);
+    offsets.reserve(items.size());
+    sorted_ids.reserve(items.size());
+    for (const SnapshotItem &item : items)
+    {
+        offsets.push_back(fb::Offset<T>(item.offset));
+        sorted_ids.push_back(ID(item.id._high, item.id._low));
+    }
+
+    ids = builder.fbb.CreateVectorOfStructs(sorted_ids);
+    return builder.fbb.CreateVector(offsets);
+}
+
+static fb::Offset<Index> export_index(SnapshotExport &builder, enum ScribaEntityType type,
+                                      scriba_id_t (*key)(const SnapshotItem &), bool timed)
+{
+    const Vector<SnapshotItem> &items = builder.items[type];
+    Vector<IndexEntry> entries;
+
+    // items have already been sorted by export_entities(), so the position
+    // of an item is the position of its entity in the snapshot
+    entries.reserve(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        scriba_id_t item_key = key(items[i]);
+        entries.push_back(IndexEntry(ID(item_key._high, item_key._low),
+                                     timed ? items[i].time : 0, (uint32_t)i));
+    }
+    std::sort(entries.begin(), entries.end(), index_less);
+
+    return builder.fbb.CreateVectorOfStructs(entries);
+}
+
+static scriba_id_t item_company(const SnapshotItem &item)
+{
+    return item.company_id;
+}
+
+static scriba_id_t item_poc(const SnapshotItem &item)
+{
+    return item.poc_id;
+}
+
+static scriba_id_t item_project(const SnapshotItem &item)
+{
+    return item.project_id;
+}
+
+static scriba_id_t item_state(const SnapshotItem &item)
+{
+    return state_key(item.state);
+}
+
+static scriba_id_t item_none(const SnapshotItem &)
+{
+    scriba_id_t key;
+
+    scriba_id_zero_init(&key);
+    return key;
+}
+
+static int write_file(const char *path, const void *buf, size_t len)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(buf);
+    std::string tmp_path = std::string(path) + ".tmp";
+    int ret = 0;
+
+    // the snapshot is written next to the target and renamed over it, so that
+    // the target always holds a complete snapshot
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    while (len > 0)
+    {
+        ssize_t written = write(fd, bytes, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        bytes += written;
+        len -= (size_t)written;
+    }
+    // data should reach the disk before the file replaces the target
+    if ((ret == 0) && (fsync(fd) != 0))
+    {
+        ret = -1;
+    }
+    if (close(fd) != 0)
+    {
+        ret = -1;
+    }
+
+    if ((ret == 0) && (rename(tmp_path.c_str(), path) != 0))
+    {
+        ret = -1;
+    }
+    if (ret != 0)
+    {
+        unlink(tmp_path.c_str());
+    }
+    return ret;
+}
+
+} // namespace scriba
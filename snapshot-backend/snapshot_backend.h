@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_SNAPSHOT_BACKEND_H
+#define SCRIBA_SNAPSHOT_BACKEND_H
+
+#include "db_backend.h"
+#include "serializer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Read-only backend serving the data from a snapshot file created by
+ * scriba_snapshot_export(). The file is mapped into memory, entities are looked
+ * up by binary search over sorted id and index vectors of the mapping. Changes
+ * are ignored: add, update and remove functions do nothing, upserts, bulk
+ * operations and write transactions fail. */
+
+#define SCRIBA_SNAPSHOT_BACKEND_NAME "scriba_snapshot"
+#define SCRIBA_SNAPSHOT_LOCATION_PARAM "snapshot_loc"
+
+extern struct ScribaInternalDB snapshotDB;
+
+int scriba_snapshot_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl);
+
+void scriba_snapshot_cleanup();
+
+// write snapshot of the local database to the file at the given path; the file
+// is replaced atomically, so that processes using the previous snapshot keep
+// their data; returns 0 on success
+int scriba_snapshot_export(const char *path);
+
+// build snapshot of the local database the same way scriba_snapshot_export() does
+// and hand over the snapshot data in buf without writing it; the data should be
+// released by scriba_freeSerializedBuffer(); returns 0 on success
+int scriba_snapshot_build(struct ScribaSerializedBuffer *buf);
+
+// write snapshot data built by scriba_snapshot_build() to the file at the given
+// path, the file is replaced atomically; returns 0 on success
+int scriba_snapshot_write(const char *path, const struct ScribaSerializedBuffer *buf);
+
+// call the given functions with the last argument as context for each entity
+// of the snapshot file at the given path the same way scan functions do;
+// NULL functions skip entities of their type; returns 0 on success
+int scriba_snapshot_read(const char *path, scriba_company_scan_fn company_func,
+                         scriba_poc_scan_fn poc_func, scriba_project_scan_fn project_func,
+                         scriba_event_scan_fn event_func, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRIBA_SNAPSHOT_BACKEND_H
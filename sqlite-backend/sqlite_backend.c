@@ -36,7 +36,8 @@
     "address TEXT COLLATE NOCASE,"\
     "inn TEXT,"\
     "phonenum TEXT,"\
-    "email TEXT"\
+    "email TEXT,"\
+    "hash INTEGER"\
     ")"
 
 #define COMPANY_TABLE_COLUMNS 7
@@ -51,7 +52,8 @@
     "type INTEGER,"\
     "outcome TEXT,"\
     "timestamp INTEGER,"\
-    "state INTEGER"\
+    "state INTEGER,"\
+    "hash INTEGER"\
     ")"\
 
 #define EVENT_TABLE_COLUMNS 9
@@ -66,7 +68,8 @@
     "phonenum TEXT COLLATE NOCASE,"\
     "email TEXT COLLATE NOCASE,"\
     "position TEXT COLLATE NOCASE,"\
-    "company_id BLOB"\
+    "company_id BLOB,"\
+    "hash INTEGER"\
     ")"
 
 #define POC_TABLE_COLUMNS 9
@@ -81,21 +84,168 @@
     "currency INTEGER,"\
     "cost INTEGER,"\
     "start_time INTEGER,"\
-    "mod_time INTEGER"\
+    "mod_time INTEGER,"\
+    "hash INTEGER"\
     ")"
 
 #define PROJECT_TABLE_COLUMNS 9
 
+// each entity table has hash column besides entity columns: content hash of the
+// entity data written by upsert, so that upsert of the same data does not write
+// anything; local changes reset it to NULL; databases created before the column
+// was introduced get it when they are opened
+#define ROW_HASH_TABLES { "Companies", "Events", "People", "Projects" }
+
+// change tracking: Changes keeps the last change of each entity, removed entities
+// stay there as tombstones; the change stamp is the rowid, each change replaces
+// the entity row by a new one, AUTOINCREMENT makes stamps grow and never be reused
+#define CREATE_CHANGES_TABLE "CREATE TABLE IF NOT EXISTS Changes"\
+    "("\
+    "seq INTEGER PRIMARY KEY AUTOINCREMENT,"\
+    "id BLOB,"\
+    "type INTEGER,"\
+    "removed INTEGER,"\
+    "UNIQUE(type,id)"\
+    ")"
+
+// triggers stamping every change of the table; existing databases get them
+// when they are opened, entities stored before that are not stamped
+#define CHANGE_TRIGGER(table, event, type, row, removed) \
+    "CREATE TRIGGER IF NOT EXISTS " table event " AFTER " event " ON " table " BEGIN "\
+    "INSERT OR REPLACE INTO Changes(id,type,removed) "\
+    "VALUES(" row ".id," type "," removed ");"\
+    "END;"
+
+#define CREATE_CHANGE_TRIGGERS(table, type) \
+    CHANGE_TRIGGER(table, "INSERT", type, "NEW", "0")\
+    CHANGE_TRIGGER(table, "UPDATE", type, "NEW", "0")\
+    CHANGE_TRIGGER(table, "DELETE", type, "OLD", "1")
+
+// columns selected by batch queries, in table order
+#define COMPANY_BATCH_COLUMNS "id,name,jur_name,address,inn,phonenum,email"
+#define EVENT_BATCH_COLUMNS "id,descr,company_id,poc_id,project_id,type,outcome,timestamp,state"
+#define POC_BATCH_COLUMNS "id,firstname,secondname,lastname,mobilenum,phonenum,email,position,company_id"
+#define PROJECT_BATCH_COLUMNS "id,title,descr,company_id,state,currency,cost,start_time,mod_time"
+
+// initial value of content hash
+#define ROW_HASH_INIT 14695981039346656037ULL
+
+// bulk operation query limits
+#define BULK_QUERY_SIZE 512
+#define BULK_MAX_PARAMS 16
+
+// maximum number of ids bound to a single batch query;
+// must not exceed SQLITE_MAX_VARIABLE_NUMBER
+#define BATCH_SIZE 256
+
 #define ENABLE_SYNC "PRAGMA synchronous=2"
 #define DISABLE_SYNC "PRAGMA synchronous=0"
 
+// size of the header SQLite memory allocations are prefixed with
+// when SQLite uses library allocator
+#define SQLITE_MEM_HEADER_SIZE 8
+
+// upsert statements kept prepared between calls
+enum UpsertStmt
+{
+    UPSERT_COMPANY = 0,
+    UPSERT_POC,
+    UPSERT_PROJECT,
+    UPSERT_EVENT,
+    UPSERT_STMT_NUM
+};
+
 struct ScribaSQLite
 {
     sqlite3 *db;
     char *db_filename;
     int sync;
+    // prepared upsert statements: insert unless the entity exists and
+    // update of the existing entity unless its content hash is the same
+    sqlite3_stmt *upsert_stmts[UPSERT_STMT_NUM][2];
 } *data = NULL;
 
+// read connection of the calling thread, attached by attachReader();
+// __thread rather than C11 _Thread_local, the Android build uses -std=c99
+static __thread sqlite3 *reader_db = NULL;
+
+// functions receiving entities found by a scan
+struct ScanTarget
+{
+    scriba_company_scan_fn company;
+    scriba_poc_scan_fn poc;
+    scriba_project_scan_fn project;
+    scriba_event_scan_fn event;
+    void *ctx;
+};
+
+// function called for each row returned by scan query
+typedef void (*scan_row_func)(sqlite3_stmt *stmt, const struct ScanTarget *target);
+
+// position of an id in the array passed to batch get function
+struct BatchIdPos
+{
+    scriba_id_t id;
+    size_t pos;
+};
+
+// types of bulk operation query parameters
+enum BulkParamType
+{
+    BULK_PARAM_INT = 0,
+    BULK_PARAM_ID,
+    BULK_PARAM_TEXT
+};
+
+// bulk operation query parameter
+struct BulkParam
+{
+    enum BulkParamType type;
+    sqlite3_int64 num;
+    scriba_id_t id;
+    const char *text;
+};
+
+// bulk operation query built from filter and field assignments
+struct BulkQuery
+{
+    char text[BULK_QUERY_SIZE];
+    struct BulkParam params[BULK_MAX_PARAMS];
+    int num_params;
+    int num_conditions;
+};
+
+// function called for each row returned by batch query and each position
+// the row id occupies in the requested id array
+typedef void (*batch_row_func)(sqlite3_stmt *stmt, size_t pos, void *ctx);
+
+
+
+// SQLite memory methods used when library allocator is replaced
+static void *sqlite_mem_malloc(int size);
+static void sqlite_mem_free(void *ptr);
+static void *sqlite_mem_realloc(void *ptr, int size);
+static int sqlite_mem_size(void *ptr);
+static int sqlite_mem_roundup(int size);
+static int sqlite_mem_init(void *app_data);
+static void sqlite_mem_shutdown(void *app_data);
+
+static sqlite3_mem_methods scriba_mem_methods =
+{
+    sqlite_mem_malloc,
+    sqlite_mem_free,
+    sqlite_mem_realloc,
+    sqlite_mem_size,
+    sqlite_mem_roundup,
+    sqlite_mem_init,
+    sqlite_mem_shutdown,
+    NULL
+};
+
+// SQLite memory methods that were active before the backend replaced them
+static sqlite3_mem_methods default_mem_methods;
+static int mem_methods_replaced = 0;
+
 
 
 struct ScribaInternalDB sqliteDB = 
@@ -115,12 +265,101 @@ void scriba_sqlite_cleanup();
 
 // process parameter list; returns 0 on success, 1 on failure
 static int parse_param_list(struct ScribaDBParamList *pl);
+// make SQLite use library allocator; returns 0 on success, 1 on failure
+static int configure_memory();
+// restore SQLite memory methods replaced by configure_memory()
+static void restore_memory();
 // create new database; returns 0 on success, 1 on failure
 static int create_database();
 // configure SQLite sync mode
 static int configure_sync();
+// create change tracking tables and triggers unless they exist;
+// returns 0 on success, 1 on failure
+static int configure_change_tracking();
+// add content hash column to entity tables of databases created without it;
+// returns 0 on success, 1 on failure
+static int configure_row_hashes();
 // insert % at the beginning and at the end of search string for LIKE operator
 static char *str_for_like_op(const char *src);
+// run batch query for given ids, BATCH_SIZE ids at a time; the list of id
+// placeholders is inserted between query_head and query_tail (may be NULL);
+// id_col is the column rows are matched with requested ids by;
+// returns 0 on success, 1 on failure
+static int batchQuery(const char *query_head, const char *query_tail, int id_col,
+                      const scriba_id_t *ids, size_t n, batch_row_func func, void *ctx);
+// append text to bulk operation query
+static void bulk_append(struct BulkQuery *q, const char *text);
+// append WHERE condition to bulk operation query
+static void bulk_condition(struct BulkQuery *q, const char *condition);
+// add parameters to bulk operation query
+static void bulk_param_int(struct BulkQuery *q, sqlite3_int64 num);
+static void bulk_param_id(struct BulkQuery *q, const scriba_id_t *id);
+static void bulk_param_text(struct BulkQuery *q, const char *text);
+// prepare bulk operation query and bind its parameters; returns NULL on failure
+static sqlite3_stmt *bulkPrepare(sqlite3 *db, struct BulkQuery *q);
+// bind bulk operation query parameters to prepared statement; returns 0 on success
+static int bulkBind(sqlite3_stmt *stmt, struct BulkQuery *q);
+// execute prepared bulk operation statement;
+// returns the number of changed rows or -1 on failure
+static long bulkStep(sqlite3_stmt *stmt);
+// execute bulk operation query, also used for other queries with bound parameters;
+// returns the number of changed rows or -1 on failure
+static long bulkExecute(struct BulkQuery *q);
+// execute bulk operation query using statement cached in stmt, the statement
+// is prepared on the first call and reused afterwards
+static long bulkExecuteCached(struct BulkQuery *q, sqlite3_stmt **stmt);
+// content hash of entity data, the hash of each field is added to the hash of
+// preceding fields starting with ROW_HASH_INIT
+static sqlite3_uint64 row_hash_bytes(sqlite3_uint64 hash, const void *bytes, size_t len);
+static sqlite3_uint64 row_hash_text(sqlite3_uint64 hash, const char *text);
+static sqlite3_uint64 row_hash_id(sqlite3_uint64 hash, const scriba_id_t *id);
+static sqlite3_uint64 row_hash_int(sqlite3_uint64 hash, sqlite3_int64 num);
+// run upsert statements of the given type sharing the parameters of q: insert
+// query and, if the entity exists and overwrite is non-zero, update query;
+// returns SCRIBA_UPSERT_* result or -1 on failure
+static int upsertRow(struct BulkQuery *q, const char *insert, const char *update,
+                     enum UpsertStmt type, int overwrite);
+// fill temporary table of ids scan queries are joined against
+static int scan_fill_ids(const char *table, const scriba_id_t *ids, size_t n);
+// find the range of rowids [first, last) of the table that belong to the scan
+// filter shard; returns 0 on success
+static int scan_shard_range(const char *table, const struct ScribaScanFilter *filter,
+                            sqlite3_int64 *first, sqlite3_int64 *last);
+// run scan query over the given table for all rows or only those matching the filter;
+// type is the type of the table entities, company_column is the column compared
+// with filter company ids, has_mod_time is non-zero if the table has mod_time column
+static int scanQuery(const char *table, enum ScribaEntityType type, const char *columns,
+                     const char *company_column, int has_mod_time,
+                     const struct ScribaScanFilter *filter,
+                     scan_row_func func, const struct ScanTarget *target);
+// scan query row handlers
+static void companyScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target);
+static void pocScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target);
+static void projectScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target);
+static void eventScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target);
+// scan interface functions
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx);
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx);
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx);
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx);
+static void beginRead();
+static void endRead();
+// execute transaction control statement, retrying while the database is busy;
+// returns 0 on success
+static int execTransaction(const char *query);
+static int beginWrite();
+static int commitWrite();
+static void rollbackWrite();
+// connection used for scans and read transactions by the calling thread
+static sqlite3 *read_db();
+static int attachReader();
+static void detachReader();
+static unsigned long long getChangeStamp();
+static int scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx);
+// size of entity storage required for string field
+static size_t field_size(const char *str);
+// size of entity storage required for company string field, empty strings are not stored
+static size_t company_field_size(const char *str);
 
 // create company data structure based on given parameters
 static struct ScribaCompany *fillCompanyData(scriba_id_t id, const char *name,
@@ -131,8 +370,17 @@ static struct ScribaCompany *fillCompanyData(scriba_id_t id, const char *name,
 // common company search routine
 static scriba_list_t *companySearch(const char *query, const char *text);
 
+// create company data structure from batch query row
+static struct ScribaCompany *companyFromRow(sqlite3_stmt *stmt);
+// batch query row handlers filling company data and child lists
+static void companyBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+static void companyPOCBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+static void companyProjectBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+static void companyEventBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+
 // company handling interface functions
 static struct ScribaCompany *getCompany(scriba_id_t id);
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies);
 static scriba_list_t *getAllCompanies();
 static scriba_list_t *getCompaniesByName(const char *name);
 static scriba_list_t *getCompaniesByJurName(const char *juridicial_name);
@@ -142,6 +390,7 @@ static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
                        const char *email);
 static void updateCompany(const struct ScribaCompany *company);
 static void removeCompany(scriba_id_t id);
+static int upsertCompany(const struct ScribaCompany *company, int overwrite);
 
 // create event data structure based on given parameters
 static struct ScribaEvent *fillEventData(scriba_id_t id, const char *descr,
@@ -153,8 +402,14 @@ static struct ScribaEvent *fillEventData(scriba_id_t id, const char *descr,
 // common event search routine
 static scriba_list_t *eventSearch(const char *query, scriba_id_t id);
 
+// create event data structure from batch query row
+static struct ScribaEvent *eventFromRow(sqlite3_stmt *stmt);
+// batch query row handler
+static void eventBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+
 // event handling interface functions
 static struct ScribaEvent *getEvent(scriba_id_t id);
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events);
 static scriba_list_t *getAllEvents();
 static scriba_list_t *getEventsByDescr(const char *descr);
 static scriba_list_t *getEventsByCompany(scriba_id_t id);
@@ -166,6 +421,12 @@ static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id,
                      scriba_time_t timestamp, enum ScribaEventState state);
 static void updateEvent(const struct ScribaEvent *event);
 static void removeEvent(scriba_id_t id);
+static int upsertEvent(const struct ScribaEvent *event, int overwrite);
+// build WHERE clause of event bulk operation
+static void eventFilterConditions(struct BulkQuery *q, const struct ScribaEventFilter *filter);
+static long updateEvents(const struct ScribaEventFilter *filter,
+                         const struct ScribaEventUpdate *update);
+static long removeEvents(const struct ScribaEventFilter *filter);
 
 // create POC data structure based on given parameters
 static struct ScribaPoc *fillPOCData(scriba_id_t id, const char *firstname,
@@ -184,8 +445,14 @@ static void pocExecuteQuery(sqlite3_stmt *stmt, scriba_list_t *list);
 // POC search by string routine
 static scriba_list_t *pocSearchByStr(const char *query, const char *str);
 
+// create POC data structure from batch query row
+static struct ScribaPoc *pocFromRow(sqlite3_stmt *stmt);
+// batch query row handler
+static void pocBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+
 // POC handling interface functions
 static struct ScribaPoc *getPOC(scriba_id_t id);
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people);
 static scriba_list_t *getAllPeople();
 static scriba_list_t *getPOCByName(const char *name);
 static scriba_list_t *getPOCByCompany(scriba_id_t id);
@@ -197,6 +464,7 @@ static void addPOC(scriba_id_t id, const char *firstname, const char *secondname
                    const char *email, const char *position, scriba_id_t company_id);
 static void updatePOC(const struct ScribaPoc *poc);
 static void removePOC(scriba_id_t id);
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite);
 
 // create project data structure based on given parameters
 static struct ScribaProject *fillProjectData(scriba_id_t id, const char *title, const char *descr,
@@ -207,8 +475,14 @@ static struct ScribaProject *fillProjectData(scriba_id_t id, const char *title,
 // common project search routine
 static scriba_list_t *projectSearch(sqlite3_stmt *stmt);
 
+// create project data structure from batch query row
+static struct ScribaProject *projectFromRow(sqlite3_stmt *stmt);
+// batch query row handler
+static void projectBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx);
+
 // project handling interface functions
 static struct ScribaProject *getProject(scriba_id_t id);
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects);
 static scriba_list_t *getAllProjects();
 static scriba_list_t *getProjectsByTitle(const char *title);
 static scriba_list_t *getProjectsByCompany(scriba_id_t id);
@@ -225,6 +499,14 @@ static void addProject(scriba_id_t id, const char *title, const char *descr,
                        enum ScribaCurrency currency, long long cost, scriba_time_t start_time);
 static void updateProject(struct ScribaProject *project);
 static void removeProject(scriba_id_t id);
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time);
+// build WHERE clause of project bulk operation
+static void projectFilterConditions(struct BulkQuery *q, const struct ScribaProjectFilter *filter);
+static long updateProjects(const struct ScribaProjectFilter *filter,
+                           const struct ScribaProjectUpdate *update,
+                           scriba_time_t mod_time);
+static long removeProjects(const struct ScribaProjectFilter *filter);
 
 
 
@@ -235,7 +517,7 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
         goto error;
     }
 
-    data = (struct ScribaSQLite *)malloc(sizeof (struct ScribaSQLite));
+    data = (struct ScribaSQLite *)scriba_malloc(sizeof (struct ScribaSQLite));
     memset(data, 0, sizeof (struct ScribaSQLite));
     data->sync = 1;     // sync is on by default
 
@@ -244,6 +526,11 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
         goto error;
     }
 
+    if (configure_memory() != 0)
+    {
+        goto error;
+    }
+
     // try to open database file using filename received via param list
     int err = sqlite3_open_v2(data->db_filename, &data->db, SQLITE_OPEN_READWRITE, NULL);
     if (err == SQLITE_CANTOPEN)
@@ -265,7 +552,18 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
         goto error;
     }
 
+    if (configure_change_tracking() != 0)
+    {
+        goto error;
+    }
+
+    if (configure_row_hashes() != 0)
+    {
+        goto error;
+    }
+
     fTbl->getCompany = getCompany;
+    fTbl->getCompanies = getCompanies;
     fTbl->getAllCompanies = getAllCompanies;
     fTbl->getCompaniesByName = getCompaniesByName;
     fTbl->getCompaniesByJurName = getCompaniesByJurName;
@@ -274,6 +572,7 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
     fTbl->updateCompany = updateCompany;
     fTbl->removeCompany = removeCompany;
     fTbl->getEvent = getEvent;
+    fTbl->getEvents = getEvents;
     fTbl->getAllEvents = getAllEvents;
     fTbl->getEventsByDescr = getEventsByDescr;
     fTbl->getEventsByCompany = getEventsByCompany;
@@ -284,6 +583,7 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
     fTbl->updateEvent = updateEvent;
     fTbl->removeEvent = removeEvent;
     fTbl->getPOC = getPOC;
+    fTbl->getPeople = getPeople;
     fTbl->getAllPeople = getAllPeople;
     fTbl->getPOCByName = getPOCByName;
     fTbl->getPOCByCompany = getPOCByCompany;
@@ -294,6 +594,7 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
     fTbl->updatePOC = updatePOC;
     fTbl->removePOC = removePOC;
     fTbl->getProject = getProject;
+    fTbl->getProjects = getProjects;
     fTbl->getAllProjects = getAllProjects;
     fTbl->getProjectsByTitle = getProjectsByTitle;
     fTbl->getProjectsByCompany = getProjectsByCompany;
@@ -303,6 +604,27 @@ int scriba_sqlite_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTb
     fTbl->addProject = addProject;
     fTbl->updateProject = updateProject;
     fTbl->removeProject = removeProject;
+    fTbl->updateEvents = updateEvents;
+    fTbl->removeEvents = removeEvents;
+    fTbl->updateProjects = updateProjects;
+    fTbl->removeProjects = removeProjects;
+    fTbl->upsertCompany = upsertCompany;
+    fTbl->upsertPOC = upsertPOC;
+    fTbl->upsertProject = upsertProject;
+    fTbl->upsertEvent = upsertEvent;
+    fTbl->scanCompanies = scanCompanies;
+    fTbl->scanPeople = scanPeople;
+    fTbl->scanProjects = scanProjects;
+    fTbl->scanEvents = scanEvents;
+    fTbl->beginRead = beginRead;
+    fTbl->endRead = endRead;
+    fTbl->beginWrite = beginWrite;
+    fTbl->commitWrite = commitWrite;
+    fTbl->rollbackWrite = rollbackWrite;
+    fTbl->attachReader = attachReader;
+    fTbl->detachReader = detachReader;
+    fTbl->getChangeStamp = getChangeStamp;
+    fTbl->scanRemoved = scanRemoved;
 
 success:
     return 0;
@@ -313,8 +635,10 @@ error:
         if (data->db != NULL)
         {
             sqlite3_close(data->db);
+            data->db = NULL;
         }
     }
+    restore_memory();
 
     return 1;
 }
@@ -325,7 +649,19 @@ void scriba_sqlite_cleanup()
     {
         if (data->db_filename != NULL)
         {
-            free(data->db_filename);
+            scriba_free(data->db_filename);
+        }
+
+        // cached statements must be finalized before the database is closed
+        for (int i = 0; i < UPSERT_STMT_NUM; i++)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                if (data->upsert_stmts[i][j] != NULL)
+                {
+                    sqlite3_finalize(data->upsert_stmts[i][j]);
+                }
+            }
         }
 
         if (data->db != NULL)
@@ -333,9 +669,11 @@ void scriba_sqlite_cleanup()
             sqlite3_close(data->db);
         }
 
-        free(data);
+        scriba_free(data);
         data = NULL;
     }
+
+    restore_memory();
 }
 
 static int parse_param_list(struct ScribaDBParamList *pl)
@@ -358,7 +696,7 @@ static int parse_param_list(struct ScribaDBParamList *pl)
         {
             name_found = 1;
             int len = strlen(param->value);
-            data->db_filename = (char *)malloc(len + 1);
+            data->db_filename = (char *)scriba_malloc(len + 1);
             memset(data->db_filename, 0, len + 1);
             strcpy(data->db_filename, param->value);
         }
@@ -380,6 +718,120 @@ static int parse_param_list(struct ScribaDBParamList *pl)
     return !name_found;
 }
 
+// make SQLite use library allocator
+static int configure_memory()
+{
+    if (!scriba_has_custom_allocator())
+    {
+        return 0;
+    }
+
+    // memory methods may only be changed while SQLite is not initialized;
+    // SQLite already used by the host process is not shut down, it keeps
+    // its own allocator
+    if (sqlite3_config(SQLITE_CONFIG_GETMALLOC, &default_mem_methods) != SQLITE_OK)
+    {
+        return 0;
+    }
+    if (sqlite3_config(SQLITE_CONFIG_MALLOC, &scriba_mem_methods) != SQLITE_OK)
+    {
+        return 1;
+    }
+    mem_methods_replaced = 1;
+
+    return 0;
+}
+
+// restore SQLite memory methods
+static void restore_memory()
+{
+    if (!mem_methods_replaced)
+    {
+        return;
+    }
+
+    // release all memory SQLite obtained from the library allocator
+    sqlite3_shutdown();
+    sqlite3_config(SQLITE_CONFIG_MALLOC, &default_mem_methods);
+    mem_methods_replaced = 0;
+}
+
+/* SQLite memory methods. SQLite requires allocation size to be known,
+ * so each allocation is prefixed with a header holding its size. */
+
+static void *sqlite_mem_malloc(int size)
+{
+    sqlite3_int64 *block = NULL;
+
+    if (size <= 0)
+    {
+        return NULL;
+    }
+
+    block = (sqlite3_int64 *)scriba_malloc(size + SQLITE_MEM_HEADER_SIZE);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    block[0] = size;
+
+    return (void *)(block + 1);
+}
+
+static void sqlite_mem_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        scriba_free((sqlite3_int64 *)ptr - 1);
+    }
+}
+
+static void *sqlite_mem_realloc(void *ptr, int size)
+{
+    sqlite3_int64 *block = NULL;
+
+    if (ptr == NULL)
+    {
+        return sqlite_mem_malloc(size);
+    }
+
+    block = (sqlite3_int64 *)scriba_realloc((sqlite3_int64 *)ptr - 1,
+                                            size + SQLITE_MEM_HEADER_SIZE);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    block[0] = size;
+
+    return (void *)(block + 1);
+}
+
+static int sqlite_mem_size(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return 0;
+    }
+
+    return (int)((sqlite3_int64 *)ptr)[-1];
+}
+
+static int sqlite_mem_roundup(int size)
+{
+    return (size + 7) & ~7;
+}
+
+static int sqlite_mem_init(void *app_data)
+{
+    (void)app_data;
+    return SQLITE_OK;
+}
+
+static void sqlite_mem_shutdown(void *app_data)
+{
+    (void)app_data;
+}
+
 // create new database; returns 0 on success, 1 on failure
 static int create_database()
 {
@@ -447,6 +899,65 @@ error:
     return 1;
 }
 
+// create change tracking tables and triggers
+static int configure_change_tracking()
+{
+    const char *queries[] =
+    {
+        CREATE_CHANGES_TABLE,
+        CREATE_CHANGE_TRIGGERS("Companies", "0"),
+        CREATE_CHANGE_TRIGGERS("Events", "1"),
+        CREATE_CHANGE_TRIGGERS("People", "2"),
+        CREATE_CHANGE_TRIGGERS("Projects", "3")
+    };
+
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof (queries) / sizeof (queries[0]); i++)
+    {
+        if (sqlite3_exec(data->db, queries[i], NULL, NULL, NULL) != SQLITE_OK)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int configure_row_hashes()
+{
+    const char *tables[] = ROW_HASH_TABLES;
+    char query[64];
+
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof (tables) / sizeof (tables[0]); i++)
+    {
+        sqlite3_stmt *stmt = NULL;
+
+        // the query can only be prepared if the column exists
+        snprintf(query, sizeof (query), "SELECT hash FROM %s LIMIT 0", tables[i]);
+        int err = sqlite3_prepare_v2(data->db, query, -1, &stmt, NULL);
+        sqlite3_finalize(stmt);
+        if (err == SQLITE_OK)
+        {
+            continue;
+        }
+
+        snprintf(query, sizeof (query), "ALTER TABLE %s ADD COLUMN hash INTEGER", tables[i]);
+        if (sqlite3_exec(data->db, query, NULL, NULL, NULL) != SQLITE_OK)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // insert % at the beginning and at the end of search string for LIKE operator
 static char *str_for_like_op(const char *src)
 {
@@ -455,10 +966,968 @@ static char *str_for_like_op(const char *src)
         return NULL;
     }
 
-    int len = strlen(src) + 3; // 2 '%' and terminating 0
-    char *result = (char *)malloc(len);
-    snprintf(result, len, "%%%s%%", src);
-    return result;
+    int len = strlen(src) + 3; // 2 '%' and terminating 0
+    char *result = (char *)scriba_malloc(len);
+    snprintf(result, len, "%%%s%%", src);
+    return result;
+}
+
+// size of entity storage required for string field
+static size_t field_size(const char *str)
+{
+    return (str != NULL) ? strlen(str) + 1 : 0;
+}
+
+// size of entity storage required for company string field
+static size_t company_field_size(const char *str)
+{
+    return ((str != NULL) && (*str != 0)) ? strlen(str) + 1 : 0;
+}
+
+// compare ids of batch id positions, used to sort and search them
+static int batch_id_compare(const void *a, const void *b)
+{
+    const scriba_id_t *id1 = &(((const struct BatchIdPos *)a)->id);
+    const scriba_id_t *id2 = &(((const struct BatchIdPos *)b)->id);
+
+    if (id1->_high != id2->_high)
+    {
+        return (id1->_high < id2->_high) ? -1 : 1;
+    }
+    if (id1->_low != id2->_low)
+    {
+        return (id1->_low < id2->_low) ? -1 : 1;
+    }
+    return 0;
+}
+
+// build batch query text with num placeholders
+static char *batch_query_text(const char *query_head, const char *query_tail, size_t num)
+{
+    size_t head_len = strlen(query_head);
+    size_t tail_len = (query_tail != NULL) ? strlen(query_tail) : 0;
+    // 2 brackets, num placeholders, num - 1 commas and terminating 0
+    char *query = (char *)scriba_malloc(head_len + tail_len + num * 2 + 2);
+    char *cur = query;
+
+    if (query == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(cur, query_head, head_len);
+    cur += head_len;
+    *cur++ = '(';
+    for (size_t i = 0; i < num; i++)
+    {
+        if (i != 0)
+        {
+            *cur++ = ',';
+        }
+        *cur++ = '?';
+    }
+    *cur++ = ')';
+    if (tail_len != 0)
+    {
+        memcpy(cur, query_tail, tail_len);
+        cur += tail_len;
+    }
+    *cur = 0;
+
+    return query;
+}
+
+// run batch query for given ids
+static int batchQuery(const char *query_head, const char *query_tail, int id_col,
+                      const scriba_id_t *ids, size_t n, batch_row_func func, void *ctx)
+{
+    struct BatchIdPos *index = NULL;
+    sqlite3_stmt *stmt = NULL;
+    size_t stmt_size = 0;       // number of placeholders in the prepared statement
+    int ret = 1;
+
+    if ((data == NULL) || (ids == NULL) || (func == NULL))
+    {
+        goto exit;
+    }
+
+    index = (struct BatchIdPos *)scriba_malloc(n * sizeof (struct BatchIdPos));
+    if ((index == NULL) && (n != 0))
+    {
+        goto exit;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        scriba_id_copy(&(index[i].id), &(ids[i]));
+        index[i].pos = i;
+    }
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        size_t chunk = ((n - start) > BATCH_SIZE) ? BATCH_SIZE : (n - start);
+        struct BatchIdPos *chunk_index = index + start;
+
+        // statement prepared for the previous chunk is reused if its size fits
+        if (chunk != stmt_size)
+        {
+            if (stmt != NULL)
+            {
+                sqlite3_finalize(stmt);
+                stmt = NULL;
+            }
+
+            char *query = batch_query_text(query_head, query_tail, chunk);
+            if (query == NULL)
+            {
+                goto exit;
+            }
+            int err = sqlite3_prepare_v2(data->db, query, -1, &stmt, NULL);
+            scriba_free(query);
+            if (err != SQLITE_OK)
+            {
+                goto exit;
+            }
+            stmt_size = chunk;
+        }
+        else
+        {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            void *id_blob = scriba_id_to_blob(&(chunk_index[i].id));
+            int err = sqlite3_bind_blob(stmt,
+                                        (int)i + 1,
+                                        id_blob,
+                                        SCRIBA_ID_BLOB_SIZE,
+                                        SQLITE_TRANSIENT);
+            scriba_free(id_blob);
+            if (err != SQLITE_OK)
+            {
+                goto exit;
+            }
+        }
+
+        // rows are matched with requested positions by id
+        qsort(chunk_index, chunk, sizeof (struct BatchIdPos), batch_id_compare);
+
+        while (1)
+        {
+            int err = sqlite3_step(stmt);
+            if (err == SQLITE_BUSY)
+            {
+                // retry
+                continue;
+            }
+            else if (err == SQLITE_ROW)
+            {
+                struct BatchIdPos key;
+                scriba_id_from_blob(sqlite3_column_blob(stmt, id_col), &(key.id));
+
+                // find the first position of the id, the same id may be requested several times
+                size_t lo = 0;
+                size_t hi = chunk;
+                while (lo < hi)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    if (batch_id_compare(&(chunk_index[mid]), &key) < 0)
+                    {
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        hi = mid;
+                    }
+                }
+                for (size_t i = lo; (i < chunk) && (batch_id_compare(&(chunk_index[i]), &key) == 0); i++)
+                {
+                    func(stmt, chunk_index[i].pos, ctx);
+                }
+            }
+            else if (err == SQLITE_DONE)
+            {
+                break;
+            }
+            else
+            {
+                // this should not happen
+                goto exit;
+            }
+        }
+    }
+
+    ret = 0;
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    if (index != NULL)
+    {
+        scriba_free(index);
+    }
+    return ret;
+}
+
+// append text to bulk operation query
+static void bulk_append(struct BulkQuery *q, const char *text)
+{
+    strncat(q->text, text, BULK_QUERY_SIZE - strlen(q->text) - 1);
+}
+
+// append WHERE condition to bulk operation query
+static void bulk_condition(struct BulkQuery *q, const char *condition)
+{
+    bulk_append(q, (q->num_conditions == 0) ? " WHERE " : " AND ");
+    bulk_append(q, condition);
+    q->num_conditions++;
+}
+
+static void bulk_param_int(struct BulkQuery *q, sqlite3_int64 num)
+{
+    if (q->num_params < BULK_MAX_PARAMS)
+    {
+        q->params[q->num_params].type = BULK_PARAM_INT;
+        q->params[q->num_params].num = num;
+        q->num_params++;
+    }
+}
+
+static void bulk_param_id(struct BulkQuery *q, const scriba_id_t *id)
+{
+    if (q->num_params < BULK_MAX_PARAMS)
+    {
+        q->params[q->num_params].type = BULK_PARAM_ID;
+        scriba_id_copy(&(q->params[q->num_params].id), id);
+        q->num_params++;
+    }
+}
+
+static void bulk_param_text(struct BulkQuery *q, const char *text)
+{
+    if (q->num_params < BULK_MAX_PARAMS)
+    {
+        q->params[q->num_params].type = BULK_PARAM_TEXT;
+        q->params[q->num_params].text = text;
+        q->num_params++;
+    }
+}
+
+// prepare bulk operation query and bind its parameters
+static sqlite3_stmt *bulkPrepare(sqlite3 *db, struct BulkQuery *q)
+{
+    sqlite3_stmt *stmt = NULL;
+
+    if (sqlite3_prepare_v2(db, q->text, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        goto error;
+    }
+
+    if (bulkBind(stmt, q) != 0)
+    {
+        goto error;
+    }
+
+    return stmt;
+
+error:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return NULL;
+}
+
+// bind bulk operation query parameters
+static int bulkBind(sqlite3_stmt *stmt, struct BulkQuery *q)
+{
+    for (int i = 0; i < q->num_params; i++)
+    {
+        int err = SQLITE_OK;
+        void *id_blob = NULL;
+
+        switch (q->params[i].type)
+        {
+        case BULK_PARAM_INT:
+            err = sqlite3_bind_int64(stmt, i + 1, q->params[i].num);
+            break;
+        case BULK_PARAM_ID:
+            id_blob = scriba_id_to_blob(&(q->params[i].id));
+            err = sqlite3_bind_blob(stmt, i + 1, id_blob, SCRIBA_ID_BLOB_SIZE, SQLITE_TRANSIENT);
+            scriba_free(id_blob);
+            break;
+        case BULK_PARAM_TEXT:
+            err = sqlite3_bind_text(stmt, i + 1, q->params[i].text, -1, SQLITE_TRANSIENT);
+            break;
+        }
+        if (err != SQLITE_OK)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// execute prepared bulk operation statement
+static long bulkStep(sqlite3_stmt *stmt)
+{
+    long ret = -1;
+
+    while (1)
+    {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        else if (err == SQLITE_DONE)
+        {
+            ret = (long)sqlite3_changes(data->db);
+            break;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+// execute bulk operation query
+static long bulkExecute(struct BulkQuery *q)
+{
+    sqlite3_stmt *stmt = NULL;
+    long ret = -1;
+
+    if (data == NULL)
+    {
+        goto exit;
+    }
+
+    stmt = bulkPrepare(data->db, q);
+    if (stmt == NULL)
+    {
+        goto exit;
+    }
+
+    ret = bulkStep(stmt);
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+// execute bulk operation query using cached statement
+static long bulkExecuteCached(struct BulkQuery *q, sqlite3_stmt **stmt)
+{
+    long ret = -1;
+
+    if (data == NULL)
+    {
+        return -1;
+    }
+
+    if (*stmt == NULL)
+    {
+        if (sqlite3_prepare_v2(data->db, q->text, -1, stmt, NULL) != SQLITE_OK)
+        {
+            sqlite3_finalize(*stmt);
+            *stmt = NULL;
+            return -1;
+        }
+    }
+
+    if (bulkBind(*stmt, q) == 0)
+    {
+        ret = bulkStep(*stmt);
+    }
+
+    // reset the statement right away, so that it does not keep the database locked
+    sqlite3_reset(*stmt);
+    sqlite3_clear_bindings(*stmt);
+    return ret;
+}
+
+static sqlite3_uint64 row_hash_bytes(sqlite3_uint64 hash, const void *bytes, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)bytes;
+
+    // FNV-1a
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static sqlite3_uint64 row_hash_text(sqlite3_uint64 hash, const char *text)
+{
+    // length prefix keeps field boundaries, NULL differs from empty string
+    sqlite3_int64 len = (text != NULL) ? (sqlite3_int64)strlen(text) : -1;
+
+    hash = row_hash_int(hash, len);
+    return (text != NULL) ? row_hash_bytes(hash, text, (size_t)len) : hash;
+}
+
+static sqlite3_uint64 row_hash_id(sqlite3_uint64 hash, const scriba_id_t *id)
+{
+    hash = row_hash_int(hash, (sqlite3_int64)(id->_high));
+    return row_hash_int(hash, (sqlite3_int64)(id->_low));
+}
+
+static sqlite3_uint64 row_hash_int(sqlite3_uint64 hash, sqlite3_int64 num)
+{
+    return row_hash_bytes(hash, &num, sizeof (num));
+}
+
+static int upsertRow(struct BulkQuery *q, const char *insert, const char *update,
+                     enum UpsertStmt type, int overwrite)
+{
+    // query text is only used when the statement is prepared for the first time
+    q->text[0] = '\0';
+    bulk_append(q, insert);
+    long ret = bulkExecuteCached(q, &(data->upsert_stmts[type][0]));
+    if (ret != 0)
+    {
+        return (ret > 0) ? SCRIBA_UPSERT_INSERTED : -1;
+    }
+    if (!overwrite)
+    {
+        return SCRIBA_UPSERT_KEPT;
+    }
+
+    q->text[0] = '\0';
+    bulk_append(q, update);
+    ret = bulkExecuteCached(q, &(data->upsert_stmts[type][1]));
+    if (ret < 0)
+    {
+        return -1;
+    }
+    return (ret > 0) ? SCRIBA_UPSERT_UPDATED : SCRIBA_UPSERT_KEPT;
+}
+
+// fill temporary table of ids scan queries are joined against
+static int scan_fill_ids(const char *table, const scriba_id_t *ids, size_t n)
+{
+    char query[128];
+    sqlite3 *db = read_db();
+    sqlite3_stmt *stmt = NULL;
+    int ret = 1;
+
+    snprintf(query, sizeof (query), "CREATE TEMP TABLE IF NOT EXISTS %s(id BLOB PRIMARY KEY)", table);
+    if (sqlite3_exec(db, query, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        goto exit;
+    }
+    snprintf(query, sizeof (query), "DELETE FROM temp.%s", table);
+    if (sqlite3_exec(db, query, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        goto exit;
+    }
+
+    snprintf(query, sizeof (query), "INSERT OR IGNORE INTO temp.%s(id) VALUES(?)", table);
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        goto exit;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        void *id_blob = scriba_id_to_blob(&(ids[i]));
+        int err = sqlite3_bind_blob(stmt, 1, id_blob, SCRIBA_ID_BLOB_SIZE, SQLITE_TRANSIENT);
+        scriba_free(id_blob);
+        if (err != SQLITE_OK)
+        {
+            goto exit;
+        }
+        while (1)
+        {
+            err = sqlite3_step(stmt);
+            if (err != SQLITE_BUSY)
+            {
+                break;
+            }
+        }
+        if (err != SQLITE_DONE)
+        {
+            goto exit;
+        }
+        sqlite3_reset(stmt);
+    }
+    ret = 0;
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+// find rowid range of the scan filter shard
+static int scan_shard_range(const char *table, const struct ScribaScanFilter *filter,
+                            sqlite3_int64 *first, sqlite3_int64 *last)
+{
+    char query[128];
+    sqlite3_stmt *stmt = NULL;
+    int ret = 1;
+
+    snprintf(query, sizeof (query), "SELECT min(rowid), max(rowid) FROM %s", table);
+    if (sqlite3_prepare_v2(read_db(), query, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        goto exit;
+    }
+    while (1)
+    {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        if (err != SQLITE_ROW)
+        {
+            goto exit;
+        }
+        break;
+    }
+
+    if (sqlite3_column_type(stmt, 0) == SQLITE_NULL)
+    {
+        // empty table, every shard is empty
+        *first = 0;
+        *last = 0;
+    }
+    else
+    {
+        // rowid range is split into num_shards parts that differ in size by one at most
+        sqlite3_int64 min = sqlite3_column_int64(stmt, 0);
+        sqlite3_uint64 span = (sqlite3_uint64)(sqlite3_column_int64(stmt, 1) - min) + 1;
+        sqlite3_uint64 size = span / filter->num_shards;
+        sqlite3_uint64 rem = span % filter->num_shards;
+
+        *first = min + (sqlite3_int64)(size * filter->shard +
+                                       ((filter->shard < rem) ? filter->shard : rem));
+        *last = *first + (sqlite3_int64)(size + ((filter->shard < rem) ? 1 : 0));
+    }
+    ret = 0;
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+// run scan query
+static int scanQuery(const char *table, enum ScribaEntityType type, const char *columns,
+                     const char *company_column, int has_mod_time,
+                     const struct ScribaScanFilter *filter,
+                     scan_row_func func, const struct ScanTarget *target)
+{
+    struct BulkQuery q;
+    sqlite3_stmt *stmt = NULL;
+    int ret = 1;
+
+    if (data == NULL)
+    {
+        goto exit;
+    }
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "SELECT ");
+    bulk_append(&q, columns);
+    bulk_append(&q, " FROM ");
+    bulk_append(&q, table);
+    if (filter != NULL)
+    {
+        // id sets are joined against the table in a single query
+        if (filter->ids != NULL)
+        {
+            if (scan_fill_ids("ScanIds", filter->ids, filter->num_ids) != 0)
+            {
+                goto exit;
+            }
+            bulk_condition(&q, "id IN (SELECT id FROM temp.ScanIds)");
+        }
+        if (filter->company_ids != NULL)
+        {
+            if (scan_fill_ids("ScanCompanyIds", filter->company_ids, filter->num_company_ids) != 0)
+            {
+                goto exit;
+            }
+            bulk_condition(&q, company_column);
+            bulk_append(&q, " IN (SELECT id FROM temp.ScanCompanyIds)");
+        }
+        if (filter->use_mod_since && has_mod_time)
+        {
+            bulk_condition(&q, "mod_time>=?");
+            bulk_param_int(&q, (sqlite3_int64)(filter->mod_since));
+        }
+        // changed entities are looked up by change stamp, so the scan does not depend
+        // on the table size; unary plus keeps the planner from choosing the unique
+        // index by type, which covers all entities of the table
+        if (filter->use_changed_since)
+        {
+            bulk_condition(&q, "id IN (SELECT id FROM Changes WHERE +type=? AND seq>? AND removed=0)");
+            bulk_param_int(&q, (sqlite3_int64)type);
+            bulk_param_int(&q, (sqlite3_int64)(filter->changed_since));
+        }
+        // shards are contiguous rowid ranges, so that each shard only reads its own pages
+        if (filter->num_shards > 1)
+        {
+            sqlite3_int64 first = 0;
+            sqlite3_int64 last = 0;
+
+            if (scan_shard_range(table, filter, &first, &last) != 0)
+            {
+                goto exit;
+            }
+            bulk_condition(&q, "rowid>=? AND rowid<?");
+            bulk_param_int(&q, first);
+            bulk_param_int(&q, last);
+        }
+    }
+
+    stmt = bulkPrepare(read_db(), &q);
+    if (stmt == NULL)
+    {
+        goto exit;
+    }
+
+    while (1)
+    {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_ROW)
+        {
+            func(stmt, target);
+        }
+        else if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        else
+        {
+            if (err == SQLITE_DONE)
+            {
+                ret = 0;
+            }
+            break;
+        }
+    }
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    // do not keep id sets in memory between scans
+    if ((data != NULL) && (filter != NULL) && (filter->ids != NULL))
+    {
+        sqlite3_exec(read_db(), "DELETE FROM temp.ScanIds", NULL, NULL, NULL);
+    }
+    if ((data != NULL) && (filter != NULL) && (filter->company_ids != NULL))
+    {
+        sqlite3_exec(read_db(), "DELETE FROM temp.ScanCompanyIds", NULL, NULL, NULL);
+    }
+    return ret;
+}
+
+// scan row handlers pass column values to the scan function directly,
+// entity data is only valid until the next step of the query
+static void companyScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target)
+{
+    struct ScribaCompany company;
+
+    memset(&company, 0, sizeof (company));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &(company.id));
+    company.name = (char *)sqlite3_column_text(stmt, 1);
+    company.jur_name = (char *)sqlite3_column_text(stmt, 2);
+    company.address = (char *)sqlite3_column_text(stmt, 3);
+    company.inn = (char *)sqlite3_column_text(stmt, 4);
+    company.phonenum = (char *)sqlite3_column_text(stmt, 5);
+    company.email = (char *)sqlite3_column_text(stmt, 6);
+    target->company(&company, target->ctx);
+}
+
+static void pocScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target)
+{
+    struct ScribaPoc poc;
+
+    memset(&poc, 0, sizeof (poc));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &(poc.id));
+    poc.firstname = (char *)sqlite3_column_text(stmt, 1);
+    poc.secondname = (char *)sqlite3_column_text(stmt, 2);
+    poc.lastname = (char *)sqlite3_column_text(stmt, 3);
+    poc.mobilenum = (char *)sqlite3_column_text(stmt, 4);
+    poc.phonenum = (char *)sqlite3_column_text(stmt, 5);
+    poc.email = (char *)sqlite3_column_text(stmt, 6);
+    poc.position = (char *)sqlite3_column_text(stmt, 7);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 8), &(poc.company_id));
+    target->poc(&poc, target->ctx);
+}
+
+static void projectScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target)
+{
+    struct ScribaProject project;
+
+    memset(&project, 0, sizeof (project));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &(project.id));
+    project.title = (char *)sqlite3_column_text(stmt, 1);
+    project.descr = (char *)sqlite3_column_text(stmt, 2);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 3), &(project.company_id));
+    project.state = (enum ScribaProjectState)sqlite3_column_int(stmt, 4);
+    project.currency = (enum ScribaCurrency)sqlite3_column_int(stmt, 5);
+    project.cost = (long long)sqlite3_column_int64(stmt, 6);
+    project.start_time = (scriba_time_t)sqlite3_column_int64(stmt, 7);
+    project.mod_time = (scriba_time_t)sqlite3_column_int64(stmt, 8);
+    target->project(&project, target->ctx);
+}
+
+static void eventScanRow(sqlite3_stmt *stmt, const struct ScanTarget *target)
+{
+    struct ScribaEvent event;
+
+    memset(&event, 0, sizeof (event));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &(event.id));
+    event.descr = (char *)sqlite3_column_text(stmt, 1);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 2), &(event.company_id));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 3), &(event.poc_id));
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 4), &(event.project_id));
+    event.type = (enum ScribaEventType)sqlite3_column_int(stmt, 5);
+    event.outcome = (char *)sqlite3_column_text(stmt, 6);
+    event.timestamp = (scriba_time_t)sqlite3_column_int64(stmt, 7);
+    event.state = (enum ScribaEventState)sqlite3_column_int(stmt, 8);
+    target->event(&event, target->ctx);
+}
+
+static int scanCompanies(const struct ScribaScanFilter *filter, scriba_company_scan_fn func, void *ctx)
+{
+    struct ScanTarget target;
+
+    memset(&target, 0, sizeof (target));
+    target.company = func;
+    target.ctx = ctx;
+    return scanQuery("Companies", SCRIBA_ENTITY_COMPANY, COMPANY_BATCH_COLUMNS, "id", 0, filter, companyScanRow, &target);
+}
+
+static int scanPeople(const struct ScribaScanFilter *filter, scriba_poc_scan_fn func, void *ctx)
+{
+    struct ScanTarget target;
+
+    memset(&target, 0, sizeof (target));
+    target.poc = func;
+    target.ctx = ctx;
+    return scanQuery("People", SCRIBA_ENTITY_POC, POC_BATCH_COLUMNS, "company_id", 0, filter, pocScanRow, &target);
+}
+
+static int scanProjects(const struct ScribaScanFilter *filter, scriba_project_scan_fn func, void *ctx)
+{
+    struct ScanTarget target;
+
+    memset(&target, 0, sizeof (target));
+    target.project = func;
+    target.ctx = ctx;
+    return scanQuery("Projects", SCRIBA_ENTITY_PROJECT, PROJECT_BATCH_COLUMNS, "company_id", 1, filter, projectScanRow, &target);
+}
+
+static int scanEvents(const struct ScribaScanFilter *filter, scriba_event_scan_fn func, void *ctx)
+{
+    struct ScanTarget target;
+
+    memset(&target, 0, sizeof (target));
+    target.event = func;
+    target.ctx = ctx;
+    return scanQuery("Events", SCRIBA_ENTITY_EVENT, EVENT_BATCH_COLUMNS, "company_id", 0, filter, eventScanRow, &target);
+}
+
+// the database snapshot is taken right away by reading the schema and kept
+// until the transaction ends; the shared lock held meanwhile keeps writers
+// from committing, so readers attached to other threads see the same data
+static void beginRead()
+{
+    if (data != NULL)
+    {
+        sqlite3_exec(read_db(), "BEGIN", NULL, NULL, NULL);
+        sqlite3_exec(read_db(), "SELECT count(*) FROM sqlite_master", NULL, NULL, NULL);
+    }
+}
+
+static void endRead()
+{
+    if (data != NULL)
+    {
+        sqlite3_exec(read_db(), "COMMIT", NULL, NULL, NULL);
+    }
+}
+
+static sqlite3 *read_db()
+{
+    return (reader_db != NULL) ? reader_db : data->db;
+}
+
+// reader connections of all threads should be detached before backend cleanup
+static int attachReader()
+{
+    if ((data == NULL) || (reader_db != NULL))
+    {
+        return 1;
+    }
+
+    if (sqlite3_open_v2(data->db_filename, &reader_db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        sqlite3_close(reader_db);
+        reader_db = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+static void detachReader()
+{
+    if (reader_db != NULL)
+    {
+        sqlite3_close(reader_db);
+        reader_db = NULL;
+    }
+}
+
+static unsigned long long getChangeStamp()
+{
+    sqlite3_stmt *stmt = NULL;
+    unsigned long long ret = 0;
+
+    if (data == NULL)
+    {
+        goto exit;
+    }
+
+    // the last stamp stays in sqlite_sequence, there is no row before the first change
+    if (sqlite3_prepare_v2(read_db(), "SELECT seq FROM sqlite_sequence WHERE name='Changes'",
+                           -1, &stmt, NULL) != SQLITE_OK)
+    {
+        goto exit;
+    }
+    while (1)
+    {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_ROW)
+        {
+            ret = (unsigned long long)sqlite3_column_int64(stmt, 0);
+        }
+        else if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        break;
+    }
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+static int scanRemoved(unsigned long long since, scriba_removed_scan_fn func, void *ctx)
+{
+    struct BulkQuery q;
+    sqlite3_stmt *stmt = NULL;
+    int ret = 1;
+
+    if (data == NULL)
+    {
+        goto exit;
+    }
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "SELECT id,type FROM Changes WHERE seq>? AND removed=1");
+    bulk_param_int(&q, (sqlite3_int64)since);
+    stmt = bulkPrepare(read_db(), &q);
+    if (stmt == NULL)
+    {
+        goto exit;
+    }
+
+    while (1)
+    {
+        int err = sqlite3_step(stmt);
+        if (err == SQLITE_ROW)
+        {
+            scriba_id_t id;
+
+            scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+            func(&id, (enum ScribaEntityType)sqlite3_column_int(stmt, 1), ctx);
+        }
+        else if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        else
+        {
+            if (err == SQLITE_DONE)
+            {
+                ret = 0;
+            }
+            break;
+        }
+    }
+
+exit:
+    if (stmt != NULL)
+    {
+        sqlite3_finalize(stmt);
+    }
+    return ret;
+}
+
+static int execTransaction(const char *query)
+{
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    while (1)
+    {
+        int err = sqlite3_exec(data->db, query, NULL, NULL, NULL);
+        if (err == SQLITE_BUSY)
+        {
+            // retry
+            continue;
+        }
+        return (err == SQLITE_OK) ? 0 : 1;
+    }
+}
+
+static int beginWrite()
+{
+    // write lock is taken right away, so that the transaction does not
+    // fail half way because of another writer
+    return execTransaction("BEGIN IMMEDIATE");
+}
+
+static int commitWrite()
+{
+    return execTransaction("COMMIT");
+}
+
+static void rollbackWrite()
+{
+    execTransaction("ROLLBACK");
 }
 
 // create company data structure based on given parameters
@@ -467,68 +1936,45 @@ static struct ScribaCompany *fillCompanyData(scriba_id_t id, const char *name,
                                              const char *inn, const char *phonenum,
                                              const char *email)
 {
-    int len = 0;
-    struct ScribaCompany *company = (struct ScribaCompany *)malloc(sizeof (struct ScribaCompany));
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    // empty strings are not stored
+    size_t str_size = company_field_size(name) + company_field_size(jur_name) +
+                      company_field_size(addr) + company_field_size(inn) +
+                      company_field_size(phonenum) + company_field_size(email);
+    struct ScribaCompany *company = (struct ScribaCompany *)scriba_entity_alloc(sizeof (struct ScribaCompany),
+                                                                                str_size, &str_buf, &layout);
     if (company == NULL)
     {
         return NULL;
     }
-    memset((void *)company, 0, sizeof (struct ScribaCompany));
+    company->layout = (char)layout;
 
     scriba_id_copy(&(company->id), &id);
-    if (name != NULL)
+    if (company_field_size(name) != 0)
     {
-        len = strlen(name);
-        if (len != 0)
-        {
-            company->name = (char *)malloc(len + 1);
-            strcpy(company->name, name);
-        }
+        company->name = scriba_entity_strcpy(&str_buf, name);
     }
-    if (jur_name != NULL)
+    if (company_field_size(jur_name) != 0)
     {
-        len = strlen(jur_name);
-        if (len != 0)
-        {
-            company->jur_name = (char *)malloc(len + 1);
-            strcpy(company->jur_name, jur_name);
-        }
+        company->jur_name = scriba_entity_strcpy(&str_buf, jur_name);
     }
-    if (addr != NULL)
+    if (company_field_size(addr) != 0)
     {
-        len = strlen(addr);
-        if (len != 0)
-        {
-            company->address = (char *)malloc(len + 1);
-            strcpy(company->address, addr);
-        }
+        company->address = scriba_entity_strcpy(&str_buf, addr);
     }
-    if (inn != NULL)
+    if (company_field_size(inn) != 0)
     {
-        len = strlen(inn);
-        if (len != 0)
-        {
-            company->inn = (char *)malloc(len + 1);
-            strcpy(company->inn, inn);
-        }
+        company->inn = scriba_entity_strcpy(&str_buf, inn);
     }
-    if (phonenum != NULL)
+    if (company_field_size(phonenum) != 0)
     {
-        len = strlen(phonenum);
-        if (len != 0)
-        {
-            company->phonenum = (char *)malloc(len + 1);
-            strcpy(company->phonenum, phonenum);
-        }
+        company->phonenum = scriba_entity_strcpy(&str_buf, phonenum);
     }
-    if (email != NULL)
+    if (company_field_size(email) != 0)
     {
-        len = strlen(email);
-        if (len != 0)
-        {
-            company->email = (char *)malloc(len + 1);
-            strcpy(company->email, email);
-        }
+        company->email = scriba_entity_strcpy(&str_buf, email);
     }
 
     return company;
@@ -579,11 +2025,11 @@ static scriba_list_t *companySearch(const char *query, const char *text)
             if (name != NULL)
             {
                 int len = strlen(name);
-                company_name = (char *)malloc(len + 1);
+                company_name = (char *)scriba_malloc(len + 1);
                 strcpy(company_name, name);
                 company_name[len] = 0;
                 scriba_list_add(companies, id, company_name);
-                free(company_name);
+                scriba_free(company_name);
             }
             else
             {
@@ -623,7 +2069,7 @@ static struct ScribaCompany *getCompany(scriba_id_t id)
     }
 
     // prepare query
-    sprintf(query, "SELECT * FROM Companies WHERE id=?");
+    sprintf(query, "SELECT " COMPANY_BATCH_COLUMNS " FROM Companies WHERE id=?");
 
     if (sqlite3_prepare_v2(data->db, query, -1, &sqlite_stmt, NULL) != SQLITE_OK)
     {
@@ -679,14 +2125,14 @@ static struct ScribaCompany *getCompany(scriba_id_t id)
     sqlite3_finalize(sqlite_stmt);
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return company;
 
 error:
     if (company != NULL)
     {
-        free(company);
+        scriba_free(company);
     }
     if (sqlite_stmt != NULL)
     {
@@ -694,12 +2140,150 @@ error:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 
     return NULL;
 }
 
+// create company data structure from batch query row
+static struct ScribaCompany *companyFromRow(sqlite3_stmt *stmt)
+{
+    scriba_id_t id;
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+
+    return fillCompanyData(id,
+                           (const char *)sqlite3_column_text(stmt, 1),
+                           (const char *)sqlite3_column_text(stmt, 2),
+                           (const char *)sqlite3_column_text(stmt, 3),
+                           (const char *)sqlite3_column_text(stmt, 4),
+                           (const char *)sqlite3_column_text(stmt, 5),
+                           (const char *)sqlite3_column_text(stmt, 6));
+}
+
+static void companyBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaCompany **companies = (struct ScribaCompany **)ctx;
+    struct ScribaCompany *company = companyFromRow(stmt);
+
+    if (company != NULL)
+    {
+        // child lists are filled by subsequent batch queries
+        company->poc_list = scriba_list_init();
+        company->proj_list = scriba_list_init();
+        company->event_list = scriba_list_init();
+    }
+    companies[pos] = company;
+}
+
+static void companyPOCBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaCompany **companies = (struct ScribaCompany **)ctx;
+    scriba_id_t id;
+
+    if (companies[pos] == NULL)
+    {
+        return;
+    }
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    char *name = combine_poc_names((const char *)sqlite3_column_text(stmt, 1),
+                                   (const char *)sqlite3_column_text(stmt, 2),
+                                   (const char *)sqlite3_column_text(stmt, 3));
+    scriba_list_add(companies[pos]->poc_list, id, name);
+    scriba_free(name);
+}
+
+static void companyProjectBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaCompany **companies = (struct ScribaCompany **)ctx;
+    scriba_id_t id;
+
+    if (companies[pos] == NULL)
+    {
+        return;
+    }
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    const char *title = (const char *)sqlite3_column_text(stmt, 1);
+    scriba_list_add(companies[pos]->proj_list, id,
+                    ((title != NULL) && (*title != 0)) ? (char *)title : NULL);
+}
+
+static void companyEventBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaCompany **companies = (struct ScribaCompany **)ctx;
+    scriba_id_t id;
+
+    if (companies[pos] == NULL)
+    {
+        return;
+    }
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    const char *descr = (const char *)sqlite3_column_text(stmt, 1);
+    scriba_list_add(companies[pos]->event_list, id,
+                    ((descr != NULL) && (*descr != 0)) ? (char *)descr : NULL);
+}
+
+static size_t getCompanies(const scriba_id_t *ids, size_t n, struct ScribaCompany **companies)
+{
+    char event_order[128];
+    time_t cur_time = time(NULL);
+    size_t found = 0;
+
+    if (companies == NULL)
+    {
+        return 0;
+    }
+    memset(companies, 0, n * sizeof (struct ScribaCompany *));
+
+    if (batchQuery("SELECT " COMPANY_BATCH_COLUMNS " FROM Companies WHERE id IN ", NULL, 0,
+                   ids, n, companyBatchRow, companies) != 0)
+    {
+        goto error;
+    }
+
+    // child lists are retrieved by one query per table
+    if (batchQuery("SELECT id,firstname,secondname,lastname,company_id FROM People "
+                   "WHERE company_id IN ", NULL, 4,
+                   ids, n, companyPOCBatchRow, companies) != 0)
+    {
+        goto error;
+    }
+    if (batchQuery("SELECT id,title,company_id FROM Projects WHERE company_id IN ", NULL, 2,
+                   ids, n, companyProjectBatchRow, companies) != 0)
+    {
+        goto error;
+    }
+    // same order as getEventsByCompany()
+    snprintf(event_order, sizeof (event_order),
+             " ORDER BY (timestamp > %lld) DESC, (abs(timestamp-%lld)) ASC",
+             (long long)cur_time, (long long)cur_time);
+    if (batchQuery("SELECT id,descr,company_id FROM Events WHERE company_id IN ", event_order, 2,
+                   ids, n, companyEventBatchRow, companies) != 0)
+    {
+        goto error;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (companies[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+
+error:
+    for (size_t i = 0; i < n; i++)
+    {
+        scriba_freeCompanyData(companies[i]);
+        companies[i] = NULL;
+    }
+    return 0;
+}
+
 static scriba_list_t *getAllCompanies()
 {
     return companySearch("SELECT id, name FROM Companies", NULL);
@@ -711,7 +2295,7 @@ static scriba_list_t *getCompaniesByName(const char *name)
     char *search = str_for_like_op(name);
 
     ret = companySearch("SELECT id, name FROM Companies WHERE name LIKE ?", search);
-    free(search);
+    scriba_free(search);
 
     return ret;
 }
@@ -722,7 +2306,7 @@ static scriba_list_t *getCompaniesByJurName(const char *juridicial_name)
     char *search = str_for_like_op(juridicial_name);
 
     ret = companySearch("SELECT id, name FROM Companies WHERE jur_name LIKE ?", search);
-    free(search);
+    scriba_free(search);
 
     return ret;
 }
@@ -733,7 +2317,7 @@ static scriba_list_t *getCompaniesByAddress(const char *address)
     char *search = str_for_like_op(address);
 
     ret = companySearch("SELECT id, name FROM Companies WHERE address LIKE ?", search);
-    free(search);
+    scriba_free(search);
 
     return ret;
 }
@@ -813,15 +2397,15 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 }
 
 static void updateCompany(const struct ScribaCompany *company)
 {
     sqlite3_stmt *stmt = NULL;
-    char query[] = "UPDATE Companies SET name=?,jur_name=?,address=?,inn=?,phonenum=?,email=?"
-                   "WHERE id=?";
+    char query[] = "UPDATE Companies SET name=?,jur_name=?,address=?,inn=?,phonenum=?,email=?,"
+                   "hash=NULL WHERE id=?";
     void *id_blob = NULL;
 
     if ((company == NULL) || (data == NULL))
@@ -889,7 +2473,7 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 }
 
@@ -941,10 +2525,43 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 }
 
+// the bundled SQLite version does not support ON CONFLICT upsert clause, so
+// INSERT OR IGNORE is followed by UPDATE if the entity exists; UPDATE only
+// writes the row if its content hash differs, so that repeated sync of the same
+// data neither rewrites rows and their indexes nor stamps them as changed
+static int upsertCompany(const struct ScribaCompany *company, int overwrite)
+{
+    struct BulkQuery q;
+    sqlite3_uint64 hash = ROW_HASH_INIT;
+
+    hash = row_hash_text(hash, company->name);
+    hash = row_hash_text(hash, company->jur_name);
+    hash = row_hash_text(hash, company->address);
+    hash = row_hash_text(hash, company->inn);
+    hash = row_hash_text(hash, company->phonenum);
+    hash = row_hash_text(hash, company->email);
+
+    memset(&q, 0, sizeof (q));
+    bulk_param_id(&q, &(company->id));
+    bulk_param_text(&q, company->name);
+    bulk_param_text(&q, company->jur_name);
+    bulk_param_text(&q, company->address);
+    bulk_param_text(&q, company->inn);
+    bulk_param_text(&q, company->phonenum);
+    bulk_param_text(&q, company->email);
+    bulk_param_int(&q, (sqlite3_int64)hash);
+
+    return upsertRow(&q, "INSERT OR IGNORE INTO Companies(id,name,jur_name,address,inn,"
+                         "phonenum,email,hash) VALUES(?1,?2,?3,?4,?5,?6,?7,?8)",
+                     "UPDATE Companies SET name=?2,jur_name=?3,address=?4,inn=?5,phonenum=?6,"
+                     "email=?7,hash=?8 WHERE id=?1 AND hash IS NOT ?8",
+                     UPSERT_COMPANY, overwrite);
+}
+
 // create event data structure based on given parameters
 static struct ScribaEvent *fillEventData(scriba_id_t id, const char *descr,
                                          scriba_id_t company_id, scriba_id_t poc_id,
@@ -952,21 +2569,22 @@ static struct ScribaEvent *fillEventData(scriba_id_t id, const char *descr,
                                          const char *outcome, scriba_time_t timestamp,
                                          enum ScribaEventState state)
 {
-    int len = 0;
-    struct ScribaEvent *ret = (struct ScribaEvent *)malloc(sizeof (struct ScribaEvent));
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
 
+    size_t str_size = field_size(descr) + field_size(outcome);
+    struct ScribaEvent *ret = (struct ScribaEvent *)scriba_entity_alloc(sizeof (struct ScribaEvent),
+                                                                        str_size, &str_buf, &layout);
     if (ret == NULL)
     {
         return NULL;
     }
-    memset(ret, 0, sizeof (struct ScribaEvent));
+    ret->layout = (char)layout;
 
     scriba_id_copy(&(ret->id), &id);
     if (descr != NULL)
     {
-        len = strlen(descr);
-        ret->descr = (char *)malloc(len + 1);
-        strcpy(ret->descr, descr);
+        ret->descr = scriba_entity_strcpy(&str_buf, descr);
     }
     scriba_id_copy(&(ret->company_id), &company_id);
     scriba_id_copy(&(ret->poc_id), &poc_id);
@@ -974,9 +2592,7 @@ static struct ScribaEvent *fillEventData(scriba_id_t id, const char *descr,
     ret->type = type;
     if (outcome != NULL)
     {
-        len = strlen(outcome);
-        ret->outcome = (char *)malloc(len + 1);
-        strcpy(ret->outcome, outcome);
+        ret->outcome = scriba_entity_strcpy(&str_buf, outcome);
     }
     ret->timestamp = timestamp;
     ret->state = state;
@@ -1040,10 +2656,10 @@ static scriba_list_t *eventSearch(const char *query, scriba_id_t id)
             int len = strlen(descr);
             if (len > 0)
             {
-                char *event_descr = (char *)malloc(len + 1);
+                char *event_descr = (char *)scriba_malloc(len + 1);
                 strcpy(event_descr, descr);
                 scriba_list_add(events, id, event_descr);
-                free(event_descr);
+                scriba_free(event_descr);
             }
             else
             {
@@ -1068,14 +2684,14 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return events;
 }
 
 static struct ScribaEvent *getEvent(scriba_id_t id)
 {
-    char query[] = "SELECT * FROM Events WHERE id=?";
+    char query[] = "SELECT " EVENT_BATCH_COLUMNS " FROM Events WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
 
@@ -1144,7 +2760,7 @@ static struct ScribaEvent *getEvent(scriba_id_t id)
     sqlite3_finalize(stmt);
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return event;
 
@@ -1155,12 +2771,73 @@ error:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 
     return NULL;
 }
 
+// create event data structure from batch query row
+static struct ScribaEvent *eventFromRow(sqlite3_stmt *stmt)
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 2), &company_id);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 3), &poc_id);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 4), &project_id);
+
+    return fillEventData(id,
+                         (const char *)sqlite3_column_text(stmt, 1),
+                         company_id,
+                         poc_id,
+                         project_id,
+                         (enum ScribaEventType)sqlite3_column_int(stmt, 5),
+                         (const char *)sqlite3_column_text(stmt, 6),
+                         (scriba_time_t)sqlite3_column_int64(stmt, 7),
+                         (enum ScribaEventState)sqlite3_column_int(stmt, 8));
+}
+
+static void eventBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaEvent **events = (struct ScribaEvent **)ctx;
+    events[pos] = eventFromRow(stmt);
+}
+
+static size_t getEvents(const scriba_id_t *ids, size_t n, struct ScribaEvent **events)
+{
+    size_t found = 0;
+
+    if (events == NULL)
+    {
+        return 0;
+    }
+    memset(events, 0, n * sizeof (struct ScribaEvent *));
+
+    if (batchQuery("SELECT " EVENT_BATCH_COLUMNS " FROM Events WHERE id IN ", NULL, 0,
+                   ids, n, eventBatchRow, events) != 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            scriba_freeEventData(events[i]);
+            events[i] = NULL;
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (events[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
 static scriba_list_t *getAllEvents()
 {
     scriba_list_t *events = scriba_list_init();
@@ -1207,10 +2884,10 @@ static scriba_list_t *getAllEvents()
             int len = strlen(descr);
             if (len > 0)
             {
-                char *event_descr = (char *)malloc(len + 1);
+                char *event_descr = (char *)scriba_malloc(len + 1);
                 strcpy(event_descr, descr);
                 scriba_list_add(events, id, event_descr);
-                free(event_descr);
+                scriba_free(event_descr);
             }
             else
             {
@@ -1287,10 +2964,10 @@ static scriba_list_t *getEventsByDescr(const char *descr)
             int len = strlen(descr);
             if (len > 0)
             {
-                char *event_descr = (char *)malloc(len + 1);
+                char *event_descr = (char *)scriba_malloc(len + 1);
                 strcpy(event_descr, descr);
                 scriba_list_add(events, id, event_descr);
-                free(event_descr);
+                scriba_free(event_descr);
             }
             else
             {
@@ -1315,7 +2992,7 @@ exit:
     }
     if (search != NULL)
     {
-        free(search);
+        scriba_free(search);
     }
     return events;
 }
@@ -1389,10 +3066,10 @@ static scriba_list_t *getEventsByState(enum ScribaEventState state)
             int len = strlen(descr);
             if (len > 0)
             {
-                char *event_descr = (char *)malloc(len + 1);
+                char *event_descr = (char *)scriba_malloc(len + 1);
                 strcpy(event_descr, descr);
                 scriba_list_add(events, id, event_descr);
-                free(event_descr);
+                scriba_free(event_descr);
             }
             else
             {
@@ -1520,26 +3197,26 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
     if (poc_id_blob != NULL)
     {
-        free(poc_id_blob);
+        scriba_free(poc_id_blob);
     }
     if (project_id_blob != NULL)
     {
-        free(project_id_blob);
+        scriba_free(project_id_blob);
     }
 }
 
 static void updateEvent(const struct ScribaEvent *event)
 {
     char query[] = "UPDATE Events SET descr=?,company_id=?,poc_id=?,project_id=?,"
-                   "type=?,outcome=?,timestamp=?,state=? WHERE id=?";
+                   "type=?,outcome=?,timestamp=?,state=?,hash=NULL WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
     void *company_id_blob = NULL;
@@ -1635,19 +3312,19 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
     if (poc_id_blob != NULL)
     {
-        free(poc_id_blob);
+        scriba_free(poc_id_blob);
     }
     if (project_id_blob != NULL)
     {
-        free(project_id_blob);
+        scriba_free(project_id_blob);
     }
 }
 
@@ -1699,8 +3376,131 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
+    }
+}
+
+static int upsertEvent(const struct ScribaEvent *event, int overwrite)
+{
+    struct BulkQuery q;
+    sqlite3_uint64 hash = ROW_HASH_INIT;
+
+    hash = row_hash_text(hash, event->descr);
+    hash = row_hash_id(hash, &(event->company_id));
+    hash = row_hash_id(hash, &(event->poc_id));
+    hash = row_hash_id(hash, &(event->project_id));
+    hash = row_hash_int(hash, (sqlite3_int64)(event->type));
+    hash = row_hash_text(hash, event->outcome);
+    hash = row_hash_int(hash, (sqlite3_int64)(event->timestamp));
+    hash = row_hash_int(hash, (sqlite3_int64)(event->state));
+
+    memset(&q, 0, sizeof (q));
+    bulk_param_id(&q, &(event->id));
+    bulk_param_text(&q, event->descr);
+    bulk_param_id(&q, &(event->company_id));
+    bulk_param_id(&q, &(event->poc_id));
+    bulk_param_id(&q, &(event->project_id));
+    bulk_param_int(&q, (sqlite3_int64)(event->type));
+    bulk_param_text(&q, event->outcome);
+    bulk_param_int(&q, (sqlite3_int64)(event->timestamp));
+    bulk_param_int(&q, (sqlite3_int64)(event->state));
+    bulk_param_int(&q, (sqlite3_int64)hash);
+
+    return upsertRow(&q, "INSERT OR IGNORE INTO Events(id,descr,company_id,poc_id,project_id,"
+                         "type,outcome,timestamp,state,hash) "
+                         "VALUES(?1,?2,?3,?4,?5,?6,?7,?8,?9,?10)",
+                     "UPDATE Events SET descr=?2,company_id=?3,poc_id=?4,project_id=?5,type=?6,"
+                     "outcome=?7,timestamp=?8,state=?9,hash=?10 WHERE id=?1 AND hash IS NOT ?10",
+                     UPSERT_EVENT, overwrite);
+}
+
+// build WHERE clause of event bulk operation
+static void eventFilterConditions(struct BulkQuery *q, const struct ScribaEventFilter *filter)
+{
+    if (filter->flags & SCRIBA_EVENT_FILTER_STATE)
+    {
+        bulk_condition(q, "state=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->state));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_TYPE)
+    {
+        bulk_condition(q, "type=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->type));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_COMPANY)
+    {
+        bulk_condition(q, "company_id=?");
+        bulk_param_id(q, &(filter->company_id));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_POC)
+    {
+        bulk_condition(q, "poc_id=?");
+        bulk_param_id(q, &(filter->poc_id));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_PROJECT)
+    {
+        bulk_condition(q, "project_id=?");
+        bulk_param_id(q, &(filter->project_id));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_TIME_FROM)
+    {
+        bulk_condition(q, "timestamp>=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->time_from));
+    }
+    if (filter->flags & SCRIBA_EVENT_FILTER_TIME_TO)
+    {
+        bulk_condition(q, "timestamp<?");
+        bulk_param_int(q, (sqlite3_int64)(filter->time_to));
+    }
+}
+
+static long updateEvents(const struct ScribaEventFilter *filter,
+                         const struct ScribaEventUpdate *update)
+{
+    struct BulkQuery q;
+    int num_fields = 0;
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "UPDATE Events SET ");
+    if (update->flags & SCRIBA_EVENT_SET_STATE)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "state=?" : ",state=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->state));
+    }
+    if (update->flags & SCRIBA_EVENT_SET_TYPE)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "type=?" : ",type=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->type));
+    }
+    if (update->flags & SCRIBA_EVENT_SET_OUTCOME)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "outcome=?" : ",outcome=?");
+        bulk_param_text(&q, update->outcome);
+    }
+    if (update->flags & SCRIBA_EVENT_SET_TIMESTAMP)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "timestamp=?" : ",timestamp=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->timestamp));
+    }
+    if (num_fields == 0)
+    {
+        return 0;
     }
+    bulk_append(&q, ",hash=NULL");
+    eventFilterConditions(&q, filter);
+
+    return bulkExecute(&q);
+}
+
+static long removeEvents(const struct ScribaEventFilter *filter)
+{
+    struct BulkQuery q;
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "DELETE FROM Events");
+    eventFilterConditions(&q, filter);
+
+    return bulkExecute(&q);
 }
 
 // create POC data structure based on given parameters
@@ -1710,57 +3510,49 @@ static struct ScribaPoc *fillPOCData(scriba_id_t id, const char *firstname,
                                      const char *email, const char *position,
                                      scriba_id_t company_id)
 {
-    int len = 0;
-    struct ScribaPoc *poc = (struct ScribaPoc *)malloc(sizeof (struct ScribaPoc));
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(firstname) + field_size(secondname) +
+                      field_size(lastname) + field_size(mobilenum) +
+                      field_size(phonenum) + field_size(email) +
+                      field_size(position);
+    struct ScribaPoc *poc = (struct ScribaPoc *)scriba_entity_alloc(sizeof (struct ScribaPoc),
+                                                                    str_size, &str_buf, &layout);
     if (poc == NULL)
     {
         return NULL;
     }
-
-    memset(poc, 0, sizeof (struct ScribaPoc));
+    poc->layout = (char)layout;
 
     scriba_id_copy(&(poc->id), &id);
     if (firstname != NULL)
     {
-        len = strlen(firstname);
-        poc->firstname = (char *)malloc(len + 1);
-        strcpy(poc->firstname, firstname);
+        poc->firstname = scriba_entity_strcpy(&str_buf, firstname);
     }
     if (secondname != NULL)
     {
-        len = strlen(secondname);
-        poc->secondname = (char *)malloc(len + 1);
-        strcpy(poc->secondname, secondname);
+        poc->secondname = scriba_entity_strcpy(&str_buf, secondname);
     }
     if (lastname != NULL)
     {
-        len = strlen(lastname);
-        poc->lastname = (char *)malloc(len + 1);
-        strcpy(poc->lastname, lastname);
+        poc->lastname = scriba_entity_strcpy(&str_buf, lastname);
     }
     if (mobilenum != NULL)
     {
-        len = strlen(mobilenum);
-        poc->mobilenum = (char *)malloc(len + 1);
-        strcpy(poc->mobilenum, mobilenum);
+        poc->mobilenum = scriba_entity_strcpy(&str_buf, mobilenum);
     }
     if (phonenum != NULL)
     {
-        len = strlen(phonenum);
-        poc->phonenum = (char *)malloc(len + 1);
-        strcpy(poc->phonenum, phonenum);
+        poc->phonenum = scriba_entity_strcpy(&str_buf, phonenum);
     }
     if (email != NULL)
     {
-        len = strlen(email);
-        poc->email = (char *)malloc(len + 1);
-        strcpy(poc->email, email);
+        poc->email = scriba_entity_strcpy(&str_buf, email);
     }
     if (position != NULL)
     {
-        len = strlen(position);
-        poc->position = (char *)malloc(len + 1);
-        strcpy(poc->position, position);
+        poc->position = scriba_entity_strcpy(&str_buf, position);
     }
     scriba_id_copy(&(poc->company_id), &company_id);
 
@@ -1780,7 +3572,7 @@ static char *combine_poc_names(const char *firstname,
     }
 
     // we need two additional spaces and a null character
-    char *result = (char *)malloc(len + 3);
+    char *result = (char *)scriba_malloc(len + 3);
     strcpy(result, firstname);
     strcat(result, " ");
     strcat(result, secondname);
@@ -1816,7 +3608,7 @@ static void pocExecuteQuery(sqlite3_stmt *stmt, scriba_list_t *list)
             const char *lastname = sqlite3_column_text(stmt, 3);
             char *name = combine_poc_names(firstname, secondname, lastname);
             scriba_list_add(list, id, name);
-            free(name);
+            scriba_free(name);
         }
         else
         {
@@ -1863,7 +3655,7 @@ exit:
 static struct ScribaPoc *getPOC(scriba_id_t id)
 {
     struct ScribaPoc *poc = NULL;
-    char query[] = "SELECT * FROM People WHERE id=?";
+    char query[] = "SELECT " POC_BATCH_COLUMNS " FROM People WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
 
@@ -1930,7 +3722,7 @@ static struct ScribaPoc *getPOC(scriba_id_t id)
     sqlite3_finalize(stmt);
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return poc;
 
@@ -1941,12 +3733,69 @@ error:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 
     return NULL;
 }
 
+// create POC data structure from batch query row
+static struct ScribaPoc *pocFromRow(sqlite3_stmt *stmt)
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 8), &company_id);
+
+    return fillPOCData(id,
+                       (const char *)sqlite3_column_text(stmt, 1),
+                       (const char *)sqlite3_column_text(stmt, 2),
+                       (const char *)sqlite3_column_text(stmt, 3),
+                       (const char *)sqlite3_column_text(stmt, 4),
+                       (const char *)sqlite3_column_text(stmt, 5),
+                       (const char *)sqlite3_column_text(stmt, 6),
+                       (const char *)sqlite3_column_text(stmt, 7),
+                       company_id);
+}
+
+static void pocBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaPoc **people = (struct ScribaPoc **)ctx;
+    people[pos] = pocFromRow(stmt);
+}
+
+static size_t getPeople(const scriba_id_t *ids, size_t n, struct ScribaPoc **people)
+{
+    size_t found = 0;
+
+    if (people == NULL)
+    {
+        return 0;
+    }
+    memset(people, 0, n * sizeof (struct ScribaPoc *));
+
+    if (batchQuery("SELECT " POC_BATCH_COLUMNS " FROM People WHERE id IN ", NULL, 0,
+                   ids, n, pocBatchRow, people) != 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            scriba_freePOCData(people[i]);
+            people[i] = NULL;
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (people[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
 static scriba_list_t *getAllPeople()
 {
     scriba_list_t *people = scriba_list_init();
@@ -2046,7 +3895,7 @@ exit:
     }
     if (search != NULL)
     {
-        free(search);
+        scriba_free(search);
     }
     return people;
 }
@@ -2087,7 +3936,7 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return people;
 }
@@ -2101,7 +3950,7 @@ static scriba_list_t *getPOCByPosition(const char *position)
 
     if (search != NULL)
     {
-        free(search);
+        scriba_free(search);
     }
     return ret;
 }
@@ -2121,7 +3970,7 @@ static scriba_list_t *getPOCByEmail(const char *email)
 
     if (search != NULL)
     {
-        free(search);
+        scriba_free(search);
     }
     return ret;
 }
@@ -2216,18 +4065,18 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
 }
 
 static void updatePOC(const struct ScribaPoc *poc)
 {
     char query[] = "UPDATE People SET firstname=?,secondname=?,lastname=?,mobilenum=?,"
-                   "phonenum=?,email=?,position=?,company_id=? WHERE id=?";
+                   "phonenum=?,email=?,position=?,company_id=?,hash=NULL WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
     void *company_id_blob = NULL;
@@ -2311,11 +4160,11 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
 }
 
@@ -2367,36 +4216,71 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
 }
 
+static int upsertPOC(const struct ScribaPoc *poc, int overwrite)
+{
+    struct BulkQuery q;
+    sqlite3_uint64 hash = ROW_HASH_INIT;
+
+    hash = row_hash_text(hash, poc->firstname);
+    hash = row_hash_text(hash, poc->secondname);
+    hash = row_hash_text(hash, poc->lastname);
+    hash = row_hash_text(hash, poc->mobilenum);
+    hash = row_hash_text(hash, poc->phonenum);
+    hash = row_hash_text(hash, poc->email);
+    hash = row_hash_text(hash, poc->position);
+    hash = row_hash_id(hash, &(poc->company_id));
+
+    memset(&q, 0, sizeof (q));
+    bulk_param_id(&q, &(poc->id));
+    bulk_param_text(&q, poc->firstname);
+    bulk_param_text(&q, poc->secondname);
+    bulk_param_text(&q, poc->lastname);
+    bulk_param_text(&q, poc->mobilenum);
+    bulk_param_text(&q, poc->phonenum);
+    bulk_param_text(&q, poc->email);
+    bulk_param_text(&q, poc->position);
+    bulk_param_id(&q, &(poc->company_id));
+    bulk_param_int(&q, (sqlite3_int64)hash);
+
+    return upsertRow(&q, "INSERT OR IGNORE INTO People(id,firstname,secondname,lastname,"
+                         "mobilenum,phonenum,email,position,company_id,hash) "
+                         "VALUES(?1,?2,?3,?4,?5,?6,?7,?8,?9,?10)",
+                     "UPDATE People SET firstname=?2,secondname=?3,lastname=?4,mobilenum=?5,"
+                     "phonenum=?6,email=?7,position=?8,company_id=?9,hash=?10 "
+                     "WHERE id=?1 AND hash IS NOT ?10",
+                     UPSERT_POC, overwrite);
+}
+
 // create project data structure based on given parameters
 static struct ScribaProject *fillProjectData(scriba_id_t id, const char *title, const char *descr,
                                              scriba_id_t company_id, enum ScribaProjectState state,
                                              enum ScribaCurrency currency, long long cost,
                                              scriba_time_t start_time, scriba_time_t mod_time)
 {
-    int len = 0;
-    struct ScribaProject *project = (struct ScribaProject*)malloc(sizeof (struct ScribaProject));
+    char *str_buf = NULL;
+    enum ScribaEntityLayout layout;
+
+    size_t str_size = field_size(title) + field_size(descr);
+    struct ScribaProject *project = (struct ScribaProject *)scriba_entity_alloc(sizeof (struct ScribaProject),
+                                                                                str_size, &str_buf, &layout);
     if (project == NULL)
     {
         return NULL;
     }
-    memset(project, 0, sizeof (struct ScribaProject));
+    project->layout = (char)layout;
 
     scriba_id_copy(&(project->id), &id);
     if (title != NULL)
     {
-        len = strlen(title);
-        project->title = (char *)malloc(len + 1);
-        strcpy(project->title, title);
+        project->title = scriba_entity_strcpy(&str_buf, title);
     }
     if (descr != NULL)
     {
-        len = strlen(descr);
-        project->descr = (char *)malloc(len + 1);
-        strcpy(project->descr, descr);
+        project->descr = scriba_entity_strcpy(&str_buf, descr);
     }
     scriba_id_copy(&(project->company_id), &company_id);
     project->state = state;
@@ -2432,10 +4316,10 @@ static scriba_list_t *projectSearch(sqlite3_stmt *stmt)
             int len = strlen(title);
             if (len > 0)
             {
-                char *project_title = (char *)malloc(len + 1);
+                char *project_title = (char *)scriba_malloc(len + 1);
                 strcpy(project_title, title);
                 scriba_list_add(projects, id, project_title);
-                free(project_title);
+                scriba_free(project_title);
             }
             else
             {
@@ -2459,7 +4343,7 @@ exit:
 // project handling interface functions
 static struct ScribaProject *getProject(scriba_id_t id)
 {
-    char query[] = "SELECT * FROM Projects WHERE id=?";
+    char query[] = "SELECT " PROJECT_BATCH_COLUMNS " FROM Projects WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
 
@@ -2525,7 +4409,7 @@ static struct ScribaProject *getProject(scriba_id_t id)
     sqlite3_finalize(stmt);
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return project;
 
@@ -2536,11 +4420,68 @@ error:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return NULL;
 }
 
+// create project data structure from batch query row
+static struct ScribaProject *projectFromRow(sqlite3_stmt *stmt)
+{
+    scriba_id_t id;
+    scriba_id_t company_id;
+
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 0), &id);
+    scriba_id_from_blob(sqlite3_column_blob(stmt, 3), &company_id);
+
+    return fillProjectData(id,
+                           (const char *)sqlite3_column_text(stmt, 1),
+                           (const char *)sqlite3_column_text(stmt, 2),
+                           company_id,
+                           (enum ScribaProjectState)sqlite3_column_int(stmt, 4),
+                           (enum ScribaCurrency)sqlite3_column_int(stmt, 5),
+                           (long long)sqlite3_column_int64(stmt, 6),
+                           (scriba_time_t)sqlite3_column_int64(stmt, 7),
+                           (scriba_time_t)sqlite3_column_int64(stmt, 8));
+}
+
+static void projectBatchRow(sqlite3_stmt *stmt, size_t pos, void *ctx)
+{
+    struct ScribaProject **projects = (struct ScribaProject **)ctx;
+    projects[pos] = projectFromRow(stmt);
+}
+
+static size_t getProjects(const scriba_id_t *ids, size_t n, struct ScribaProject **projects)
+{
+    size_t found = 0;
+
+    if (projects == NULL)
+    {
+        return 0;
+    }
+    memset(projects, 0, n * sizeof (struct ScribaProject *));
+
+    if (batchQuery("SELECT " PROJECT_BATCH_COLUMNS " FROM Projects WHERE id IN ", NULL, 0,
+                   ids, n, projectBatchRow, projects) != 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            scriba_freeProjectData(projects[i]);
+            projects[i] = NULL;
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (projects[i] != NULL)
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
 static scriba_list_t *getAllProjects()
 {
     sqlite3_stmt *stmt = NULL;
@@ -2607,10 +4548,10 @@ static scriba_list_t *getProjectsByTitle(const char *title)
             int len = strlen(title);
             if (len > 0)
             {
-                char *project_title = (char *)malloc(len + 1);
+                char *project_title = (char *)scriba_malloc(len + 1);
                 strcpy(project_title, title);
                 scriba_list_add(projects, id, project_title);
-                free(project_title);
+                scriba_free(project_title);
             }
             else
             {
@@ -2630,7 +4571,7 @@ exit:
     }
     if (search != NULL)
     {
-        free(search);
+        scriba_free(search);
     }
     return projects;
 }
@@ -2662,7 +4603,7 @@ static scriba_list_t *getProjectsByCompany(scriba_id_t id)
 
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     return projectSearch(stmt);
  
@@ -2673,7 +4614,7 @@ error:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     // we have to return an empty list, can't return NULL
     return (scriba_list_init());
@@ -2768,7 +4709,7 @@ static scriba_list_t *getProjectsByTime(scriba_time_t start_time, enum ScribaTim
         len += strlen(and_part);
     }
     len++;
-    query = (char *)malloc(len);
+    query = (char *)scriba_malloc(len);
     strcpy(query, beginning);
     if (start_time_part != NULL)
     {
@@ -2814,7 +4755,7 @@ exit:
     }
     if (query != NULL)
     {
-        free(query);
+        scriba_free(query);
     }
     if (ret == NULL)
     {
@@ -2890,7 +4831,7 @@ static scriba_list_t *getProjectsByStateTime(enum ScribaProjectState state,
         len += strlen(and_part2);
     }
     len++;
-    query = (char *)malloc(len);
+    query = (char *)scriba_malloc(len);
     strcpy(query, beginning);
     if (and_part1 != NULL)
     {
@@ -2944,7 +4885,7 @@ exit:
     }
     if (query != NULL)
     {
-        free(query);
+        scriba_free(query);
     }
     if (ret == NULL)
     {
@@ -3044,18 +4985,18 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
 }
 
 static void updateProject(struct ScribaProject *project)
 {
     char query[] = "UPDATE Projects SET title=?,descr=?,company_id=?,state=?,currency=?,cost=?,"
-                   "start_time=?,mod_time=? WHERE id=?";
+                   "start_time=?,mod_time=?,hash=NULL WHERE id=?";
     sqlite3_stmt *stmt = NULL;
     void *id_blob = NULL;
     void *company_id_blob = NULL;
@@ -3139,11 +5080,11 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
     }
     if (company_id_blob != NULL)
     {
-        free(company_id_blob);
+        scriba_free(company_id_blob);
     }
 }
 
@@ -3195,6 +5136,137 @@ exit:
     }
     if (id_blob != NULL)
     {
-        free(id_blob);
+        scriba_free(id_blob);
+    }
+}
+
+static int upsertProject(const struct ScribaProject *project, int overwrite,
+                         scriba_time_t mod_time)
+{
+    struct BulkQuery q;
+    sqlite3_uint64 hash = ROW_HASH_INIT;
+
+    // the hash covers the project as received, mod_time set on state change
+    // does not matter since the same data does not change the state
+    hash = row_hash_text(hash, project->title);
+    hash = row_hash_text(hash, project->descr);
+    hash = row_hash_id(hash, &(project->company_id));
+    hash = row_hash_int(hash, (sqlite3_int64)(project->state));
+    hash = row_hash_int(hash, (sqlite3_int64)(project->currency));
+    hash = row_hash_int(hash, (sqlite3_int64)(project->cost));
+    hash = row_hash_int(hash, (sqlite3_int64)(project->start_time));
+    hash = row_hash_int(hash, (sqlite3_int64)(project->mod_time));
+
+    memset(&q, 0, sizeof (q));
+    bulk_param_id(&q, &(project->id));
+    bulk_param_text(&q, project->title);
+    bulk_param_text(&q, project->descr);
+    bulk_param_id(&q, &(project->company_id));
+    bulk_param_int(&q, (sqlite3_int64)(project->state));
+    bulk_param_int(&q, (sqlite3_int64)(project->currency));
+    bulk_param_int(&q, (sqlite3_int64)(project->cost));
+    bulk_param_int(&q, (sqlite3_int64)(project->start_time));
+    bulk_param_int(&q, (sqlite3_int64)(project->mod_time));
+    bulk_param_int(&q, (sqlite3_int64)mod_time);
+    bulk_param_int(&q, (sqlite3_int64)hash);
+
+    // if an existing project changes its state, mod_time is set to the given time;
+    // expressions on the right of UPDATE refer to the old state value
+    return upsertRow(&q, "INSERT OR IGNORE INTO Projects(id,title,descr,company_id,state,"
+                         "currency,cost,start_time,mod_time,hash) "
+                         "VALUES(?1,?2,?3,?4,?5,?6,?7,?8,?9,?11)",
+                     "UPDATE Projects SET title=?2,descr=?3,company_id=?4,state=?5,currency=?6,"
+                     "cost=?7,start_time=?8,mod_time=CASE WHEN state<>?5 THEN ?10 ELSE ?9 END,"
+                     "hash=?11 WHERE id=?1 AND hash IS NOT ?11",
+                     UPSERT_PROJECT, overwrite);
+}
+
+// build WHERE clause of project bulk operation
+static void projectFilterConditions(struct BulkQuery *q, const struct ScribaProjectFilter *filter)
+{
+    if (filter->flags & SCRIBA_PROJECT_FILTER_STATE)
+    {
+        bulk_condition(q, "state=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->state));
+    }
+    if (filter->flags & SCRIBA_PROJECT_FILTER_COMPANY)
+    {
+        bulk_condition(q, "company_id=?");
+        bulk_param_id(q, &(filter->company_id));
+    }
+    if (filter->flags & SCRIBA_PROJECT_FILTER_START_FROM)
+    {
+        bulk_condition(q, "start_time>=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->start_from));
+    }
+    if (filter->flags & SCRIBA_PROJECT_FILTER_START_TO)
+    {
+        bulk_condition(q, "start_time<?");
+        bulk_param_int(q, (sqlite3_int64)(filter->start_to));
+    }
+    if (filter->flags & SCRIBA_PROJECT_FILTER_MOD_FROM)
+    {
+        bulk_condition(q, "mod_time>=?");
+        bulk_param_int(q, (sqlite3_int64)(filter->mod_from));
+    }
+    if (filter->flags & SCRIBA_PROJECT_FILTER_MOD_TO)
+    {
+        bulk_condition(q, "mod_time<?");
+        bulk_param_int(q, (sqlite3_int64)(filter->mod_to));
+    }
+}
+
+static long updateProjects(const struct ScribaProjectFilter *filter,
+                           const struct ScribaProjectUpdate *update,
+                           scriba_time_t mod_time)
+{
+    struct BulkQuery q;
+    int num_fields = 0;
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "UPDATE Projects SET ");
+    if (update->flags & SCRIBA_PROJECT_SET_STATE)
+    {
+        // expressions on the right refer to the old state value,
+        // so mod_time changes only for projects whose state changes
+        bulk_append(&q, (num_fields++ == 0) ? "" : ",");
+        bulk_append(&q, "mod_time=CASE WHEN state<>? THEN ? ELSE mod_time END,state=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->state));
+        bulk_param_int(&q, (sqlite3_int64)mod_time);
+        bulk_param_int(&q, (sqlite3_int64)(update->state));
+    }
+    if (update->flags & SCRIBA_PROJECT_SET_COMPANY)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "company_id=?" : ",company_id=?");
+        bulk_param_id(&q, &(update->company_id));
+    }
+    if (update->flags & SCRIBA_PROJECT_SET_CURRENCY)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "currency=?" : ",currency=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->currency));
+    }
+    if (update->flags & SCRIBA_PROJECT_SET_COST)
+    {
+        bulk_append(&q, (num_fields++ == 0) ? "cost=?" : ",cost=?");
+        bulk_param_int(&q, (sqlite3_int64)(update->cost));
     }
+    if (num_fields == 0)
+    {
+        return 0;
+    }
+    bulk_append(&q, ",hash=NULL");
+    projectFilterConditions(&q, filter);
+
+    return bulkExecute(&q);
+}
+
+static long removeProjects(const struct ScribaProjectFilter *filter)
+{
+    struct BulkQuery q;
+
+    memset(&q, 0, sizeof (q));
+    bulk_append(&q, "DELETE FROM Projects");
+    projectFilterConditions(&q, filter);
+
+    return bulkExecute(&q);
 }
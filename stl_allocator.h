@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_STL_ALLOCATOR_H
+#define SCRIBA_STL_ALLOCATOR_H
+
+#include "types.h"
+#include "flatbuffers/flatbuffers.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace scriba
+{
+
+// STL allocator taking memory from the library allocator, see scriba_set_allocator();
+// C++ parts of the library keep their containers with it, so that the host can
+// account for their memory
+template<typename T>
+class Allocator
+{
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    // older libstdc++ containers rebind allocators by themselves
+    template<typename U>
+    struct rebind
+    {
+        typedef Allocator<U> other;
+    };
+
+    Allocator() noexcept {}
+    template<typename U>
+    Allocator(const Allocator<U> &) noexcept {}
+
+    T *allocate(size_type n)
+    {
+        void *ptr = (n > max_size()) ? NULL : scriba_malloc(n * sizeof (T));
+        if (ptr == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(ptr);
+    }
+
+    void deallocate(T *ptr, size_type)
+    {
+        scriba_free(ptr);
+    }
+
+    size_type max_size() const noexcept
+    {
+        return static_cast<size_type>(-1) / sizeof (T);
+    }
+
+    template<typename U, typename... Args>
+    void construct(U *ptr, Args&&... args)
+    {
+        ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U *ptr)
+    {
+        ptr->~U();
+    }
+
+    T *address(T &ref) const noexcept { return &ref; }
+    const T *address(const T &ref) const noexcept { return &ref; }
+};
+
+template<typename T, typename U>
+bool operator==(const Allocator<T> &, const Allocator<U> &) noexcept
+{
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const Allocator<T> &, const Allocator<U> &) noexcept
+{
+    return false;
+}
+
+// vector keeping its elements in memory of the library allocator
+template<typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+// allocate memory with the library allocator, throw std::bad_alloc on failure
+// the same way operator new does
+inline void *allocate(std::size_t size)
+{
+    void *ptr = scriba_malloc(size);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// create object in memory of the library allocator; returns NULL if there is no memory,
+// exceptions of the constructor are passed to the caller
+template<typename T, typename... Args>
+T *try_create(Args&&... args)
+{
+    void *ptr = scriba_malloc(sizeof (T));
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+    try
+    {
+        return ::new (ptr) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        scriba_free(ptr);
+        throw;
+    }
+}
+
+// create object in memory of the library allocator, throw std::bad_alloc on failure
+template<typename T, typename... Args>
+T *create(Args&&... args)
+{
+    T *ptr = try_create<T>(std::forward<Args>(args)...);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// destroy object created by create() or try_create()
+template<typename T>
+void destroy(T *ptr)
+{
+    if (ptr != NULL)
+    {
+        ptr->~T();
+        scriba_free(ptr);
+    }
+}
+
+// deleters of smart pointers owning memory of the library allocator
+template<typename T>
+struct Destroy
+{
+    void operator()(T *ptr) const
+    {
+        destroy(ptr);
+    }
+};
+
+struct Free
+{
+    void operator()(void *ptr) const
+    {
+        scriba_free(ptr);
+    }
+};
+
+// FlatBuffers builder allocator taking memory from the library allocator
+class BuilderAllocator : public flatbuffers::simple_allocator
+{
+public:
+    uint8_t *allocate(size_t size) const override
+    {
+        return static_cast<uint8_t *>(scriba::allocate(size));
+    }
+
+    void deallocate(uint8_t *ptr) const override
+    {
+        scriba_free(ptr);
+    }
+};
+
+// FlatBuffers builder keeping the buffer being built in memory of the library allocator
+class Builder : public flatbuffers::FlatBufferBuilder
+{
+public:
+    explicit Builder(flatbuffers::uoffset_t initial_size = 1024)
+        : flatbuffers::FlatBufferBuilder(initial_size, &allocator())
+    {
+    }
+
+private:
+    static const BuilderAllocator &allocator()
+    {
+        static const BuilderAllocator instance;
+        return instance;
+    }
+};
+
+} // namespace scriba
+
+#endif // SCRIBA_STL_ALLOCATOR_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "alloc_test.h"
+#include "sqlite_backend.h"
+#include "scriba.h"
+#include "company.h"
+#include "serializer.h"
+#include "sqlite3.h"
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_DB_LOCATION "./alloc_test_sqlite_db"
+
+// allocator context, keeps track of allocated memory
+struct AllocStats
+{
+    unsigned long num_allocs;
+    unsigned long num_frees;
+    long long outstanding;      // number of bytes currently allocated
+    long long peak;             // maximum of outstanding
+};
+
+static struct AllocStats stats;
+
+// test allocator functions; each block is prefixed with its size
+static void *test_malloc(size_t size, void *ctx);
+static void *test_realloc(void *ptr, size_t size, void *ctx);
+static void test_free(void *ptr, void *ctx);
+
+int alloc_test_init()
+{
+    return 0;
+}
+
+int alloc_test_cleanup()
+{
+    scriba_set_allocator(NULL, NULL, NULL, NULL);
+    unlink(TEST_DB_LOCATION);
+
+    return 0;
+}
+
+// verify that library and SQLite allocate memory with custom allocator
+// and release all of it on cleanup
+void test_custom_allocator()
+{
+    // SQLite left initialized by other tests would keep its own allocator
+    CU_ASSERT_EQUAL(sqlite3_shutdown(), SQLITE_OK);
+    memset(&stats, 0, sizeof (stats));
+    scriba_set_allocator(test_malloc, test_realloc, test_free, &stats);
+
+    struct ScribaDB db;
+    db.name = SCRIBA_SQLITE_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam param;
+    param.key = SCRIBA_SQLITE_DB_LOCATION_PARAM;
+    param.value = TEST_DB_LOCATION;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &param;
+    paramList.next = NULL;
+
+    CU_ASSERT_EQUAL(scriba_init(&db, &paramList), SCRIBA_INIT_SUCCESS);
+    // SQLite allocates memory on database open
+    CU_ASSERT(stats.num_allocs > 0);
+
+    scriba_addCompany("Allocator company", "Allocator LLC", "Allocator street",
+                      "123", "456", "alloc@test.com");
+    scriba_list_t *companies = scriba_getAllCompanies();
+    CU_ASSERT_FALSE(scriba_list_is_empty(companies));
+
+    unsigned long num_allocs = stats.num_allocs;
+    struct ScribaCompany *company = scriba_getCompany(companies->id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "Allocator company");
+    CU_ASSERT(stats.num_allocs > num_allocs);
+    scriba_freeCompanyData(company);
+
+    char *id_str = scriba_id_to_string(&(companies->id));
+    CU_ASSERT_PTR_NOT_NULL(id_str);
+    scriba_free(id_str);
+
+    unsigned long buflen = 0;
+    void *buf = scriba_serialize(companies, NULL, NULL, NULL, &buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+    CU_ASSERT(buflen > 0);
+    scriba_free(buf);
+
+    // serializer builds the buffer in memory of the allocator too, so that the
+    // builder exists along with the copy returned to the caller; nothing is read
+    // from the database for empty lists, so that SQLite does not allocate memory
+    unsigned long empty_len = 0;
+    long long outstanding = stats.outstanding;
+    stats.peak = outstanding;
+    buf = scriba_serialize(NULL, NULL, NULL, NULL, &empty_len);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+    CU_ASSERT(stats.peak - outstanding > (long long)empty_len);
+    scriba_free(buf);
+
+    // serialized buffer stays in the builder until it is released
+    struct ScribaSerializedBuffer serialized;
+    CU_ASSERT_EQUAL(scriba_serializeToBuffer(NULL, &serialized), 0);
+    CU_ASSERT(serialized.len > 0);
+    long long serialized_len = (long long)serialized.len;
+    outstanding = stats.outstanding;
+    scriba_freeSerializedBuffer(&serialized);
+    CU_ASSERT(outstanding - stats.outstanding >= serialized_len);
+
+    scriba_removeCompany(companies->id);
+    scriba_list_delete(companies);
+
+    scriba_cleanup();
+    // everything allocated by the library and SQLite has been released
+    CU_ASSERT_EQUAL(stats.outstanding, 0);
+    CU_ASSERT_EQUAL(stats.num_allocs, stats.num_frees);
+
+    scriba_set_allocator(NULL, NULL, NULL, NULL);
+}
+
+static void *test_malloc(size_t size, void *ctx)
+{
+    struct AllocStats *s = (struct AllocStats *)ctx;
+    long long *block = (long long *)malloc(size + sizeof (long long));
+
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block[0] = (long long)size;
+    s->num_allocs++;
+    s->outstanding += (long long)size;
+    if (s->outstanding > s->peak)
+    {
+        s->peak = s->outstanding;
+    }
+
+    return (void *)(block + 1);
+}
+
+static void *test_realloc(void *ptr, size_t size, void *ctx)
+{
+    struct AllocStats *s = (struct AllocStats *)ctx;
+    long long *block = NULL;
+    long long old_size = 0;
+
+    if (ptr == NULL)
+    {
+        return test_malloc(size, ctx);
+    }
+
+    old_size = ((long long *)ptr)[-1];
+    block = (long long *)realloc((long long *)ptr - 1, size + sizeof (long long));
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block[0] = (long long)size;
+    s->outstanding += (long long)size - old_size;
+    if (s->outstanding > s->peak)
+    {
+        s->peak = s->outstanding;
+    }
+
+    return (void *)(block + 1);
+}
+
+static void test_free(void *ptr, void *ctx)
+{
+    struct AllocStats *s = (struct AllocStats *)ctx;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    s->num_frees++;
+    s->outstanding -= ((long long *)ptr)[-1];
+    free((long long *)ptr - 1);
+}
@@ -0,0 +1,1336 @@
+/*
+ * Copyright (C) 2015 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// libscriba performance benchmarks
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "scriba.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "arena.h"
+#include "serializer.h"
+#include "sqlite_backend.h"
+#include <time.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// return values
+#define OK              0
+#define INVALID_ARGS    1
+#define USAGE           2
+
+// defaults
+#define DEFAULT_NUM_ENTITIES    1000
+
+// temporary database location
+#define TEMP_DB     "benchmark_db"
+// temporary export file location
+#define TEMP_EXPORT "benchmark_export"
+// default import benchmark input, the output of scriba_test_generator
+#define DEFAULT_IMPORT_FILE "scriba_test_db"
+
+struct
+{
+    int num_entities;
+    const char *import_file;
+} params;
+
+// benchmark descriptor
+struct Benchmark
+{
+    const char *name;
+    const char *descr;
+    int (*run)();
+};
+
+/* Allocations made by the library and SQLite are counted by the library
+ * allocator set at startup. */
+static unsigned long num_allocs = 0;
+
+static void *count_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    num_allocs++;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    if (ptr == NULL)
+    {
+        num_allocs++;
+    }
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+int parse_args(int argc, char **argv);
+// time elapsed between two timestamps in microseconds
+static long elapsed_us(struct timespec *start, struct timespec *end);
+// initialize library with temporary database
+static int init_db();
+// initialize library with existing temporary database; sync selects
+// SQLite synchronous mode
+static int open_db(int sync);
+// clean up library and remove temporary database
+static void cleanup_db();
+// populate the database with given number of entities of each type
+static void populate_db(int num);
+// peak resident set size of the process in kilobytes
+static long peak_rss_kb();
+
+// benchmarks
+static int bench_alloc();
+static int bench_batch();
+static int bench_serialize();
+static int bench_export();
+static int bench_import();
+static int bench_pipeline();
+static int bench_parallel_export();
+static int bench_delta();
+static int bench_compress();
+static int bench_compact();
+static int bench_resync();
+static int bench_reconcile();
+
+static struct Benchmark benchmarks[] =
+{
+    { "alloc", "allocations made by get functions for each entity layout", bench_alloc },
+    { "batch", "single versus batch retrieval of entities by id", bench_batch },
+    { "serialize", "serialization throughput for all entities in the database", bench_serialize },
+    { "export", "peak memory of serializer output methods", bench_export },
+    { "import", "import throughput of scriba_test_generator output", bench_import },
+    { "pipeline", "import throughput by number of decoder threads", bench_pipeline },
+    { "parallel_export", "export throughput by number of threads", bench_parallel_export },
+    { "delta", "incremental export time and size by number of changes", bench_delta },
+    { "compress", "compression ratio and speed on scriba_test_generator output", bench_compress },
+    { "compact", "size and speed of compact buffers on scriba_test_generator output", bench_compact },
+    { "resync", "repeated import of scriba_test_generator output by number of changes", bench_resync },
+    { "reconcile", "reconciliation traffic and time by number of changes", bench_reconcile },
+    { NULL, NULL, NULL }
+};
+
+static const char *bench_name = NULL;
+
+int parse_args(int argc, char **argv)
+{
+    params.num_entities = DEFAULT_NUM_ENTITIES;
+    params.import_file = DEFAULT_IMPORT_FILE;
+
+    if ((argc == 1) || !strcmp("-h", argv[1]))
+    {
+        // print usage
+        printf("usage: %s <benchmark> [options]\n", argv[0]);
+        printf("available benchmarks:\n");
+        for (int i = 0; benchmarks[i].name != NULL; i++)
+        {
+            printf("%s\t%s\n", benchmarks[i].name, benchmarks[i].descr);
+        }
+        printf("available options:\n");
+        printf("-n <num_entities>\tnumber of entities of each type\n");
+        printf("-f <file>\tserialized data imported by import benchmark\n");
+        return USAGE;
+    }
+
+    bench_name = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp("-n", argv[i]))
+        {
+            if ((i + 1) == argc)
+            {
+                printf("Missing value for option -n\n");
+                return INVALID_ARGS;
+            }
+            else
+            {
+                params.num_entities = atoi(argv[i + 1]);
+                i++;
+            }
+        }
+        else if (!strcmp("-f", argv[i]))
+        {
+            if ((i + 1) == argc)
+            {
+                printf("Missing value for option -f\n");
+                return INVALID_ARGS;
+            }
+            else
+            {
+                params.import_file = argv[i + 1];
+                i++;
+            }
+        }
+        else
+        {
+            printf("Invalid argument %s\n", argv[i]);
+            printf("Run %s -h for the list of valid arguments\n", argv[0]);
+            return INVALID_ARGS;
+        }
+    }
+
+    return OK;
+}
+
+int main(int argc, char **argv)
+{
+    int err = parse_args(argc, argv);
+    if (err == USAGE)
+    {
+        return OK;
+    }
+    if (err != OK)
+    {
+        return err;
+    }
+
+    scriba_set_allocator(count_malloc, count_realloc, count_free, NULL);
+    for (int i = 0; benchmarks[i].name != NULL; i++)
+    {
+        if (!strcmp(benchmarks[i].name, bench_name))
+        {
+            return benchmarks[i].run();
+        }
+    }
+
+    printf("Unknown benchmark %s\n", bench_name);
+    return INVALID_ARGS;
+}
+
+static long elapsed_us(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000 +
+           (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+static int open_db(int sync)
+{
+    struct ScribaDB db;
+    db.name = SCRIBA_SQLITE_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam param1;
+    param1.key = SCRIBA_SQLITE_DB_LOCATION_PARAM;
+    param1.value = TEMP_DB;
+
+    struct ScribaDBParam param2;
+    param2.key = SCRIBA_SQLITE_DB_SYNC_PARAM;
+    param2.value = sync ? SCRIBA_SQLITE_DB_SYNC_ON : SCRIBA_SQLITE_DB_SYNC_OFF;
+
+    struct ScribaDBParamList paramList[2];
+    paramList[0].param = &param1;
+    paramList[0].next = &paramList[1];
+    paramList[1].param = &param2;
+    paramList[1].next = NULL;
+
+    return scriba_init(&db, paramList);
+}
+
+static int init_db()
+{
+    unlink(TEMP_DB);
+    return open_db(0);
+}
+
+static void cleanup_db()
+{
+    scriba_cleanup();
+    unlink(TEMP_DB);
+}
+
+static void populate_db(int num)
+{
+    for (int i = 0; i < num; i++)
+    {
+        scriba_id_t company_id;
+        scriba_id_t poc_id;
+        scriba_id_t proj_id;
+        scriba_id_t event_id;
+        char name[50];
+        char str[50];
+
+        scriba_id_create(&company_id);
+        scriba_id_create(&poc_id);
+        scriba_id_create(&proj_id);
+        scriba_id_create(&event_id);
+
+        snprintf(name, 50, "Company %d", i + 1);
+        snprintf(str, 50, "%d street", i + 1);
+        scriba_addCompanyWithID(company_id, name, "Company LLC", str,
+                                "1234567890", "555-1234", "company@test.com");
+
+        snprintf(name, 50, "Person %d", i + 1);
+        snprintf(str, 50, "person%d@test.com", i + 1);
+        scriba_addPOCWithID(poc_id, name, "Secondname", "Lastname", "985-123",
+                            "85-123", str, "manager", company_id);
+
+        snprintf(name, 50, "Project %d", i + 1);
+        scriba_addProjectWithID(proj_id, name, "project description", company_id,
+                                PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 1000,
+                                (scriba_time_t)i);
+
+        snprintf(name, 50, "Event %d", i + 1);
+        scriba_addEventWithID(event_id, name, company_id, poc_id, proj_id,
+                              EVENT_TYPE_MEETING, "event outcome", (scriba_time_t)i,
+                              EVENT_STATE_SCHEDULED);
+    }
+}
+
+// entity operations used by allocation benchmark
+struct EntityOps
+{
+    const char *name;
+    void *(*get)(scriba_id_t);
+    void *(*copy)(const void *);
+    void (*free)(void *);
+};
+
+static void *get_company(scriba_id_t id) { return scriba_getCompany(id); }
+static void *copy_company(const void *c) { return scriba_copyCompany(c); }
+static void free_company(void *c) { scriba_freeCompanyData(c); }
+static void *get_poc(scriba_id_t id) { return scriba_getPOC(id); }
+static void *copy_poc(const void *p) { return scriba_copyPOC(p); }
+static void free_poc(void *p) { scriba_freePOCData(p); }
+static void *get_project(scriba_id_t id) { return scriba_getProject(id); }
+static void *copy_project(const void *p) { return scriba_copyProject(p); }
+static void free_project(void *p) { scriba_freeProjectData(p); }
+static void *get_event(scriba_id_t id) { return scriba_getEvent(id); }
+static void *copy_event(const void *e) { return scriba_copyEvent(e); }
+static void free_event(void *e) { scriba_freeEventData(e); }
+
+// fetch and copy every entity once and count allocations
+static int bench_alloc()
+{
+    const char *layout_names[] = { "separate", "block", "arena" };
+    struct EntityOps ops[] =
+    {
+        { "company", get_company, copy_company, free_company },
+        { "poc", get_poc, copy_poc, free_poc },
+        { "project", get_project, copy_project, free_project },
+        { "event", get_event, copy_event, free_event }
+    };
+    scriba_list_t *ids[4];
+    scriba_arena_t *arena = NULL;
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    printf("done\n");
+
+    ids[0] = scriba_getAllCompanies();
+    ids[1] = scriba_getAllPeople();
+    ids[2] = scriba_getAllProjects();
+    ids[3] = scriba_getAllEvents();
+
+    arena = scriba_arena_create(0);
+
+    printf("%-10s %-10s %12s %12s %12s %12s\n", "layout", "entity",
+           "get allocs", "get us", "copy allocs", "copy us");
+    for (int layout = SCRIBA_LAYOUT_SEPARATE; layout <= SCRIBA_LAYOUT_ARENA; layout++)
+    {
+        scriba_setEntityLayout((enum ScribaEntityLayout)layout, arena);
+
+        for (int i = 0; i < 4; i++)
+        {
+            struct timespec start_ts;
+            struct timespec end_ts;
+            unsigned long start_allocs;
+            unsigned long get_allocs;
+            unsigned long copy_allocs;
+            long get_time;
+            long copy_time;
+
+            // fetch from the database
+            start_allocs = num_allocs;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+            scriba_list_for_each(ids[i], item)
+            {
+                ops[i].free(ops[i].get(item->id));
+            }
+            clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+            get_allocs = num_allocs - start_allocs;
+            get_time = elapsed_us(&start_ts, &end_ts);
+            scriba_arena_reset(arena);
+
+            // copy one entity as many times; this shows allocations made
+            // by the library itself without SQLite overhead
+            void *entity = ops[i].get(ids[i]->id);
+            start_allocs = num_allocs;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+            for (int j = 0; j < params.num_entities; j++)
+            {
+                ops[i].free(ops[i].copy(entity));
+            }
+            clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+            copy_allocs = num_allocs - start_allocs;
+            copy_time = elapsed_us(&start_ts, &end_ts);
+            ops[i].free(entity);
+            scriba_arena_reset(arena);
+
+            printf("%-10s %-10s %12.2f %12ld %12.2f %12ld\n", layout_names[layout], ops[i].name,
+                   (double)get_allocs / params.num_entities, get_time,
+                   (double)copy_allocs / params.num_entities, copy_time);
+        }
+    }
+    printf("(allocation numbers are per entity, times are totals)\n");
+
+    scriba_setEntityLayout(SCRIBA_LAYOUT_SEPARATE, NULL);
+    scriba_arena_destroy(arena);
+
+    for (int i = 0; i < 4; i++)
+    {
+        scriba_list_delete(ids[i]);
+    }
+    cleanup_db();
+
+    return OK;
+}
+
+// copy list ids into array, returns number of ids
+static size_t list_to_ids(scriba_list_t *list, scriba_id_t **ids)
+{
+    size_t num = 0;
+
+    scriba_list_for_each(list, item)
+    {
+        num++;
+    }
+    *ids = (scriba_id_t *)malloc(num * sizeof (scriba_id_t));
+    num = 0;
+    scriba_list_for_each(list, item)
+    {
+        scriba_id_copy(&((*ids)[num]), &(item->id));
+        num++;
+    }
+
+    return num;
+}
+
+// retrieve all entities one by one and in batches
+static int bench_batch()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    scriba_id_t *ids = NULL;
+    size_t num = 0;
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    printf("done\n");
+
+    printf("%-10s %14s %14s\n", "entity", "single, us", "batch, us");
+
+    // companies
+    scriba_list_t *list = scriba_getAllCompanies();
+    num = list_to_ids(list, &ids);
+    scriba_list_delete(list);
+    struct ScribaCompany **companies = (struct ScribaCompany **)malloc(num * sizeof (struct ScribaCompany *));
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeCompanyData(scriba_getCompany(ids[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long single_time = elapsed_us(&start_ts, &end_ts);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_getCompanies(ids, num, companies);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeCompanyData(companies[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    printf("%-10s %14ld %14ld\n", "company", single_time, elapsed_us(&start_ts, &end_ts));
+    free(companies);
+    free(ids);
+
+    // people
+    list = scriba_getAllPeople();
+    num = list_to_ids(list, &ids);
+    scriba_list_delete(list);
+    struct ScribaPoc **people = (struct ScribaPoc **)malloc(num * sizeof (struct ScribaPoc *));
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freePOCData(scriba_getPOC(ids[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    single_time = elapsed_us(&start_ts, &end_ts);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_getPeople(ids, num, people);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freePOCData(people[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    printf("%-10s %14ld %14ld\n", "poc", single_time, elapsed_us(&start_ts, &end_ts));
+    free(people);
+    free(ids);
+
+    // projects
+    list = scriba_getAllProjects();
+    num = list_to_ids(list, &ids);
+    scriba_list_delete(list);
+    struct ScribaProject **projects = (struct ScribaProject **)malloc(num * sizeof (struct ScribaProject *));
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeProjectData(scriba_getProject(ids[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    single_time = elapsed_us(&start_ts, &end_ts);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_getProjects(ids, num, projects);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeProjectData(projects[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    printf("%-10s %14ld %14ld\n", "project", single_time, elapsed_us(&start_ts, &end_ts));
+    free(projects);
+    free(ids);
+
+    // events
+    list = scriba_getAllEvents();
+    num = list_to_ids(list, &ids);
+    scriba_list_delete(list);
+    struct ScribaEvent **events = (struct ScribaEvent **)malloc(num * sizeof (struct ScribaEvent *));
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeEventData(scriba_getEvent(ids[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    single_time = elapsed_us(&start_ts, &end_ts);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_getEvents(ids, num, events);
+    for (size_t i = 0; i < num; i++)
+    {
+        scriba_freeEventData(events[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    printf("%-10s %14ld %14ld\n", "event", single_time, elapsed_us(&start_ts, &end_ts));
+    free(events);
+    free(ids);
+
+    cleanup_db();
+
+    return OK;
+}
+
+// serialize all entities in the database
+static int bench_serialize()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    unsigned long buflen = 0;
+    unsigned long start_allocs;
+    long num = 4 * (long)params.num_entities;
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    printf("done\n");
+
+    printf("%-16s %14s %14s %14s %14s\n", "method", "time, us", "entities/s",
+           "allocs/entity", "buffer bytes");
+
+    // id lists of all entities passed to scriba_serialize()
+    start_allocs = num_allocs;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_list_t *companies = scriba_getAllCompanies();
+    scriba_list_t *events = scriba_getAllEvents();
+    scriba_list_t *people = scriba_getAllPeople();
+    scriba_list_t *projects = scriba_getAllProjects();
+    void *buf = scriba_serialize(companies, events, people, projects, &buflen);
+    scriba_list_delete(companies);
+    scriba_list_delete(events);
+    scriba_list_delete(people);
+    scriba_list_delete(projects);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long time = elapsed_us(&start_ts, &end_ts);
+    printf("%-16s %14ld %14.0f %14.2f %14lu\n", "serialize(lists)", time,
+           (time > 0) ? (double)num * 1000000.0 / time : 0.0,
+           (double)(num_allocs - start_allocs) / num, buflen);
+    scriba_free(buf);
+
+    start_allocs = num_allocs;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    buf = scriba_serializeAll(&buflen);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    time = elapsed_us(&start_ts, &end_ts);
+    printf("%-16s %14ld %14.0f %14.2f %14lu\n", "serializeAll", time,
+           (time > 0) ? (double)num * 1000000.0 / time : 0.0,
+           (double)(num_allocs - start_allocs) / num, buflen);
+    scriba_free(buf);
+
+    cleanup_db();
+
+    return OK;
+}
+
+static long peak_rss_kb()
+{
+    char line[128];
+    long rss = -1;
+
+    // peak RSS is reported by the kernel as VmHWM
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status == NULL)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof (line), status) != NULL)
+    {
+        if (!strncmp(line, "VmHWM:", 6))
+        {
+            rss = atol(line + 6);
+            break;
+        }
+    }
+    fclose(status);
+    return rss;
+}
+
+// serializer output methods compared by export benchmark
+static void export_file()
+{
+    scriba_serializeToFile(NULL, TEMP_EXPORT);
+    unlink(TEMP_EXPORT);
+}
+
+static void export_stream()
+{
+    FILE *file = fopen(TEMP_EXPORT, "wb");
+    if (file != NULL)
+    {
+        scriba_serializeStreamToFd(NULL, SCRIBA_STREAM_CHUNK_SIZE, fileno(file));
+        fclose(file);
+    }
+    unlink(TEMP_EXPORT);
+}
+
+static void export_buffer()
+{
+    struct ScribaSerializedBuffer out;
+
+    scriba_serializeToBuffer(NULL, &out);
+    scriba_freeSerializedBuffer(&out);
+}
+
+static void export_copy()
+{
+    unsigned long buflen = 0;
+
+    scriba_free(scriba_serializeAll(&buflen));
+}
+
+// export all entities using different serializer output methods
+static int bench_export()
+{
+    struct
+    {
+        const char *name;
+        void (*run)();
+    } methods[] =
+    {
+        { "serializeStream", export_stream },
+        { "serializeToFile", export_file },
+        { "serializeToBuffer", export_buffer },
+        { "serializeAll", export_copy },
+    };
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    scriba_cleanup();
+    printf("done\n");
+
+    printf("%-18s %14s %14s\n", "method", "time, us", "peak RSS +KB");
+    fflush(stdout);
+
+    /* Peak RSS of a process never decreases, so each method is run in a separate
+     * child process, which starts with its own peak RSS counter. */
+    for (size_t i = 0; i < sizeof (methods) / sizeof (methods[0]); i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            struct timespec start_ts;
+            struct timespec end_ts;
+
+            if (open_db(0) != SCRIBA_INIT_SUCCESS)
+            {
+                _exit(1);
+            }
+            long base_rss = peak_rss_kb();
+            clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+            methods[i].run();
+            clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+            printf("%-18s %14ld %14ld\n", methods[i].name, elapsed_us(&start_ts, &end_ts),
+                   peak_rss_kb() - base_rss);
+            fflush(stdout);
+            scriba_cleanup();
+            _exit(0);
+        }
+        if (pid > 0)
+        {
+            waitpid(pid, NULL, 0);
+        }
+    }
+
+    unlink(TEMP_DB);
+
+    return OK;
+}
+
+// import serialized data into empty database with synchronous mode on
+// read import benchmark input; returns NULL on failure
+static void *read_import_file(unsigned long *buflen)
+{
+    FILE *file = fopen(params.import_file, "rb");
+    if (file == NULL)
+    {
+        printf("Failed to open %s, run scriba_test_generator first\n", params.import_file);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *buflen = (unsigned long)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void *buf = malloc(*buflen);
+    if (fread(buf, 1, *buflen, file) != *buflen)
+    {
+        printf("Failed to read %s\n", params.import_file);
+        fclose(file);
+        free(buf);
+        return NULL;
+    }
+    fclose(file);
+    return buf;
+}
+
+static int bench_import()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    // batch size 1 commits each entry, the way entries were stored one by one
+    unsigned long batch_sizes[] = { 1, 1000, 0 };
+    unsigned long buflen = 0;
+
+    void *buf = read_import_file(&buflen);
+    if (buf == NULL)
+    {
+        return INVALID_ARGS;
+    }
+
+    printf("%-12s %14s %14s\n", "batch size", "time, us", "entities/s");
+    for (size_t i = 0; i < sizeof (batch_sizes) / sizeof (batch_sizes[0]); i++)
+    {
+        unlink(TEMP_DB);
+        if (open_db(1) != SCRIBA_INIT_SUCCESS)
+        {
+            printf("failed to initialize database\n");
+            free(buf);
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+        enum ScribaMergeStatus status = scriba_deserializeBatched(buf, buflen,
+                                                                  SCRIBA_MERGE_REMOTE_OVERRIDE,
+                                                                  batch_sizes[i]);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+        long time = elapsed_us(&start_ts, &end_ts);
+
+        // count imported entities
+        long num = 0;
+        scriba_list_t *lists[] = { scriba_getAllCompanies(), scriba_getAllPeople(),
+                                   scriba_getAllProjects(), scriba_getAllEvents() };
+        for (int j = 0; j < 4; j++)
+        {
+            scriba_list_for_each(lists[j], item)
+            {
+                num++;
+            }
+            scriba_list_delete(lists[j]);
+        }
+
+        if (batch_sizes[i] == 0)
+        {
+            printf("%-12s", "all");
+        }
+        else
+        {
+            printf("%-12lu", batch_sizes[i]);
+        }
+        printf(" %14ld %14.0f%s\n", time, (time > 0) ? (double)num * 1000000.0 / time : 0.0,
+               (status == SCRIBA_MERGE_FAILED) ? " (failed)" : "");
+        cleanup_db();
+    }
+
+    free(buf);
+
+    return OK;
+}
+
+// import serialized database with different number of decoder threads
+static int bench_pipeline()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    // 0 stands for import without decoder threads
+    unsigned int threads[] = { 0, 1, 2, 4, 8 };
+
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed to initialize database\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeAll(&buflen);
+    cleanup_db();
+
+    long num = 4 * (long)params.num_entities;
+    printf("%ld entities, %lu bytes\n", num, buflen);
+    printf("%-12s %14s %14s\n", "threads", "time, us", "entities/s");
+    for (size_t i = 0; i < sizeof (threads) / sizeof (threads[0]); i++)
+    {
+        if (init_db() != SCRIBA_INIT_SUCCESS)
+        {
+            printf("failed to initialize database\n");
+            free(buf);
+            return 1;
+        }
+
+        enum ScribaMergeStatus status;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+        if (threads[i] == 0)
+        {
+            status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+        }
+        else
+        {
+            status = scriba_deserializeParallel(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE,
+                                                0, threads[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+        long time = elapsed_us(&start_ts, &end_ts);
+
+        if (threads[i] == 0)
+        {
+            printf("%-12s", "serial");
+        }
+        else
+        {
+            printf("%-12u", threads[i]);
+        }
+        printf(" %14ld %14.0f%s\n", time, (time > 0) ? (double)num * 1000000.0 / time : 0.0,
+               (status == SCRIBA_MERGE_FAILED) ? " (failed)" : "");
+        cleanup_db();
+    }
+
+    free(buf);
+
+    return OK;
+}
+
+// stream write function counting exported bytes, so that export is not bound by I/O
+static int count_bytes(const void *data, unsigned long len, void *ctx)
+{
+    (void)data;
+    *(unsigned long *)ctx += len;
+    return 0;
+}
+
+// export all entities by different number of threads
+static int bench_parallel_export()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    unsigned int threads[] = { 1, 2, 4, 8, 16 };
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    printf("done\n");
+
+    long num = 4 * (long)params.num_entities;
+    printf("%-12s %14s %14s %14s\n", "threads", "time, us", "entities/s", "bytes");
+    for (size_t i = 0; i < sizeof (threads) / sizeof (threads[0]); i++)
+    {
+        unsigned long bytes = 0;
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+        int ret = scriba_serializeParallel(NULL, SCRIBA_STREAM_CHUNK_SIZE, threads[i],
+                                           count_bytes, &bytes);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+        long time = elapsed_us(&start_ts, &end_ts);
+
+        printf("%-12u %14ld %14.0f %14lu%s\n", threads[i], time,
+               (time > 0) ? (double)num * 1000000.0 / time : 0.0, bytes,
+               (ret != 0) ? " (failed)" : "");
+    }
+
+    cleanup_db();
+
+    return OK;
+}
+
+// modify the given number of companies
+static void update_companies(scriba_list_t *companies, int num)
+{
+    scriba_list_for_each(companies, id)
+    {
+        if (num-- == 0)
+        {
+            break;
+        }
+        struct ScribaCompany *company = scriba_getCompany(id->id);
+        if (company != NULL)
+        {
+            scriba_free(company->phonenum);
+            company->phonenum = (char *)scriba_malloc(strlen("555-4321") + 1);
+            strcpy(company->phonenum, "555-4321");
+            scriba_updateCompany(company);
+            scriba_freeCompanyData(company);
+        }
+    }
+}
+
+static int bench_delta()
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    int changes[] = { 0, 1, 10, 100, 1000, 10000 };
+    scriba_sync_token_t token = 0;
+    unsigned long buflen = 0;
+
+    printf("Populating database with %d entities of each type...", params.num_entities);
+    fflush(stdout);
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed\n");
+        return 1;
+    }
+    populate_db(params.num_entities);
+    printf("done\n");
+
+    printf("%-12s %14s %14s\n", "changes", "time, us", "buffer bytes");
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    void *buf = scriba_serializeChangesSince(0, &token, &buflen);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    printf("%-12s %14ld %14lu\n", "full", elapsed_us(&start_ts, &end_ts), buflen);
+    scriba_free(buf);
+
+    scriba_list_t *companies = scriba_getAllCompanies();
+    for (size_t i = 0; i < sizeof (changes) / sizeof (changes[0]); i++)
+    {
+        if (changes[i] > params.num_entities)
+        {
+            break;
+        }
+        update_companies(companies, changes[i]);
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+        buf = scriba_serializeChangesSince(token, &token, &buflen);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+        printf("%-12d %14ld %14lu\n", changes[i], elapsed_us(&start_ts, &end_ts), buflen);
+        scriba_free(buf);
+    }
+    scriba_list_delete(companies);
+
+    cleanup_db();
+
+    return OK;
+}
+
+// number of entries in small buffers compressed by compression benchmark,
+// the size of a typical sync delta
+#define COMPRESS_SMALL_CHUNK 16
+
+// serialized buffers collected from stream chunks
+struct ChunkList
+{
+    void **data;
+    unsigned long *lens;
+    unsigned int num;
+    unsigned int size;
+};
+
+// stream write function collecting chunks without their size prefix
+static int collect_chunk(const void *data, unsigned long len, void *ctx)
+{
+    struct ChunkList *chunks = (struct ChunkList *)ctx;
+
+    if (len <= sizeof (uint32_t))
+    {
+        // end of stream mark
+        return 0;
+    }
+    if (chunks->num == chunks->size)
+    {
+        chunks->size = (chunks->size != 0) ? chunks->size * 2 : 256;
+        chunks->data = realloc(chunks->data, chunks->size * sizeof (void *));
+        chunks->lens = realloc(chunks->lens, chunks->size * sizeof (unsigned long));
+    }
+    len -= sizeof (uint32_t);
+    chunks->data[chunks->num] = malloc(len);
+    memcpy(chunks->data[chunks->num], (const char *)data + sizeof (uint32_t), len);
+    chunks->lens[chunks->num] = len;
+    chunks->num++;
+    return 0;
+}
+
+// compress and decompress buffers, print compression ratio and speed
+static void compress_buffers(const char *name, void **bufs, unsigned long *lens, unsigned int n)
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    void **frames = malloc(n * sizeof (void *));
+    unsigned long *frame_lens = malloc(n * sizeof (unsigned long));
+    unsigned long total = 0;
+    unsigned long total_compressed = 0;
+    int failed = 0;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        frames[i] = scriba_compress(bufs[i], lens[i], &(frame_lens[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long compress_time = elapsed_us(&start_ts, &end_ts);
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        unsigned long len = 0;
+        void *buf = scriba_decompress(frames[i], frame_lens[i], &len);
+        if ((buf == NULL) || (len != lens[i]))
+        {
+            failed = 1;
+        }
+        scriba_free(buf);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long decompress_time = elapsed_us(&start_ts, &end_ts);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        total += lens[i];
+        total_compressed += frame_lens[i];
+        scriba_free(frames[i]);
+    }
+    free(frames);
+    free(frame_lens);
+
+    printf("%-12s %10u %14lu %14lu %8.2f %12.1f %12.1f%s\n", name, n, total, total_compressed,
+           (total_compressed > 0) ? (double)total / total_compressed : 0.0,
+           (compress_time > 0) ? (double)total / compress_time : 0.0,
+           (decompress_time > 0) ? (double)total / decompress_time : 0.0,
+           failed ? " (failed)" : "");
+}
+
+static int bench_compress()
+{
+    struct ChunkList chunks = { NULL, NULL, 0, 0 };
+    char dict[SCRIBA_COMPRESS_DICT_MAX_SIZE];
+    unsigned long buflen = 0;
+
+    void *buf = read_import_file(&buflen);
+    if (buf == NULL)
+    {
+        return INVALID_ARGS;
+    }
+
+    printf("%-12s %10s %14s %14s %8s %12s %12s\n", "data", "buffers", "bytes",
+           "compressed", "ratio", "comp MB/s", "decomp MB/s");
+    compress_buffers("full", &buf, &buflen, 1);
+
+    // small buffers are cut out of the same data by stream export
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed to initialize database\n");
+        free(buf);
+        return 1;
+    }
+    scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    scriba_serializeStream(NULL, COMPRESS_SMALL_CHUNK, collect_chunk, &chunks);
+    cleanup_db();
+
+    // dictionary is trained on the first half of buffers and used for the second half
+    unsigned int half = chunks.num / 2;
+    compress_buffers("small", chunks.data + half, chunks.lens + half, chunks.num - half);
+    unsigned long dict_len = scriba_trainCompressionDict((const void *const *)chunks.data,
+                                                         chunks.lens, half, dict, sizeof (dict));
+    scriba_setCompressionDict(dict, dict_len);
+    compress_buffers("small+dict", chunks.data + half, chunks.lens + half, chunks.num - half);
+    scriba_setCompressionDict(NULL, 0);
+    printf("dictionary size %lu\n", dict_len);
+
+    for (unsigned int i = 0; i < chunks.num; i++)
+    {
+        free(chunks.data[i]);
+    }
+    free(chunks.data);
+    free(chunks.lens);
+    free(buf);
+
+    return OK;
+}
+
+// export the database with the given filter flags, import the result into empty
+// database and print buffer size and timings
+static void compact_buffer(const char *name, unsigned int flags, int compress)
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    struct ScribaSerializeFilter filter;
+    unsigned long buflen = 0;
+    void *buf = NULL;
+
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = flags;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    if (compress)
+    {
+        buf = scriba_serializeCompressed(&filter, &buflen);
+    }
+    else
+    {
+        buf = scriba_serializeFiltered(&filter, &buflen);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long export_time = elapsed_us(&start_ts, &end_ts);
+    cleanup_db();
+
+    init_db();
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    long import_time = elapsed_us(&start_ts, &end_ts);
+
+    printf("%-16s %14lu %14ld %14ld%s\n", name, buflen, export_time, import_time,
+           (status == SCRIBA_MERGE_FAILED) ? " (failed)" : "");
+    scriba_free(buf);
+}
+
+static int bench_compact()
+{
+    unsigned long buflen = 0;
+
+    void *buf = read_import_file(&buflen);
+    if (buf == NULL)
+    {
+        return INVALID_ARGS;
+    }
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed to initialize database\n");
+        free(buf);
+        return 1;
+    }
+    scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    free(buf);
+
+    // each export reads the database imported by the previous one
+    printf("%-16s %14s %14s %14s\n", "format", "bytes", "export, us", "import, us");
+    compact_buffer("original", 0, 0);
+    compact_buffer("compact", SCRIBA_SERIALIZE_COMPACT, 0);
+    compact_buffer("compressed", 0, 1);
+    compact_buffer("compact+compr", SCRIBA_SERIALIZE_COMPACT, 1);
+    cleanup_db();
+
+    return OK;
+}
+
+// import buffer into the benchmark database and print merge statistics
+static void resync_import(const char *name, void *buf, unsigned long buflen)
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    struct ScribaMergeStats stats;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+    scriba_getMergeStats(&stats);
+    printf("%-12s %14ld %10lu %10lu %10lu%s\n", name, elapsed_us(&start_ts, &end_ts),
+           stats.inserted, stats.updated, stats.skipped,
+           (status == SCRIBA_MERGE_FAILED) ? " (failed)" : "");
+}
+
+// import the same data again after local changes of 0, 1 and 10 percent of companies
+static int bench_resync()
+{
+    int percents[] = { 0, 1, 10 };
+    unsigned long buflen = 0;
+    char name[16];
+
+    void *buf = read_import_file(&buflen);
+    if (buf == NULL)
+    {
+        return INVALID_ARGS;
+    }
+    unlink(TEMP_DB);
+    if (open_db(1) != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed to initialize database\n");
+        free(buf);
+        return 1;
+    }
+
+    printf("%-12s %14s %10s %10s %10s\n", "changed", "time, us", "inserted", "updated", "skipped");
+    resync_import("initial", buf, buflen);
+
+    scriba_list_t *companies = scriba_getAllCompanies();
+    long num_companies = 0;
+    scriba_list_for_each(companies, item)
+    {
+        num_companies++;
+    }
+    for (size_t i = 0; i < sizeof (percents) / sizeof (percents[0]); i++)
+    {
+        update_companies(companies, (int)(num_companies * percents[i] / 100));
+        snprintf(name, sizeof (name), "%d%%", percents[i]);
+        resync_import(name, buf, buflen);
+    }
+    scriba_list_delete(companies);
+
+    free(buf);
+    cleanup_db();
+
+    return OK;
+}
+
+// reconcile the database with its snapshot taken before num companies were changed
+static void reconcile_changes(scriba_reconciler_t *peer, int num)
+{
+    struct timespec start_ts;
+    struct timespec end_ts;
+    unsigned long len = 0;
+    unsigned long bytes = 0;
+    int messages = 0;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
+    scriba_reconciler_t *local = scriba_reconciler_create();
+    void *msg = scriba_reconciler_start(local, &len);
+    scriba_reconciler_t *receiver = peer;
+    while (msg != NULL)
+    {
+        void *reply = NULL;
+        bytes += len;
+        messages++;
+        scriba_reconciler_process(receiver, msg, len, &reply, &len);
+        scriba_free(msg);
+        msg = reply;
+        receiver = (receiver == local) ? peer : local;
+    }
+    void *buf = scriba_reconciler_serialize(local, &len);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end_ts);
+
+    printf("%-12d %14ld %10d %14lu %14lu\n", num, elapsed_us(&start_ts, &end_ts), messages,
+           bytes, len);
+    scriba_free(buf);
+    scriba_reconciler_free(local);
+}
+
+static int bench_reconcile()
+{
+    int changes[] = { 0, 1, 10, 100 };
+    unsigned long buflen = 0;
+
+    void *buf = read_import_file(&buflen);
+    if (buf == NULL)
+    {
+        return INVALID_ARGS;
+    }
+    if (init_db() != SCRIBA_INIT_SUCCESS)
+    {
+        printf("failed to initialize database\n");
+        free(buf);
+        return 1;
+    }
+    scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    free(buf);
+
+    // the peer is the database as imported, full export is what is sent without
+    // reconciliation
+    buf = scriba_serializeAll(&buflen);
+    scriba_free(buf);
+    printf("full export: %lu bytes\n", buflen);
+    scriba_reconciler_t *peer = scriba_reconciler_create();
+
+    printf("%-12s %14s %10s %14s %14s\n", "changes", "time, us", "messages", "message bytes",
+           "export bytes");
+    scriba_list_t *companies = scriba_getAllCompanies();
+    for (size_t i = 0; i < sizeof (changes) / sizeof (changes[0]); i++)
+    {
+        update_companies(companies, changes[i]);
+        reconcile_changes(peer, changes[i]);
+    }
+    scriba_list_delete(companies);
+    scriba_reconciler_free(peer);
+
+    cleanup_db();
+
+    return OK;
+}
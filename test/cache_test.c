@@ -0,0 +1,373 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "cache_test.h"
+#include "cache.h"
+#include "memory_backend.h"
+#include "scriba.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "db_backend.h"
+#include <CUnit/CUnit.h>
+#include <string.h>
+
+#define TEST_CACHE_SIZE (1024 * 1024)
+
+int cache_test_init()
+{
+    struct ScribaDB db;
+    db.name = SCRIBA_MEMORY_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    scriba_setCacheSize(TEST_CACHE_SIZE);
+    scriba_setQueryCacheSize(TEST_CACHE_SIZE);
+    return (scriba_init(&db, NULL) == SCRIBA_INIT_SUCCESS) ? 0 : 1;
+}
+
+int cache_test_cleanup()
+{
+    scriba_cleanup();
+    scriba_setCacheSize(0);
+    scriba_setQueryCacheSize(0);
+
+    return 0;
+}
+
+// repeated retrievals are served by the cache, changes are not
+void test_cache_hits()
+{
+    struct ScribaCacheStats stats;
+    scriba_id_t company_id;
+
+    scriba_setCacheSize(0);
+    scriba_setCacheSize(TEST_CACHE_SIZE);
+    scriba_id_create(&company_id);
+    scriba_addCompanyWithID(company_id, "Cached Company", "", "Cached street", "", "", NULL);
+
+    struct ScribaCompany *stored = scriba_getCompany(company_id);
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    // cached copy keeps empty and missing strings as they are
+    CU_ASSERT_STRING_EQUAL(company->name, "Cached Company");
+    CU_ASSERT_STRING_EQUAL(company->address, "Cached street");
+    CU_ASSERT_EQUAL(company->jur_name == NULL, stored->jur_name == NULL);
+    CU_ASSERT_PTR_NULL(company->email);
+    scriba_freeCompanyData(stored);
+    scriba_getCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.misses, 1);
+    CU_ASSERT_EQUAL(stats.hits, 1);
+    CU_ASSERT_EQUAL(stats.entries, 1);
+    CU_ASSERT(stats.size > sizeof (struct ScribaCompany));
+
+    char *name = company->name;
+    company->name = "Changed Company";
+    scriba_updateCompany(company);
+    company->name = name;
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company_id);
+    CU_ASSERT_STRING_EQUAL(company->name, "Changed Company");
+    scriba_freeCompanyData(company);
+    scriba_getCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.invalidations, 1);
+    CU_ASSERT_EQUAL(stats.misses, 2);
+
+    // batch retrieval takes cached companies and retrieves the rest
+    scriba_id_t ids[2];
+    struct ScribaCompany *companies[2];
+    scriba_id_copy(&(ids[0]), &company_id);
+    scriba_id_create(&(ids[1]));
+    CU_ASSERT_EQUAL(scriba_getCompanies(ids, 2, companies), 1);
+    CU_ASSERT_PTR_NOT_NULL(companies[0]);
+    CU_ASSERT_PTR_NULL(companies[1]);
+    scriba_freeCompanyData(companies[0]);
+    scriba_getCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.hits, 2);
+
+    scriba_removeCompany(company_id);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company_id));
+}
+
+// company child lists follow changes of people, projects and events
+void test_cache_child_lists()
+{
+    scriba_id_t company1_id;
+    scriba_id_t company2_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+
+    scriba_id_create(&company1_id);
+    scriba_id_create(&company2_id);
+    scriba_id_create(&poc_id);
+    scriba_id_create(&project_id);
+    scriba_addCompanyWithID(company1_id, "Company 1", "", "", "", "", "");
+    scriba_addCompanyWithID(company2_id, "Company 2", "", "", "", "", "");
+
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    CU_ASSERT(scriba_list_is_empty(company->poc_list));
+    scriba_freeCompanyData(company);
+
+    scriba_addPOCWithID(poc_id, "Ivan", "Ivanovich", "Ivanov", "", "", "", "", company1_id);
+    scriba_addProjectWithID(project_id, "Project", "", company1_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 0, 100);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_FALSE(scriba_list_is_empty(company->poc_list));
+    CU_ASSERT_FALSE(scriba_list_is_empty(company->proj_list));
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company2_id);
+    scriba_freeCompanyData(company);
+
+    // the person moves to another company
+    struct ScribaPoc *poc = scriba_getPOC(poc_id);
+    scriba_id_copy(&(poc->company_id), &company2_id);
+    scriba_updatePOC(poc);
+    scriba_freePOCData(poc);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT(scriba_list_is_empty(company->poc_list));
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company2_id);
+    CU_ASSERT_FALSE(scriba_list_is_empty(company->poc_list));
+    scriba_freeCompanyData(company);
+
+    // the project is removed while it is not cached itself
+    scriba_removeProject(project_id);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT(scriba_list_is_empty(company->proj_list));
+    scriba_freeCompanyData(company);
+
+    scriba_removePOC(poc_id);
+    company = scriba_getCompany(company2_id);
+    CU_ASSERT(scriba_list_is_empty(company->poc_list));
+    scriba_freeCompanyData(company);
+
+    scriba_removeCompany(company1_id);
+    scriba_removeCompany(company2_id);
+}
+
+// least recently used entities are evicted to stay within the cache size
+void test_cache_eviction()
+{
+    struct ScribaCacheStats stats;
+    scriba_id_t company_ids[10];
+
+    scriba_setCacheSize(0);
+    scriba_setCacheSize(1024);
+    for (int i = 0; i < 10; i++)
+    {
+        scriba_id_create(&(company_ids[i]));
+        scriba_addCompanyWithID(company_ids[i], "Evicted Company", "Evicted Company LLC",
+                                "Evicted street", "", "", "");
+        struct ScribaCompany *company = scriba_getCompany(company_ids[i]);
+        scriba_freeCompanyData(company);
+    }
+
+    scriba_getCacheStats(&stats);
+    CU_ASSERT(stats.evictions > 0);
+    CU_ASSERT(stats.size <= 1024);
+    CU_ASSERT(stats.entries < 10);
+
+    // the last company is still cached, the first one is not
+    struct ScribaCompany *company = scriba_getCompany(company_ids[9]);
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company_ids[0]);
+    scriba_freeCompanyData(company);
+    struct ScribaCacheStats new_stats;
+    scriba_getCacheStats(&new_stats);
+    CU_ASSERT_EQUAL(new_stats.hits, stats.hits + 1);
+    CU_ASSERT_EQUAL(new_stats.misses, stats.misses + 1);
+
+    for (int i = 0; i < 10; i++)
+    {
+        scriba_removeCompany(company_ids[i]);
+    }
+    scriba_setCacheSize(TEST_CACHE_SIZE);
+}
+
+// rolled back changes do not stay in the cache
+void test_cache_rollback()
+{
+    scriba_id_t company_id;
+
+    scriba_id_create(&company_id);
+    scriba_addCompanyWithID(company_id, "Rollback Company", "", "", "", "", "");
+
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    char *name = company->name;
+    company->name = "Discarded Company";
+    scriba_updateCompany(company);
+    company->name = name;
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company_id);
+    CU_ASSERT_STRING_EQUAL(company->name, "Discarded Company");
+    scriba_freeCompanyData(company);
+    scriba_rollbackWrite();
+
+    company = scriba_getCompany(company_id);
+    CU_ASSERT_STRING_EQUAL(company->name, "Rollback Company");
+    scriba_freeCompanyData(company);
+
+    scriba_removeCompany(company_id);
+}
+
+// shared entities are the same object for all users and outlive invalidation
+void test_cache_shared()
+{
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&poc_id);
+    scriba_addCompanyWithID(company_id, "Shared Company", "", "Shared street", "", "", "");
+    scriba_addPOCWithID(poc_id, "Ivan", "Ivanovich", "Ivanov", "", "", "", "", company_id);
+
+    const struct ScribaCompany *company1 = scriba_getSharedCompany(company_id);
+    const struct ScribaCompany *company2 = scriba_getSharedCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company1);
+    CU_ASSERT_PTR_EQUAL(company1, company2);
+    CU_ASSERT_EQUAL(company1->layout, SCRIBA_LAYOUT_SHARED);
+    CU_ASSERT_STRING_EQUAL(company1->name, "Shared Company");
+    CU_ASSERT_FALSE(scriba_list_is_empty(company1->poc_list));
+    scriba_release(company2);
+
+    // copy API keeps returning private copies of the shared entity
+    struct ScribaCompany *copy = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_EQUAL(copy, company1);
+    CU_ASSERT_NOT_EQUAL(copy->layout, SCRIBA_LAYOUT_SHARED);
+    char *name = copy->name;
+    copy->name = "Changed Company";
+    scriba_updateCompany(copy);
+    copy->name = name;
+    scriba_freeCompanyData(copy);
+
+    // the old version stays valid while it is referenced
+    CU_ASSERT_STRING_EQUAL(company1->name, "Shared Company");
+    company2 = scriba_getSharedCompany(company_id);
+    CU_ASSERT_PTR_NOT_EQUAL(company1, company2);
+    CU_ASSERT_STRING_EQUAL(company2->name, "Changed Company");
+    scriba_retain(company2);
+    scriba_release(company2);
+    scriba_freeCompanyData((struct ScribaCompany *)company2);
+    scriba_release(company1);
+
+    const struct ScribaPoc *poc = scriba_getSharedPOC(poc_id);
+    CU_ASSERT_STRING_EQUAL(poc->firstname, "Ivan");
+    CU_ASSERT_PTR_EQUAL(poc, scriba_getSharedPOC(poc_id));
+    scriba_release(poc);
+    scriba_release(poc);
+
+    // entities are shared without the cache as well
+    scriba_setCacheSize(0);
+    poc = scriba_getSharedPOC(poc_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    CU_ASSERT_EQUAL(poc->layout, SCRIBA_LAYOUT_SHARED);
+    scriba_release(poc);
+    scriba_setCacheSize(TEST_CACHE_SIZE);
+
+    scriba_removePOC(poc_id);
+    scriba_removeCompany(company_id);
+    CU_ASSERT_PTR_NULL(scriba_getSharedCompany(company_id));
+}
+
+// list queries are served from the cache until the queried table changes
+void test_cache_queries()
+{
+    struct ScribaCacheStats stats;
+    scriba_id_t company_id;
+    scriba_id_t project1_id;
+    scriba_id_t project2_id;
+
+    scriba_setQueryCacheSize(0);
+    scriba_setQueryCacheSize(TEST_CACHE_SIZE);
+    scriba_id_create(&company_id);
+    scriba_id_create(&project1_id);
+    scriba_id_create(&project2_id);
+    scriba_addCompanyWithID(company_id, "Query Company", "", "", "", "", "");
+    scriba_addProjectWithID(project1_id, "Query Project 1", "", company_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 0, 100);
+
+    scriba_list_t *projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT_FALSE(scriba_list_is_empty(projects));
+    CU_ASSERT(scriba_id_compare(&(projects->id), &project1_id));
+    CU_ASSERT_PTR_NULL(projects->next);
+    scriba_list_delete(projects);
+    projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT(scriba_id_compare(&(projects->id), &project1_id));
+    CU_ASSERT_STRING_EQUAL(projects->text, "Query Project 1");
+    scriba_list_delete(projects);
+    // different arguments make a different query
+    projects = scriba_getProjectsByState(PROJECT_STATE_CONTRACT_SIGNED);
+    CU_ASSERT(scriba_list_is_empty(projects));
+    scriba_list_delete(projects);
+    projects = scriba_getProjectsByTitle("Query Project 1");
+    CU_ASSERT_FALSE(scriba_list_is_empty(projects));
+    scriba_list_delete(projects);
+    projects = scriba_getProjectsByTitle("Query Project 1");
+    scriba_list_delete(projects);
+    scriba_getQueryCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.misses, 3);
+    CU_ASSERT_EQUAL(stats.hits, 2);
+    CU_ASSERT_EQUAL(stats.entries, 3);
+
+    // changes of other tables keep results
+    scriba_list_t *companies = scriba_getCompaniesByName("Query Company");
+    scriba_list_delete(companies);
+    scriba_addProjectWithID(project2_id, "Query Project 2", "", company_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 0, 100);
+    companies = scriba_getCompaniesByName("Query Company");
+    CU_ASSERT_FALSE(scriba_list_is_empty(companies));
+    scriba_list_delete(companies);
+    scriba_getQueryCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.hits, 3);
+
+    // the project table has changed
+    projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT_FALSE(scriba_list_is_empty(projects));
+    CU_ASSERT_PTR_NOT_NULL(projects->next);
+    scriba_list_delete(projects);
+    scriba_getQueryCacheStats(&stats);
+    CU_ASSERT_EQUAL(stats.hits, 3);
+    CU_ASSERT_EQUAL(stats.invalidations, 1);
+
+    // rolled back changes are not kept
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_removeProject(project1_id);
+    projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT_PTR_NULL(projects->next);
+    scriba_list_delete(projects);
+    scriba_rollbackWrite();
+    projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT_PTR_NOT_NULL(projects->next);
+    scriba_list_delete(projects);
+
+    // bulk removal
+    struct ScribaProjectFilter filter;
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_PROJECT_FILTER_COMPANY;
+    scriba_id_copy(&(filter.company_id), &company_id);
+    CU_ASSERT_EQUAL(scriba_removeProjects(&filter), 2);
+    projects = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    CU_ASSERT(scriba_list_is_empty(projects));
+    scriba_list_delete(projects);
+    scriba_removeCompany(company_id);
+}
@@ -26,7 +26,9 @@
 #include "event.h"
 #include "common_test.h"
 #include <CUnit/CUnit.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -1246,6 +1248,312 @@ void test_ru_project_search()
     clean_local_db();
 }
 
+// number of people created by batch get test, exceeds backend batch size
+#define BATCH_TEST_NUM_PEOPLE 300
+
+// batch retrieval test
+void test_batch_get()
+{
+    scriba_id_t company1_id;
+    scriba_id_t company2_id;
+    scriba_id_t poc_ids[BATCH_TEST_NUM_PEOPLE + 2];
+    scriba_id_t project_ids[3];
+    scriba_id_t event_ids[3];
+    scriba_id_t missing_id;
+    struct ScribaCompany *companies[3];
+    struct ScribaPoc *people[BATCH_TEST_NUM_PEOPLE + 2];
+    struct ScribaProject *projects[3];
+    struct ScribaEvent *events[3];
+
+    scriba_id_create(&company1_id);
+    scriba_id_create(&company2_id);
+    scriba_id_create(&missing_id);
+    scriba_addCompanyWithID(company1_id, "Batch company 1", "Batch1 LLC", "Batch address 1",
+                            "111", "111-111", "batch1@test.com");
+    scriba_addCompanyWithID(company2_id, "Batch company 2", "Batch2 LLC", "Batch address 2",
+                            "222", "222-222", "batch2@test.com");
+
+    for (int i = 0; i < BATCH_TEST_NUM_PEOPLE; i++)
+    {
+        char name[32];
+        snprintf(name, 32, "Person%d", i);
+        scriba_id_create(&(poc_ids[i]));
+        scriba_addPOCWithID(poc_ids[i], name, "Batch", "Tester", "123", "456",
+                            "batch@test.com", "tester", company1_id);
+    }
+    // request unknown id and the first person once again
+    scriba_id_copy(&(poc_ids[BATCH_TEST_NUM_PEOPLE]), &missing_id);
+    scriba_id_copy(&(poc_ids[BATCH_TEST_NUM_PEOPLE + 1]), &(poc_ids[0]));
+
+    scriba_id_create(&(project_ids[0]));
+    scriba_id_create(&(project_ids[2]));
+    scriba_id_copy(&(project_ids[1]), &missing_id);
+    scriba_addProjectWithID(project_ids[0], "Batch project 1", "Descr 1", company1_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 100, 1);
+    scriba_addProjectWithID(project_ids[2], "Batch project 2", "Descr 2", company2_id,
+                            PROJECT_STATE_REJECTED, SCRIBA_CURRENCY_USD, 200, 2);
+
+    scriba_id_create(&(event_ids[0]));
+    scriba_id_create(&(event_ids[1]));
+    scriba_id_copy(&(event_ids[2]), &missing_id);
+    scriba_addEventWithID(event_ids[0], "Batch event 1", company1_id, poc_ids[0], project_ids[0],
+                          EVENT_TYPE_CALL, "Outcome 1", 1, EVENT_STATE_COMPLETED);
+    scriba_addEventWithID(event_ids[1], "Batch event 2", company1_id, poc_ids[1], project_ids[0],
+                          EVENT_TYPE_TASK, "Outcome 2", 2, EVENT_STATE_SCHEDULED);
+
+    // people are returned in the order of requested ids
+    CU_ASSERT_EQUAL(scriba_getPeople(poc_ids, BATCH_TEST_NUM_PEOPLE + 2, people),
+                    BATCH_TEST_NUM_PEOPLE + 1);
+    for (int i = 0; i < BATCH_TEST_NUM_PEOPLE; i++)
+    {
+        char name[32];
+        snprintf(name, 32, "Person%d", i);
+        CU_ASSERT_PTR_NOT_NULL(people[i]);
+        if (people[i] != NULL)
+        {
+            CU_ASSERT(scriba_id_compare(&(people[i]->id), &(poc_ids[i])));
+            CU_ASSERT_STRING_EQUAL(people[i]->firstname, name);
+            CU_ASSERT_STRING_EQUAL(people[i]->position, "tester");
+            CU_ASSERT(scriba_id_compare(&(people[i]->company_id), &company1_id));
+        }
+    }
+    CU_ASSERT_PTR_NULL(people[BATCH_TEST_NUM_PEOPLE]);
+    CU_ASSERT_PTR_NOT_NULL(people[BATCH_TEST_NUM_PEOPLE + 1]);
+    CU_ASSERT_NOT_EQUAL(people[BATCH_TEST_NUM_PEOPLE + 1], people[0]);
+    if (people[BATCH_TEST_NUM_PEOPLE + 1] != NULL)
+    {
+        CU_ASSERT(scriba_id_compare(&(people[BATCH_TEST_NUM_PEOPLE + 1]->id), &(poc_ids[0])));
+    }
+    for (int i = 0; i < BATCH_TEST_NUM_PEOPLE + 2; i++)
+    {
+        scriba_freePOCData(people[i]);
+    }
+
+    // companies come with their child lists
+    scriba_id_t company_ids[3];
+    scriba_id_copy(&(company_ids[0]), &company2_id);
+    scriba_id_copy(&(company_ids[1]), &missing_id);
+    scriba_id_copy(&(company_ids[2]), &company1_id);
+    CU_ASSERT_EQUAL(scriba_getCompanies(company_ids, 3, companies), 2);
+    CU_ASSERT_PTR_NOT_NULL(companies[0]);
+    CU_ASSERT_PTR_NULL(companies[1]);
+    CU_ASSERT_PTR_NOT_NULL(companies[2]);
+    if ((companies[0] != NULL) && (companies[2] != NULL))
+    {
+        CU_ASSERT_STRING_EQUAL(companies[0]->name, "Batch company 2");
+        CU_ASSERT_STRING_EQUAL(companies[0]->email, "batch2@test.com");
+        CU_ASSERT(scriba_list_is_empty(companies[0]->poc_list));
+        CU_ASSERT(scriba_list_is_empty(companies[0]->event_list));
+        CU_ASSERT_FALSE(scriba_list_is_empty(companies[0]->proj_list));
+        CU_ASSERT(scriba_id_compare(&(companies[0]->proj_list->id), &(project_ids[2])));
+
+        CU_ASSERT_STRING_EQUAL(companies[2]->name, "Batch company 1");
+        int num_people = 0;
+        scriba_list_for_each(companies[2]->poc_list, poc)
+        {
+            num_people++;
+        }
+        CU_ASSERT_EQUAL(num_people, BATCH_TEST_NUM_PEOPLE);
+        int num_events = 0;
+        scriba_list_for_each(companies[2]->event_list, event)
+        {
+            num_events++;
+        }
+        CU_ASSERT_EQUAL(num_events, 2);
+        CU_ASSERT(scriba_id_compare(&(companies[2]->proj_list->id), &(project_ids[0])));
+        CU_ASSERT(scriba_list_is_empty(companies[2]->proj_list->next));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        scriba_freeCompanyData(companies[i]);
+    }
+
+    CU_ASSERT_EQUAL(scriba_getProjects(project_ids, 3, projects), 2);
+    CU_ASSERT_PTR_NOT_NULL(projects[0]);
+    CU_ASSERT_PTR_NULL(projects[1]);
+    CU_ASSERT_PTR_NOT_NULL(projects[2]);
+    if ((projects[0] != NULL) && (projects[2] != NULL))
+    {
+        CU_ASSERT_STRING_EQUAL(projects[0]->title, "Batch project 1");
+        CU_ASSERT_EQUAL(projects[0]->cost, 100);
+        CU_ASSERT_STRING_EQUAL(projects[2]->descr, "Descr 2");
+        CU_ASSERT_EQUAL(projects[2]->state, PROJECT_STATE_REJECTED);
+        CU_ASSERT_EQUAL(projects[2]->currency, SCRIBA_CURRENCY_USD);
+        CU_ASSERT(scriba_id_compare(&(projects[2]->company_id), &company2_id));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        scriba_freeProjectData(projects[i]);
+    }
+
+    CU_ASSERT_EQUAL(scriba_getEvents(event_ids, 3, events), 2);
+    CU_ASSERT_PTR_NOT_NULL(events[0]);
+    CU_ASSERT_PTR_NOT_NULL(events[1]);
+    CU_ASSERT_PTR_NULL(events[2]);
+    if ((events[0] != NULL) && (events[1] != NULL))
+    {
+        CU_ASSERT_STRING_EQUAL(events[0]->descr, "Batch event 1");
+        CU_ASSERT_STRING_EQUAL(events[0]->outcome, "Outcome 1");
+        CU_ASSERT_EQUAL(events[0]->type, EVENT_TYPE_CALL);
+        CU_ASSERT(scriba_id_compare(&(events[0]->poc_id), &(poc_ids[0])));
+        CU_ASSERT_STRING_EQUAL(events[1]->descr, "Batch event 2");
+        CU_ASSERT_EQUAL(events[1]->state, EVENT_STATE_SCHEDULED);
+        CU_ASSERT_EQUAL(events[1]->timestamp, 2);
+        CU_ASSERT(scriba_id_compare(&(events[1]->project_id), &(project_ids[0])));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        scriba_freeEventData(events[i]);
+    }
+
+    // empty batch
+    CU_ASSERT_EQUAL(scriba_getEvents(event_ids, 0, events), 0);
+
+    clean_local_db();
+}
+
+void test_bulk_ops()
+{
+    scriba_id_t company1_id;
+    scriba_id_t company2_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_ids[4];
+    scriba_id_t event_ids[4];
+    struct ScribaProjectFilter project_filter;
+    struct ScribaProjectUpdate project_update;
+    struct ScribaEventFilter event_filter;
+    struct ScribaEventUpdate event_update;
+    struct ScribaProject *project = NULL;
+    struct ScribaEvent *event = NULL;
+    scriba_list_t *list = NULL;
+    int count = 0;
+
+    scriba_id_create(&company1_id);
+    scriba_id_create(&company2_id);
+    scriba_id_zero_init(&poc_id);
+    scriba_addCompanyWithID(company1_id, "Bulk company 1", "Bulk1 LLC", "Bulk address 1",
+                            "111", "111-111", "bulk1@test.com");
+    scriba_addCompanyWithID(company2_id, "Bulk company 2", "Bulk2 LLC", "Bulk address 2",
+                            "222", "222-222", "bulk2@test.com");
+
+    for (int i = 0; i < 4; i++)
+    {
+        char title[32];
+        snprintf(title, 32, "Bulk project %d", i);
+        scriba_id_create(&(project_ids[i]));
+        scriba_addProjectWithID(project_ids[i], title, "Bulk", (i < 3) ? company1_id : company2_id,
+                                PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 100 * (i + 1), 10 * (i + 1));
+
+        snprintf(title, 32, "Bulk event %d", i);
+        scriba_id_create(&(event_ids[i]));
+        scriba_addEventWithID(event_ids[i], title, (i < 3) ? company1_id : company2_id,
+                              poc_id, project_ids[i], EVENT_TYPE_CALL, "",
+                              100 + i, EVENT_STATE_SCHEDULED);
+    }
+
+    // reject company1 projects started before 30
+    memset(&project_filter, 0, sizeof (project_filter));
+    project_filter.flags = SCRIBA_PROJECT_FILTER_COMPANY | SCRIBA_PROJECT_FILTER_START_TO;
+    scriba_id_copy(&(project_filter.company_id), &company1_id);
+    project_filter.start_to = 30;
+    memset(&project_update, 0, sizeof (project_update));
+    project_update.flags = SCRIBA_PROJECT_SET_STATE | SCRIBA_PROJECT_SET_COST;
+    project_update.state = PROJECT_STATE_REJECTED;
+    project_update.cost = 0;
+    CU_ASSERT_EQUAL(scriba_updateProjects(&project_filter, &project_update), 2);
+
+    list = scriba_getProjectsByState(PROJECT_STATE_REJECTED);
+    count = 0;
+    scriba_list_for_each(list, item)
+    {
+        count++;
+    }
+    scriba_list_delete(list);
+    CU_ASSERT_EQUAL(count, 2);
+
+    project = scriba_getProject(project_ids[0]);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    if (project != NULL)
+    {
+        CU_ASSERT_EQUAL(project->state, PROJECT_STATE_REJECTED);
+        CU_ASSERT_EQUAL(project->cost, 0);
+        CU_ASSERT_NOT_EQUAL(project->mod_time, 0);
+        scriba_freeProjectData(project);
+    }
+    project = scriba_getProject(project_ids[2]);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    if (project != NULL)
+    {
+        CU_ASSERT_EQUAL(project->state, PROJECT_STATE_OFFER);
+        CU_ASSERT_EQUAL(project->cost, 300);
+        scriba_freeProjectData(project);
+    }
+
+    // complete events of company1 with timestamp in [101, 103)
+    memset(&event_filter, 0, sizeof (event_filter));
+    event_filter.flags = SCRIBA_EVENT_FILTER_COMPANY | SCRIBA_EVENT_FILTER_TIME_FROM |
+                         SCRIBA_EVENT_FILTER_TIME_TO;
+    scriba_id_copy(&(event_filter.company_id), &company1_id);
+    event_filter.time_from = 101;
+    event_filter.time_to = 103;
+    memset(&event_update, 0, sizeof (event_update));
+    event_update.flags = SCRIBA_EVENT_SET_STATE | SCRIBA_EVENT_SET_OUTCOME;
+    event_update.state = EVENT_STATE_COMPLETED;
+    event_update.outcome = "Bulk outcome";
+    CU_ASSERT_EQUAL(scriba_updateEvents(&event_filter, &event_update), 2);
+
+    event = scriba_getEvent(event_ids[1]);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    if (event != NULL)
+    {
+        CU_ASSERT_EQUAL(event->state, EVENT_STATE_COMPLETED);
+        CU_ASSERT_STRING_EQUAL(event->outcome, "Bulk outcome");
+        CU_ASSERT_EQUAL(event->timestamp, 101);
+        scriba_freeEventData(event);
+    }
+    event = scriba_getEvent(event_ids[0]);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    if (event != NULL)
+    {
+        CU_ASSERT_EQUAL(event->state, EVENT_STATE_SCHEDULED);
+        scriba_freeEventData(event);
+    }
+
+    // nothing to assign
+    event_update.flags = 0;
+    CU_ASSERT_EQUAL(scriba_updateEvents(&event_filter, &event_update), 0);
+
+    // remove completed events, then scheduled events of company2
+    memset(&event_filter, 0, sizeof (event_filter));
+    event_filter.flags = SCRIBA_EVENT_FILTER_STATE;
+    event_filter.state = EVENT_STATE_COMPLETED;
+    CU_ASSERT_EQUAL(scriba_removeEvents(&event_filter), 2);
+    event_filter.flags = SCRIBA_EVENT_FILTER_STATE | SCRIBA_EVENT_FILTER_COMPANY;
+    event_filter.state = EVENT_STATE_SCHEDULED;
+    scriba_id_copy(&(event_filter.company_id), &company2_id);
+    CU_ASSERT_EQUAL(scriba_removeEvents(&event_filter), 1);
+
+    list = scriba_getAllEvents();
+    CU_ASSERT_FALSE(scriba_list_is_empty(list));
+    if (!scriba_list_is_empty(list))
+    {
+        CU_ASSERT(scriba_id_compare(&(list->id), &(event_ids[0])));
+        CU_ASSERT(scriba_list_is_empty(list->next));
+    }
+    scriba_list_delete(list);
+
+    // empty filter matches all projects
+    memset(&project_filter, 0, sizeof (project_filter));
+    CU_ASSERT_EQUAL(scriba_removeProjects(&project_filter), 4);
+    list = scriba_getAllProjects();
+    CU_ASSERT(scriba_list_is_empty(list));
+    scriba_list_delete(list);
+
+    CU_ASSERT_EQUAL(scriba_removeProjects(NULL), -1);
+
+    clean_local_db();
+}
+
 // remove all data from the local DB
 void clean_local_db()
 {
@@ -35,6 +35,8 @@ void test_poc_search();
 void test_ru_poc_search();
 void test_project_search();
 void test_ru_project_search();
+void test_batch_get();
+void test_bulk_ops();
 void clean_local_db();
 
 #endif // SCRIBA_COMMON_TEST_H
@@ -0,0 +1,79 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* External backend library loaded by unit tests. The library reuses the memory
+ * backend of libscriba and declares only some of its optional functions.
+ * Init failures are simulated by "fail" parameter: "init" makes init fail,
+ * "table" leaves a mandatory function out of the function table. */
+
+#include "db_backend.h"
+#include "memory_backend.h"
+#include <stddef.h>
+#include <string.h>
+
+#define EXT_TEST_BACKEND_NAME "scriba_ext_test"
+#define EXT_TEST_FAIL_PARAM "fail"
+
+const struct ScribaExtDB *scriba_ext_backend(unsigned int abi_version);
+
+static int ext_test_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl);
+
+static const struct ScribaExtDB ext_test_db =
+{
+    SCRIBA_EXT_ABI_VERSION,
+    EXT_TEST_BACKEND_NAME,
+    SCRIBA_EXT_CAP_BATCH | SCRIBA_EXT_CAP_SCAN | SCRIBA_EXT_CAP_WRITE_TXN,
+    ext_test_init,
+    scriba_memory_cleanup
+};
+
+const struct ScribaExtDB *scriba_ext_backend(unsigned int abi_version)
+{
+    return (abi_version == SCRIBA_EXT_ABI_VERSION) ? &ext_test_db : NULL;
+}
+
+static int ext_test_init(struct ScribaDBParamList *pl, struct ScribaDBFuncTbl *fTbl)
+{
+    const char *fail = "";
+
+    for (; pl != NULL; pl = pl->next)
+    {
+        if ((pl->param != NULL) && (pl->param->key != NULL) && (pl->param->value != NULL) &&
+            (strcmp(pl->param->key, EXT_TEST_FAIL_PARAM) == 0))
+        {
+            fail = pl->param->value;
+        }
+    }
+
+    // memory is allocated before the failure, so that it has to be cleaned up
+    if (scriba_memory_init(NULL, fTbl) != 0)
+    {
+        return 1;
+    }
+    if (strcmp(fail, "init") == 0)
+    {
+        return 1;
+    }
+    if (strcmp(fail, "table") == 0)
+    {
+        fTbl->getCompany = NULL;
+    }
+    return 0;
+}
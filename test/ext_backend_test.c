@@ -0,0 +1,134 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "ext_backend_test.h"
+#include "scriba.h"
+#include "company.h"
+#include "db_backend.h"
+#include <CUnit/CUnit.h>
+#include <stddef.h>
+
+// library built from test/ext_backend.c
+#define TEST_EXT_BACKEND_LOCATION "./libscriba-ext-test.so"
+#define TEST_EXT_BACKEND_NAME "scriba_ext_test"
+
+static int init_backend(const char *name, const char *location);
+// init test backend making it fail the given way, see test/ext_backend.c
+static int init_failing_backend(const char *fail);
+
+int ext_backend_test_init()
+{
+    return (init_backend(TEST_EXT_BACKEND_NAME, TEST_EXT_BACKEND_LOCATION) ==
+            SCRIBA_INIT_SUCCESS) ? 0 : 1;
+}
+
+int ext_backend_test_cleanup()
+{
+    scriba_cleanup();
+
+    return 0;
+}
+
+// libraries that can't be loaded or serve another backend are rejected
+void test_ext_load_errors()
+{
+    scriba_cleanup();
+
+    CU_ASSERT_EQUAL(init_backend(TEST_EXT_BACKEND_NAME, NULL), SCRIBA_INIT_INVALID_ARG);
+    CU_ASSERT_EQUAL(init_backend(TEST_EXT_BACKEND_NAME, "./libscriba-ext-missing.so"),
+                    SCRIBA_INIT_BACKEND_NOT_FOUND);
+    CU_ASSERT_EQUAL(init_backend("scriba_ext_other", TEST_EXT_BACKEND_LOCATION),
+                    SCRIBA_INIT_BACKEND_NOT_FOUND);
+    scriba_cleanup();
+
+    CU_ASSERT_EQUAL(init_backend(TEST_EXT_BACKEND_NAME, TEST_EXT_BACKEND_LOCATION),
+                    SCRIBA_INIT_SUCCESS);
+}
+
+// functions of declared groups are used, the rest falls back to the library
+void test_ext_capabilities()
+{
+    scriba_id_t company_id;
+
+    scriba_id_create(&company_id);
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_addCompanyWithID(company_id, "External Company", "", "", "", "", "");
+    CU_ASSERT_EQUAL(scriba_commitWrite(), 0);
+
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "External Company");
+
+    // upsert falls back to get and update
+    char *name = company->name;
+    company->name = "Updated Company";
+    CU_ASSERT_EQUAL(scriba_upsertCompany(company, 1), SCRIBA_UPSERT_UPDATED);
+    company->name = name;
+    scriba_freeCompanyData(company);
+    company = scriba_getCompany(company_id);
+    CU_ASSERT_STRING_EQUAL(company->name, "Updated Company");
+    scriba_freeCompanyData(company);
+
+    // change tracking has not been declared
+    CU_ASSERT_EQUAL(scriba_getChangeStamp(), 0);
+
+    scriba_removeCompany(company_id);
+}
+
+// failed backend is cleaned up and unloaded, so that it can be initialized again
+void test_ext_init_errors()
+{
+    scriba_cleanup();
+
+    CU_ASSERT_EQUAL(init_failing_backend("init"), SCRIBA_INIT_BACKEND_INIT_FAILED);
+    CU_ASSERT_EQUAL(init_failing_backend("table"), SCRIBA_INIT_NOT_SUPPORTED);
+
+    CU_ASSERT_EQUAL(init_backend(TEST_EXT_BACKEND_NAME, TEST_EXT_BACKEND_LOCATION),
+                    SCRIBA_INIT_SUCCESS);
+}
+
+static int init_backend(const char *name, const char *location)
+{
+    struct ScribaDB db;
+    db.name = (char *)name;
+    db.type = SCRIBA_DB_EXT;
+    db.location = (char *)location;
+
+    return scriba_init(&db, NULL);
+}
+
+static int init_failing_backend(const char *fail)
+{
+    struct ScribaDB db;
+    db.name = (char *)TEST_EXT_BACKEND_NAME;
+    db.type = SCRIBA_DB_EXT;
+    db.location = (char *)TEST_EXT_BACKEND_LOCATION;
+
+    struct ScribaDBParam failParam;
+    failParam.key = (char *)"fail";
+    failParam.value = (char *)fail;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &failParam;
+    paramList.next = NULL;
+
+    return scriba_init(&db, &paramList);
+}
@@ -0,0 +1,33 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_EXT_BACKEND_TEST_H
+#define SCRIBA_EXT_BACKEND_TEST_H
+
+#define EXT_BACKEND_TEST_NAME "External backend test"
+
+int ext_backend_test_init();
+int ext_backend_test_cleanup();
+
+void test_ext_load_errors();
+void test_ext_capabilities();
+void test_ext_init_errors();
+
+#endif // SCRIBA_EXT_BACKEND_TEST_H
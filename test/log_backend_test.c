@@ -0,0 +1,312 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "log_backend_test.h"
+#include "log_backend.h"
+#include "scriba.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "db_backend.h"
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_LOG_LOCATION "./log_test_log"
+#define TEST_LOG_CHECKPOINT_LOCATION "./log_test_log.checkpoint"
+#define TEST_LOG_NEXT_LOCATION "./log_test_log.next"
+
+static int init_backend(const char *checkpoint_size);
+static void remove_files();
+// close and open the log again, so that data is loaded from the files
+static int reopen(const char *checkpoint_size);
+
+int log_backend_test_init()
+{
+    remove_files();
+
+    return (init_backend(NULL) == SCRIBA_INIT_SUCCESS) ? 0 : 1;
+}
+
+int log_backend_test_cleanup()
+{
+    scriba_cleanup();
+    remove_files();
+
+    return 0;
+}
+
+// changes are replayed from the log at init
+void test_log_replay()
+{
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+    scriba_id_t event_id;
+    scriba_id_t removed_id;
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&poc_id);
+    scriba_id_create(&project_id);
+    scriba_id_create(&event_id);
+    scriba_id_create(&removed_id);
+    scriba_addCompanyWithID(company_id, "Log Company", "Log Company LLC",
+                            "Log street", "1234567890", "555-0000", "");
+    scriba_addCompanyWithID(removed_id, "Removed Company", "", "", "", "", "");
+    scriba_addPOCWithID(poc_id, "Ivan", "Ivanovich", "Ivanov", "", "555-0001",
+                        "ivan@example.com", "Director", company_id);
+    scriba_addProjectWithID(project_id, "Log Project", "Description", company_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 1000, 500);
+    scriba_addEventWithID(event_id, "Log Event", company_id, poc_id, project_id,
+                          EVENT_TYPE_MEETING, "Outcome", 700, EVENT_STATE_COMPLETED);
+    scriba_removeCompany(removed_id);
+
+    struct ScribaProject *project = scriba_getProject(project_id);
+    project->state = PROJECT_STATE_CONTRACT_SIGNED;
+    scriba_updateProject(project);
+    scriba_freeProjectData(project);
+    project = scriba_getProject(project_id);
+    scriba_time_t mod_time = project->mod_time;
+    scriba_freeProjectData(project);
+
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "Log Company");
+    CU_ASSERT_STRING_EQUAL(company->phonenum, "555-0000");
+    CU_ASSERT(scriba_id_compare(&(company->poc_list->id), &poc_id));
+    CU_ASSERT(scriba_id_compare(&(company->proj_list->id), &project_id));
+    CU_ASSERT(scriba_id_compare(&(company->event_list->id), &event_id));
+    scriba_freeCompanyData(company);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(removed_id));
+
+    struct ScribaPoc *poc = scriba_getPOC(poc_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    CU_ASSERT_STRING_EQUAL(poc->email, "ivan@example.com");
+    scriba_freePOCData(poc);
+
+    project = scriba_getProject(project_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    CU_ASSERT_EQUAL(project->state, PROJECT_STATE_CONTRACT_SIGNED);
+    CU_ASSERT_EQUAL(project->mod_time, mod_time);
+    scriba_freeProjectData(project);
+
+    struct ScribaEvent *event = scriba_getEvent(event_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    CU_ASSERT_STRING_EQUAL(event->outcome, "Outcome");
+    CU_ASSERT_EQUAL(event->timestamp, 700);
+    scriba_freeEventData(event);
+
+    scriba_removeEvent(event_id);
+    scriba_removeProject(project_id);
+    scriba_removePOC(poc_id);
+    scriba_removeCompany(company_id);
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company_id));
+    CU_ASSERT_PTR_NULL(scriba_getEvent(event_id));
+}
+
+// committed transactions are stored, rolled back ones are not
+void test_log_transaction()
+{
+    scriba_id_t committed_id;
+    scriba_id_t rolled_back_id;
+
+    scriba_id_create(&committed_id);
+    scriba_id_create(&rolled_back_id);
+
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_addCompanyWithID(rolled_back_id, "Rolled back Company", "", "", "", "", "");
+    scriba_rollbackWrite();
+
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_addCompanyWithID(committed_id, "Committed Company", "", "", "", "", "");
+    struct ScribaCompany *company = scriba_getCompany(committed_id);
+    char *name = company->name;
+    company->name = "Updated Company";
+    scriba_updateCompany(company);
+    company->name = name;
+    scriba_freeCompanyData(company);
+    CU_ASSERT_EQUAL(scriba_commitWrite(), 0);
+
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(rolled_back_id));
+    company = scriba_getCompany(committed_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "Updated Company");
+    scriba_freeCompanyData(company);
+
+    scriba_removeCompany(committed_id);
+}
+
+// the log starts over after the checkpoint, data is loaded from both
+void test_log_checkpoint()
+{
+    scriba_id_t company_ids[20];
+
+    CU_ASSERT_EQUAL(reopen("1024"), SCRIBA_INIT_SUCCESS);
+    for (int i = 0; i < 20; i++)
+    {
+        scriba_id_create(&(company_ids[i]));
+        scriba_addCompanyWithID(company_ids[i], "Checkpoint Company", "Checkpoint Company LLC",
+                                "Checkpoint street", "1234567890", "555-0000",
+                                "checkpoint@example.com");
+    }
+    scriba_removeCompany(company_ids[0]);
+
+    CU_ASSERT_EQUAL(reopen("1024"), SCRIBA_INIT_SUCCESS);
+    CU_ASSERT_EQUAL(access(TEST_LOG_CHECKPOINT_LOCATION, F_OK), 0);
+    CU_ASSERT_NOT_EQUAL(access(TEST_LOG_NEXT_LOCATION, F_OK), 0);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company_ids[0]));
+    for (int i = 1; i < 20; i++)
+    {
+        struct ScribaCompany *company = scriba_getCompany(company_ids[i]);
+        CU_ASSERT_PTR_NOT_NULL(company);
+        if (company != NULL)
+        {
+            CU_ASSERT_STRING_EQUAL(company->email, "checkpoint@example.com");
+            scriba_freeCompanyData(company);
+        }
+        scriba_removeCompany(company_ids[i]);
+    }
+
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company_ids[1]));
+}
+
+// a record cut short by a crash is dropped, records before it are kept
+void test_log_torn_record()
+{
+    scriba_id_t company_id;
+    scriba_id_t new_company_id;
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&new_company_id);
+    scriba_addCompanyWithID(company_id, "Torn Company", "", "", "", "", "");
+    scriba_cleanup();
+
+    FILE *log = fopen(TEST_LOG_LOCATION, "ab");
+    CU_ASSERT_PTR_NOT_NULL(log);
+    fwrite("\x40\x00\x00\x00garbage", 1, 11, log);
+    fclose(log);
+
+    CU_ASSERT_EQUAL(init_backend(NULL), SCRIBA_INIT_SUCCESS);
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+
+    // new records follow the valid part of the log
+    scriba_addCompanyWithID(new_company_id, "New Company", "", "", "", "", "");
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+    company = scriba_getCompany(new_company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+
+    scriba_removeCompany(company_id);
+    scriba_removeCompany(new_company_id);
+}
+
+// a record passing the checksum but holding broken entries ends the log as well
+void test_log_invalid_record()
+{
+    scriba_id_t company_id;
+    scriba_id_t new_company_id;
+    // root table offset pointing beyond the buffer
+    uint8_t buf[8] = { 0x00, 0x10, 0x00, 0x00, 0, 0, 0, 0 };
+    uint32_t header[2];
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&new_company_id);
+    scriba_addCompanyWithID(company_id, "Valid Company", "", "", "", "", "");
+    scriba_cleanup();
+
+    // FNV-1a checksum used by the log
+    header[0] = sizeof (buf);
+    header[1] = 2166136261U;
+    for (size_t i = 0; i < sizeof (buf); i++)
+    {
+        header[1] = (header[1] ^ buf[i]) * 16777619U;
+    }
+    FILE *log = fopen(TEST_LOG_LOCATION, "ab");
+    CU_ASSERT_PTR_NOT_NULL(log);
+    fwrite(header, 1, sizeof (header), log);
+    fwrite(buf, 1, sizeof (buf), log);
+    fclose(log);
+
+    CU_ASSERT_EQUAL(init_backend(NULL), SCRIBA_INIT_SUCCESS);
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+
+    // the invalid record has been dropped, new records follow the valid part
+    scriba_addCompanyWithID(new_company_id, "New Company", "", "", "", "", "");
+    CU_ASSERT_EQUAL(reopen(NULL), SCRIBA_INIT_SUCCESS);
+    company = scriba_getCompany(new_company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+
+    scriba_removeCompany(company_id);
+    scriba_removeCompany(new_company_id);
+}
+
+static int init_backend(const char *checkpoint_size)
+{
+    struct ScribaDB db;
+    db.name = SCRIBA_LOG_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam locationParam;
+    locationParam.key = SCRIBA_LOG_LOCATION_PARAM;
+    locationParam.value = (char *)TEST_LOG_LOCATION;
+
+    struct ScribaDBParam sizeParam;
+    sizeParam.key = SCRIBA_LOG_CHECKPOINT_SIZE_PARAM;
+    sizeParam.value = (char *)checkpoint_size;
+
+    struct ScribaDBParamList sizeList;
+    sizeList.param = &sizeParam;
+    sizeList.next = NULL;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &locationParam;
+    paramList.next = (checkpoint_size != NULL) ? &sizeList : NULL;
+
+    return scriba_init(&db, &paramList);
+}
+
+static void remove_files()
+{
+    unlink(TEST_LOG_LOCATION);
+    unlink(TEST_LOG_CHECKPOINT_LOCATION);
+    unlink(TEST_LOG_NEXT_LOCATION);
+}
+
+static int reopen(const char *checkpoint_size)
+{
+    scriba_cleanup();
+    return init_backend(checkpoint_size);
+}
@@ -0,0 +1,35 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_LOG_BACKEND_TEST_H
+#define SCRIBA_LOG_BACKEND_TEST_H
+
+#define LOG_BACKEND_TEST_NAME "Log backend test"
+
+int log_backend_test_init();
+int log_backend_test_cleanup();
+
+void test_log_replay();
+void test_log_transaction();
+void test_log_checkpoint();
+void test_log_torn_record();
+void test_log_invalid_record();
+
+#endif // SCRIBA_LOG_BACKEND_TEST_H
@@ -22,6 +22,12 @@
 #include "frontend_test.h"
 #include "sqlite_backend_test.h"
 #include "serializer_test.h"
+#include "alloc_test.h"
+#include "snapshot_backend_test.h"
+#include "memory_backend_test.h"
+#include "log_backend_test.h"
+#include "ext_backend_test.h"
+#include "cache_test.h"
 #include <CUnit/Basic.h>
 #include <stdio.h>
 
@@ -30,6 +36,12 @@ int main()
     CU_pSuite frontend_test_suite = NULL;
     CU_pSuite sqlite_backend_test_suite = NULL;
     CU_pSuite serializer_test_suite = NULL;
+    CU_pSuite alloc_test_suite = NULL;
+    CU_pSuite snapshot_backend_test_suite = NULL;
+    CU_pSuite memory_backend_test_suite = NULL;
+    CU_pSuite log_backend_test_suite = NULL;
+    CU_pSuite ext_backend_test_suite = NULL;
+    CU_pSuite cache_test_suite = NULL;
     int ret = 0;
 
     if (CUE_SUCCESS != CU_initialize_registry())
@@ -58,6 +70,8 @@ int main()
     CU_add_test(frontend_test_suite, "Frontend event search test", test_event_search);
     CU_add_test(frontend_test_suite, "Frontend poc search test", test_poc_search);
     CU_add_test(frontend_test_suite, "Frontend project search test", test_project_search);
+    CU_add_test(frontend_test_suite, "Frontend batch get test", test_batch_get);
+    CU_add_test(frontend_test_suite, "Frontend bulk operations test", test_bulk_ops);
 
     /* SQLite backend test suite */
     sqlite_backend_test_suite = CU_add_suite(SQLITE_BACKEND_TEST_NAME,
@@ -101,6 +115,15 @@ int main()
     CU_add_test(sqlite_backend_test_suite,
                 "SQLite backend project search test in Russian",
                 test_ru_project_search);
+    CU_add_test(sqlite_backend_test_suite,
+                "SQLite backend batch get test",
+                test_batch_get);
+    CU_add_test(sqlite_backend_test_suite,
+                "SQLite backend bulk operations test",
+                test_bulk_ops);
+    CU_add_test(sqlite_backend_test_suite,
+                "SQLite backend entity layout test",
+                test_entity_layout);
 
     /* Serializer test suite */
     serializer_test_suite = CU_add_suite(SERIALIZER_TEST_NAME,
@@ -120,6 +143,241 @@ int main()
     CU_add_test(serializer_test_suite,
                 "Serializer local override test",
                 test_serializer_local_override);
+    CU_add_test(serializer_test_suite,
+                "Serializer subset test",
+                test_serializer_subset);
+    CU_add_test(serializer_test_suite,
+                "Serializer serialize all test",
+                test_serializer_all);
+    CU_add_test(serializer_test_suite,
+                "Serializer filtered test",
+                test_serializer_filtered);
+    CU_add_test(serializer_test_suite,
+                "Serializer output test",
+                test_serializer_output);
+    CU_add_test(serializer_test_suite,
+                "Serializer stream test",
+                test_serializer_stream);
+    CU_add_test(serializer_test_suite,
+                "Serializer transaction test",
+                test_serializer_transaction);
+    CU_add_test(serializer_test_suite,
+                "Serializer parallel test",
+                test_serializer_parallel);
+    CU_add_test(serializer_test_suite,
+                "Serializer parallel export test",
+                test_serializer_parallel_export);
+    CU_add_test(serializer_test_suite,
+                "Serializer changes test",
+                test_serializer_changes);
+    CU_add_test(serializer_test_suite,
+                "Serializer compressed test",
+                test_serializer_compressed);
+    CU_add_test(serializer_test_suite,
+                "Serializer compact test",
+                test_serializer_compact);
+    CU_add_test(serializer_test_suite,
+                "Serializer merge statistics test",
+                test_serializer_merge_stats);
+    CU_add_test(serializer_test_suite,
+                "Serializer reconciliation test",
+                test_serializer_reconcile);
+    CU_add_test(serializer_test_suite,
+                "Serializer file import test",
+                test_serializer_file);
+
+    /* Allocator test suite */
+    alloc_test_suite = CU_add_suite(ALLOC_TEST_NAME,
+                                    alloc_test_init,
+                                    alloc_test_cleanup);
+    if (alloc_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(alloc_test_suite, "Custom allocator test", test_custom_allocator);
+
+    /* Snapshot backend test suite */
+    snapshot_backend_test_suite = CU_add_suite(SNAPSHOT_BACKEND_TEST_NAME,
+                                               snapshot_backend_test_init,
+                                               snapshot_backend_test_cleanup);
+    if (snapshot_backend_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(snapshot_backend_test_suite, "Snapshot backend get test", test_snapshot_get);
+    CU_add_test(snapshot_backend_test_suite, "Snapshot backend search test", test_snapshot_search);
+    CU_add_test(snapshot_backend_test_suite,
+                "Snapshot backend read-only test",
+                test_snapshot_read_only);
+
+    /* Memory backend test suite */
+    memory_backend_test_suite = CU_add_suite(MEMORY_BACKEND_TEST_NAME,
+                                             memory_backend_test_init,
+                                             memory_backend_test_cleanup);
+    if (memory_backend_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend company test",
+                test_company);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend POC test",
+                test_poc);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend project test",
+                test_project);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend project time test",
+                test_project_time);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend event test",
+                test_event);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend create with ID test",
+                test_create_with_id);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend company search test",
+                test_company_search);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend event search test",
+                test_event_search);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend poc search test",
+                test_poc_search);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend project search test",
+                test_project_search);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend batch get test",
+                test_batch_get);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend bulk operations test",
+                test_bulk_ops);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend persistence test",
+                test_memory_persistence);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend rollback test",
+                test_memory_rollback);
+    CU_add_test(memory_backend_test_suite,
+                "Memory backend change tracking test",
+                test_memory_changes);
+
+    /* Log backend test suite */
+    log_backend_test_suite = CU_add_suite(LOG_BACKEND_TEST_NAME,
+                                          log_backend_test_init,
+                                          log_backend_test_cleanup);
+    if (log_backend_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(log_backend_test_suite,
+                "Log backend company test",
+                test_company);
+    CU_add_test(log_backend_test_suite,
+                "Log backend POC test",
+                test_poc);
+    CU_add_test(log_backend_test_suite,
+                "Log backend project test",
+                test_project);
+    CU_add_test(log_backend_test_suite,
+                "Log backend project time test",
+                test_project_time);
+    CU_add_test(log_backend_test_suite,
+                "Log backend event test",
+                test_event);
+    CU_add_test(log_backend_test_suite,
+                "Log backend create with ID test",
+                test_create_with_id);
+    CU_add_test(log_backend_test_suite,
+                "Log backend company search test",
+                test_company_search);
+    CU_add_test(log_backend_test_suite,
+                "Log backend event search test",
+                test_event_search);
+    CU_add_test(log_backend_test_suite,
+                "Log backend poc search test",
+                test_poc_search);
+    CU_add_test(log_backend_test_suite,
+                "Log backend project search test",
+                test_project_search);
+    CU_add_test(log_backend_test_suite,
+                "Log backend batch get test",
+                test_batch_get);
+    CU_add_test(log_backend_test_suite,
+                "Log backend bulk operations test",
+                test_bulk_ops);
+    CU_add_test(log_backend_test_suite,
+                "Log backend replay test",
+                test_log_replay);
+    CU_add_test(log_backend_test_suite,
+                "Log backend transaction test",
+                test_log_transaction);
+    CU_add_test(log_backend_test_suite,
+                "Log backend checkpoint test",
+                test_log_checkpoint);
+    CU_add_test(log_backend_test_suite,
+                "Log backend torn record test",
+                test_log_torn_record);
+    CU_add_test(log_backend_test_suite,
+                "Log backend invalid record test",
+                test_log_invalid_record);
+
+    /* External backend test suite */
+    ext_backend_test_suite = CU_add_suite(EXT_BACKEND_TEST_NAME,
+                                          ext_backend_test_init,
+                                          ext_backend_test_cleanup);
+    if (ext_backend_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(ext_backend_test_suite,
+                "External backend load errors test",
+                test_ext_load_errors);
+    CU_add_test(ext_backend_test_suite,
+                "External backend capabilities test",
+                test_ext_capabilities);
+    CU_add_test(ext_backend_test_suite,
+                "External backend init errors test",
+                test_ext_init_errors);
+
+    /* Cache test suite */
+    cache_test_suite = CU_add_suite(CACHE_TEST_NAME, cache_test_init, cache_test_cleanup);
+    if (cache_test_suite == NULL)
+    {
+        ret = CU_get_error();
+        goto cleanup;
+    }
+
+    CU_add_test(cache_test_suite, "Cache company test", test_company);
+    CU_add_test(cache_test_suite, "Cache POC test", test_poc);
+    CU_add_test(cache_test_suite, "Cache project test", test_project);
+    CU_add_test(cache_test_suite, "Cache project time test", test_project_time);
+    CU_add_test(cache_test_suite, "Cache event test", test_event);
+    CU_add_test(cache_test_suite, "Cache create with ID test", test_create_with_id);
+    CU_add_test(cache_test_suite, "Cache company search test", test_company_search);
+    CU_add_test(cache_test_suite, "Cache event search test", test_event_search);
+    CU_add_test(cache_test_suite, "Cache poc search test", test_poc_search);
+    CU_add_test(cache_test_suite, "Cache project search test", test_project_search);
+    CU_add_test(cache_test_suite, "Cache batch get test", test_batch_get);
+    CU_add_test(cache_test_suite, "Cache bulk operations test", test_bulk_ops);
+    CU_add_test(cache_test_suite, "Cache hits test", test_cache_hits);
+    CU_add_test(cache_test_suite, "Cache child lists test", test_cache_child_lists);
+    CU_add_test(cache_test_suite, "Cache eviction test", test_cache_eviction);
+    CU_add_test(cache_test_suite, "Cache rollback test", test_cache_rollback);
+    CU_add_test(cache_test_suite, "Cache shared entities test", test_cache_shared);
+    CU_add_test(cache_test_suite, "Cache query results test", test_cache_queries);
 
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
@@ -0,0 +1,278 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "memory_backend_test.h"
+#include "memory_backend.h"
+#include "scriba.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "db_backend.h"
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_MEMORY_SNAPSHOT_LOCATION "./memory_test_snapshot"
+
+static int init_backend(const char *snapshot);
+static int list_contains(scriba_list_t *list, const scriba_id_t *id);
+static void count_removed(const scriba_id_t *id, enum ScribaEntityType type, void *ctx);
+static void count_company(const struct ScribaCompany *company, void *ctx);
+
+int memory_backend_test_init()
+{
+    unlink(TEST_MEMORY_SNAPSHOT_LOCATION);
+
+    return (init_backend(NULL) == SCRIBA_INIT_SUCCESS) ? 0 : 1;
+}
+
+int memory_backend_test_cleanup()
+{
+    scriba_cleanup();
+    unlink(TEST_MEMORY_SNAPSHOT_LOCATION);
+
+    return 0;
+}
+
+// data is saved to the snapshot at cleanup and loaded back at init
+void test_memory_persistence()
+{
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+    scriba_id_t event_id;
+
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(init_backend(TEST_MEMORY_SNAPSHOT_LOCATION), SCRIBA_INIT_SUCCESS);
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&poc_id);
+    scriba_id_create(&project_id);
+    scriba_id_create(&event_id);
+    scriba_addCompanyWithID(company_id, "Memory Company", "Memory Company LLC",
+                            "Memory street", "1234567890", "555-0000", "");
+    scriba_addPOCWithID(poc_id, "Ivan", "Ivanovich", "Ivanov", "", "555-0001",
+                        "ivan@example.com", "Director", company_id);
+    scriba_addProjectWithID(project_id, "Memory Project", "Description", company_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 1000, 500);
+    scriba_addEventWithID(event_id, "Memory Event", company_id, poc_id, project_id,
+                          EVENT_TYPE_MEETING, "Outcome", 700, EVENT_STATE_COMPLETED);
+
+    // project mod_time survives the round trip
+    struct ScribaProject *project = scriba_getProject(project_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    project->state = PROJECT_STATE_CONTRACT_SIGNED;
+    scriba_updateProject(project);
+    scriba_freeProjectData(project);
+    project = scriba_getProject(project_id);
+    scriba_time_t mod_time = project->mod_time;
+    scriba_freeProjectData(project);
+
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(access(TEST_MEMORY_SNAPSHOT_LOCATION, F_OK), 0);
+    CU_ASSERT_EQUAL(init_backend(TEST_MEMORY_SNAPSHOT_LOCATION), SCRIBA_INIT_SUCCESS);
+
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "Memory Company");
+    CU_ASSERT_STRING_EQUAL(company->phonenum, "555-0000");
+    CU_ASSERT_PTR_NULL(company->email);
+    CU_ASSERT(scriba_id_compare(&(company->poc_list->id), &poc_id));
+    CU_ASSERT_STRING_EQUAL(company->poc_list->text, "Ivan Ivanovich Ivanov");
+    CU_ASSERT(scriba_id_compare(&(company->proj_list->id), &project_id));
+    CU_ASSERT(scriba_id_compare(&(company->event_list->id), &event_id));
+    scriba_freeCompanyData(company);
+
+    struct ScribaPoc *poc = scriba_getPOC(poc_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    CU_ASSERT_STRING_EQUAL(poc->email, "ivan@example.com");
+    CU_ASSERT_STRING_EQUAL(poc->mobilenum, "");
+    scriba_freePOCData(poc);
+
+    project = scriba_getProject(project_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    CU_ASSERT_EQUAL(project->state, PROJECT_STATE_CONTRACT_SIGNED);
+    CU_ASSERT_EQUAL(project->start_time, 500);
+    CU_ASSERT_EQUAL(project->mod_time, mod_time);
+    scriba_freeProjectData(project);
+
+    struct ScribaEvent *event = scriba_getEvent(event_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    CU_ASSERT_STRING_EQUAL(event->descr, "Memory Event");
+    CU_ASSERT_EQUAL(event->timestamp, 700);
+    CU_ASSERT_EQUAL(event->state, EVENT_STATE_COMPLETED);
+    scriba_freeEventData(event);
+
+    // indexes are rebuilt for loaded entities
+    scriba_list_t *list = scriba_getProjectsByState(PROJECT_STATE_CONTRACT_SIGNED);
+    CU_ASSERT(scriba_id_compare(&(list->id), &project_id));
+    scriba_list_delete(list);
+    list = scriba_getEventsByPOC(poc_id);
+    CU_ASSERT(scriba_id_compare(&(list->id), &event_id));
+    scriba_list_delete(list);
+
+    scriba_removeCompany(company_id);
+    scriba_removePOC(poc_id);
+    scriba_removeProject(project_id);
+    scriba_removeEvent(event_id);
+    scriba_cleanup();
+    unlink(TEST_MEMORY_SNAPSHOT_LOCATION);
+    CU_ASSERT_EQUAL(init_backend(NULL), SCRIBA_INIT_SUCCESS);
+}
+
+// rolled back changes are not visible and indexes are restored
+void test_memory_rollback()
+{
+    scriba_id_t company_id;
+    scriba_id_t project_id;
+    scriba_id_t new_company_id;
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&project_id);
+    scriba_id_create(&new_company_id);
+    scriba_addCompanyWithID(company_id, "Rollback Company", "", "", "", "", "");
+    scriba_addProjectWithID(project_id, "Rollback Project", "", company_id,
+                            PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB, 0, 100);
+    unsigned long long stamp = scriba_getChangeStamp();
+
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_addCompanyWithID(new_company_id, "New Company", "", "", "", "", "");
+    struct ScribaProject *project = scriba_getProject(project_id);
+    project->state = PROJECT_STATE_REJECTED;
+    scriba_updateProject(project);
+    scriba_freeProjectData(project);
+    scriba_removeCompany(company_id);
+    scriba_rollbackWrite();
+
+    CU_ASSERT_PTR_NULL(scriba_getCompany(new_company_id));
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT(scriba_id_compare(&(company->proj_list->id), &project_id));
+    scriba_freeCompanyData(company);
+    project = scriba_getProject(project_id);
+    CU_ASSERT_EQUAL(project->state, PROJECT_STATE_OFFER);
+    scriba_freeProjectData(project);
+    scriba_list_t *list = scriba_getProjectsByState(PROJECT_STATE_REJECTED);
+    CU_ASSERT_FALSE(list_contains(list, &project_id));
+    scriba_list_delete(list);
+    CU_ASSERT_EQUAL(scriba_getChangeStamp(), stamp);
+
+    // committed changes stay
+    CU_ASSERT_EQUAL(scriba_beginWrite(), 0);
+    scriba_removeProject(project_id);
+    CU_ASSERT_EQUAL(scriba_commitWrite(), 0);
+    CU_ASSERT_PTR_NULL(scriba_getProject(project_id));
+
+    scriba_removeCompany(company_id);
+}
+
+// scans report entities changed and removed after the given stamp
+void test_memory_changes()
+{
+    scriba_id_t company_ids[3];
+    int count = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        scriba_id_create(&(company_ids[i]));
+        scriba_addCompanyWithID(company_ids[i], "Change Company", "", "", "", "", "");
+    }
+    unsigned long long stamp = scriba_getChangeStamp();
+
+    struct ScribaCompany *company = scriba_getCompany(company_ids[0]);
+    char *name = company->name;
+    company->name = "Changed Company";
+    scriba_updateCompany(company);
+    company->name = name;
+    scriba_freeCompanyData(company);
+    scriba_removeCompany(company_ids[1]);
+    CU_ASSERT(scriba_getChangeStamp() > stamp);
+
+    struct ScribaScanFilter filter;
+    memset(&filter, 0, sizeof (filter));
+    filter.use_changed_since = 1;
+    filter.changed_since = stamp;
+    CU_ASSERT_EQUAL(scriba_scanCompanies(&filter, count_company, &count), 0);
+    CU_ASSERT_EQUAL(count, 1);
+
+    count = 0;
+    CU_ASSERT_EQUAL(scriba_scanRemoved(stamp, count_removed, &count), 0);
+    CU_ASSERT_EQUAL(count, 1);
+
+    // same data does not change anything, empty fields are returned as NULL,
+    // so the first upsert stores them the same way
+    company = scriba_getCompany(company_ids[2]);
+    scriba_upsertCompany(company, 1);
+    unsigned long long upsert_stamp = scriba_getChangeStamp();
+    CU_ASSERT_EQUAL(scriba_upsertCompany(company, 1), SCRIBA_UPSERT_KEPT);
+    scriba_freeCompanyData(company);
+    CU_ASSERT_EQUAL(scriba_getChangeStamp(), upsert_stamp);
+
+    scriba_removeCompany(company_ids[0]);
+    scriba_removeCompany(company_ids[2]);
+}
+
+static int init_backend(const char *snapshot)
+{
+    struct ScribaDB db;
+    db.name = SCRIBA_MEMORY_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam param;
+    param.key = SCRIBA_MEMORY_SNAPSHOT_PARAM;
+    param.value = (char *)snapshot;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &param;
+    paramList.next = NULL;
+
+    return scriba_init(&db, (snapshot != NULL) ? &paramList : NULL);
+}
+
+static int list_contains(scriba_list_t *list, const scriba_id_t *id)
+{
+    scriba_list_for_each(list, item)
+    {
+        if (scriba_id_compare(&(item->id), id))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void count_removed(const scriba_id_t *id, enum ScribaEntityType type, void *ctx)
+{
+    (void)id;
+    if (type == SCRIBA_ENTITY_COMPANY)
+    {
+        (*(int *)ctx)++;
+    }
+}
+
+static void count_company(const struct ScribaCompany *company, void *ctx)
+{
+    (void)company;
+    (*(int *)ctx)++;
+}
@@ -0,0 +1,33 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_MEMORY_BACKEND_TEST_H
+#define SCRIBA_MEMORY_BACKEND_TEST_H
+
+#define MEMORY_BACKEND_TEST_NAME "Memory backend test"
+
+int memory_backend_test_init();
+int memory_backend_test_cleanup();
+
+void test_memory_persistence();
+void test_memory_rollback();
+void test_memory_changes();
+
+#endif // SCRIBA_MEMORY_BACKEND_TEST_H
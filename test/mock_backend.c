@@ -117,7 +117,7 @@ static void mock_backend_cleanup()
         struct MockCompanyList *current = company;
         free_company_data(current->data);
         company = current->next;
-        free(current);
+        scriba_free(current);
     }
 
     struct MockEventList *event = mockData.events;
@@ -126,7 +126,7 @@ static void mock_backend_cleanup()
         struct MockEventList *current = event;
         free_event_data(current->data);
         event = current->next;
-        free(current);
+        scriba_free(current);
     }
 
     struct MockPOCList *poc = mockData.people;
@@ -135,7 +135,7 @@ static void mock_backend_cleanup()
         struct MockPOCList *current = poc;
         free_poc_data(current->data);
         poc = current->next;
-        free(current);
+        scriba_free(current);
     }
 
     struct MockProjectList *project = mockData.projects;
@@ -144,7 +144,7 @@ static void mock_backend_cleanup()
         struct MockProjectList *current = project;
         free_project_data(current->data);
         project = current->next;
-        free(current);
+        scriba_free(current);
     }
 }
 
@@ -284,11 +284,11 @@ static scriba_list_t *getCompaniesByName(const char *name)
             scriba_list_add(list, company->data->id, company->data->name);
         }
 
-        free(name_lower);
+        scriba_free(name_lower);
         company = company->next;
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -307,10 +307,10 @@ static scriba_list_t *getCompaniesByJurName(const char *juridicial_name)
         }
 
         company = company->next;
-        free(jur_name_lower);
+        scriba_free(jur_name_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -329,10 +329,10 @@ static scriba_list_t *getCompaniesByAddress(const char *address)
         }
 
         company = company->next;
-        free(addr_lower);
+        scriba_free(addr_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -340,7 +340,7 @@ static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
                        const char *address, const char *inn, const char *phonenum,
                        const char *email)
 {
-    struct ScribaCompany *new_company = (struct ScribaCompany *)malloc(sizeof (struct ScribaCompany));
+    struct ScribaCompany *new_company = (struct ScribaCompany *)scriba_malloc(sizeof (struct ScribaCompany));
     int len = 0;
 
     memset((void *)new_company, 0, sizeof (struct ScribaCompany));
@@ -348,37 +348,37 @@ static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
     scriba_id_copy(&(new_company->id), &id);
     if ((len = strlen(name)) > 0)
     {
-        new_company->name = (char *)malloc(len + 1);
+        new_company->name = (char *)scriba_malloc(len + 1);
         memset(new_company->name, 0, len + 1);
         strncpy(new_company->name, name, len);
     }
     if ((len = strlen(jur_name)) > 0)
     {
-        new_company->jur_name = (char *)malloc(len + 1);
+        new_company->jur_name = (char *)scriba_malloc(len + 1);
         memset(new_company->jur_name, 0, len + 1);
         strncpy(new_company->jur_name, jur_name, len);
     }
     if ((len = strlen(address)) > 0)
     {
-        new_company->address = (char *)malloc(len + 1);
+        new_company->address = (char *)scriba_malloc(len + 1);
         memset(new_company->address, 0, len + 1);
         strncpy(new_company->address, address, len);
     }
     if ((len = strlen(inn)) > 0)
     {
-        new_company->inn = (char *)malloc(len + 1);
+        new_company->inn = (char *)scriba_malloc(len + 1);
         memset(new_company->inn, 0, len + 1);
         strncpy(new_company->inn, inn, len);
     }
     if ((len = strlen(phonenum)) > 0)
     {
-        new_company->phonenum = (char *)malloc(len + 1);
+        new_company->phonenum = (char *)scriba_malloc(len + 1);
         memset(new_company->phonenum, 0, len + 1);
         strncpy(new_company->phonenum, phonenum, len);
     }
     if ((len = strlen(email)) > 0)
     {
-        new_company->email = (char *)malloc(len + 1);
+        new_company->email = (char *)scriba_malloc(len + 1);
         memset(new_company->email, 0, len + 1);
         strncpy(new_company->email, email, len);
     }
@@ -393,7 +393,7 @@ static void addCompany(scriba_id_t id, const char *name, const char *jur_name,
         }
         company = company->next;
     }
-    company = (struct MockCompanyList *)malloc(sizeof (struct MockCompanyList));
+    company = (struct MockCompanyList *)scriba_malloc(sizeof (struct MockCompanyList));
     company->data = new_company;
     company->next = NULL;
     if (mockData.companies == NULL)
@@ -416,7 +416,7 @@ static void updateCompany(const struct ScribaCompany *company)
         {
             struct ScribaCompany *updated = scriba_copyCompany(company);
             free_company_data(cur_company->data);
-            free(cur_company->data);
+            scriba_free(cur_company->data);
             cur_company->data = updated;
             break;
         }
@@ -444,8 +444,8 @@ static void removeCompany(scriba_id_t id)
                 mockData.companies = company->next;
             }
             free_company_data(company->data);
-            free(company->data);
-            free(company);
+            scriba_free(company->data);
+            scriba_free(company);
             break;
         }
 
@@ -458,32 +458,32 @@ static void free_company_data(struct ScribaCompany *company)
 {
     if (company->name != NULL)
     {
-        free(company->name);
+        scriba_free(company->name);
         company->name = NULL;
     }
     if (company->jur_name != NULL)
     {
-        free(company->jur_name);
+        scriba_free(company->jur_name);
         company->jur_name = NULL;
     }
     if (company->address != NULL)
     {
-        free(company->address);
+        scriba_free(company->address);
         company->address = NULL;
     }
     if (company->inn != NULL)
     {
-        free(company->inn);
+        scriba_free(company->inn);
         company->inn = NULL;
     }
     if (company->phonenum != NULL)
     {
-        free(company->phonenum);
+        scriba_free(company->phonenum);
         company->phonenum = NULL;
     }
     if (company->email != NULL)
     {
-        free(company->email);
+        scriba_free(company->email);
         company->email = NULL;
     }
 }
@@ -535,10 +535,10 @@ static scriba_list_t *getEventsByDescr(const char *descr)
             scriba_list_add(list, event->data->id, event->data->descr);
         }
         event = event->next;
-        free(descr_lower);
+        scriba_free(descr_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -618,7 +618,7 @@ static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id,
                      scriba_id_t project_id, enum ScribaEventType type, const char *outcome,
                      scriba_time_t timestamp, enum ScribaEventState state)
 {
-    struct ScribaEvent *new_event = (struct ScribaEvent *)malloc(sizeof (struct ScribaEvent));
+    struct ScribaEvent *new_event = (struct ScribaEvent *)scriba_malloc(sizeof (struct ScribaEvent));
     int len = 0;
 
     memset(new_event, 0, sizeof (struct ScribaEvent));
@@ -626,7 +626,7 @@ static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id,
     scriba_id_copy(&(new_event->id), &id);
     if ((len = strlen(descr)) > 0)
     {
-        new_event->descr = (char *)malloc(len + 1);
+        new_event->descr = (char *)scriba_malloc(len + 1);
         memset(new_event->descr, 0, len + 1);
         strncpy(new_event->descr, descr, len);
     }
@@ -636,7 +636,7 @@ static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id,
     new_event->type = type;
     if ((len = strlen(outcome)) > 0)
     {
-        new_event->outcome = (char *)malloc(len + 1);
+        new_event->outcome = (char *)scriba_malloc(len + 1);
         memset(new_event->outcome, 0, len + 1);
         strncpy(new_event->outcome, outcome, len);
     }
@@ -653,7 +653,7 @@ static void addEvent(scriba_id_t id, const char *descr, scriba_id_t company_id,
         }
         event = event->next;
     }
-    event = (struct MockEventList *)malloc(sizeof (struct MockEventList));
+    event = (struct MockEventList *)scriba_malloc(sizeof (struct MockEventList));
     event->data = new_event;
     event->next = NULL;
     if (mockData.events == NULL)
@@ -676,7 +676,7 @@ static void updateEvent(const struct ScribaEvent *event)
         {
             struct ScribaEvent *updated = scriba_copyEvent(event);
             free_event_data(cur_event->data);
-            free(cur_event->data);
+            scriba_free(cur_event->data);
             cur_event->data = updated;
             break;
         }
@@ -704,8 +704,8 @@ static void removeEvent(scriba_id_t id)
                 mockData.events = event->next;
             }
             free_event_data(event->data);
-            free(event->data);
-            free(event);
+            scriba_free(event->data);
+            scriba_free(event);
             break;
         }
 
@@ -718,13 +718,13 @@ static void free_event_data(struct ScribaEvent *event)
 {
     if (event->descr != NULL)
     {
-        free(event->descr);
+        scriba_free(event->descr);
         event->descr = NULL;
     }
 
     if (event->outcome != NULL)
     {
-        free(event->outcome);
+        scriba_free(event->outcome);
         event->outcome = NULL;
     }
 }
@@ -783,12 +783,12 @@ static scriba_list_t *getPOCByName(const char *name)
         }
 
         poc = poc->next;
-        free(firstname_lower);
-        free(secondname_lower);
-        free(lastname_lower);
+        scriba_free(firstname_lower);
+        scriba_free(secondname_lower);
+        scriba_free(lastname_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -828,10 +828,10 @@ static scriba_list_t *getPOCByPosition(const char *position)
         }
 
         poc = poc->next;
-        free(pos_lower);
+        scriba_free(pos_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -871,10 +871,10 @@ static scriba_list_t *getPOCByEmail(const char *email)
         }
 
         poc = poc->next;
-        free(email_lower);
+        scriba_free(email_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -882,7 +882,7 @@ static void addPOC(scriba_id_t id, const char *firstname, const char *secondname
                    const char *lastname, const char *mobilenum, const char *phonenum,
                    const char *email, const char *position, scriba_id_t company_id)
 {
-    struct ScribaPoc *new_poc = (struct ScribaPoc *)malloc(sizeof (struct ScribaPoc));
+    struct ScribaPoc *new_poc = (struct ScribaPoc *)scriba_malloc(sizeof (struct ScribaPoc));
     int len = 0;
 
     memset(new_poc, 0, sizeof (struct ScribaPoc));
@@ -890,43 +890,43 @@ static void addPOC(scriba_id_t id, const char *firstname, const char *secondname
     scriba_id_copy(&(new_poc->id), &id);
     if ((len = strlen(firstname)) > 0)
     {
-        new_poc->firstname = (char *)malloc(len + 1);
+        new_poc->firstname = (char *)scriba_malloc(len + 1);
         memset(new_poc->firstname, 0, len + 1);
         strncpy(new_poc->firstname, firstname, len);
     }
     if ((len = strlen(secondname)) > 0)
     {
-        new_poc->secondname = (char *)malloc(len + 1);
+        new_poc->secondname = (char *)scriba_malloc(len + 1);
         memset(new_poc->secondname, 0, len + 1);
         strncpy(new_poc->secondname, secondname, len);
     }
     if ((len = strlen(lastname)) > 0)
     {
-        new_poc->lastname = (char *)malloc(len + 1);
+        new_poc->lastname = (char *)scriba_malloc(len + 1);
         memset(new_poc->lastname, 0, len + 1);
         strncpy(new_poc->lastname, lastname, len);
     }
     if ((len = strlen(mobilenum)) > 0)
     {
-        new_poc->mobilenum = (char *)malloc(len + 1);
+        new_poc->mobilenum = (char *)scriba_malloc(len + 1);
         memset(new_poc->mobilenum, 0, len + 1);
         strncpy(new_poc->mobilenum, mobilenum, len);
     }
     if ((len = strlen(phonenum)) > 0)
     {
-        new_poc->phonenum = (char *)malloc(len + 1);
+        new_poc->phonenum = (char *)scriba_malloc(len + 1);
         memset(new_poc->phonenum, 0, len + 1);
         strncpy(new_poc->phonenum, phonenum, len);
     }
     if ((len = strlen(email)) > 0)
     {
-        new_poc->email = (char *)malloc(len + 1);
+        new_poc->email = (char *)scriba_malloc(len + 1);
         memset(new_poc->email, 0, len + 1);
         strncpy(new_poc->email, email, len);
     }
     if ((len = strlen(position)) > 0)
     {
-        new_poc->position = (char *)malloc(len + 1);
+        new_poc->position = (char *)scriba_malloc(len + 1);
         memset(new_poc->position, 0, len + 1);
         strncpy(new_poc->position, position, len);
     }
@@ -942,7 +942,7 @@ static void addPOC(scriba_id_t id, const char *firstname, const char *secondname
         }
         poc = poc->next;
     }
-    poc = (struct MockPOCList *)malloc(sizeof (struct MockPOCList));
+    poc = (struct MockPOCList *)scriba_malloc(sizeof (struct MockPOCList));
     poc->data = new_poc;
     poc->next = NULL;
     if (mockData.people == NULL)
@@ -965,7 +965,7 @@ static void updatePOC(const struct ScribaPoc *poc)
         {
             struct ScribaPoc *updated = scriba_copyPOC(poc);
             free_poc_data(cur_poc->data);
-            free(cur_poc->data);
+            scriba_free(cur_poc->data);
             cur_poc->data = updated;
             break;
         }
@@ -993,8 +993,8 @@ static void removePOC(scriba_id_t id)
                 mockData.people = poc->next;
             }
             free_poc_data(poc->data);
-            free(poc->data);
-            free(poc);
+            scriba_free(poc->data);
+            scriba_free(poc);
             break;
         }
 
@@ -1007,37 +1007,37 @@ static void free_poc_data(struct ScribaPoc *poc)
 {
     if (poc->firstname != NULL)
     {
-        free(poc->firstname);
+        scriba_free(poc->firstname);
         poc->firstname = NULL;
     }
     if (poc->secondname != NULL)
     {
-        free(poc->secondname);
+        scriba_free(poc->secondname);
         poc->secondname = NULL;
     }
     if (poc->lastname != NULL)
     {
-        free(poc->lastname);
+        scriba_free(poc->lastname);
         poc->lastname = NULL;
     }
     if (poc->mobilenum != NULL)
     {
-        free(poc->mobilenum);
+        scriba_free(poc->mobilenum);
         poc->mobilenum = NULL;
     }
     if (poc->phonenum != NULL)
     {
-        free(poc->phonenum);
+        scriba_free(poc->phonenum);
         poc->phonenum = NULL;
     }
     if (poc->email != NULL)
     {
-        free(poc->email);
+        scriba_free(poc->email);
         poc->email = NULL;
     }
     if (poc->position != NULL)
     {
-        free(poc->position);
+        scriba_free(poc->position);
         poc->position = NULL;
     }
 }
@@ -1090,10 +1090,10 @@ static scriba_list_t *getProjectsByTitle(const char *title)
         }
 
         project = project->next;
-        free(title_lower);
+        scriba_free(title_lower);
     }
 
-    free(search_lower);
+    scriba_free(search_lower);
     return list;
 }
 
@@ -1217,7 +1217,7 @@ static void addProject(scriba_id_t id, const char *title, const char *descr,
                        scriba_id_t company_id, enum ScribaProjectState state,
                        enum ScribaCurrency currency, long long cost, scriba_time_t start_time)
 {
-    struct ScribaProject *new_project = (struct ScribaProject *)malloc(sizeof (struct ScribaProject));
+    struct ScribaProject *new_project = (struct ScribaProject *)scriba_malloc(sizeof (struct ScribaProject));
     int len = 0;
 
     memset(new_project, 0, sizeof (struct ScribaProject));
@@ -1225,13 +1225,13 @@ static void addProject(scriba_id_t id, const char *title, const char *descr,
     scriba_id_copy(&(new_project->id), &id);
     if ((len = strlen(title)) != 0)
     {
-        new_project->title = (char *)malloc(len + 1);
+        new_project->title = (char *)scriba_malloc(len + 1);
         memset(new_project->title, 0, len + 1);
         strncpy(new_project->title, title, len);
     }
     if ((len = strlen(descr)) != 0)
     {
-        new_project->descr = (char *)malloc(len + 1);
+        new_project->descr = (char *)scriba_malloc(len + 1);
         memset(new_project->descr, 0, len + 1);
         strncpy(new_project->descr, descr, len);
     }
@@ -1252,7 +1252,7 @@ static void addProject(scriba_id_t id, const char *title, const char *descr,
         }
         project = project->next;
     }
-    project = (struct MockProjectList *)malloc(sizeof (struct MockProjectList));
+    project = (struct MockProjectList *)scriba_malloc(sizeof (struct MockProjectList));
     project->data = new_project;
     project->next = NULL;
     if (mockData.projects == NULL)
@@ -1275,7 +1275,7 @@ static void updateProject(struct ScribaProject *project)
         {
             struct ScribaProject *updated = scriba_copyProject(project);
             free_project_data(cur_project->data);
-            free(cur_project->data);
+            scriba_free(cur_project->data);
             cur_project->data = updated;
             break;
         }
@@ -1303,8 +1303,8 @@ static void removeProject(scriba_id_t id)
                 mockData.projects = project->next;
             }
             free_project_data(project->data);
-            free(project->data);
-            free(project);
+            scriba_free(project->data);
+            scriba_free(project);
             break;
         }
 
@@ -1317,12 +1317,12 @@ static void free_project_data(struct ScribaProject *project)
 {
     if (project->title != NULL)
     {
-        free(project->title);
+        scriba_free(project->title);
         project->title = NULL;
     }
     if (project->descr != NULL)
     {
-        free(project->descr);
+        scriba_free(project->descr);
         project->descr = NULL;
     }
 }
@@ -1338,7 +1338,7 @@ static char *str_tolower(const char *str)
     }
 
     len = strlen(str);
-    result = (char *)malloc(len + 1);
+    result = (char *)scriba_malloc(len + 1);
     for (int i = 0; i < len; i++)
     {
         result[i] = tolower(str[i]);
@@ -18,15 +18,25 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "serializer_test.h"
 #include "common_test.h"
 #include "sqlite_backend.h"
 #include "serializer.h"
+#include "sqlite3.h"
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <CUnit/CUnit.h>
 
 #define TEST_DB_LOCATION "./serializer_test_sqlite_db"
+#define TEST_EXPORT_LOCATION "./serializer_test_export"
+#define TEST_PEER_DB_LOCATION "./serializer_test_peer_sqlite_db"
 
 static scriba_id_t company1_id;
 static scriba_id_t company2_id;
@@ -45,6 +55,14 @@ static void verify_test_data();
 static void create_ru_test_data();
 // verify data in Russian restored from buffer
 static void verify_ru_test_data();
+// replace string field of entity data
+static void replace_string(char **field, const char *value);
+// switch the library to another database file
+static void open_test_db(const char *location);
+// exchange reconciliation messages between two reconcilers; returns number of messages
+static int reconcile_local(scriba_reconciler_t *rec1, scriba_reconciler_t *rec2);
+// write data to the test export file
+static void write_test_file(const void *data, unsigned long len);
 
 int serializer_test_init()
 {
@@ -240,6 +258,1141 @@ void test_serializer_local_override()
     free(buf);
 }
 
+// test serialization of a part of local data
+void test_serializer_subset()
+{
+    scriba_id_t missing_id;
+
+    // previous tests may leave data in the local DB
+    clean_local_db();
+    create_test_data();
+
+    // export entries of the first company only; unknown ids are ignored
+    scriba_id_create(&missing_id);
+    scriba_list_t *companies = scriba_list_init();
+    scriba_list_add(companies, company1_id, NULL);
+    scriba_list_add(companies, missing_id, NULL);
+    scriba_list_t *people = scriba_list_init();
+    scriba_list_add(people, poc1_id, NULL);
+    scriba_list_t *projects = scriba_list_init();
+    scriba_list_add(projects, project1_id, NULL);
+    scriba_list_t *events = scriba_list_init();
+    scriba_list_add(events, event1_id, NULL);
+
+    void *buf = NULL;
+    unsigned long buflen = 0;
+    buf = scriba_serialize(companies, events, people, projects, &buflen);
+
+    scriba_list_delete(companies);
+    scriba_list_delete(people);
+    scriba_list_delete(projects);
+    scriba_list_delete(events);
+
+    clean_local_db();
+
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    if (company != NULL)
+    {
+        CU_ASSERT_STRING_EQUAL(company->name, "TestCompany1");
+        CU_ASSERT_STRING_EQUAL(company->email, "testcompany@test1.com");
+        scriba_freeCompanyData(company);
+    }
+    struct ScribaPoc *poc = scriba_getPOC(poc1_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    if (poc != NULL)
+    {
+        CU_ASSERT_STRING_EQUAL(poc->position, "regular moose");
+        CU_ASSERT(scriba_id_compare(&(poc->company_id), &company1_id));
+        scriba_freePOCData(poc);
+    }
+    struct ScribaProject *project = scriba_getProject(project1_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    if (project != NULL)
+    {
+        CU_ASSERT_EQUAL(project->cost, 1000);
+        CU_ASSERT_EQUAL(project->mod_time, 100);
+        scriba_freeProjectData(project);
+    }
+    struct ScribaEvent *event = scriba_getEvent(event1_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    if (event != NULL)
+    {
+        CU_ASSERT_STRING_EQUAL(event->outcome, "missed");
+        CU_ASSERT(scriba_id_compare(&(event->poc_id), &poc1_id));
+        scriba_freeEventData(event);
+    }
+
+    // entries that have not been exported
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company2_id));
+    CU_ASSERT_PTR_NULL(scriba_getCompany(missing_id));
+    CU_ASSERT_PTR_NULL(scriba_getPOC(poc2_id));
+    CU_ASSERT_PTR_NULL(scriba_getProject(project2_id));
+    CU_ASSERT_PTR_NULL(scriba_getEvent(event2_id));
+
+    clean_local_db();
+}
+
+// test serialization of the whole local database
+void test_serializer_all()
+{
+    clean_local_db();
+    create_test_data();
+
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeAll(&buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+
+    clean_local_db();
+
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    verify_test_data();
+
+    clean_local_db();
+}
+
+// test serialization of local data selected by filter
+void test_serializer_filtered()
+{
+    struct ScribaSerializeFilter filter;
+
+    clean_local_db();
+    create_test_data();
+
+    // data of the second company only
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_COMPANIES;
+    filter.companies = scriba_list_init();
+    scriba_list_add(filter.companies, company2_id, NULL);
+
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeFiltered(&filter, &buflen);
+    scriba_list_delete(filter.companies);
+
+    clean_local_db();
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    struct ScribaCompany *company = scriba_getCompany(company2_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    if (company != NULL)
+    {
+        CU_ASSERT_STRING_EQUAL(company->name, "TestCompany2");
+        scriba_freeCompanyData(company);
+    }
+    struct ScribaPoc *poc = scriba_getPOC(poc2_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    scriba_freePOCData(poc);
+    struct ScribaProject *project = scriba_getProject(project2_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    scriba_freeProjectData(project);
+    struct ScribaEvent *event = scriba_getEvent(event2_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    scriba_freeEventData(event);
+
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company1_id));
+    CU_ASSERT_PTR_NULL(scriba_getPOC(poc1_id));
+    CU_ASSERT_PTR_NULL(scriba_getProject(project1_id));
+    CU_ASSERT_PTR_NULL(scriba_getEvent(event1_id));
+
+    // projects modified since the given time, other entries are not affected
+    clean_local_db();
+    create_test_data();
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_MOD_SINCE;
+    filter.mod_since = 150;
+    buf = scriba_serializeFiltered(&filter, &buflen);
+
+    clean_local_db();
+    status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    project = scriba_getProject(project2_id);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    if (project != NULL)
+    {
+        CU_ASSERT_EQUAL(project->mod_time, 200);
+        scriba_freeProjectData(project);
+    }
+    CU_ASSERT_PTR_NULL(scriba_getProject(project1_id));
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+    event = scriba_getEvent(event1_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    scriba_freeEventData(event);
+
+    // empty company list selects nothing
+    clean_local_db();
+    create_test_data();
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_COMPANIES;
+    filter.companies = scriba_list_init();
+    buf = scriba_serializeFiltered(&filter, &buflen);
+    scriba_list_delete(filter.companies);
+
+    clean_local_db();
+    status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    scriba_list_t *companies = scriba_getAllCompanies();
+    CU_ASSERT(scriba_list_is_empty(companies));
+    scriba_list_delete(companies);
+    scriba_list_t *events = scriba_getAllEvents();
+    CU_ASSERT(scriba_list_is_empty(events));
+    scriba_list_delete(events);
+
+    clean_local_db();
+}
+
+// test serialization without copying output buffer
+void test_serializer_output()
+{
+    struct ScribaSerializedBuffer out;
+
+    clean_local_db();
+    create_test_data();
+
+    // reference copy of the serialized data
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeAll(&buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+
+    // serializer's own buffer
+    CU_ASSERT_EQUAL(scriba_serializeToBuffer(NULL, &out), 0);
+    CU_ASSERT_PTR_NOT_NULL(out.data);
+    CU_ASSERT_EQUAL(out.len, buflen);
+    if ((out.data != NULL) && (out.len == buflen))
+    {
+        CU_ASSERT_EQUAL(memcmp(out.data, buf, buflen), 0);
+    }
+    scriba_freeSerializedBuffer(&out);
+    CU_ASSERT_PTR_NULL(out.data);
+    CU_ASSERT_EQUAL(out.len, 0);
+
+    // file written directly from serializer's buffer
+    CU_ASSERT_EQUAL(scriba_serializeToFile(NULL, TEST_EXPORT_LOCATION), 0);
+    void *filebuf = malloc(buflen + 1);
+    FILE *file = fopen(TEST_EXPORT_LOCATION, "rb");
+    CU_ASSERT_PTR_NOT_NULL(file);
+    if (file != NULL)
+    {
+        CU_ASSERT_EQUAL(fread(filebuf, 1, buflen + 1, file), buflen);
+        fclose(file);
+        CU_ASSERT_EQUAL(memcmp(filebuf, buf, buflen), 0);
+    }
+    unlink(TEST_EXPORT_LOCATION);
+    free(buf);
+
+    CU_ASSERT_EQUAL(scriba_serializeToFd(NULL, -1), -1);
+    CU_ASSERT_EQUAL(scriba_serializeToFile(NULL, "./nonexistent_dir/export"), -1);
+
+    clean_local_db();
+    enum ScribaMergeStatus status = scriba_deserialize(filebuf, buflen,
+                                                       SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(filebuf);
+
+    verify_test_data();
+
+    clean_local_db();
+}
+
+// in-memory stream used by stream tests
+struct TestStream
+{
+    unsigned char *data;
+    unsigned long len;
+};
+
+// stream write function appending data to TestStream
+static int test_stream_write(const void *data, unsigned long len, void *ctx)
+{
+    struct TestStream *stream = (struct TestStream *)ctx;
+
+    stream->data = realloc(stream->data, stream->len + len);
+    memcpy(stream->data + stream->len, data, len);
+    stream->len += len;
+    return 0;
+}
+
+// test streaming serialization
+void test_serializer_stream()
+{
+    struct TestStream stream = { NULL, 0 };
+    enum ScribaMergeStatus status = SCRIBA_MERGE_CONFLICTS;
+
+    clean_local_db();
+    create_test_data();
+
+    // 8 entries are split into 3 chunks
+    CU_ASSERT_EQUAL(scriba_serializeStream(NULL, 3, test_stream_write, &stream), 0);
+    CU_ASSERT(stream.len > 4);
+    if (stream.len > 4)
+    {
+        CU_ASSERT_EQUAL(memcmp(stream.data + stream.len - 4, "\0\0\0\0", 4), 0);
+    }
+
+    // the stream is fed to the reader in small pieces
+    clean_local_db();
+    scriba_stream_reader_t *reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_PTR_NOT_NULL(reader);
+    for (unsigned long offset = 0; offset < stream.len; offset += 7)
+    {
+        unsigned long len = ((stream.len - offset) < 7) ? (stream.len - offset) : 7;
+        CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data + offset, len), 0);
+    }
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), 0);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    verify_test_data();
+
+    // incomplete stream
+    reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, stream.len - 2), 0);
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), -1);
+
+    // data after the end of stream mark
+    reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, stream.len), 0);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, 1), -1);
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), -1);
+    free(stream.data);
+
+    // entries added to the writer one by one
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    struct ScribaPoc *poc = scriba_getPOC(poc1_id);
+    stream.data = NULL;
+    stream.len = 0;
+    scriba_stream_writer_t *writer = scriba_stream_writer_create(0, test_stream_write, &stream);
+    CU_ASSERT_PTR_NOT_NULL(writer);
+    CU_ASSERT_EQUAL(scriba_stream_write_company(writer, company), 0);
+    CU_ASSERT_EQUAL(scriba_stream_write_poc(writer, poc), 0);
+    CU_ASSERT_EQUAL(scriba_stream_writer_finish(writer), 0);
+    scriba_freeCompanyData(company);
+    scriba_freePOCData(poc);
+
+    clean_local_db();
+    reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, stream.len), 0);
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), 0);
+    free(stream.data);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+    poc = scriba_getPOC(poc1_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    scriba_freePOCData(poc);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company2_id));
+
+    // stream written to and read from file
+    clean_local_db();
+    create_test_data();
+    FILE *file = fopen(TEST_EXPORT_LOCATION, "w+b");
+    CU_ASSERT_PTR_NOT_NULL(file);
+    if (file != NULL)
+    {
+        CU_ASSERT_EQUAL(scriba_serializeStreamToFd(NULL, 0, fileno(file)), 0);
+        clean_local_db();
+        lseek(fileno(file), 0, SEEK_SET);
+        CU_ASSERT_EQUAL(scriba_deserializeStreamFromFd(fileno(file),
+                                                       SCRIBA_MERGE_REMOTE_OVERRIDE,
+                                                       &status), 0);
+        fclose(file);
+        verify_test_data();
+    }
+    unlink(TEST_EXPORT_LOCATION);
+
+    clean_local_db();
+}
+
+// execute SQL statement on the test database through a separate connection
+static void test_db_exec(const char *query)
+{
+    sqlite3 *db = NULL;
+
+    CU_ASSERT_EQUAL(sqlite3_open(TEST_DB_LOCATION, &db), SQLITE_OK);
+    CU_ASSERT_EQUAL(sqlite3_exec(db, query, NULL, NULL, NULL), SQLITE_OK);
+    sqlite3_close(db);
+}
+
+// test that import is discarded if any of the entries can not be stored
+void test_serializer_transaction()
+{
+    clean_local_db();
+    create_test_data();
+
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeAll(&buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+    clean_local_db();
+
+    // projects can not be stored, so nothing is imported
+    test_db_exec("CREATE TRIGGER fail_import BEFORE INSERT ON Projects "
+                 "BEGIN SELECT RAISE(ABORT, 'import failure'); END");
+    enum ScribaMergeStatus status = scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_FAILED);
+    scriba_list_t *companies = scriba_getAllCompanies();
+    CU_ASSERT(scriba_list_is_empty(companies));
+    scriba_list_delete(companies);
+    scriba_list_t *people = scriba_getAllPeople();
+    CU_ASSERT(scriba_list_is_empty(people));
+    scriba_list_delete(people);
+
+    // batches committed before the failure are kept
+    status = scriba_deserializeBatched(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE, 2);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_FAILED);
+    struct ScribaCompany *company = scriba_getCompany(company2_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+    struct ScribaPoc *poc = scriba_getPOC(poc2_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    scriba_freePOCData(poc);
+    scriba_list_t *projects = scriba_getAllProjects();
+    CU_ASSERT(scriba_list_is_empty(projects));
+    scriba_list_delete(projects);
+
+    test_db_exec("DROP TRIGGER fail_import");
+    clean_local_db();
+    status = scriba_deserializeBatched(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE, 3);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(buf);
+
+    verify_test_data();
+
+    clean_local_db();
+}
+
+void test_serializer_parallel()
+{
+    clean_local_db();
+    create_test_data();
+
+    // enough companies for entries to be split between decoder threads
+    for (int i = 0; i < 1000; i++)
+    {
+        char name[50];
+        snprintf(name, 50, "Company %d", i);
+        scriba_addCompany(name, "Company LLC", "address", "1234567890", "555", "company@test.com");
+    }
+
+    unsigned long buflen = 0;
+    void *buf = scriba_serializeAll(&buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+    clean_local_db();
+
+    // failure in any batch discards all entries
+    test_db_exec("CREATE TRIGGER fail_import BEFORE INSERT ON Projects "
+                 "BEGIN SELECT RAISE(ABORT, 'import failure'); END");
+    enum ScribaMergeStatus status = scriba_deserializeParallel(buf, buflen,
+                                                               SCRIBA_MERGE_REMOTE_OVERRIDE,
+                                                               0, 4);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_FAILED);
+    scriba_list_t *companies = scriba_getAllCompanies();
+    CU_ASSERT(scriba_list_is_empty(companies));
+    scriba_list_delete(companies);
+    test_db_exec("DROP TRIGGER fail_import");
+
+    unsigned int threads[] = { 0, 1, 4 };
+    for (int i = 0; i < 3; i++)
+    {
+        clean_local_db();
+        status = scriba_deserializeParallel(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE,
+                                            100, threads[i]);
+        CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+        verify_test_data();
+
+        int num = 0;
+        companies = scriba_getAllCompanies();
+        scriba_list_for_each(companies, company)
+        {
+            num++;
+        }
+        scriba_list_delete(companies);
+        CU_ASSERT_EQUAL(num, 1002);
+    }
+    free(buf);
+
+    clean_local_db();
+}
+
+// test serialization by several threads
+void test_serializer_parallel_export()
+{
+    struct TestStream stream = { NULL, 0 };
+    struct ScribaSerializeFilter filter;
+    enum ScribaMergeStatus status = SCRIBA_MERGE_CONFLICTS;
+
+    clean_local_db();
+    create_test_data();
+    for (int i = 0; i < 1000; i++)
+    {
+        char name[50];
+        snprintf(name, 50, "Company %d", i);
+        scriba_addCompany(name, "Company LLC", "address", "1234567890", "555", "company@test.com");
+    }
+
+    CU_ASSERT_EQUAL(scriba_serializeParallel(NULL, 100, 4, test_stream_write, &stream), 0);
+    clean_local_db();
+    scriba_stream_reader_t *reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, stream.len), 0);
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), 0);
+    CU_ASSERT_EQUAL(status, SCRIBA_MERGE_OK);
+    free(stream.data);
+    verify_test_data();
+
+    // every entity belongs to exactly one shard
+    int num = 0;
+    scriba_list_t *companies = scriba_getAllCompanies();
+    scriba_list_for_each(companies, company)
+    {
+        num++;
+    }
+    scriba_list_delete(companies);
+    CU_ASSERT_EQUAL(num, 1002);
+
+    // filter is applied to each shard
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_COMPANIES;
+    filter.companies = scriba_list_init();
+    scriba_list_add(filter.companies, company2_id, NULL);
+    stream.data = NULL;
+    stream.len = 0;
+    CU_ASSERT_EQUAL(scriba_serializeParallel(&filter, 0, 3, test_stream_write, &stream), 0);
+    scriba_list_delete(filter.companies);
+
+    clean_local_db();
+    reader = scriba_stream_reader_create(SCRIBA_MERGE_REMOTE_OVERRIDE);
+    CU_ASSERT_EQUAL(scriba_stream_reader_feed(reader, stream.data, stream.len), 0);
+    CU_ASSERT_EQUAL(scriba_stream_reader_finish(reader, &status), 0);
+    free(stream.data);
+    struct ScribaPoc *poc = scriba_getPOC(poc2_id);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    scriba_freePOCData(poc);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company1_id));
+    CU_ASSERT_PTR_NULL(scriba_getPOC(poc1_id));
+
+    clean_local_db();
+}
+
+void test_serializer_changes()
+{
+    scriba_sync_token_t token = 0;
+    scriba_sync_token_t new_token = 0;
+    unsigned long full_len = 0;
+    unsigned long delta_len = 0;
+
+    clean_local_db();
+    create_test_data();
+
+    // token 0 exports everything
+    void *full = scriba_serializeChangesSince(0, &token, &full_len);
+    CU_ASSERT_PTR_NOT_NULL(full);
+    CU_ASSERT_NOT_EQUAL(token, 0);
+
+    // nothing has changed since the full export
+    void *delta = scriba_serializeChangesSince(token, &new_token, &delta_len);
+    CU_ASSERT_EQUAL(new_token, token);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(delta, delta_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_list_t *companies = scriba_getAllCompanies();
+    CU_ASSERT_TRUE(scriba_list_is_empty(companies));
+    scriba_list_delete(companies);
+    free(delta);
+
+    // restore the exported state, it gets new stamps after import
+    CU_ASSERT_EQUAL(scriba_deserialize(full, full_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    delta = scriba_serializeChangesSince(0, &token, &delta_len);
+    free(delta);
+
+    // update one company and remove one event
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    free(company->name);
+    company->name = (char *)malloc(strlen("UpdatedCompany1") + 1);
+    strcpy(company->name, "UpdatedCompany1");
+    scriba_updateCompany(company);
+    scriba_freeCompanyData(company);
+    scriba_removeEvent(event1_id);
+
+    delta = scriba_serializeChangesSince(token, &new_token, &delta_len);
+    CU_ASSERT_PTR_NOT_NULL(delta);
+    CU_ASSERT_TRUE(new_token > token);
+    CU_ASSERT_TRUE(delta_len < full_len);
+
+    // applying changes to the exported state gives the current state
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(full, full_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    struct ScribaEvent *event = scriba_getEvent(event1_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    scriba_freeEventData(event);
+    CU_ASSERT_EQUAL(scriba_deserialize(delta, delta_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_STRING_EQUAL(company->name, "UpdatedCompany1");
+    scriba_freeCompanyData(company);
+    CU_ASSERT_PTR_NULL(scriba_getEvent(event1_id));
+    event = scriba_getEvent(event2_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    scriba_freeEventData(event);
+
+    // local data wins over remote removals with local override
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(full, full_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    CU_ASSERT_EQUAL(scriba_deserialize(delta, delta_len, SCRIBA_MERGE_LOCAL_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    event = scriba_getEvent(event1_id);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    scriba_freeEventData(event);
+
+    // only changed entries are exported
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(delta, delta_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    scriba_freeCompanyData(company);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company2_id));
+    CU_ASSERT_PTR_NULL(scriba_getPOC(poc1_id));
+
+    free(full);
+    free(delta);
+    clean_local_db();
+}
+
+void test_serializer_compressed()
+{
+    unsigned long buflen = 0;
+    unsigned long framelen = 0;
+    unsigned long len = 0;
+
+    clean_local_db();
+    create_test_data();
+
+    void *buf = scriba_serializeAll(&buflen);
+    void *frame = scriba_compress(buf, buflen, &framelen);
+    CU_ASSERT_PTR_NOT_NULL(frame);
+    CU_ASSERT_TRUE(scriba_isCompressed(frame, framelen));
+    CU_ASSERT_FALSE(scriba_isCompressed(buf, buflen));
+    CU_ASSERT_TRUE(framelen < buflen);
+
+    void *plain = scriba_decompress(frame, framelen, &len);
+    CU_ASSERT_PTR_NOT_NULL(plain);
+    CU_ASSERT_EQUAL(len, buflen);
+    CU_ASSERT_EQUAL(memcmp(plain, buf, buflen), 0);
+    free(plain);
+
+    // the frame is detected by deserializer
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(frame, framelen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+    free(frame);
+
+    frame = scriba_serializeCompressed(NULL, &framelen);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserializeBatched(frame, framelen, SCRIBA_MERGE_REMOTE_OVERRIDE, 2),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+
+    // truncated frame is rejected
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(frame, framelen - 1, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+    CU_ASSERT_PTR_NULL(scriba_decompress(frame, framelen - 1, &len));
+    free(frame);
+
+    // frame compressed with dictionary requires the same dictionary
+    char dict[SCRIBA_COMPRESS_DICT_MAX_SIZE];
+    const void *samples[] = { buf };
+    unsigned long dict_len = scriba_trainCompressionDict(samples, &buflen, 1, dict, sizeof (dict));
+    CU_ASSERT_NOT_EQUAL(dict_len, 0);
+    CU_ASSERT_EQUAL(scriba_setCompressionDict(dict, dict_len), 0);
+    void *dict_frame = scriba_compress(buf, buflen, &len);
+    CU_ASSERT_PTR_NOT_NULL(dict_frame);
+    CU_ASSERT_TRUE(len < framelen);
+    CU_ASSERT_EQUAL(scriba_setCompressionDict(NULL, 0), 0);
+    CU_ASSERT_EQUAL(scriba_deserialize(dict_frame, len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+    CU_ASSERT_EQUAL(scriba_setCompressionDict(dict, dict_len), 0);
+    CU_ASSERT_EQUAL(scriba_deserialize(dict_frame, len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+    free(dict_frame);
+    free(buf);
+
+    // arbitrary data survives round trip: long runs, random bytes and
+    // matches reaching into the dictionary
+    buflen = 200000;
+    buf = malloc(buflen);
+    srand(1);
+    for (unsigned long i = 0; i < buflen; i++)
+    {
+        if (i < 70000)
+        {
+            ((unsigned char *)buf)[i] = (unsigned char)(rand() & 0xff);
+        }
+        else if (i < 140000)
+        {
+            ((unsigned char *)buf)[i] = (unsigned char)((i / 1000) & 0xff);
+        }
+        else
+        {
+            ((unsigned char *)buf)[i] = (unsigned char)dict[i % dict_len];
+        }
+    }
+    frame = scriba_compress(buf, buflen, &framelen);
+    plain = scriba_decompress(frame, framelen, &len);
+    CU_ASSERT_PTR_NOT_NULL(plain);
+    CU_ASSERT_EQUAL(len, buflen);
+    CU_ASSERT_EQUAL(memcmp(plain, buf, buflen), 0);
+    free(plain);
+    free(frame);
+    free(buf);
+
+    scriba_setCompressionDict(NULL, 0);
+    clean_local_db();
+}
+
+// test compact buffers
+void test_serializer_compact()
+{
+    struct ScribaSerializeFilter filter;
+    unsigned long buflen = 0;
+    unsigned long compact_len = 0;
+    scriba_id_t event3_id;
+    scriba_id_t zero_id;
+
+    clean_local_db();
+    create_test_data();
+    // event not bound to anything has zero ids, which are not stored
+    scriba_id_create(&event3_id);
+    memset(&zero_id, 0, sizeof (zero_id));
+    scriba_addEventWithID(event3_id, "Test event1", zero_id, zero_id, zero_id,
+                          EVENT_TYPE_CALL, "missed", (scriba_time_t)0, EVENT_STATE_CANCELLED);
+
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_COMPACT;
+    void *buf = scriba_serializeAll(&buflen);
+    void *compact = scriba_serializeFiltered(&filter, &compact_len);
+    CU_ASSERT_PTR_NOT_NULL(compact);
+    CU_ASSERT_TRUE(compact_len < buflen);
+    free(buf);
+
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(compact, compact_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+    struct ScribaEvent *event3 = scriba_getEvent(event3_id);
+    CU_ASSERT_PTR_NOT_NULL(event3);
+    CU_ASSERT_STRING_EQUAL(event3->descr, "Test event1");
+    CU_ASSERT(scriba_id_compare(&(event3->company_id), &zero_id));
+    CU_ASSERT(scriba_id_compare(&(event3->poc_id), &zero_id));
+    CU_ASSERT(scriba_id_compare(&(event3->project_id), &zero_id));
+    scriba_freeEventData(event3);
+
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserializeParallel(compact, compact_len,
+                                               SCRIBA_MERGE_REMOTE_OVERRIDE, 0, 2),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+
+    // compact buffer may be compressed as well
+    unsigned long framelen = 0;
+    void *frame = scriba_serializeCompressed(&filter, &framelen);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(frame, framelen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+    free(frame);
+
+    // buffer of unknown schema version is rejected: the version is the 6th field
+    // of the root table, its offset is found in the vtable referred by the table
+    unsigned char *data = (unsigned char *)compact;
+    uint32_t root = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    int32_t vt = (int32_t)(data[root] | (data[root + 1] << 8) | (data[root + 2] << 16) |
+                           ((uint32_t)data[root + 3] << 24));
+    unsigned char *vtable = data + root - vt;
+    uint16_t version_offset = vtable[14] | (vtable[15] << 8);
+    CU_ASSERT_NOT_EQUAL(version_offset, 0);
+    CU_ASSERT_EQUAL(data[root + version_offset], 1);
+    data[root + version_offset] = 2;
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(compact, compact_len, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company1_id));
+    free(compact);
+
+    clean_local_db();
+}
+
+// test that import of unchanged entries does not write them
+void test_serializer_merge_stats()
+{
+    struct ScribaMergeStats stats;
+    scriba_sync_token_t token = 0;
+    scriba_sync_token_t new_token = 0;
+    unsigned long buflen = 0;
+    unsigned long delta_len = 0;
+
+    clean_local_db();
+    create_test_data();
+    void *buf = scriba_serializeAll(&buflen);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+
+    // import into empty database inserts everything
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.inserted, 8);
+    CU_ASSERT_EQUAL(stats.updated, 0);
+    CU_ASSERT_EQUAL(stats.skipped, 0);
+
+    // the same data is skipped and does not show up in changes
+    void *delta = scriba_serializeChangesSince(0, &token, &delta_len);
+    free(delta);
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.inserted, 0);
+    CU_ASSERT_EQUAL(stats.updated, 0);
+    CU_ASSERT_EQUAL(stats.skipped, 8);
+    delta = scriba_serializeChangesSince(token, &new_token, &delta_len);
+    CU_ASSERT_EQUAL(new_token, token);
+    free(delta);
+
+    // local modification makes the next import overwrite the entity
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    replace_string(&(company->name), "Modified company name");
+    scriba_updateCompany(company);
+    scriba_freeCompanyData(company);
+    struct ScribaProject *project = scriba_getProject(project2_id);
+    project->cost = 3000;
+    scriba_updateProject(project);
+    scriba_freeProjectData(project);
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.inserted, 0);
+    CU_ASSERT_EQUAL(stats.updated, 2);
+    CU_ASSERT_EQUAL(stats.skipped, 6);
+    verify_test_data();
+
+    // local data is kept by local override
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_LOCAL_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.updated, 0);
+    CU_ASSERT_EQUAL(stats.skipped, 8);
+    free(buf);
+
+    // remote modification is written
+    company = scriba_getCompany(company2_id);
+    replace_string(&(company->email), "remote@test2.com");
+    scriba_updateCompany(company);
+    buf = scriba_serializeAll(&buflen);
+    replace_string(&(company->email), "testcompany@test2.com");
+    scriba_updateCompany(company);
+    scriba_freeCompanyData(company);
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.updated, 0);
+    CU_ASSERT_EQUAL(stats.skipped, 8);
+    company = scriba_getCompany(company2_id);
+    CU_ASSERT_STRING_EQUAL(company->email, "remote@test2.com");
+    scriba_freeCompanyData(company);
+    free(buf);
+
+    clean_local_db();
+}
+
+// test reconciliation of two databases
+void test_serializer_reconcile()
+{
+    unsigned long buflen = 0;
+    scriba_id_t poc3_id;
+    scriba_id_t event3_id;
+
+    // enough companies to split their ranges
+    clean_local_db();
+    create_test_data();
+    for (int i = 0; i < 100; i++)
+    {
+        scriba_addCompany("Company", "Company LLC", "Address", "0000000000", "000", "c@test.com");
+    }
+    void *buf = scriba_serializeAll(&buflen);
+
+    // peer database is a copy with its own changes
+    open_test_db(TEST_PEER_DB_LOCATION);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    free(buf);
+    struct ScribaCompany *company = scriba_getCompany(company1_id);
+    replace_string(&(company->name), "Peer company name");
+    scriba_updateCompany(company);
+    scriba_freeCompanyData(company);
+    scriba_id_create(&poc3_id);
+    scriba_addPOCWithID(poc3_id, "Peer", "Peer", "Peer", "555", "5555",
+                        "peer@test.com", "peer moose", company2_id);
+    scriba_reconciler_t *peer = scriba_reconciler_create();
+    CU_ASSERT_PTR_NOT_NULL(peer);
+
+    open_test_db(TEST_DB_LOCATION);
+    struct ScribaProject *project = scriba_getProject(project2_id);
+    project->cost = 3000;
+    scriba_updateProject(project);
+    scriba_freeProjectData(project);
+    scriba_id_create(&event3_id);
+    scriba_addEventWithID(event3_id, "Test event3", company1_id, poc1_id, project1_id,
+                          EVENT_TYPE_MEETING, "done", (scriba_time_t)0, EVENT_STATE_COMPLETED);
+    scriba_reconciler_t *local = scriba_reconciler_create();
+    CU_ASSERT_PTR_NOT_NULL(local);
+
+    // the peer runs in a child process connected by socket
+    int fds[2];
+    CU_ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        int ret = scriba_reconcileOverFd(peer, fds[1], 0);
+        _exit(((ret == 0) && (scriba_reconciler_count(peer) == 3)) ? 0 : 1);
+    }
+    close(fds[1]);
+    CU_ASSERT_EQUAL(scriba_reconcileOverFd(local, fds[0], 1), 0);
+    close(fds[0]);
+    int child_status = 1;
+    waitpid(pid, &child_status, 0);
+    CU_ASSERT_TRUE(WIFEXITED(child_status) && (WEXITSTATUS(child_status) == 0));
+    // entities changed on one side are found by that side, entities changed on
+    // both sides (company1 and project2) are found by both
+    CU_ASSERT_EQUAL(scriba_reconciler_count(local), 3);
+
+    // the same result without transport
+    scriba_reconciler_free(local);
+    local = scriba_reconciler_create();
+    CU_ASSERT_TRUE(reconcile_local(local, peer) > 1);
+    CU_ASSERT_EQUAL(scriba_reconciler_count(local), 3);
+    CU_ASSERT_EQUAL(scriba_reconciler_count(peer), 3);
+
+    // only changed entities are exchanged, local data wins conflicts
+    void *local_buf = scriba_reconciler_serialize(local, &buflen);
+    open_test_db(TEST_PEER_DB_LOCATION);
+    unsigned long peer_buflen = 0;
+    void *peer_buf = scriba_reconciler_serialize(peer, &peer_buflen);
+    CU_ASSERT_EQUAL(scriba_deserialize(local_buf, buflen, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    struct ScribaMergeStats stats;
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.inserted, 1);
+    CU_ASSERT_EQUAL(stats.updated, 2);
+    scriba_free(local_buf);
+    scriba_reconciler_free(peer);
+    peer = scriba_reconciler_create();
+
+    open_test_db(TEST_DB_LOCATION);
+    CU_ASSERT_EQUAL(scriba_deserialize(peer_buf, peer_buflen, SCRIBA_MERGE_LOCAL_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    scriba_getMergeStats(&stats);
+    CU_ASSERT_EQUAL(stats.inserted, 1);
+    CU_ASSERT_EQUAL(stats.skipped, 2);
+    scriba_free(peer_buf);
+    company = scriba_getCompany(company1_id);
+    CU_ASSERT_STRING_EQUAL(company->name, "TestCompany1");
+    scriba_freeCompanyData(company);
+    struct ScribaPoc *poc3 = scriba_getPOC(poc3_id);
+    CU_ASSERT_PTR_NOT_NULL(poc3);
+    scriba_freePOCData(poc3);
+
+    // databases are the same now, the first message gets no reply
+    scriba_reconciler_free(local);
+    local = scriba_reconciler_create();
+    CU_ASSERT_EQUAL(reconcile_local(local, peer), 1);
+    CU_ASSERT_EQUAL(scriba_reconciler_count(local), 0);
+    CU_ASSERT_EQUAL(scriba_reconciler_count(peer), 0);
+
+    // malformed message is rejected
+    void *reply = NULL;
+    unsigned long replylen = 0;
+    unsigned char garbage[] = { 0xff, 0xff, 0xff, 0x7f };
+    CU_ASSERT_EQUAL(scriba_reconciler_process(local, garbage, sizeof (garbage), &reply, &replylen), -1);
+    // root table referring to vtable outside the message
+    unsigned char corrupted[64];
+    int32_t vtable_offset = -100000;
+    memset(corrupted, 0, sizeof (corrupted));
+    corrupted[0] = 8;
+    memcpy(corrupted + 8, &vtable_offset, sizeof (vtable_offset));
+    CU_ASSERT_EQUAL(scriba_reconciler_process(local, corrupted, sizeof (corrupted), &reply, &replylen), -1);
+    // truncated message
+    unsigned long msglen = 0;
+    void *msg = scriba_reconciler_start(peer, &msglen);
+    CU_ASSERT_PTR_NOT_NULL(msg);
+    CU_ASSERT_EQUAL(scriba_reconciler_process(local, msg, msglen / 2, &reply, &replylen), -1);
+    CU_ASSERT_PTR_NULL(reply);
+
+    // message received at 4-byte aligned address is processed the same way
+    CU_ASSERT_EQUAL(msglen % 8, 0);
+    uint64_t *misaligned = (uint64_t *)malloc(msglen + sizeof (uint64_t));
+    memcpy((char *)misaligned + 4, msg, msglen);
+    CU_ASSERT_EQUAL(scriba_reconciler_process(local, (char *)misaligned + 4, msglen, &reply, &replylen), 0);
+    CU_ASSERT_PTR_NULL(reply);
+    free(misaligned);
+    scriba_free(msg);
+
+    scriba_reconciler_free(local);
+    scriba_reconciler_free(peer);
+    unlink(TEST_PEER_DB_LOCATION);
+    clean_local_db();
+}
+
+// test import of serialized file mapped into memory
+void test_serializer_file()
+{
+    struct ScribaSerializeFilter filter;
+    unsigned long buflen = 0;
+
+    clean_local_db();
+    create_test_data();
+    CU_ASSERT_EQUAL(scriba_serializeToFile(NULL, TEST_EXPORT_LOCATION), 0);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+
+    // compact and compressed files
+    memset(&filter, 0, sizeof (filter));
+    filter.flags = SCRIBA_SERIALIZE_COMPACT;
+    CU_ASSERT_EQUAL(scriba_serializeToFile(&filter, TEST_EXPORT_LOCATION), 0);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+    void *frame = scriba_serializeCompressed(NULL, &buflen);
+    write_test_file(frame, buflen);
+    scriba_free(frame);
+    clean_local_db();
+    CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_OK);
+    verify_test_data();
+
+    // truncated file is rejected as a whole, whatever the cut; up to 7 last
+    // bytes may be alignment padding, which is not needed
+    unsigned long compact_len = 0;
+    void *compact = scriba_serializeFiltered(&filter, &compact_len);
+    void *buf = scriba_serializeAll(&buflen);
+    clean_local_db();
+    for (unsigned long len = 0; len + 8 <= buflen; len += 7)
+    {
+        write_test_file(buf, len);
+        CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                        SCRIBA_MERGE_FAILED);
+    }
+    // compact buffer holds vector of ids, which are structs
+    for (unsigned long len = 0; len + 8 <= compact_len; len += 7)
+    {
+        write_test_file(compact, len);
+        CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                        SCRIBA_MERGE_FAILED);
+    }
+    scriba_free(compact);
+    CU_ASSERT_PTR_NULL(scriba_getCompany(company1_id));
+
+    // offset pointing outside of the file
+    unsigned char *data = (unsigned char *)buf;
+    data[0] = 0xff;
+    data[1] = 0xff;
+    write_test_file(buf, buflen);
+    CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+    free(buf);
+
+    unlink(TEST_EXPORT_LOCATION);
+    CU_ASSERT_EQUAL(scriba_deserializeFile(TEST_EXPORT_LOCATION, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+    CU_ASSERT_EQUAL(scriba_deserializeFile(NULL, SCRIBA_MERGE_REMOTE_OVERRIDE),
+                    SCRIBA_MERGE_FAILED);
+
+    clean_local_db();
+}
+
+static void write_test_file(const void *data, unsigned long len)
+{
+    FILE *file = fopen(TEST_EXPORT_LOCATION, "wb");
+
+    CU_ASSERT_PTR_NOT_NULL(file);
+    if (file != NULL)
+    {
+        CU_ASSERT_EQUAL(fwrite(data, 1, len, file), len);
+        fclose(file);
+    }
+}
+
+static void open_test_db(const char *location)
+{
+    struct ScribaDB db;
+    db.name = SCRIBA_SQLITE_BACKEND_NAME;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam param;
+    param.key = SCRIBA_SQLITE_DB_LOCATION_PARAM;
+    param.value = (char *)location;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &param;
+    paramList.next = NULL;
+
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(scriba_init(&db, &paramList), SCRIBA_INIT_SUCCESS);
+}
+
+static int reconcile_local(scriba_reconciler_t *rec1, scriba_reconciler_t *rec2)
+{
+    unsigned long len = 0;
+    void *msg = scriba_reconciler_start(rec1, &len);
+    int num = 0;
+    scriba_reconciler_t *receiver = rec2;
+
+    while (msg != NULL)
+    {
+        void *reply = NULL;
+        CU_ASSERT_EQUAL(scriba_reconciler_process(receiver, msg, len, &reply, &len), 0);
+        scriba_free(msg);
+        msg = reply;
+        receiver = (receiver == rec1) ? rec2 : rec1;
+        num++;
+    }
+    return num;
+}
+
+static void replace_string(char **field, const char *value)
+{
+    size_t len = strlen(value);
+
+    free(*field);
+    *field = (char *)malloc(len + 1);
+    memcpy(*field, value, len + 1);
+}
+
 // populate local DB with test data
 static void create_test_data()
 {
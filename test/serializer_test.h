@@ -29,5 +29,19 @@ void test_serializer();
 void test_serializer_ru();
 void test_serializer_remote_override();
 void test_serializer_local_override();
+void test_serializer_subset();
+void test_serializer_all();
+void test_serializer_filtered();
+void test_serializer_output();
+void test_serializer_stream();
+void test_serializer_transaction();
+void test_serializer_parallel();
+void test_serializer_parallel_export();
+void test_serializer_changes();
+void test_serializer_compressed();
+void test_serializer_compact();
+void test_serializer_merge_stats();
+void test_serializer_reconcile();
+void test_serializer_file();
 
 #endif // SCRIBA_SERIALIZER_TEST_H
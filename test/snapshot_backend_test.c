@@ -0,0 +1,424 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "snapshot_backend_test.h"
+#include "snapshot_backend.h"
+#include "sqlite_backend.h"
+#include "scriba.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "serializer.h"
+#include "db_backend.h"
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_SNAPSHOT_DB_LOCATION "./snapshot_test_sqlite_db"
+#define TEST_SNAPSHOT_LOCATION "./snapshot_test_snapshot"
+#define TEST_SNAPSHOT_COMPANIES 3
+#define TEST_SNAPSHOT_QUERIES 31
+
+static scriba_id_t company_ids[TEST_SNAPSHOT_COMPANIES];
+static scriba_id_t poc_ids[TEST_SNAPSHOT_COMPANIES * 2];
+static scriba_id_t project_ids[TEST_SNAPSHOT_COMPANIES * 2];
+static scriba_id_t event_ids[TEST_SNAPSHOT_COMPANIES * 3];
+static scriba_time_t test_time = 0;
+
+static int init_backend(const char *name, const char *key, const char *value);
+static void fill_test_db();
+static void run_queries(scriba_list_t **results, int *ordered);
+static int lists_match(scriba_list_t *list1, scriba_list_t *list2, int ordered);
+static int list_count(scriba_list_t *list, const scriba_id_t *id, const char *text);
+
+int snapshot_backend_test_init()
+{
+    unlink(TEST_SNAPSHOT_DB_LOCATION);
+    unlink(TEST_SNAPSHOT_LOCATION);
+
+    // the snapshot is exported from SQLite database
+    if (init_backend(SCRIBA_SQLITE_BACKEND_NAME, SCRIBA_SQLITE_DB_LOCATION_PARAM,
+                     TEST_SNAPSHOT_DB_LOCATION) != SCRIBA_INIT_SUCCESS)
+    {
+        return 1;
+    }
+    fill_test_db();
+    int ret = scriba_snapshot_export(TEST_SNAPSHOT_LOCATION);
+    scriba_cleanup();
+    if (ret != 0)
+    {
+        return 1;
+    }
+
+    if (init_backend(SCRIBA_SNAPSHOT_BACKEND_NAME, SCRIBA_SNAPSHOT_LOCATION_PARAM,
+                     TEST_SNAPSHOT_LOCATION) != SCRIBA_INIT_SUCCESS)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int snapshot_backend_test_cleanup()
+{
+    scriba_cleanup();
+    unlink(TEST_SNAPSHOT_DB_LOCATION);
+    unlink(TEST_SNAPSHOT_LOCATION);
+
+    return 0;
+}
+
+// entities are returned the same way SQLite backend returns them
+void test_snapshot_get()
+{
+    struct ScribaCompany *company = scriba_getCompany(company_ids[0]);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT(scriba_id_compare(&(company->id), &(company_ids[0])));
+    CU_ASSERT_STRING_EQUAL(company->name, "Snapshot Company 0");
+    CU_ASSERT_STRING_EQUAL(company->jur_name, "Snapshot Company 0 LLC");
+    CU_ASSERT_STRING_EQUAL(company->address, "Main street 0");
+    CU_ASSERT_STRING_EQUAL(company->inn, "1234567890");
+    CU_ASSERT_STRING_EQUAL(company->phonenum, "555-0000");
+    // empty company fields are not stored
+    CU_ASSERT_PTR_NULL(company->email);
+    CU_ASSERT_EQUAL(list_count(company->poc_list, &(poc_ids[0]), "Ivan 0 Petrov"), 1);
+    CU_ASSERT_EQUAL(list_count(company->poc_list, &(poc_ids[1]), "Maria 0 Ivanova"), 1);
+    CU_ASSERT_EQUAL(list_count(company->proj_list, &(project_ids[0]), "Project 0"), 1);
+    CU_ASSERT_EQUAL(list_count(company->proj_list, &(project_ids[1]), "Project 1"), 1);
+    // upcoming event goes first, then past events closest to the current time first
+    scriba_list_t *item = company->event_list;
+    CU_ASSERT(scriba_id_compare(&(item->id), &(event_ids[2])));
+    item = item->next;
+    CU_ASSERT_PTR_NOT_NULL(item);
+    CU_ASSERT(scriba_id_compare(&(item->id), &(event_ids[0])));
+    item = item->next;
+    CU_ASSERT_PTR_NOT_NULL(item);
+    CU_ASSERT(scriba_id_compare(&(item->id), &(event_ids[1])));
+    CU_ASSERT_PTR_NULL(item->next);
+    scriba_freeCompanyData(company);
+
+    struct ScribaPoc *poc = scriba_getPOC(poc_ids[3]);
+    CU_ASSERT_PTR_NOT_NULL(poc);
+    CU_ASSERT_STRING_EQUAL(poc->firstname, "Maria");
+    CU_ASSERT_STRING_EQUAL(poc->secondname, "1");
+    CU_ASSERT_STRING_EQUAL(poc->lastname, "Ivanova");
+    CU_ASSERT_STRING_EQUAL(poc->mobilenum, "");
+    CU_ASSERT_STRING_EQUAL(poc->phonenum, "555-0103");
+    CU_ASSERT_STRING_EQUAL(poc->email, "maria1@example.com");
+    CU_ASSERT_STRING_EQUAL(poc->position, "Sales Manager");
+    CU_ASSERT(scriba_id_compare(&(poc->company_id), &(company_ids[1])));
+    scriba_freePOCData(poc);
+
+    struct ScribaProject *project = scriba_getProject(project_ids[5]);
+    CU_ASSERT_PTR_NOT_NULL(project);
+    CU_ASSERT_STRING_EQUAL(project->title, "Project 5");
+    CU_ASSERT_STRING_EQUAL(project->descr, "Description 5");
+    CU_ASSERT(scriba_id_compare(&(project->company_id), &(company_ids[2])));
+    CU_ASSERT_EQUAL(project->state, PROJECT_STATE_EXECUTION);
+    CU_ASSERT_EQUAL(project->currency, SCRIBA_CURRENCY_EUR);
+    CU_ASSERT_EQUAL(project->cost, 5000);
+    CU_ASSERT_EQUAL(project->start_time, test_time - 5000);
+    scriba_freeProjectData(project);
+
+    struct ScribaEvent *event = scriba_getEvent(event_ids[4]);
+    CU_ASSERT_PTR_NOT_NULL(event);
+    CU_ASSERT_STRING_EQUAL(event->descr, "Event 4");
+    CU_ASSERT(scriba_id_compare(&(event->company_id), &(company_ids[1])));
+    CU_ASSERT(scriba_id_compare(&(event->poc_id), &(poc_ids[2])));
+    CU_ASSERT(scriba_id_compare(&(event->project_id), &(project_ids[2])));
+    CU_ASSERT_EQUAL(event->type, EVENT_TYPE_CALL);
+    CU_ASSERT_STRING_EQUAL(event->outcome, "Outcome 4");
+    CU_ASSERT_EQUAL(event->timestamp, test_time - 45000);
+    CU_ASSERT_EQUAL(event->state, EVENT_STATE_CANCELLED);
+    scriba_freeEventData(event);
+
+    // batch retrieval reports missing entities
+    scriba_id_t missing;
+    scriba_id_create(&missing);
+    scriba_id_t ids[3] = { event_ids[8], missing, event_ids[0] };
+    struct ScribaEvent *events[3];
+    CU_ASSERT_EQUAL(scriba_getEvents(ids, 3, events), 2);
+    CU_ASSERT_PTR_NOT_NULL(events[0]);
+    CU_ASSERT(scriba_id_compare(&(events[0]->id), &(event_ids[8])));
+    CU_ASSERT_PTR_NULL(events[1]);
+    CU_ASSERT_PTR_NOT_NULL(events[2]);
+    CU_ASSERT(scriba_id_compare(&(events[2]->id), &(event_ids[0])));
+    scriba_freeEventData(events[0]);
+    scriba_freeEventData(events[2]);
+
+    CU_ASSERT_PTR_NULL(scriba_getCompany(missing));
+    CU_ASSERT_PTR_NULL(scriba_getPOC(missing));
+}
+
+// searches return the same results as SQLite backend
+void test_snapshot_search()
+{
+    scriba_list_t *snapshot_results[TEST_SNAPSHOT_QUERIES];
+    scriba_list_t *sqlite_results[TEST_SNAPSHOT_QUERIES];
+    int ordered[TEST_SNAPSHOT_QUERIES];
+
+    run_queries(snapshot_results, ordered);
+
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(init_backend(SCRIBA_SQLITE_BACKEND_NAME, SCRIBA_SQLITE_DB_LOCATION_PARAM,
+                                 TEST_SNAPSHOT_DB_LOCATION), SCRIBA_INIT_SUCCESS);
+    run_queries(sqlite_results, ordered);
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(init_backend(SCRIBA_SNAPSHOT_BACKEND_NAME, SCRIBA_SNAPSHOT_LOCATION_PARAM,
+                                 TEST_SNAPSHOT_LOCATION), SCRIBA_INIT_SUCCESS);
+
+    for (int i = 0; i < TEST_SNAPSHOT_QUERIES; i++)
+    {
+        CU_ASSERT(lists_match(snapshot_results[i], sqlite_results[i], ordered[i]));
+        scriba_list_delete(snapshot_results[i]);
+        scriba_list_delete(sqlite_results[i]);
+    }
+}
+
+// changes are ignored and data can be exported from the snapshot
+void test_snapshot_read_only()
+{
+    scriba_id_t id;
+    unsigned long len = 0;
+
+    scriba_id_create(&id);
+    scriba_addCompanyWithID(id, "New company", "", "", "", "", "");
+    CU_ASSERT_PTR_NULL(scriba_getCompany(id));
+    scriba_removeCompany(company_ids[0]);
+    struct ScribaCompany *company = scriba_getCompany(company_ids[0]);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_EQUAL(scriba_upsertCompany(company, 1), -1);
+    scriba_freeCompanyData(company);
+    CU_ASSERT_NOT_EQUAL(scriba_beginWrite(), 0);
+
+    // serializer scans the mapped snapshot
+    void *buf = scriba_serializeAll(&len);
+    CU_ASSERT_PTR_NOT_NULL(buf);
+    CU_ASSERT_EQUAL(scriba_deserialize(buf, len, SCRIBA_MERGE_REMOTE_OVERRIDE), SCRIBA_MERGE_FAILED);
+    scriba_free(buf);
+
+    // snapshot of the snapshot holds the same data
+    CU_ASSERT_EQUAL(scriba_snapshot_export(TEST_SNAPSHOT_LOCATION), 0);
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(init_backend(SCRIBA_SNAPSHOT_BACKEND_NAME, SCRIBA_SNAPSHOT_LOCATION_PARAM,
+                                 TEST_SNAPSHOT_LOCATION), SCRIBA_INIT_SUCCESS);
+    scriba_list_t *people = scriba_getAllPeople();
+    int num = 0;
+    scriba_list_for_each(people, item)
+    {
+        num++;
+    }
+    CU_ASSERT_EQUAL(num, TEST_SNAPSHOT_COMPANIES * 2);
+    scriba_list_delete(people);
+
+    // files that are not snapshots are rejected
+    scriba_cleanup();
+    CU_ASSERT_NOT_EQUAL(init_backend(SCRIBA_SNAPSHOT_BACKEND_NAME, SCRIBA_SNAPSHOT_LOCATION_PARAM,
+                                     TEST_SNAPSHOT_DB_LOCATION), SCRIBA_INIT_SUCCESS);
+    scriba_cleanup();
+    CU_ASSERT_EQUAL(init_backend(SCRIBA_SNAPSHOT_BACKEND_NAME, SCRIBA_SNAPSHOT_LOCATION_PARAM,
+                                 TEST_SNAPSHOT_LOCATION), SCRIBA_INIT_SUCCESS);
+}
+
+static int init_backend(const char *name, const char *key, const char *value)
+{
+    struct ScribaDB db;
+    db.name = (char *)name;
+    db.type = SCRIBA_DB_BUILTIN;
+    db.location = NULL;
+
+    struct ScribaDBParam param;
+    param.key = (char *)key;
+    param.value = (char *)value;
+
+    struct ScribaDBParamList paramList;
+    paramList.param = &param;
+    paramList.next = NULL;
+
+    return scriba_init(&db, &paramList);
+}
+
+static void fill_test_db()
+{
+    char text[6][64];
+
+    test_time = (scriba_time_t)time(NULL);
+
+    for (int i = 0; i < TEST_SNAPSHOT_COMPANIES; i++)
+    {
+        scriba_id_create(&(company_ids[i]));
+        snprintf(text[0], sizeof (text[0]), "Snapshot Company %d", i);
+        snprintf(text[1], sizeof (text[1]), "Snapshot Company %d LLC", i);
+        snprintf(text[2], sizeof (text[2]), "Main street %d", i);
+        snprintf(text[3], sizeof (text[3]), "555-000%d", i);
+        scriba_addCompanyWithID(company_ids[i], text[0], text[1], text[2], "1234567890",
+                                text[3], "");
+    }
+
+    for (int i = 0; i < TEST_SNAPSHOT_COMPANIES * 2; i++)
+    {
+        scriba_id_create(&(poc_ids[i]));
+        snprintf(text[0], sizeof (text[0]), "%d", i / 2);
+        snprintf(text[1], sizeof (text[1]), "555-010%d", i);
+        snprintf(text[2], sizeof (text[2]), "%s%d@example.com", (i % 2) ? "maria" : "ivan", i / 2);
+        scriba_addPOCWithID(poc_ids[i], (i % 2) ? "Maria" : "Ivan", text[0],
+                            (i % 2) ? "Ivanova" : "Petrov", "", text[1], text[2],
+                            (i % 2) ? "Sales Manager" : "Director", company_ids[i / 2]);
+    }
+
+    for (int i = 0; i < TEST_SNAPSHOT_COMPANIES * 2; i++)
+    {
+        scriba_id_create(&(project_ids[i]));
+        snprintf(text[0], sizeof (text[0]), "Project %d", i);
+        snprintf(text[1], sizeof (text[1]), "Description %d", i);
+        scriba_addProjectWithID(project_ids[i], text[0], text[1], company_ids[i / 2],
+                                (enum ScribaProjectState)(i + 1),
+                                (enum ScribaCurrency)(i % 3), i * 1000,
+                                test_time - i * 1000);
+    }
+
+    // each company has two past events and one upcoming event, all of them
+    // at different distances from the current time
+    for (int i = 0; i < TEST_SNAPSHOT_COMPANIES * 3; i++)
+    {
+        scriba_time_t timestamp = (i % 3 == 2) ? test_time + (i + 1) * 10000 :
+                                                 test_time - (i + 1) * 10000 + (i % 3) * 5000;
+        scriba_id_create(&(event_ids[i]));
+        snprintf(text[0], sizeof (text[0]), "Event %d", i);
+        snprintf(text[1], sizeof (text[1]), "Outcome %d", i);
+        scriba_addEventWithID(event_ids[i], text[0], company_ids[i / 3], poc_ids[(i / 3) * 2],
+                              project_ids[(i / 3) * 2], (enum ScribaEventType)(i % 3), text[1],
+                              timestamp, (enum ScribaEventState)((i + 1) % 3));
+    }
+}
+
+static void run_queries(scriba_list_t **results, int *ordered)
+{
+    int n = 0;
+
+    memset(ordered, 0, TEST_SNAPSHOT_QUERIES * sizeof (int));
+
+    results[n++] = scriba_getAllCompanies();
+    results[n++] = scriba_getCompaniesByName("company");
+    results[n++] = scriba_getCompaniesByName("COMPANY 1");
+    results[n++] = scriba_getCompaniesByJurName("llc");
+    results[n++] = scriba_getCompaniesByAddress("street 2");
+    results[n++] = scriba_getAllPeople();
+    results[n++] = scriba_getPOCByName("ivan");
+    results[n++] = scriba_getPOCByName("1");
+    results[n++] = scriba_getPOCByCompany(company_ids[1]);
+    results[n++] = scriba_getPOCByPosition("manager");
+    results[n++] = scriba_getPOCByPhoneNum("555-0104");
+    results[n++] = scriba_getPOCByPhoneNum("0104");
+    results[n++] = scriba_getPOCByEmail("@EXAMPLE");
+    results[n++] = scriba_getAllProjects();
+    results[n++] = scriba_getProjectsByTitle("project");
+    results[n++] = scriba_getProjectsByCompany(company_ids[2]);
+    results[n++] = scriba_getProjectsByState(PROJECT_STATE_OFFER);
+    results[n++] = scriba_getProjectsByTime(test_time - 2500, SCRIBA_TIME_BEFORE, 0, SCRIBA_TIME_IGNORE);
+    results[n++] = scriba_getProjectsByTime(test_time - 2500, SCRIBA_TIME_AFTER, 0, SCRIBA_TIME_AFTER);
+    results[n++] = scriba_getProjectsByTime(0, SCRIBA_TIME_IGNORE, 0, SCRIBA_TIME_IGNORE);
+    results[n++] = scriba_getProjectsByStateTime(PROJECT_STATE_EXECUTION, test_time - 2500,
+                                                 SCRIBA_TIME_BEFORE, 0, SCRIBA_TIME_IGNORE);
+    results[n++] = scriba_getProjectsByStateTime(PROJECT_STATE_CLIENT_INFORMED, 0,
+                                                 SCRIBA_TIME_IGNORE, 0, SCRIBA_TIME_IGNORE);
+    // events are ordered by time
+    for (int i = n; i < TEST_SNAPSHOT_QUERIES; i++)
+    {
+        ordered[i] = 1;
+    }
+    results[n++] = scriba_getAllEvents();
+    results[n++] = scriba_getEventsByDescr("EVENT");
+    results[n++] = scriba_getEventsByDescr("5");
+    results[n++] = scriba_getEventsByCompany(company_ids[1]);
+    results[n++] = scriba_getEventsByPOC(poc_ids[4]);
+    results[n++] = scriba_getEventsByPOC(poc_ids[5]);
+    results[n++] = scriba_getEventsByProject(project_ids[0]);
+    results[n++] = scriba_getEventsByState(EVENT_STATE_SCHEDULED);
+    results[n++] = scriba_getEventsByState(EVENT_STATE_CANCELLED);
+
+    CU_ASSERT_EQUAL(n, TEST_SNAPSHOT_QUERIES);
+}
+
+// lists match if they have the same items, in the same order if ordered is set
+static int lists_match(scriba_list_t *list1, scriba_list_t *list2, int ordered)
+{
+    int num1 = 0;
+    int num2 = 0;
+
+    scriba_list_for_each(list1, item)
+    {
+        num1++;
+    }
+    scriba_list_for_each(list2, item)
+    {
+        num2++;
+    }
+    if (num1 != num2)
+    {
+        return 0;
+    }
+
+    if (ordered)
+    {
+        scriba_list_t *item2 = list2;
+        scriba_list_for_each(list1, item1)
+        {
+            if (!scriba_id_compare(&(item1->id), &(item2->id)))
+            {
+                return 0;
+            }
+            item2 = item2->next;
+        }
+        return 1;
+    }
+
+    scriba_list_for_each(list1, item)
+    {
+        if (list_count(list1, &(item->id), item->text) != list_count(list2, &(item->id), item->text))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// number of list items with the given id and text
+static int list_count(scriba_list_t *list, const scriba_id_t *id, const char *text)
+{
+    int num = 0;
+
+    scriba_list_for_each(list, item)
+    {
+        if (!scriba_id_compare(&(item->id), id))
+        {
+            continue;
+        }
+        if ((item->text == NULL) ? (text == NULL) : ((text != NULL) && (strcmp(item->text, text) == 0)))
+        {
+            num++;
+        }
+    }
+    return num;
+}
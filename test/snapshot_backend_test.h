@@ -0,0 +1,33 @@
+/* 
+ * Copyright (C) 2014 Mikhail Sapozhnikov
+ *
+ * This file is part of libscriba.
+ *
+ * libscriba is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libscriba is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libscriba. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIBA_SNAPSHOT_BACKEND_TEST_H
+#define SCRIBA_SNAPSHOT_BACKEND_TEST_H
+
+#define SNAPSHOT_BACKEND_TEST_NAME "Snapshot backend test"
+
+int snapshot_backend_test_init();
+int snapshot_backend_test_cleanup();
+
+void test_snapshot_get();
+void test_snapshot_search();
+void test_snapshot_read_only();
+
+#endif // SCRIBA_SNAPSHOT_BACKEND_TEST_H
@@ -21,6 +21,13 @@
 #include "sqlite_backend_test.h"
 #include "sqlite_backend.h"
 #include "scriba.h"
+#include "common_test.h"
+#include "company.h"
+#include "poc.h"
+#include "project.h"
+#include "event.h"
+#include "arena.h"
+#include <CUnit/CUnit.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -58,3 +65,117 @@ int sqlite_backend_test_cleanup()
 
     return 0;
 }
+
+// check that entities are correctly returned with every memory layout
+void test_entity_layout()
+{
+    scriba_id_t company_id;
+    scriba_id_t poc_id;
+    scriba_id_t project_id;
+    scriba_id_t event_id;
+    scriba_arena_t *arena = NULL;
+
+    scriba_id_create(&company_id);
+    scriba_id_create(&poc_id);
+    scriba_id_create(&project_id);
+    scriba_id_create(&event_id);
+
+    scriba_addCompanyWithID(company_id, "Layout company", "Layout LLC", "",
+                            "123", "555", "layout@test.com");
+    scriba_addPOCWithID(poc_id, "Mister", "Layout", "Tester", "1234", "5678",
+                        "mister@test.com", "tester", company_id);
+    scriba_addProjectWithID(project_id, "Layout project", "Project description",
+                            company_id, PROJECT_STATE_OFFER, SCRIBA_CURRENCY_RUB,
+                            1000, 0);
+    scriba_addEventWithID(event_id, "Layout event", company_id, poc_id, project_id,
+                          EVENT_TYPE_MEETING, "Outcome", 1, EVENT_STATE_COMPLETED);
+
+    arena = scriba_arena_create(256);
+    CU_ASSERT_PTR_NOT_NULL(arena);
+
+    // arena layout requires an arena, layout remains unchanged
+    scriba_setEntityLayout(SCRIBA_LAYOUT_ARENA, NULL);
+    struct ScribaCompany *company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_EQUAL(company->layout, SCRIBA_LAYOUT_SEPARATE);
+    scriba_freeCompanyData(company);
+
+    for (int layout = SCRIBA_LAYOUT_BLOCK; layout <= SCRIBA_LAYOUT_ARENA; layout++)
+    {
+        scriba_setEntityLayout((enum ScribaEntityLayout)layout, arena);
+
+        struct ScribaCompany *company = scriba_getCompany(company_id);
+        CU_ASSERT_PTR_NOT_NULL(company);
+        CU_ASSERT_EQUAL(company->layout, layout);
+        CU_ASSERT(scriba_id_compare(&(company->id), &company_id));
+        CU_ASSERT_STRING_EQUAL(company->name, "Layout company");
+        CU_ASSERT_STRING_EQUAL(company->jur_name, "Layout LLC");
+        CU_ASSERT_PTR_NULL(company->address);
+        CU_ASSERT_STRING_EQUAL(company->inn, "123");
+        CU_ASSERT_STRING_EQUAL(company->phonenum, "555");
+        CU_ASSERT_STRING_EQUAL(company->email, "layout@test.com");
+        CU_ASSERT_FALSE(scriba_list_is_empty(company->poc_list));
+        CU_ASSERT_FALSE(scriba_list_is_empty(company->proj_list));
+        CU_ASSERT_FALSE(scriba_list_is_empty(company->event_list));
+
+        struct ScribaCompany *company_copy = scriba_copyCompany(company);
+        CU_ASSERT_PTR_NOT_NULL(company_copy);
+        CU_ASSERT_EQUAL(company_copy->layout, layout);
+        CU_ASSERT_STRING_EQUAL(company_copy->name, "Layout company");
+        CU_ASSERT_STRING_EQUAL(company_copy->email, "layout@test.com");
+        scriba_freeCompanyData(company_copy);
+        scriba_freeCompanyData(company);
+
+        struct ScribaPoc *poc = scriba_getPOC(poc_id);
+        CU_ASSERT_PTR_NOT_NULL(poc);
+        CU_ASSERT_EQUAL(poc->layout, layout);
+        CU_ASSERT_STRING_EQUAL(poc->firstname, "Mister");
+        CU_ASSERT_STRING_EQUAL(poc->secondname, "Layout");
+        CU_ASSERT_STRING_EQUAL(poc->lastname, "Tester");
+        CU_ASSERT_STRING_EQUAL(poc->mobilenum, "1234");
+        CU_ASSERT_STRING_EQUAL(poc->phonenum, "5678");
+        CU_ASSERT_STRING_EQUAL(poc->email, "mister@test.com");
+        CU_ASSERT_STRING_EQUAL(poc->position, "tester");
+        CU_ASSERT(scriba_id_compare(&(poc->company_id), &company_id));
+        struct ScribaPoc *poc_copy = scriba_copyPOC(poc);
+        CU_ASSERT_PTR_NOT_NULL(poc_copy);
+        CU_ASSERT_STRING_EQUAL(poc_copy->position, "tester");
+        scriba_freePOCData(poc_copy);
+        scriba_freePOCData(poc);
+
+        struct ScribaProject *project = scriba_getProject(project_id);
+        CU_ASSERT_PTR_NOT_NULL(project);
+        CU_ASSERT_EQUAL(project->layout, layout);
+        CU_ASSERT_STRING_EQUAL(project->title, "Layout project");
+        CU_ASSERT_STRING_EQUAL(project->descr, "Project description");
+        CU_ASSERT_EQUAL(project->cost, 1000);
+        struct ScribaProject *project_copy = scriba_copyProject(project);
+        CU_ASSERT_PTR_NOT_NULL(project_copy);
+        CU_ASSERT_STRING_EQUAL(project_copy->descr, "Project description");
+        scriba_freeProjectData(project_copy);
+        scriba_freeProjectData(project);
+
+        struct ScribaEvent *event = scriba_getEvent(event_id);
+        CU_ASSERT_PTR_NOT_NULL(event);
+        CU_ASSERT_EQUAL(event->layout, layout);
+        CU_ASSERT_STRING_EQUAL(event->descr, "Layout event");
+        CU_ASSERT_STRING_EQUAL(event->outcome, "Outcome");
+        CU_ASSERT_EQUAL(event->state, EVENT_STATE_COMPLETED);
+        struct ScribaEvent *event_copy = scriba_copyEvent(event);
+        CU_ASSERT_PTR_NOT_NULL(event_copy);
+        CU_ASSERT_STRING_EQUAL(event_copy->outcome, "Outcome");
+        scriba_freeEventData(event_copy);
+        scriba_freeEventData(event);
+
+        scriba_arena_reset(arena);
+    }
+
+    // destroying the entity arena switches the library back to separate layout
+    scriba_arena_destroy(arena);
+    company = scriba_getCompany(company_id);
+    CU_ASSERT_PTR_NOT_NULL(company);
+    CU_ASSERT_EQUAL(company->layout, SCRIBA_LAYOUT_SEPARATE);
+    scriba_freeCompanyData(company);
+
+    clean_local_db();
+}
@@ -26,4 +26,6 @@
 int sqlite_backend_test_init();
 int sqlite_backend_test_cleanup();
 
+void test_entity_layout();
+
 #endif // SCRIBA_SQLITE_BACKEND_TEST_H
@@ -29,12 +29,86 @@
 
 #define PROCFS_UUID_STR_LENGTH 38
 
+// library allocator
+static struct
+{
+    scriba_malloc_fn malloc_fn;
+    scriba_realloc_fn realloc_fn;
+    scriba_free_fn free_fn;
+    void *ctx;
+} allocator = { NULL, NULL, NULL, NULL };
+
 
 
 static void scriba_id_remove_extra_symbols(const char *in, char *out);
 
 
 
+/* memory allocation routines */
+
+// set library allocator
+void scriba_set_allocator(scriba_malloc_fn malloc_fn, scriba_realloc_fn realloc_fn,
+                          scriba_free_fn free_fn, void *ctx)
+{
+    // partially specified allocator is not allowed
+    if ((malloc_fn == NULL) || (realloc_fn == NULL) || (free_fn == NULL))
+    {
+        malloc_fn = NULL;
+        realloc_fn = NULL;
+        free_fn = NULL;
+        ctx = NULL;
+    }
+
+    allocator.malloc_fn = malloc_fn;
+    allocator.realloc_fn = realloc_fn;
+    allocator.free_fn = free_fn;
+    allocator.ctx = ctx;
+}
+
+// check whether custom allocator is set
+int scriba_has_custom_allocator()
+{
+    return (allocator.malloc_fn != NULL);
+}
+
+// allocate memory
+void *scriba_malloc(size_t size)
+{
+    if (allocator.malloc_fn != NULL)
+    {
+        return allocator.malloc_fn(size, allocator.ctx);
+    }
+    return malloc(size);
+}
+
+// reallocate memory
+void *scriba_realloc(void *ptr, size_t size)
+{
+    if (allocator.realloc_fn != NULL)
+    {
+        return allocator.realloc_fn(ptr, size, allocator.ctx);
+    }
+    return realloc(ptr, size);
+}
+
+// free memory
+void scriba_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (allocator.free_fn != NULL)
+    {
+        allocator.free_fn(ptr, allocator.ctx);
+        return;
+    }
+    free(ptr);
+}
+
+
+
 /* scriba id type handling routines */
 
 static void scriba_id_remove_extra_symbols(const char *in, char *out)
@@ -120,7 +194,7 @@ char *scriba_id_to_string(const scriba_id_t *id)
         return NULL;
     }
 
-    char *str = (char *)malloc(33); // 32 symbols for 128-bit UUID
+    char *str = (char *)scriba_malloc(33); // 32 symbols for 128-bit UUID
     memset((void *)str, 0, 33);
     snprintf(str, 33, "%llx%llx",  id->_high, id->_low);
 
@@ -161,7 +235,7 @@ void *scriba_id_to_blob(const scriba_id_t *id)
         return NULL;
     }
 
-    unsigned char *blob = (unsigned char *)malloc(SCRIBA_ID_BLOB_SIZE);
+    unsigned char *blob = (unsigned char *)scriba_malloc(SCRIBA_ID_BLOB_SIZE);
 
     // low part
     for (int i = 0; i < 8; i++)
@@ -218,7 +292,7 @@ void scriba_id_copy(scriba_id_t *dest, const scriba_id_t *src)
 // init new list
 scriba_list_t *scriba_list_init()
 {
-    scriba_list_t *new_list = (scriba_list_t *)malloc(sizeof (scriba_list_t));
+    scriba_list_t *new_list = (scriba_list_t *)scriba_malloc(sizeof (scriba_list_t));
     scriba_id_zero_init(&(new_list->id));
     new_list->text = NULL;
     new_list->next = NULL;
@@ -235,7 +309,7 @@ void scriba_list_add(scriba_list_t *head, scriba_id_t id, char *text)
         if (text != NULL)
         {
             int len = strlen(text);
-            new_text = (char *)malloc(len + 1);
+            new_text = (char *)scriba_malloc(len + 1);
             strcpy(new_text, text);
             new_text[len] = 0;
         }
@@ -250,7 +324,7 @@ void scriba_list_add(scriba_list_t *head, scriba_id_t id, char *text)
         else
         {
             // head is not empty, create new node
-            scriba_list_t *new_item = (scriba_list_t *)malloc(sizeof (scriba_list_t));
+            scriba_list_t *new_item = (scriba_list_t *)scriba_malloc(sizeof (scriba_list_t));
             memset((void *)new_item, 0, sizeof (scriba_list_t));
             scriba_id_copy(&(new_item->id), &id);
             new_item->text = new_text;
@@ -275,9 +349,9 @@ void scriba_list_delete(scriba_list_t *head)
 
         if (item->text != NULL)
         {
-            free(item->text);
+            scriba_free(item->text);
         }
-        free(item);
+        scriba_free(item);
     }
 }
 